@@ -0,0 +1,144 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+// Compares generic s_serialize/s_deserialize/s_to_json with codecs generated
+// by sss-gen for the same schema (see gen_schema.h).
+
+#include "gen_schema.h"
+#include "gen_schemas.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define N_ITERATIONS (200000)
+#define N_WAYPOINTS (8)
+
+static void* bench_allocate(size_t size, void* user_data) {
+    (void) user_data;
+    return malloc(size);
+}
+
+static void bench_deallocate(void* data, void* user_data) {
+    (void) user_data;
+    free(data);
+}
+
+static s_allocator bench_allocator = {.allocate = bench_allocate,
+                                      .deallocate = bench_deallocate};
+
+static double now_ns(void) {
+    struct timespec ts;
+
+    timespec_get(&ts, TIME_UTC);
+
+    return (double) ts.tv_sec * 1e9 + (double) ts.tv_nsec;
+}
+
+static void report(const char* op, double generic_ns, double generated_ns) {
+    printf("%-8s generic %8.1f ns/op, generated %8.1f ns/op, x%.2f\n", op,
+           generic_ns / N_ITERATIONS, generated_ns / N_ITERATIONS,
+           generic_ns / generated_ns);
+}
+
+int main() {
+    Vec3 waypoints[N_WAYPOINTS];
+    Entity entity = {.id = 1234567890123ULL,
+                     .name = "probe",
+                     .description = "long range survey probe",
+                     .active = true,
+                     .level = -3,
+                     .position = {1.0, 2.0, 3.0},
+                     .n_scores = 12,
+                     .n_waypoints = N_WAYPOINTS,
+                     .waypoints = waypoints};
+
+    for (int i = 0; i < entity.n_scores; i++)
+        entity.scores[i] = (float) i * 0.5f;
+
+    for (int i = 0; i < N_WAYPOINTS; i++)
+        waypoints[i] = (Vec3) {i, i * 2.0, i * 3.0};
+
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(Entity);
+    s_serialize_options opts = {0};
+    s_deserialize_options d_opts = {.format = FORMAT_C_STRUCT,
+                                    .allocator = &bench_allocator};
+    uint8_t buffer[1024], generated_buffer[1024];
+    char json[4096], generated_json[4096];
+    size_t size = 0, generated_size = 0;
+    double start, generic_ns, generated_ns;
+
+    // output has to be the same
+    if (s_serialize(opts, info, &entity, buffer, sizeof(buffer), &size) !=
+            SERIALIZER_OK ||
+        gen_schemas_encode_Entity(&entity, generated_buffer,
+                                  sizeof(generated_buffer),
+                                  &generated_size) != SERIALIZER_OK ||
+        size != generated_size || memcmp(buffer, generated_buffer, size)) {
+        printf("encoded output differs\n");
+        return 1;
+    }
+
+    if (s_to_json(d_opts, info, &entity, json, sizeof(json)) !=
+            SERIALIZER_OK ||
+        gen_schemas_to_json_Entity(d_opts, &entity, generated_json,
+                                   sizeof(generated_json)) != SERIALIZER_OK ||
+        strcmp(json, generated_json)) {
+        printf("json output differs\n");
+        return 1;
+    }
+
+    printf("Entity: %zu bytes encoded, %zu bytes json\n", size, strlen(json));
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++)
+        s_serialize(opts, info, &entity, buffer, sizeof(buffer), &size);
+    generic_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++)
+        gen_schemas_encode_Entity(&entity, buffer, sizeof(buffer), &size);
+    generated_ns = now_ns() - start;
+
+    report("encode", generic_ns, generated_ns);
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++) {
+        Entity decoded = {0};
+
+        s_deserialize(d_opts, info, &decoded, buffer, size);
+        gen_schemas_free_Entity(&decoded, &bench_allocator, NULL);
+    }
+    generic_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++) {
+        Entity decoded = {0};
+
+        gen_schemas_decode_Entity(&decoded, buffer, size, &bench_allocator,
+                                  NULL);
+        gen_schemas_free_Entity(&decoded, &bench_allocator, NULL);
+    }
+    generated_ns = now_ns() - start;
+
+    report("decode", generic_ns, generated_ns);
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++)
+        s_to_json(d_opts, info, &entity, json, sizeof(json));
+    generic_ns = now_ns() - start;
+
+    start = now_ns();
+    for (int i = 0; i < N_ITERATIONS; i++)
+        gen_schemas_to_json_Entity(d_opts, &entity, json, sizeof(json));
+    generated_ns = now_ns() - start;
+
+    report("to_json", generic_ns, generated_ns);
+
+    return 0;
+}
@@ -0,0 +1,28 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "gen_schema.h"
+
+S_SERIALIZE_BEGIN(Vec3)
+S_FIELD_DOUBLE(x)
+S_FIELD_DOUBLE(y)
+S_FIELD_DOUBLE(z)
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(Entity)
+S_FIELD_UINT64(id, "Id")
+S_FIELD_STRING_FIXED(name)
+S_FIELD_STRING(description)
+S_FIELD_BOOL(active)
+S_FIELD_INT32(level)
+S_FIELD_STRUCT(position, Vec3)
+S_FIELD_INT32(n_scores)
+S_FIELD_ARRAY_STATIC(scores, n_scores)
+S_BUILTIN_ARRAY_FIELD_SET_FLOAT(scores)
+S_FIELD_INT32(n_waypoints)
+S_FIELD_STRUCT_ARRAY_DYNAMIC(waypoints, n_waypoints, Vec3)
+S_SERIALIZE_END()
@@ -0,0 +1,37 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __GEN_SCHEMA_H__
+#define __GEN_SCHEMA_H__
+
+#include "sss/sss.h"
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef struct {
+    double x;
+    double y;
+    double z;
+} Vec3;
+S_DEFINE_TYPE_INFO(Vec3);
+
+typedef struct {
+    uint64_t id;
+    char name[32];
+    char* description;
+    bool active;
+    int32_t level;
+    Vec3 position;
+    int32_t n_scores;
+    float scores[16];
+    int32_t n_waypoints;
+    Vec3* waypoints;
+} Entity;
+S_DEFINE_TYPE_INFO(Entity);
+
+#endif
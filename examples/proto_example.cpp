@@ -1,4 +1,4 @@
-#include "sss/sss.h"
+#include "sss/sss.hpp"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -45,37 +45,45 @@ typedef struct {
     } data;
 } protocol;
 
-S_SERIALIZE_BEGIN(response)
-S_FIELD_ENUM(status)
-S_FIELD_STRING(data)
-S_SERIALIZE_END()
-
-S_SERIALIZE_BEGIN(candidate)
-S_FIELD_STRING(identifier)
-S_FIELD_INT32(index)
-S_FIELD_STRING(value)
-S_SERIALIZE_END()
-
-S_SERIALIZE_BEGIN(description)
-S_FIELD_ENUM(format)
-S_FIELD_STRING(content)
-S_SERIALIZE_END()
-
-S_SERIALIZE_BEGIN(protocol)
-S_FIELD_ENUM(type)
-
-S_UNION_BEGIN_TAG(data, type)
-S_FIELD_STRUCT(data.r, response, "response")
-S_FIELD_TAGGED_INT(data.r, RESPONSE)
+template <>
+struct sss::schema<response> {
+    static constexpr const char* name = "response";
+    static constexpr auto fields =
+        sss::fields(sss::field<&response::status>("status"),
+                    sss::field<&response::data>("data"));
+};
 
-S_FIELD_STRUCT(data.c, candidate, "candidate")
-S_FIELD_TAGGED_INT(data.c, CANDIDATE)
+template <>
+struct sss::schema<candidate> {
+    static constexpr const char* name = "candidate";
+    static constexpr auto fields =
+        sss::fields(sss::field<&candidate::identifier>("identifier"),
+                    sss::field<&candidate::index>("index"),
+                    sss::field<&candidate::value>("value"));
+};
 
-S_FIELD_STRUCT(data.d, description, "description")
-S_FIELD_TAGGED_INT(data.d, DESCRIPTION)
-S_UNION_END()
+template <>
+struct sss::schema<description> {
+    static constexpr const char* name = "description";
+    static constexpr auto fields =
+        sss::fields(sss::field<&description::format>("format"),
+                    sss::field<&description::content>("content"));
+};
 
-S_SERIALIZE_END()
+using protocol_data = decltype(protocol::data);
+
+template <>
+struct sss::schema<protocol> {
+    static constexpr const char* name = "protocol";
+    static constexpr auto fields = sss::fields(
+        sss::field<&protocol::type>("type"),
+        sss::tagged<&protocol::type, RESPONSE, &protocol::data,
+                    &protocol_data::r>("data.r", "response"),
+        sss::tagged<&protocol::type, CANDIDATE, &protocol::data,
+                    &protocol_data::c>("data.c", "candidate"),
+        sss::tagged<&protocol::type, DESCRIPTION, &protocol::data,
+                    &protocol_data::d>("data.d", "description"));
+};
 
 void print_protocol_message(const protocol* p) {
     switch (p->type) {
@@ -127,8 +135,7 @@ int main() {
     size_t bytes_written = 0;
     s_serialize_options opts = {};
     s_serializer_error err =
-        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(protocol), &p, buffer,
-                    sizeof(buffer), &bytes_written);
+        sss::serialize(opts, p, buffer, sizeof(buffer), &bytes_written);
 
     if (err != SERIALIZER_OK) {
         printf("Serialization failed with error: %d\n", err);
@@ -137,13 +144,11 @@ int main() {
     printf("\nSerialized size: %zu bytes\n", bytes_written);
 
     // Deserialize into a new struct
-    s_deserialize_options d_opts = {
-        .format = FORMAT_C_STRUCT,
-        .allocator = &my_allocator,
-    };
+    s_deserialize_options d_opts = {};
+    d_opts.format = FORMAT_C_STRUCT;
+    d_opts.allocator = &my_allocator;
     protocol deserialized = {};
-    err = s_deserialize(d_opts, S_GET_STRUCT_TYPE_INFO(protocol), &deserialized,
-                        buffer, bytes_written);
+    err = sss::deserialize(d_opts, deserialized, buffer, bytes_written);
 
     if (err != SERIALIZER_OK) {
         printf("Deserialization failed with error: %d\n", err);
@@ -153,5 +158,17 @@ int main() {
     printf("\nDeserialized:\n");
     print_protocol_message(&deserialized);
 
+    // same schema is available to the C API
+    char json[1024]; // NOLINT
+    err = s_to_json(d_opts, sss::type_info<protocol>(), &deserialized, json,
+                    sizeof(json));
+
+    if (err != SERIALIZER_OK) {
+        printf("JSON conversion failed with error: %d\n", err);
+        return 1;
+    }
+
+    printf("\nJSON:\n%s\n", json);
+
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,30 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __BASE64_H__
+#define __BASE64_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Base64 (RFC 4648, standard alphabet, padded) for blobs in JSON.
+
+#define S_BASE64_ENCODED_SIZE(n) (((n) + 2) / 3 * 4)
+
+// Writes S_BASE64_ENCODED_SIZE(size) characters into out (no terminating
+// zero), returns number of characters written.
+size_t s_base64_encode(const uint8_t* data, size_t size, char* out);
+
+// Number of bytes str decodes into, SIZE_MAX if len is not a multiple of 4.
+size_t s_base64_decoded_size(const char* str, size_t len);
+
+// Writes s_base64_decoded_size(str, len) bytes into out, false if str is not
+// valid base64.
+bool s_base64_decode(const char* str, size_t len, uint8_t* out);
+
+#endif
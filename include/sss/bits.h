@@ -0,0 +1,27 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __BITS_H__
+#define __BITS_H__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Bitmaps of bools: bool i is bit (i % 8) of byte (i / 8), unused bits of
+// the last byte are zero.
+
+#define S_BITS_SIZE(n) (((n) + 7) / 8)
+
+// Writes S_BITS_SIZE(count) bytes into out, any nonzero byte of values is
+// true.
+void s_bits_pack(const bool* values, size_t count, uint8_t* out);
+
+// Writes count bools into out.
+void s_bits_unpack(const uint8_t* bits, size_t count, bool* out);
+
+#endif
@@ -0,0 +1,314 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __CODEC_H__
+#define __CODEC_H__
+
+#include "sss.h"
+
+#include <string.h>
+
+/*
+ * Per-type codecs from an X-macro field list. The list is written once and
+ * gives both type info (as S_SERIALIZE_BEGIN/S_FIELD_*) and straight-line
+ * s_encode_<TYPE>/s_decode_<TYPE> for wire format v1 without field ids, which
+ * s_serialize and s_deserialize use when options allow:
+ *
+ *   // header
+ *   #define CANDIDATE_FIELDS(X)           \
+ *       X(STRING, identifier)             \
+ *       X(INT32, index, "Index")          \
+ *       X(ARRAY_STATIC, ids, n_ids)       \
+ *       X(STRUCT, location, point)
+ *   S_DEFINE_CODEC(candidate);
+ *
+ *   // source
+ *   S_SERIALIZE_CODEC(candidate, CANDIDATE_FIELDS)
+ *
+ * Entries are X(KIND, NAME, ...), extra arguments are the same as of the
+ * matching S_FIELD_<KIND> macro. Kinds: INT8 ... UINT64, FLOAT, DOUBLE, BOOL,
+ * ENUM, BLOB, STRING, STRING_CONST, STRING_FIXED, STRUCT (type must have a
+ * codec too), ARRAY_STATIC and ARRAY_DYNAMIC of scalars. Size fields of arrays
+ * must come before arrays. Unions and struct arrays need the generic macros.
+ *
+ * Fixed-size fields are bounds-checked once for the whole struct, so their
+ * headers and values are plain stores.
+ */
+
+#define S_CODEC_HEADER_SIZE (6) // uint16_t tag, uint32_t length
+
+// element tags of wire format v1, same as tlv_tag
+#define S_CODEC_TAG_FIELD (0x01)
+#define S_CODEC_TAG_NESTED (0x02)
+#define S_CODEC_TAG_LIST (0x03)
+
+static inline void s_codec_write_header(uint8_t* p, uint16_t tag,
+                                        uint32_t length) {
+    p[0] = (uint8_t) (tag >> 8);
+    p[1] = (uint8_t) tag;
+    p[2] = (uint8_t) (length >> 24);
+    p[3] = (uint8_t) (length >> 16);
+    p[4] = (uint8_t) (length >> 8);
+    p[5] = (uint8_t) length;
+}
+
+// false if element at p is not a complete one with the tag
+static inline bool s_codec_read_header(const uint8_t* p, const uint8_t* end,
+                                       uint16_t tag, uint32_t* length) {
+    if ((size_t) (end - p) < S_CODEC_HEADER_SIZE || p[0] != (tag >> 8) ||
+        p[1] != (uint8_t) tag)
+        return false;
+
+    *length = ((uint32_t) p[2] << 24) | ((uint32_t) p[3] << 16) |
+              ((uint32_t) p[4] << 8) | (uint32_t) p[5];
+
+    return *length <= (size_t) (end - p) - S_CODEC_HEADER_SIZE;
+}
+
+// kinds are mapped to classes of code
+#define S_CODEC_CLASS_INT8 SCALAR
+#define S_CODEC_CLASS_UINT8 SCALAR
+#define S_CODEC_CLASS_INT16 SCALAR
+#define S_CODEC_CLASS_UINT16 SCALAR
+#define S_CODEC_CLASS_INT32 SCALAR
+#define S_CODEC_CLASS_UINT32 SCALAR
+#define S_CODEC_CLASS_INT64 SCALAR
+#define S_CODEC_CLASS_UINT64 SCALAR
+#define S_CODEC_CLASS_FLOAT SCALAR
+#define S_CODEC_CLASS_DOUBLE SCALAR
+#define S_CODEC_CLASS_BOOL SCALAR
+#define S_CODEC_CLASS_ENUM SCALAR
+#define S_CODEC_CLASS_BLOB SCALAR
+#define S_CODEC_CLASS_STRING STRING
+#define S_CODEC_CLASS_STRING_CONST STRING
+#define S_CODEC_CLASS_STRING_FIXED STRING_FIXED
+#define S_CODEC_CLASS_STRUCT STRUCT
+#define S_CODEC_CLASS_ARRAY_STATIC ARRAY_STATIC
+#define S_CODEC_CLASS_ARRAY_DYNAMIC ARRAY_DYNAMIC
+
+#define S_CODEC_CALL(STEP, CLASS, ...) S_CODEC_CALL_(STEP, CLASS, __VA_ARGS__)
+#define S_CODEC_CALL_(STEP, CLASS, ...) S_CODEC_##STEP##_##CLASS(__VA_ARGS__)
+
+// X-macro entries for each step
+#define S_CODEC_FIELD_INFO(KIND, ...) S_FIELD_##KIND(__VA_ARGS__)
+#define S_CODEC_FIXED_SIZE(KIND, ...) \
+    +S_CODEC_CALL(FIXED_SIZE, S_CODEC_CLASS_##KIND, __VA_ARGS__, NULL)
+#define S_CODEC_ENCODE(KIND, ...) \
+    S_CODEC_CALL(ENCODE, S_CODEC_CLASS_##KIND, __VA_ARGS__, NULL)
+#define S_CODEC_DECODE(KIND, ...) \
+    S_CODEC_CALL(DECODE, S_CODEC_CLASS_##KIND, __VA_ARGS__, NULL)
+#define S_CODEC_RELEASE(KIND, ...) \
+    S_CODEC_CALL(RELEASE, S_CODEC_CLASS_##KIND, __VA_ARGS__, NULL)
+
+// bytes of fixed-size fields, checked once in front of the struct
+#define S_CODEC_FIXED_SIZE_SCALAR(NAME, ...) \
+    (S_CODEC_HEADER_SIZE + sizeof(data->NAME))
+#define S_CODEC_FIXED_SIZE_STRING(NAME, ...) 0
+#define S_CODEC_FIXED_SIZE_STRING_FIXED(NAME, ...) 0
+#define S_CODEC_FIXED_SIZE_STRUCT(NAME, ...) 0
+#define S_CODEC_FIXED_SIZE_ARRAY_STATIC(NAME, ...) 0
+#define S_CODEC_FIXED_SIZE_ARRAY_DYNAMIC(NAME, ...) 0
+
+// encoding: p is the output position, fixed_left is the space still needed
+// by fixed-size fields after the current one
+#define S_CODEC_ENCODE_SCALAR(NAME, ...)                                   \
+    s_codec_write_header(p, S_CODEC_TAG_FIELD,                             \
+                         (uint32_t) sizeof(data->NAME));                   \
+    memcpy(p + S_CODEC_HEADER_SIZE, &data->NAME, sizeof(data->NAME));      \
+    p += S_CODEC_HEADER_SIZE + sizeof(data->NAME);                         \
+    fixed_left -= S_CODEC_HEADER_SIZE + sizeof(data->NAME);
+
+#define S_CODEC_ENCODE_STRING(NAME, ...)                                   \
+    {                                                                      \
+        const char* str = data->NAME;                                      \
+        size_t length = str ? strlen(str) + 1 : 0;                         \
+        if ((size_t) (end - p) < S_CODEC_HEADER_SIZE + length + fixed_left) \
+            return SERIALIZER_ERROR_BUFFER_TOO_SMALL;                      \
+        s_codec_write_header(p, S_CODEC_TAG_FIELD, (uint32_t) length);     \
+        if (length)                                                        \
+            memcpy(p + S_CODEC_HEADER_SIZE, str, length);                  \
+        p += S_CODEC_HEADER_SIZE + length;                                 \
+    }
+#define S_CODEC_ENCODE_STRING_FIXED(NAME, ...) \
+    S_CODEC_ENCODE_STRING(NAME, __VA_ARGS__)
+
+#define S_CODEC_ENCODE_STRUCT(NAME, TYPE, ...)                              \
+    {                                                                       \
+        size_t length = 0;                                                  \
+        if ((size_t) (end - p) < S_CODEC_HEADER_SIZE + fixed_left)          \
+            return SERIALIZER_ERROR_BUFFER_TOO_SMALL;                       \
+        s_serializer_error err = s_encode_##TYPE(                           \
+            &data->NAME, p + S_CODEC_HEADER_SIZE,                           \
+            (size_t) (end - p) - S_CODEC_HEADER_SIZE - fixed_left, &length); \
+        if (err != SERIALIZER_OK)                                           \
+            return err;                                                     \
+        s_codec_write_header(p, S_CODEC_TAG_NESTED, (uint32_t) length);     \
+        p += S_CODEC_HEADER_SIZE + length;                                  \
+    }
+
+#define S_CODEC_ENCODE_ARRAY(NAME, SIZE, CAPACITY)                         \
+    {                                                                      \
+        uint32_t n = (uint32_t) data->SIZE;                                \
+        size_t length = (size_t) n * sizeof(data->NAME[0]);                \
+        if ((CAPACITY) ? n > (CAPACITY) : (n && !data->NAME))              \
+            return SERIALIZER_ERROR_INVALID_TYPE;                          \
+        if ((size_t) (end - p) < S_CODEC_HEADER_SIZE + length + fixed_left) \
+            return SERIALIZER_ERROR_BUFFER_TOO_SMALL;                      \
+        s_codec_write_header(p, S_CODEC_TAG_LIST, (uint32_t) length);      \
+        if (length)                                                        \
+            memcpy(p + S_CODEC_HEADER_SIZE, &data->NAME[0], length);       \
+        p += S_CODEC_HEADER_SIZE + length;                                 \
+    }
+#define S_CODEC_ENCODE_ARRAY_STATIC(NAME, SIZE, ...) \
+    S_CODEC_ENCODE_ARRAY(NAME, SIZE,                 \
+                         sizeof(data->NAME) / sizeof(data->NAME[0]))
+#define S_CODEC_ENCODE_ARRAY_DYNAMIC(NAME, SIZE, ...) \
+    S_CODEC_ENCODE_ARRAY(NAME, SIZE, 0)
+
+// decoding: p is the input position, anything unexpected jumps to
+// s_codec_fail
+#define S_CODEC_DECODE_SCALAR(NAME, ...)                                    \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_FIELD, &length) ||         \
+        length != sizeof(data->NAME))                                       \
+        goto s_codec_fail;                                                  \
+    memcpy(&data->NAME, p + S_CODEC_HEADER_SIZE, sizeof(data->NAME));       \
+    p += S_CODEC_HEADER_SIZE + sizeof(data->NAME);
+
+#define S_CODEC_DECODE_STRING(NAME, ...)                                    \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_FIELD, &length))           \
+        goto s_codec_fail;                                                  \
+    if (length) {                                                           \
+        char* str = (char*) allocator->allocate(length, user_data);         \
+        if (!str)                                                           \
+            goto s_codec_fail;                                              \
+        memcpy(str, p + S_CODEC_HEADER_SIZE, length);                       \
+        data->NAME = str;                                                   \
+    }                                                                       \
+    p += S_CODEC_HEADER_SIZE + length;
+
+#define S_CODEC_DECODE_STRING_FIXED(NAME, ...)                              \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_FIELD, &length) ||         \
+        length > sizeof(data->NAME))                                        \
+        goto s_codec_fail;                                                  \
+    memcpy(data->NAME, p + S_CODEC_HEADER_SIZE, length);                    \
+    p += S_CODEC_HEADER_SIZE + length;
+
+#define S_CODEC_DECODE_STRUCT(NAME, TYPE, ...)                              \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_NESTED, &length) ||        \
+        s_decode_##TYPE(&data->NAME, p + S_CODEC_HEADER_SIZE, length,       \
+                        allocator, user_data) != SERIALIZER_OK)             \
+        goto s_codec_fail;                                                  \
+    p += S_CODEC_HEADER_SIZE + length;
+
+#define S_CODEC_DECODE_ARRAY_STATIC(NAME, SIZE, ...)                        \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_LIST, &length) ||          \
+        length % sizeof(data->NAME[0]) || length > sizeof(data->NAME) ||    \
+        length / sizeof(data->NAME[0]) != (uint32_t) data->SIZE)            \
+        goto s_codec_fail;                                                  \
+    memcpy(data->NAME, p + S_CODEC_HEADER_SIZE, length);                    \
+    p += S_CODEC_HEADER_SIZE + length;
+
+#define S_CODEC_DECODE_ARRAY_DYNAMIC(NAME, SIZE, ...)                       \
+    if (!s_codec_read_header(p, end, S_CODEC_TAG_LIST, &length) ||          \
+        length % sizeof(data->NAME[0]) ||                                   \
+        length / sizeof(data->NAME[0]) != (uint32_t) data->SIZE)            \
+        goto s_codec_fail;                                                  \
+    if (length) {                                                           \
+        void* array = allocator->allocate(length, user_data);               \
+        if (!array)                                                         \
+            goto s_codec_fail;                                              \
+        memcpy(array, p + S_CODEC_HEADER_SIZE, length);                     \
+        data->NAME = array;                                                 \
+    }                                                                       \
+    p += S_CODEC_HEADER_SIZE + length;
+
+// releasing what decoder allocated
+#define S_CODEC_RELEASE_POINTER(NAME)                        \
+    if (data->NAME) {                                        \
+        allocator->deallocate((void*) data->NAME, user_data); \
+        data->NAME = NULL;                                   \
+    }
+#define S_CODEC_RELEASE_SCALAR(NAME, ...)
+#define S_CODEC_RELEASE_STRING(NAME, ...) S_CODEC_RELEASE_POINTER(NAME)
+#define S_CODEC_RELEASE_STRING_FIXED(NAME, ...)
+#define S_CODEC_RELEASE_STRUCT(NAME, TYPE, ...) \
+    s_release_##TYPE(&data->NAME, allocator, user_data);
+#define S_CODEC_RELEASE_ARRAY_STATIC(NAME, ...)
+#define S_CODEC_RELEASE_ARRAY_DYNAMIC(NAME, ...) S_CODEC_RELEASE_POINTER(NAME)
+
+// declares type info and codec of TYPE
+#define S_DEFINE_CODEC(TYPE)                                                  \
+    S_DEFINE_TYPE_INFO(TYPE);                                                 \
+    s_serializer_error s_encode_##TYPE(const TYPE* data, uint8_t* buffer,     \
+                                       size_t buffer_size,                    \
+                                       size_t* bytes_written);                \
+    /* data is zeroed first, nothing is left allocated on error */            \
+    s_serializer_error s_decode_##TYPE(TYPE* data, const uint8_t* buffer,     \
+                                       size_t buffer_size,                    \
+                                       s_allocator* allocator,                \
+                                       void* user_data);                      \
+    /* releases strings and arrays allocated by s_decode_<TYPE> */            \
+    void s_release_##TYPE(TYPE* data, s_allocator* allocator, void* user_data)
+
+// defines type info and codec of TYPE from FIELDS(X) list
+#define S_SERIALIZE_CODEC(TYPE, FIELDS)                                       \
+    s_serializer_error s_encode_##TYPE(const TYPE* data, uint8_t* buffer,     \
+                                       size_t buffer_size,                    \
+                                       size_t* bytes_written) {               \
+        size_t fixed_left = 0 FIELDS(S_CODEC_FIXED_SIZE);                     \
+        uint8_t* p = buffer;                                                  \
+        uint8_t* end = buffer + buffer_size;                                  \
+        if (buffer_size < fixed_left)                                         \
+            return SERIALIZER_ERROR_BUFFER_TOO_SMALL;                         \
+        FIELDS(S_CODEC_ENCODE)                                                \
+        (void) end;                                                           \
+        (void) fixed_left;                                                    \
+        *bytes_written = (size_t) (p - buffer);                               \
+        return SERIALIZER_OK;                                                 \
+    }                                                                         \
+    void s_release_##TYPE(TYPE* data, s_allocator* allocator,                 \
+                          void* user_data) {                                  \
+        FIELDS(S_CODEC_RELEASE)                                               \
+        (void) data;                                                          \
+        (void) allocator;                                                     \
+        (void) user_data;                                                     \
+    }                                                                         \
+    s_serializer_error s_decode_##TYPE(TYPE* data, const uint8_t* buffer,     \
+                                       size_t buffer_size,                    \
+                                       s_allocator* allocator,                \
+                                       void* user_data) {                     \
+        const uint8_t* p = buffer;                                            \
+        const uint8_t* end = buffer + buffer_size;                            \
+        uint32_t length = 0;                                                  \
+        memset(data, 0, sizeof(*data));                                       \
+        FIELDS(S_CODEC_DECODE)                                                \
+        (void) length;                                                        \
+        if (p == end)                                                         \
+            return SERIALIZER_OK;                                             \
+    s_codec_fail:                                                             \
+        s_release_##TYPE(data, allocator, user_data);                         \
+        return SERIALIZER_ERROR_INVALID_TYPE;                                 \
+    }                                                                         \
+    static s_serializer_error s_encode_any_##TYPE(                            \
+        const void* data, uint8_t* buffer, size_t buffer_size,                \
+        size_t* bytes_written) {                                              \
+        return s_encode_##TYPE((const TYPE*) data, buffer, buffer_size,       \
+                               bytes_written);                                \
+    }                                                                         \
+    static s_serializer_error s_decode_any_##TYPE(                            \
+        void* data, const uint8_t* buffer, size_t buffer_size,                \
+        s_allocator* allocator, void* user_data) {                            \
+        return s_decode_##TYPE((TYPE*) data, buffer, buffer_size, allocator,  \
+                               user_data);                                    \
+    }                                                                         \
+    S_SERIALIZE_BEGIN(TYPE)                                                   \
+    FIELDS(S_CODEC_FIELD_INFO)                                                \
+    info.encode = s_encode_any_##TYPE;                                        \
+    info.decode = s_decode_any_##TYPE;                                        \
+    S_SERIALIZE_END()
+
+#endif
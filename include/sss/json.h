@@ -0,0 +1,45 @@
+/*
+ * Created on Sun Oct 18 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include "sss.h"
+
+// chunk buffer size for output streamed to sink, including terminating zero
+#define S_JSON_CHUNK_SIZE (4096)
+
+// bounded json output, always zero-terminated; once err is set further
+// appends are ignored. With sink, data is a chunk buffer that is passed to
+// sink whenever it fills up.
+typedef struct {
+    char* data;
+    size_t length;   // bytes written so far, excluding terminating zero
+    size_t capacity; // output buffer size, including terminating zero
+    bool base64_blobs; // blobs and byte arrays as base64 strings
+    s_json_sink sink;
+    void* sink_data;
+    s_serializer_error err;
+} s_json_writer;
+
+// passes buffered output to sink, if any
+void s_json_flush(s_json_writer* w);
+
+void s_json_append(s_json_writer* w, const char* str, size_t len);
+void s_json_append_char(s_json_writer* w, char c);
+void s_json_append_int(s_json_writer* w, int64_t value);
+void s_json_append_uint(s_json_writer* w, uint64_t value);
+void s_json_append_float(s_json_writer* w, float value);
+void s_json_append_double(s_json_writer* w, double value);
+// appends quoted string, escaped as per RFC 8259
+void s_json_append_string(s_json_writer* w, const char* str, size_t len);
+// appends quoted base64 string
+void s_json_append_base64(s_json_writer* w, const uint8_t* data, size_t size);
+
+#define JSON_APPEND(w, str) s_json_append(w, str, sizeof(str) - 1)
+
+#endif
@@ -0,0 +1,28 @@
+/*
+ * Created on Sat Oct 17 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __NUMBER_H__
+#define __NUMBER_H__
+
+#include <stdint.h>
+
+// enough for any formatted number, sign included
+#define S_NUMBER_MAX_CHARS (32)
+
+// Number formatting for JSON output. Functions write at most
+// S_NUMBER_MAX_CHARS characters into buf (no terminating zero) and return
+// number of characters written.
+int s_format_int64(int64_t value, char* buf);
+int s_format_uint64(uint64_t value, char* buf);
+
+// Shortest representation that reads back into the same value (Grisu2),
+// always has a decimal point or an exponent ("1.0", "0.1", "1e+300").
+// NaN and infinities are written as null.
+int s_format_double(double value, char* buf);
+int s_format_float(float value, char* buf);
+
+#endif
@@ -0,0 +1,44 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __QUANTIZE_H__
+#define __QUANTIZE_H__
+
+#include "sss/sss.h"
+
+// Quantized float fields: FIELD_TYPE_FLOAT/DOUBLE fields and float builtin
+// arrays go on the wire with fewer bytes per value, in host byte order like
+// other scalars.
+//   S_FIELD_OPT_HALF -- IEEE 754 binary16, rounded to nearest even: relative
+//     error at most 2^-11, magnitudes above 65504 become infinity, below
+//     2^-24 -- zero. Doubles are rounded to float first.
+//   S_FIELD_OPT_FIXED -- signed integer of quantized_field_info.size bytes
+//     holding value * scale rounded half away from zero: absolute error at
+//     most 0.5 / scale, out of range values saturate, NaN becomes 0.
+
+#define S_FIELD_OPTS_QUANTIZED (S_FIELD_OPT_HALF | S_FIELD_OPT_FIXED)
+
+uint16_t s_float_to_half(float value);
+float s_half_to_float(uint16_t half);
+
+// F16C (x86, picked at run time) or NEON (aarch64) conversion with scalar
+// fallback, results are the same as of the scalar functions above.
+void s_floats_to_halves(const float* values, size_t count, uint16_t* out);
+void s_halves_to_floats(const uint16_t* halves, size_t count, float* out);
+
+// Bytes per value of field on the wire, field->size if it is not quantized.
+size_t s_quantized_size(const s_field_info* field);
+
+// Writes count values of field (floats or doubles as of field->size) into out
+// as count * s_quantized_size(field) bytes; out needs no alignment.
+void s_quantize(const s_field_info* field, const void* values, size_t count,
+                uint8_t* out);
+// Reverse of s_quantize, plain copy for fields that are not quantized.
+void s_dequantize(const s_field_info* field, const uint8_t* wire,
+                  size_t count, void* values);
+
+#endif
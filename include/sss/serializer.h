@@ -8,15 +8,39 @@
 #ifndef __SERIALIZER_H__
 #define __SERIALIZER_H__
 
+#include "json.h"
 #include "sss.h"
 #include "tlv.h"
 
 #define MAX_NESTED_LEVELS (32)
 #define MAX_TLV_ELEMS (1024)
 
+// struct decoded at one nesting level
+typedef struct {
+    const s_type_info* type_info;
+    const s_field_info* parent_info; // field that opened the level
+    uint8_t* data;                   // struct being decoded (c struct format)
+    uint8_t* array_data;             // first element of struct array
+    uint32_t array_size;
+    uint32_t array_el_idx;
+    int field_idx;        // next field expected
+    int el_idx;           // elements reported at this level so far
+    int first_decoded_el; // decoded elements of current struct start here
+    bool has_field_ids;   // elements at this level carry field ids
+    bool has_el_starts;   // structs of struct array start with NESTED_LIST_EL
+    // fields reported in current struct
+    uint64_t seen_fields[(S_MAX_FIELDS + 63) / 64];
+} s_deserialize_frame;
+
 typedef struct {
     int tlv_el_idx;
     int prev_level;
+    int level;
+    int n_decoded_els;
+    bool array_el_started; // element starts next struct of struct array
+    int skip_level; // elements at this level and deeper belong to unknown field
+    bool is_delta;  // applying delta: no defaults, replaced pointers released
+    s_deserialize_frame frames[MAX_NESTED_LEVELS];
     const s_type_info* info;
     s_deserialize_options opts;
     uint8_t* data;
@@ -25,13 +49,20 @@ typedef struct {
 
     struct {
         s_tlv_decoded_element_data el;
-        s_type_info* type_info;
+        const s_type_info* type_info;
         int field_idx;
-    } decoded_els[MAX_TLV_ELEMS];
+        uint8_t scalar[sizeof(uint64_t)]; // storage for decoded varints
+    } decoded_els[MAX_TLV_ELEMS]; // fields of structs on the current path
 
     struct {
         int count;
-        char closing_braces[MAX_NESTED_LEVELS][MAX_NESTED_LEVELS];
+        s_json_writer writer;
+        // braces to close, innermost on top
+        struct {
+            char brace;
+            int level; // closed when decoding goes above this level
+        } braces[2 * MAX_NESTED_LEVELS + 1];
+        int n_braces;
     } json_context;
 } s_deserialize_context;
 
@@ -39,5 +70,20 @@ typedef struct {
 int is_field_present(const void* struct_data, const s_field_info* field);
 int is_field_present_ctx(s_deserialize_context* ctx, int field_idx,
                          const s_type_info* field_type_info);
+// tag of union being decoded, NULL if it wasn't decoded in this struct
+const uint8_t* s_deserialize_find_tag(s_deserialize_context* ctx,
+                                      const s_type_info* type_info,
+                                      size_t tag_offset);
+// releases strings, arrays and maps allocated for the field, nested structs
+// included; released pointers and array sizes are cleared
+void s_release_field(const s_field_info* field, uint8_t* data,
+                     s_allocator* allocator, void* user_data);
+// releases allocations of all fields present in the struct
+void s_release_struct(const s_type_info* info, uint8_t* data,
+                      s_allocator* allocator, void* user_data);
+// gives decoded map of field layout the field asks for: sorted entries or
+// hash index
+s_serializer_error s_map_finish(const s_field_info* field, s_map* map,
+                                s_allocator* allocator, void* user_data);
 
 #endif
\ No newline at end of file
@@ -47,6 +47,8 @@ typedef enum {
     FIELD_TYPE_ARRAY, // array of elements
 
     FIELD_TYPE_STRUCT,
+
+    FIELD_TYPE_MAP, // s_map of key-value entry structs
 } s_field_type;
 
 typedef enum {
@@ -56,6 +58,11 @@ typedef enum {
     S_FIELD_OPT_ENCRYPTED = 1 << 2,
     S_FIELD_OPT_ARRAY_DYNAMIC = 1 << 3,
     S_FIELD_OPT_STRING_FIXED = 1 << 4,
+    S_FIELD_OPT_VARINT = 1 << 5, // encode integer field as LEB128 varint
+    S_FIELD_OPT_MAP_HASHED = 1 << 6, // decoded map gets hash index, not sorted
+    S_FIELD_OPT_BOOL_PACKED = 1 << 7, // bool shares bitmap with its neighbours
+    S_FIELD_OPT_HALF = 1 << 8,  // float values sent as IEEE half precision
+    S_FIELD_OPT_FIXED = 1 << 9, // float values sent as scaled integers
 
 } s_field_opts;
 
@@ -63,39 +70,73 @@ typedef enum {
     S_ARRAY_BUILTIN_TYPE_BLOB,
     S_ARRAY_BUILTIN_TYPE_FLOAT,
     S_ARRAY_BUILTIN_TYPE_STRING,
+    S_ARRAY_BUILTIN_TYPE_BITS, // bool array sent as bitmap
 } s_array_builtin_type;
 
 struct s_type_info;
+struct s_union_table;
+struct s_field_index;
 
+// One record per field, no separate table of cold members. Members read for
+// every field on encode and decode come first; union and array metadata is
+// only read when opts or type ask for it, names only by json and lookups.
 typedef struct {
-    const char* name;
-    const char* label;
     s_field_type type;
+    int32_t opts;
     size_t offset;
     size_t size;
-    int32_t opts;
+    struct s_type_info* struct_type_info;
     struct {
-        struct s_type_info* struct_type_info;
-        struct {
-            s_field_type tag_type;
-            size_t tag_offset;
-            int tag_value_int;
-            const char* tag_value_string;
-        } optional_field_info;
-        struct {
-            size_t size_field_size;
-            size_t size_field_offset;
-            s_array_builtin_type builtin_type;
-        } array_field_info;
-    };
+        size_t size_field_size;
+        size_t size_field_offset;
+        size_t capacity; // elements in static array, 0 -- unknown
+        s_array_builtin_type builtin_type;
+    } array_field_info;
+    struct {
+        s_field_type tag_type;
+        int tag_value_int;
+        size_t tag_offset;
+        const char* tag_value_string;
+        // all alternatives of the union, NULL -- tag is checked per field
+        const struct s_union_table* table;
+    } optional_field_info;
+    struct {
+        uint32_t bit;   // position in bitmap, the field at 0 carries it
+        uint32_t count; // bools in bitmap
+    } packed_field_info;
+    struct {
+        double scale;  // S_FIELD_OPT_FIXED: value * scale goes on the wire
+        uint32_t size; // S_FIELD_OPT_FIXED: bytes of integer, 2 or 4
+    } quantized_field_info;
+    const char* name;
+    const char* label;
 } s_field_info;
 
-typedef struct s_type_info {
-    const char* type_name;
-    s_field_info* fields;
+// Tagged fields that follow each other and share the tag are resolved with a
+// single lookup: int tags index slots directly, string tags by their perfect
+// hash (seeded FNV-1a) followed by one strcmp. Built along with type info for
+// unions of two or more alternatives with distinct tag values.
+typedef struct s_union_table {
+    const s_field_info* fields; // first alternative
+    size_t first_field;         // index of first alternative in type info
     size_t field_count;
-    size_t type_size;
-} s_type_info;
+    int32_t min_tag;      // int tags: slots[tag - min_tag]
+    uint32_t seed;        // string tags: slots[hash & (n_slots - 1)]
+    uint32_t n_slots;
+    const uint8_t* slots; // index of alternative + 1, 0 -- none
+} s_union_table;
+
+// Map field: entries are structs whose first field is the key (integer or
+// string), the rest is the value. On the wire it is a struct of entry count
+// and list of entries. Decoding sorts entries by key for binary search, or,
+// with S_FIELD_OPT_MAP_HASHED, keeps their order and indexes them with an
+// open-addressing table; either way s_map_find looks keys up directly.
+typedef struct {
+    void* entries; // count entry structs
+    uint32_t count;
+    uint32_t n_slots; // power of two, 0 -- no hash index
+    uint32_t* slots;  // entry index + 1, 0 -- empty slot
+} s_map;
 
 typedef enum {
     SERIALIZER_OK = 0,
@@ -104,6 +145,8 @@ typedef enum {
     SERIALIZER_ERROR_COMPRESSION_FAILED = -3,
     SERIALIZER_ERROR_ENCRYPTION_FAILED = -4,
     SERIALIZER_ERROR_ALLOCATOR_FAILED = -5,
+    SERIALIZER_ERROR_SINK_FAILED = -6,
+    SERIALIZER_ERROR_SCHEMA_MISMATCH = -7,
 } s_serializer_error;
 
 typedef void* (*s_allocator_allocate)(size_t, void* user_data);
@@ -114,10 +157,91 @@ typedef struct {
     s_allocator_deallocate deallocate;
 } s_allocator;
 
+// Optional per-type codecs (see codec.h): encode writes wire format v1 without
+// field ids, decode reads it into zeroed data and returns an error for
+// anything else, releasing what it allocated. Generic s_serialize and
+// s_deserialize dispatch to them and fall back to the generic path.
+typedef s_serializer_error (*s_type_encode_fn)(const void* data,
+                                               uint8_t* buffer,
+                                               size_t buffer_size,
+                                               size_t* bytes_written);
+typedef s_serializer_error (*s_type_decode_fn)(void* data,
+                                               const uint8_t* buffer,
+                                               size_t buffer_size,
+                                               s_allocator* allocator,
+                                               void* user_data);
+
+typedef struct s_type_info {
+    const char* type_name;
+    // exactly field_count entries, not to be modified; NULL -- fields couldn't
+    // be allocated, see s_type_info_is_failed
+    const s_field_info* fields;
+    size_t field_count;
+    size_t type_size;
+    s_type_encode_fn encode; // NULL -- generic encoding only
+    s_type_decode_fn decode; // NULL -- generic decoding only
+    uint64_t schema_hash;    // s_type_info_hash, set when type info is built
+    const struct s_field_index* field_index; // NULL -- s_find_field scans
+} s_type_info;
+
+// 64-bit fingerprint of the schema: names, types, sizes and options of fields
+// in order, including nested types. Type names, labels and field offsets are
+// not part of it, so the same fields in differently laid out structs match.
+uint64_t s_type_info_hash(const s_type_info* info);
+
+// alternative of union selected by tag value, NULL if tag selects none
+const s_field_info* s_union_table_find(const s_union_table* table,
+                                       const void* tag);
+
+// Field whose name or label is name[0..len), NULL if none. Type info built by
+// S_SERIALIZE_END has a minimal perfect hash over names and labels, so lookup
+// is one hash and one compare; union members that share a label follow each
+// other in field order through s_find_next_field.
+const s_field_info* s_find_field(const s_type_info* info, const char* name,
+                                 size_t len);
+const s_field_info* s_find_next_field(const s_type_info* info,
+                                      const s_field_info* field,
+                                      const char* name, size_t len);
+
+// NULL if fields can't be indexed, s_find_field falls back to scanning then
+const struct s_field_index*
+s_type_info_build_field_index(const s_type_info* info);
+
+// Entry of map with key, NULL if none. key points to a value of the key
+// field's type, string keys are passed as the string itself.
+void* s_map_find(const s_type_info* entry_info, const s_map* map,
+                 const void* key);
+// Orders entries of map by key, as decoding does for sorted maps.
+void s_map_sort(const s_type_info* entry_info, s_map* map);
+// Replaces hash index of map with one for its current entries.
+s_serializer_error s_map_build_index(const s_type_info* entry_info, s_map* map,
+                                     s_allocator* allocator, void* user_data);
+// Releases entries and index of decoded map, not data entries point to.
+void s_map_free(s_map* map, s_allocator* allocator, void* user_data);
+
+// Type info of s_map with entries of entry_info: entry count and dynamic
+// array of entries, filled into map_info and map_fields[2] by S_FIELD_MAP.
+struct s_type_info* s_map_type_info_init(struct s_type_info* map_info,
+                                         s_field_info* map_fields,
+                                         const char* type_name,
+                                         struct s_type_info* entry_info);
+
 typedef struct {
     bool is_compressed;         // TODO
     const char* encryption_key; // TODO -- RSA, AES, at minimum
     s_allocator* allocator;     // allocator for compression and encryption
+    bool use_varints; // encode all integer scalars (16 bits and wider) as
+                      // LEB128 varints, zigzag for signed types
+    bool use_compact_format; // compact wire format (v2): 1-byte tags and
+                             // varint lengths
+    bool use_field_ids; // field index in every element header: fields of
+                        // structs may come in any order, unknown fields are
+                        // skipped by older schemas
+    bool omit_defaults; // skip zero scalars, NULL strings, empty fixed strings
+                        // and arrays, deserializer fills them back with
+                        // defaults (implies field ids); "" is kept
+    bool use_schema_header; // prefix output with S_SCHEMA_HEADER_SIZE-byte
+                            // header carrying schema hash of info
 } s_serialize_options;
 
 s_serializer_error s_serialize(s_serialize_options opts,
@@ -139,6 +263,9 @@ typedef void (*s_custom_deserializer_cb)(int el_idx, int el_lvl, size_t length,
                                          const s_field_info* parent_info,
                                          void* user_data);
 
+// Receives json output in chunks, returns false to stop.
+typedef bool (*s_json_sink)(const char* chunk, size_t length, void* user_data);
+
 typedef struct {
     s_deserialization_format format;
     s_allocator* allocator; // allocator for deserialized data, decompression
@@ -147,13 +274,198 @@ typedef struct {
     s_custom_deserializer_cb custom_deserializer;
     void* user_data;
 
+    size_t data_size; // size of output buffer for FORMAT_JSON_STRING, 0 is
+                      // SERIALIZER_ERROR_BUFFER_TOO_SMALL unless json_sink
+                      // is set (it used to mean unbounded output)
+    bool json_base64_blobs; // FORMAT_JSON_STRING: blobs and byte arrays as
+                            // base64 strings instead of number arrays
+    s_json_sink json_sink;  // FORMAT_JSON_STRING: output is streamed to sink
+                            // in chunks instead of data, which is not used
+    void* json_sink_data;   // passed to json_sink
+
     const char* encryption_key; // TODO
 } s_deserialize_options;
 
+// With FORMAT_C_STRUCT data is the struct of info. With FORMAT_JSON_STRING
+// output goes to opts.json_sink or to data of opts.data_size bytes and is
+// never unbounded: output that doesn't fit, opts.data_size of 0 included, is
+// SERIALIZER_ERROR_BUFFER_TOO_SMALL. Breaking change: data_size of 0 used to
+// mean unbounded output, such callers have to pass their buffer size now.
 s_serializer_error s_deserialize(s_deserialize_options opts,
                                  const s_type_info* info, void* data,
                                  const uint8_t* buffer, size_t buffer_size);
 
+// Schema header: magic, format version, schema hash (big endian) and length
+// of the message that follows (big endian). s_deserialize, s_apply_delta and
+// s_deserialize_ndjson check the hash of buffers that start with the header
+// against info and return SERIALIZER_ERROR_SCHEMA_MISMATCH before decoding
+// anything; buffers without it are decoded as before.
+#define S_SCHEMA_HEADER_SIZE (14)
+
+typedef struct {
+    uint8_t version;
+    uint64_t schema_hash;
+    uint32_t length; // bytes after the header
+} s_schema_header;
+
+// Reads header of buffer, e.g. to route messages by schema_hash.
+// SERIALIZER_ERROR_INVALID_TYPE if buffer has no (valid) header.
+s_serializer_error s_read_schema_header(const uint8_t* buffer,
+                                        size_t buffer_size,
+                                        s_schema_header* header);
+
+// Type registry maps schema hashes to type info, so that messages of
+// different types written with schema header can share one stream. Lookups
+// take no locks and may run concurrently with s_type_registry_add; types are
+// never removed. Zero-initialized registry is empty.
+#define S_TYPE_REGISTRY_CAPACITY (256) // power of 2
+
+typedef struct {
+    uint64_t schema_hash; // 0 -- free slot
+    const s_type_info* info;
+} s_type_registry_entry;
+
+typedef struct {
+    s_type_registry_entry entries[S_TYPE_REGISTRY_CAPACITY];
+} s_type_registry;
+
+// SERIALIZER_ERROR_SCHEMA_MISMATCH if another type with the same schema hash
+// is registered, SERIALIZER_ERROR_BUFFER_TOO_SMALL if registry is full.
+// Adding the same type again is a no-op.
+s_serializer_error s_type_registry_add(s_type_registry* registry,
+                                       const s_type_info* info);
+// NULL if there is no such type
+const s_type_info* s_type_registry_find(const s_type_registry* registry,
+                                        uint64_t schema_hash);
+
+// Deserializes message with schema header as the registered type it names,
+// which is returned in info. With FORMAT_C_STRUCT data must hold data_size
+// bytes, SERIALIZER_ERROR_BUFFER_TOO_SMALL if the type doesn't fit; unknown
+// types are SERIALIZER_ERROR_SCHEMA_MISMATCH, messages without header --
+// SERIALIZER_ERROR_INVALID_TYPE.
+s_serializer_error s_deserialize_any(s_deserialize_options opts,
+                                     const s_type_registry* registry,
+                                     const s_type_info** info, void* data,
+                                     size_t data_size, const uint8_t* buffer,
+                                     size_t buffer_size);
+
+// Writes struct as json straight from memory, output is the same as of
+// s_serialize followed by s_deserialize with FORMAT_JSON_STRING and the same
+// opts (opts.format and opts.data_size are not used). out is zero-terminated,
+// SERIALIZER_ERROR_BUFFER_TOO_SMALL if out_size is not enough. With
+// opts.json_sink, output goes to sink and out may be NULL.
+s_serializer_error s_to_json(s_deserialize_options opts,
+                             const s_type_info* info, const void* data,
+                             char* out, size_t out_size);
+
+// Parses json into struct, keys are matched against field labels, then names.
+// opts.format must be FORMAT_C_STRUCT. data is zeroed first, fields missing
+// from json stay zero; strings and dynamic arrays are allocated with
+// opts.allocator. Blobs and byte arrays may be number arrays or base64
+// strings. Union tags must precede their members. Nothing is left allocated
+// on error.
+s_serializer_error s_from_json(s_deserialize_options opts,
+                               const s_type_info* info, void* data,
+                               const char* json, size_t json_size);
+// Converts json to TLV, same as s_from_json with dopts followed by
+// s_serialize with opts; the struct in between is allocated with
+// dopts.allocator and dopts.user_data too.
+s_serializer_error s_json_to_tlv(s_serialize_options opts,
+                                 s_deserialize_options dopts,
+                                 const s_type_info* info, const char* json,
+                                 size_t json_size, uint8_t* buffer,
+                                 size_t buffer_size, size_t* bytes_written);
+
+// Delta encoding: s_serialize_delta writes only fields of cur that differ from
+// prev (changed ranges for arrays of the same size), s_apply_delta updates
+// prev with them in place. Strings and dynamic arrays replaced by delta are
+// released with opts.allocator, so pointers in data must come from it (e.g.
+// from s_deserialize). Changed maps are sent whole.
+s_serializer_error s_serialize_delta(s_serialize_options opts,
+                                     const s_type_info* info, const void* prev,
+                                     const void* cur, uint8_t* buffer,
+                                     size_t buffer_size, size_t* bytes_written);
+s_serializer_error s_apply_delta(s_deserialize_options opts,
+                                 const s_type_info* info, void* data,
+                                 const uint8_t* buffer, size_t buffer_size);
+
+// Record streams: s_serialize_record writes message prefixed with its length
+// (varint), records written one after another make a stream.
+// s_deserialize_ndjson converts a stream into NDJSON, one json line per record
+// as of s_deserialize with FORMAT_JSON_STRING. Output goes to data (bounded by
+// opts.data_size, which is required) or to opts.json_sink. With n_threads > 1
+// (up to S_NDJSON_MAX_THREADS) groups of records are converted in parallel,
+// output order is kept and opts.allocator must be thread-safe; builds without
+// threads support convert on the calling thread. Conversion stops at the
+// first invalid record, n_records receives the number of converted ones.
+#define S_NDJSON_MAX_THREADS (64)
+
+s_serializer_error s_serialize_record(s_serialize_options opts,
+                                      const s_type_info* info,
+                                      const void* data, uint8_t* buffer,
+                                      size_t buffer_size,
+                                      size_t* bytes_written);
+s_serializer_error s_deserialize_ndjson(s_deserialize_options opts,
+                                        const s_type_info* info, void* data,
+                                        const uint8_t* buffer,
+                                        size_t buffer_size, int n_threads,
+                                        size_t* n_records);
+
+// Type info is built on first use: one thread builds it while others wait,
+// afterwards getting it costs a single acquire load.
+enum {
+    S_TYPE_INFO_STATE_NONE = 0,
+    S_TYPE_INFO_STATE_BUILDING = 1,
+    S_TYPE_INFO_STATE_READY = 2,
+};
+
+// Fields are collected into a S_MAX_FIELDS table on stack and copied into an
+// exactly-sized one on heap that lives until the program exits; NULL if it
+// can't be allocated.
+const s_field_info* s_type_info_store_fields(const s_field_info* fields,
+                                             size_t field_count);
+
+// Type info without fields table is refused by s_serialize, s_deserialize and
+// json conversions with SERIALIZER_ERROR_ALLOCATOR_FAILED instead of being
+// treated as empty struct.
+static inline bool s_type_info_is_failed(const s_type_info* info) {
+    return !info->fields;
+}
+
+#if defined(__GNUC__)
+// returns true if the caller has to build type info
+static inline bool s_type_info_begin_init(int* state) {
+    if (__builtin_expect(__atomic_load_n(state, __ATOMIC_ACQUIRE) ==
+                             S_TYPE_INFO_STATE_READY,
+                         1))
+        return false;
+
+    for (;;) {
+        int expected = S_TYPE_INFO_STATE_NONE;
+
+        if (__atomic_compare_exchange_n(state, &expected,
+                                        S_TYPE_INFO_STATE_BUILDING, false,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE))
+            return true;
+        if (expected == S_TYPE_INFO_STATE_READY)
+            return false;
+    }
+}
+
+static inline void s_type_info_end_init(int* state) {
+    __atomic_store_n(state, S_TYPE_INFO_STATE_READY, __ATOMIC_RELEASE);
+}
+#else
+// no atomics: first use must not race
+static inline bool s_type_info_begin_init(int* state) {
+    return *state != S_TYPE_INFO_STATE_READY;
+}
+
+static inline void s_type_info_end_init(int* state) {
+    *state = S_TYPE_INFO_STATE_READY;
+}
+#endif
+
 #ifdef __cplusplus
 }
 #endif
@@ -164,10 +476,10 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
 #define S_SERIALIZE_BEGIN(TYPE)                         \
     s_type_info* s_get_struct_type_info_##TYPE() {      \
         static s_type_info info = {0};                  \
-        static bool initialized = false;                \
-        if (initialized)                                \
+        static int state = S_TYPE_INFO_STATE_NONE;      \
+        if (!s_type_info_begin_init(&state))            \
             return &info;                               \
-        static s_field_info fields[S_MAX_FIELDS] = {0}; \
+        s_field_info fields[S_MAX_FIELDS];              \
         typedef TYPE struct_type;                       \
         struct_type dummy;                              \
         info.type_name = #TYPE;                         \
@@ -175,21 +487,27 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
         info.field_count = 0;                           \
         info.type_size = sizeof(struct_type);
 
-#define S_SERIALIZE_END() \
-    initialized = true;   \
-    return &info;         \
+#define S_SERIALIZE_END()                                             \
+    info.fields = s_type_info_store_fields(fields, info.field_count); \
+    assert(info.fields && "Failed to allocate fields");               \
+    if (!info.fields)                                                 \
+        info.field_count = 0;                                         \
+    info.schema_hash = s_type_info_hash(&info);                       \
+    info.field_index = s_type_info_build_field_index(&info);          \
+    s_type_info_end_init(&state);                                     \
+    return &info;                                                     \
     }
 
 #define S_FIELD_LABELED(NAME, TYPE, LABEL)                        \
     assert(info.field_count < S_MAX_FIELDS && "Too many fields"); \
     fields[info.field_count++] =                                  \
-        (s_field_info) {.name = #NAME,                            \
-                        .label = LABEL,                           \
-                        .type = TYPE,                             \
+        (s_field_info) {.type = TYPE,                             \
+                        .opts = S_FIELD_OPT_NONE,                 \
                         .offset = offsetof(struct_type, NAME),    \
                         .size = sizeof(dummy.NAME),               \
-                        .opts = S_FIELD_OPT_NONE,                 \
-                        .struct_type_info = NULL};
+                        .struct_type_info = NULL,                 \
+                        .name = #NAME,                            \
+                        .label = LABEL};
 
 #if S_TYPE_CHECKING_ENABLED
 #ifdef __cplusplus
@@ -324,21 +642,43 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
     GET_MACRO(__VA_ARGS__, S_FIELD_BLOB_LABELED, \
               S_FIELD_BLOB_LABELED)(__VA_ARGS__, NULL)
 
-#define S_FIELD_STRUCT_LABELED(NAME, TYPE, FIELD_LABEL, ...)      \
-    assert(info.field_count < S_MAX_FIELDS && "Too many fields"); \
-    fields[info.field_count++] =                                  \
-        (s_field_info) {.name = #NAME,                            \
-                        .label = FIELD_LABEL,                     \
-                        .type = FIELD_TYPE_STRUCT,                \
-                        .offset = offsetof(struct_type, NAME),    \
-                        .size = sizeof(dummy.NAME),               \
-                        .opts = S_FIELD_OPT_NONE,                 \
-                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE)};
+#define S_FIELD_STRUCT_LABELED(NAME, TYPE, FIELD_LABEL, ...)              \
+    assert(info.field_count < S_MAX_FIELDS && "Too many fields");         \
+    fields[info.field_count++] =                                          \
+        (s_field_info) {.type = FIELD_TYPE_STRUCT,                        \
+                        .opts = S_FIELD_OPT_NONE,                         \
+                        .offset = offsetof(struct_type, NAME),            \
+                        .size = sizeof(dummy.NAME),                       \
+                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE), \
+                        .name = #NAME,                                    \
+                        .label = FIELD_LABEL};
 
 #define S_FIELD_STRUCT(...)                          \
     GET_MACRO_3(__VA_ARGS__, S_FIELD_STRUCT_LABELED, \
                 S_FIELD_STRUCT_LABELED)(__VA_ARGS__, NULL)
 
+#define S_FIELD_MAP_LABELED(NAME, TYPE, FIELD_LABEL, ...)                 \
+    S_ASSERT_TYPE(s_map, dummy.NAME);                                     \
+    assert(info.field_count < S_MAX_FIELDS && "Too many fields");         \
+    {                                                                     \
+        static s_type_info map_info;                                      \
+        static s_field_info map_fields[2];                                \
+        fields[info.field_count++] = (s_field_info) {                     \
+            .type = FIELD_TYPE_MAP,                                       \
+            .opts = S_FIELD_OPT_NONE,                                     \
+            .offset = offsetof(struct_type, NAME),                        \
+            .size = sizeof(dummy.NAME),                                   \
+            .struct_type_info =                                           \
+                s_map_type_info_init(&map_info, map_fields, #TYPE "_map", \
+                                     S_GET_STRUCT_TYPE_INFO(TYPE)),       \
+            .name = #NAME,                                                \
+            .label = FIELD_LABEL};                                        \
+    }
+
+#define S_FIELD_MAP(...)                          \
+    GET_MACRO_3(__VA_ARGS__, S_FIELD_MAP_LABELED, \
+                S_FIELD_MAP_LABELED)(__VA_ARGS__, NULL)
+
 #define S_UNION_BEGIN_TAG(NAME, TAG_NAME)                  \
     {                                                      \
         size_t union_start_field_index = info.field_count; \
@@ -346,7 +686,7 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
 
 #define S_UNION_END()                                                     \
     for (size_t i = union_start_field_index; i < info.field_count; i++) { \
-        info.fields[i].opts |= S_FIELD_OPT_OPTIONAL;                      \
+        fields[i].opts |= S_FIELD_OPT_OPTIONAL;                           \
     }                                                                     \
     }
 
@@ -354,14 +694,14 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
     {                                                                         \
         bool field_found = false;                                             \
         for (size_t i = union_start_field_index; i < info.field_count; i++) { \
-            if (strcmp(info.fields[i].name, #NAME) == 0) {                    \
+            if (strcmp(fields[i].name, #NAME) == 0) {                         \
                 field_found = true;                                           \
-                info.fields[i].opts |= S_FIELD_OPT_OPTIONAL;                  \
-                info.fields[i].optional_field_info.tag_offset = tag_offset;   \
-                assert(info.fields[i].offset > tag_offset &&                  \
+                fields[i].opts |= S_FIELD_OPT_OPTIONAL;                       \
+                fields[i].optional_field_info.tag_offset = tag_offset;        \
+                assert(fields[i].offset > tag_offset &&                       \
                        "Tag field must be before tagged field");              \
-                info.fields[i].optional_field_info.tag_value_int = TAG_VALUE; \
-                info.fields[i].optional_field_info.tag_type =                 \
+                fields[i].optional_field_info.tag_value_int = TAG_VALUE;      \
+                fields[i].optional_field_info.tag_type =                      \
                     FIELD_TYPE_INT32;                                         \
                 break;                                                        \
             }                                                                 \
@@ -373,15 +713,15 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
     {                                                                         \
         bool field_found = false;                                             \
         for (size_t i = union_start_field_index; i < info.field_count; i++) { \
-            if (strcmp(info.fields[i].name, #NAME) == 0) {                    \
+            if (strcmp(fields[i].name, #NAME) == 0) {                         \
                 field_found = true;                                           \
-                info.fields[i].opts |= S_FIELD_OPT_OPTIONAL;                  \
-                info.fields[i].optional_field_info.tag_offset = tag_offset;   \
-                assert(info.fields[i].offset > tag_offset &&                  \
+                fields[i].opts |= S_FIELD_OPT_OPTIONAL;                       \
+                fields[i].optional_field_info.tag_offset = tag_offset;        \
+                assert(fields[i].offset > tag_offset &&                       \
                        "Tag field must be before tagged field");              \
-                info.fields[i].optional_field_info.tag_value_string =         \
+                fields[i].optional_field_info.tag_value_string =              \
                     TAG_VALUE;                                                \
-                info.fields[i].optional_field_info.tag_type =                 \
+                fields[i].optional_field_info.tag_type =                      \
                     FIELD_TYPE_STRING;                                        \
                 break;                                                        \
             }                                                                 \
@@ -393,9 +733,9 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
     {                                                                \
         bool field_found = false;                                    \
         for (size_t i = 0; i < info.field_count; i++) {              \
-            if (strcmp(info.fields[i].name, #NAME) == 0) {           \
+            if (strcmp(fields[i].name, #NAME) == 0) {                \
                 field_found = true;                                  \
-                info.fields[i].array_field_info.builtin_type =       \
+                fields[i].array_field_info.builtin_type =            \
                     S_ARRAY_BUILTIN_TYPE_FLOAT;                      \
                 break;                                               \
             }                                                        \
@@ -403,17 +743,76 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
         assert(field_found && "Field " #NAME " not found in union"); \
     }
 
-#define S_BUILTIN_ARRAY_FIELD_SET_TYPE(NAME, BUILTIN_TYPE)                   \
-    {                                                                        \
-        bool field_found = false;                                            \
-        for (size_t i = 0; i < info.field_count; i++) {                      \
-            if (strcmp(info.fields[i].name, #NAME) == 0) {                   \
-                field_found = true;                                          \
-                info.fields[i].array_field_info.builtin_type = BUILTIN_TYPE; \
-                break;                                                       \
-            }                                                                \
-        }                                                                    \
-        assert(field_found && "Field " #NAME " not found in union");         \
+#define S_BUILTIN_ARRAY_FIELD_SET_TYPE(NAME, BUILTIN_TYPE)              \
+    {                                                                   \
+        bool field_found = false;                                       \
+        for (size_t i = 0; i < info.field_count; i++) {                 \
+            if (strcmp(fields[i].name, #NAME) == 0) {                   \
+                field_found = true;                                     \
+                fields[i].array_field_info.builtin_type = BUILTIN_TYPE; \
+                break;                                                  \
+            }                                                           \
+        }                                                               \
+        assert(field_found && "Field " #NAME " not found in union");    \
+    }
+
+#define S_FIELD_SET_OPT(NAME, OPT)                                    \
+    {                                                                 \
+        bool field_found = false;                                     \
+        for (size_t i = 0; i < info.field_count; i++) {               \
+            if (strcmp(fields[i].name, #NAME) == 0) {                 \
+                field_found = true;                                   \
+                fields[i].opts |= OPT;                                \
+                break;                                                \
+            }                                                         \
+        }                                                             \
+        assert(field_found && "Field " #NAME " not found in struct"); \
+    }
+
+#define S_FIELD_SET_VARINT(NAME) S_FIELD_SET_OPT(NAME, S_FIELD_OPT_VARINT)
+#define S_FIELD_SET_MAP_HASHED(NAME) \
+    S_FIELD_SET_OPT(NAME, S_FIELD_OPT_MAP_HASHED)
+#define S_FIELD_SET_BOOL_PACKED(NAME) \
+    S_FIELD_SET_OPT(NAME, S_FIELD_OPT_BOOL_PACKED)
+
+// Float and double fields and float builtin arrays sent with fewer bytes per
+// value (see quantize.h): half precision, or fixed point -- value * SCALE
+// rounded to 16- or 32-bit integer.
+#define S_FIELD_SET_HALF(NAME) S_FIELD_SET_OPT(NAME, S_FIELD_OPT_HALF)
+
+#define S_FIELD_SET_FIXED_SIZED(NAME, SCALE, SIZE)                    \
+    {                                                                 \
+        bool field_found = false;                                     \
+        assert((SCALE) > 0 && "Fixed-point scale must be positive");  \
+        for (size_t i = 0; i < info.field_count; i++) {               \
+            if (strcmp(fields[i].name, #NAME) == 0) {                 \
+                field_found = true;                                   \
+                fields[i].opts |= S_FIELD_OPT_FIXED;                  \
+                fields[i].quantized_field_info.scale = (SCALE);       \
+                fields[i].quantized_field_info.size = (SIZE);         \
+                break;                                                \
+            }                                                         \
+        }                                                             \
+        assert(field_found && "Field " #NAME " not found in struct"); \
+    }
+#define S_FIELD_SET_FIXED16(NAME, SCALE) \
+    S_FIELD_SET_FIXED_SIZED(NAME, SCALE, sizeof(int16_t))
+#define S_FIELD_SET_FIXED32(NAME, SCALE) \
+    S_FIELD_SET_FIXED_SIZED(NAME, SCALE, sizeof(int32_t))
+
+// Bool fields that follow each other with S_FIELD_OPT_BOOL_PACKED go on the
+// wire as one bitmap element instead of an element per field. Bracketed by
+// S_BOOL_PACK_BEGIN/END, all bools in between are packed; union members never
+// are.
+#define S_BOOL_PACK_BEGIN() \
+    {                       \
+        size_t pack_start_field_index = info.field_count;
+
+#define S_BOOL_PACK_END()                                                \
+    for (size_t i = pack_start_field_index; i < info.field_count; i++) { \
+        if (fields[i].type == FIELD_TYPE_BOOL)                           \
+            fields[i].opts |= S_FIELD_OPT_BOOL_PACKED;                   \
+    }                                                                    \
     }
 
 #define S_FIELD_ARRAY_STATIC_LABELED(NAME, SIZE, FIELD_LABEL, ...)    \
@@ -424,7 +823,9 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
     fields[info.field_count - 1].array_field_info.size_field_offset = \
         offsetof(struct_type, SIZE);                                  \
     fields[info.field_count - 1].array_field_info.builtin_type =      \
-        S_ARRAY_BUILTIN_TYPE_BLOB;
+        S_ARRAY_BUILTIN_TYPE_BLOB;                                    \
+    fields[info.field_count - 1].array_field_info.capacity =          \
+        sizeof(dummy.NAME) / sizeof(dummy.NAME[0]);
 #define S_FIELD_ARRAY_STATIC(...)                          \
     GET_MACRO_3(__VA_ARGS__, S_FIELD_ARRAY_STATIC_LABELED, \
                 S_FIELD_ARRAY_STATIC_LABELED)(__VA_ARGS__, NULL)
@@ -447,17 +848,19 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
                                             ...)                           \
     assert(info.field_count < S_MAX_FIELDS && "Too many fields");          \
     fields[info.field_count++] =                                           \
-        (s_field_info) {.name = #NAME,                                     \
-                        .label = FIELD_LABEL,                              \
-                        .type = FIELD_TYPE_ARRAY,                          \
+        (s_field_info) {.type = FIELD_TYPE_ARRAY,                          \
+                        .opts = S_FIELD_OPT_NONE,                          \
                         .offset = offsetof(struct_type, NAME),             \
                         .size = sizeof(dummy.NAME[0]),                     \
-                        .opts = S_FIELD_OPT_NONE,                          \
-                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE)}; \
+                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE),  \
+                        .name = #NAME,                                     \
+                        .label = FIELD_LABEL};                             \
     fields[info.field_count - 1].array_field_info.size_field_size =        \
         sizeof(dummy.SIZE);                                                \
     fields[info.field_count - 1].array_field_info.size_field_offset =      \
-        offsetof(struct_type, SIZE);
+        offsetof(struct_type, SIZE);                                       \
+    fields[info.field_count - 1].array_field_info.capacity =               \
+        sizeof(dummy.NAME) / sizeof(dummy.NAME[0]);
 #define S_FIELD_STRUCT_ARRAY_STATIC(...)                          \
     GET_MACRO_4(__VA_ARGS__, S_FIELD_STRUCT_ARRAY_STATIC_LABELED, \
                 S_FIELD_STRUCT_ARRAY_STATIC_LABELED)(__VA_ARGS__, NULL)
@@ -466,13 +869,13 @@ s_serializer_error s_deserialize(s_deserialize_options opts,
                                              ...)                           \
     assert(info.field_count < S_MAX_FIELDS && "Too many fields");           \
     fields[info.field_count++] =                                            \
-        (s_field_info) {.name = #NAME,                                      \
-                        .label = FIELD_LABEL,                               \
-                        .type = FIELD_TYPE_ARRAY,                           \
+        (s_field_info) {.type = FIELD_TYPE_ARRAY,                           \
+                        .opts = S_FIELD_OPT_ARRAY_DYNAMIC,                  \
                         .offset = offsetof(struct_type, NAME),              \
                         .size = sizeof(*dummy.NAME),                        \
-                        .opts = S_FIELD_OPT_ARRAY_DYNAMIC,                  \
-                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE)};  \
+                        .struct_type_info = S_GET_STRUCT_TYPE_INFO(TYPE),   \
+                        .name = #NAME,                                      \
+                        .label = FIELD_LABEL};                              \
     fields[info.field_count - 1].array_field_info.size_field_size =         \
         sizeof(dummy.SIZE);                                                 \
     fields[info.field_count - 1].array_field_info.size_field_offset =       \
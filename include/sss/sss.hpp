@@ -0,0 +1,689 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __SSS_HPP__
+#define __SSS_HPP__
+
+#include "sss.h"
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+// C++17 schemas: fields of a type are declared once as constexpr descriptors
+// and encode/decode are instantiated per type, with offsets, sizes and union
+// tags known at compile time. type_info<T>() exports the same schema as
+// s_type_info for the C API (json, delta, other wire formats).
+//
+//   template <> struct sss::schema<candidate> {
+//       static constexpr const char* name = "candidate"; // optional
+//       static constexpr auto fields = sss::fields(
+//           sss::field<&candidate::identifier>("identifier"),
+//           sss::field<&candidate::index>("index"),
+//           sss::array<&candidate::values, &candidate::n_values>("values"));
+//   };
+//
+// Descriptors:
+//   field<M...>    scalar, enum, string (char*, const char*, char[N]) or
+//                  struct with a schema; M... is a path of member pointers,
+//                  e.g. &protocol::data, &decltype(protocol::data)::c
+//   blob<M...>     any member as raw bytes
+//   array<M, S>    static (E[N]) or dynamic (E*) array of scalars or structs,
+//                  S is the member holding number of elements
+//   tagged<Tag, Value, M...>
+//                  field that is present only if member Tag equals Value
+//                  (union members), same as S_FIELD_TAGGED_INT
+//
+// Compiled codecs produce and read wire format v1 without field ids, the
+// output of s_serialize with default options. Other options, and input the
+// compiled decoder doesn't expect (field ids, varints, compact format), go
+// through the C API with type_info<T>().
+
+namespace sss {
+
+// specialised for every serializable type, with constexpr tuple `fields`
+template <typename T>
+struct schema;
+
+namespace detail {
+
+// element tags of wire format v1, see tlv_tag
+enum : uint16_t {
+    k_tag_field = 0x01,
+    k_tag_nested = 0x02,
+    k_tag_list = 0x03,
+    k_tag_nested_list = 0x04,
+};
+
+constexpr size_t k_header_size = 6; // uint16_t tag, uint32_t length
+
+enum class kind { scalar, string, blob, structure, array };
+
+template <typename T, typename = void>
+struct has_schema : std::false_type {};
+template <typename T>
+struct has_schema<T, std::void_t<decltype(schema<T>::fields)>>
+    : std::true_type {};
+
+// optional `name` of schema, type_name of exported s_type_info
+template <typename T, typename = void>
+struct schema_name {
+    static constexpr const char* value = "";
+};
+template <typename T>
+struct schema_name<T, std::void_t<decltype(schema<T>::name)>> {
+    static constexpr const char* value = schema<T>::name;
+};
+
+template <typename C, typename M>
+C class_of(M C::*);
+
+// path of member pointers from the owner struct to the field
+template <auto First, auto... Rest>
+struct path {
+    using owner = decltype(class_of(First));
+
+    template <typename O>
+    static constexpr auto& get(O& obj) {
+        if constexpr (sizeof...(Rest) == 0)
+            return obj.*First;
+        else
+            return path<Rest...>::get(obj.*First);
+    }
+
+    using type = std::remove_reference_t<decltype(get(
+        std::declval<owner&>()))>;
+};
+
+template <typename O, typename M>
+size_t offset_in(const O& obj, const M& member) {
+    return static_cast<size_t>(reinterpret_cast<const uint8_t*>(&member) -
+                               reinterpret_cast<const uint8_t*>(&obj));
+}
+
+struct no_tag {
+    template <typename O>
+    static constexpr bool is_present(const O&) {
+        return true;
+    }
+
+    template <typename O>
+    static void fill(const O&, s_field_info&) {}
+};
+
+template <auto Member, int Value>
+struct int_tag {
+    template <typename O>
+    static constexpr bool is_present(const O& obj) {
+        return static_cast<int32_t>(obj.*Member) == Value;
+    }
+
+    template <typename O>
+    static void fill(const O& dummy, s_field_info& info) {
+        info.opts |= S_FIELD_OPT_OPTIONAL;
+        info.optional_field_info.tag_type = FIELD_TYPE_INT32;
+        info.optional_field_info.tag_value_int = Value;
+        info.optional_field_info.tag_offset = offset_in(dummy, dummy.*Member);
+    }
+};
+
+template <kind K, typename Path, typename SizePath, typename Tag>
+struct field_desc {
+    static constexpr kind field_kind = K;
+    using path_type = Path;
+    using size_path = SizePath; // arrays only
+    using tag_type = Tag;
+
+    const char* name;
+    const char* label;
+};
+
+template <typename X>
+constexpr kind field_kind_of() {
+    using E = std::remove_extent_t<X>;
+
+    if constexpr (std::is_arithmetic_v<X> || std::is_enum_v<X>)
+        return kind::scalar;
+    else if constexpr (std::is_same_v<std::remove_cv_t<E>, char> ||
+                       (std::is_pointer_v<X> &&
+                        std::is_same_v<std::remove_cv_t<
+                                           std::remove_pointer_t<X>>,
+                                       char>))
+        return kind::string;
+    else {
+        static_assert(has_schema<X>::value,
+                      "Field type has no sss::schema, use sss::blob for raw "
+                      "bytes");
+        return kind::structure;
+    }
+}
+
+template <typename X>
+constexpr s_field_type field_type_of() {
+    if constexpr (std::is_enum_v<X>) {
+        return FIELD_TYPE_INT32; // same as S_FIELD_ENUM
+    } else if constexpr (std::is_same_v<X, bool>) {
+        return FIELD_TYPE_BOOL;
+    } else if constexpr (std::is_same_v<X, float>) {
+        return FIELD_TYPE_FLOAT;
+    } else if constexpr (std::is_same_v<X, double>) {
+        return FIELD_TYPE_DOUBLE;
+    } else {
+        static_assert(std::is_integral_v<X>, "Unsupported scalar type");
+
+        constexpr bool is_signed = std::is_signed_v<X>;
+
+        if constexpr (sizeof(X) == 1)
+            return is_signed ? FIELD_TYPE_INT8 : FIELD_TYPE_UINT8;
+        else if constexpr (sizeof(X) == 2)
+            return is_signed ? FIELD_TYPE_INT16 : FIELD_TYPE_UINT16;
+        else if constexpr (sizeof(X) == 4)
+            return is_signed ? FIELD_TYPE_INT32 : FIELD_TYPE_UINT32;
+        else
+            return is_signed ? FIELD_TYPE_INT64 : FIELD_TYPE_UINT64;
+    }
+}
+
+// array helpers: element type, capacity (0 -- dynamic)
+template <typename X>
+struct array_traits {
+    static_assert(std::is_pointer_v<X>,
+                  "Array field must be E[N] or E* member");
+
+    using element = std::remove_cv_t<std::remove_pointer_t<X>>;
+    static constexpr size_t capacity = 0;
+};
+
+template <typename E, size_t N>
+struct array_traits<E[N]> {
+    using element = std::remove_cv_t<E>;
+    static constexpr size_t capacity = N;
+};
+
+template <typename SizePath, typename O>
+uint32_t array_size(const O& obj) {
+    return static_cast<uint32_t>(SizePath::get(obj));
+}
+
+// bounded output, element headers of nested values are written after them
+struct writer {
+    uint8_t* data;
+    size_t size;
+    size_t length;
+    bool is_ok;
+
+    bool reserve(size_t n) {
+        if (size - length < n)
+            is_ok = false;
+
+        return is_ok;
+    }
+
+    void write_header(size_t at, uint16_t tag, size_t value_length) {
+        uint32_t l = static_cast<uint32_t>(value_length);
+
+        data[at] = static_cast<uint8_t>(tag >> 8);
+        data[at + 1] = static_cast<uint8_t>(tag);
+        data[at + 2] = static_cast<uint8_t>(l >> 24);
+        data[at + 3] = static_cast<uint8_t>(l >> 16);
+        data[at + 4] = static_cast<uint8_t>(l >> 8);
+        data[at + 5] = static_cast<uint8_t>(l);
+    }
+
+    void element(uint16_t tag, const void* value, size_t value_length) {
+        if (!reserve(k_header_size + value_length))
+            return;
+
+        write_header(length, tag, value_length);
+
+        if (value_length)
+            std::memcpy(data + length + k_header_size, value, value_length);
+
+        length += k_header_size + value_length;
+    }
+
+    size_t begin_nested() {
+        size_t at = length;
+
+        if (reserve(k_header_size))
+            length += k_header_size;
+
+        return at;
+    }
+
+    void end_nested(size_t at, uint16_t tag) {
+        if (is_ok)
+            write_header(at, tag, length - at - k_header_size);
+    }
+};
+
+template <typename T>
+void encode_struct(const T& obj, writer& w);
+
+template <typename O, typename F>
+void encode_field(const O& obj, const F&, writer& w) {
+    using path_type = typename F::path_type;
+    using X = std::remove_cv_t<typename path_type::type>;
+
+    if (!F::tag_type::is_present(obj))
+        return;
+
+    const auto& value = path_type::get(obj);
+
+    if constexpr (F::field_kind == kind::scalar ||
+                  F::field_kind == kind::blob) {
+        w.element(k_tag_field, &value, sizeof(X));
+    } else if constexpr (F::field_kind == kind::string) {
+        const char* str = value;
+
+        w.element(k_tag_field, str, str ? std::strlen(str) + 1 : 0);
+    } else if constexpr (F::field_kind == kind::structure) {
+        size_t at = w.begin_nested();
+
+        encode_struct(value, w);
+        w.end_nested(at, k_tag_nested);
+    } else {
+        using traits = array_traits<X>;
+        using E = typename traits::element;
+
+        uint32_t n = array_size<typename F::size_path>(obj);
+        const E* elements = value;
+
+        if (traits::capacity && n > traits::capacity) {
+            w.is_ok = false;
+            return;
+        }
+
+        if constexpr (has_schema<E>::value) {
+            size_t at = w.begin_nested();
+
+            for (uint32_t i = 0; i < n; i++)
+                encode_struct(elements[i], w);
+
+            w.end_nested(at, k_tag_nested_list);
+        } else {
+            w.element(k_tag_list, elements, n * sizeof(E));
+        }
+    }
+}
+
+template <typename T>
+void encode_struct(const T& obj, writer& w) {
+    std::apply([&](const auto&... f) { (encode_field(obj, f, w), ...); },
+               schema<T>::fields);
+}
+
+// input of the compiled decoder, fails on anything but expected elements
+struct reader {
+    const uint8_t* data;
+    const uint8_t* end;
+    const s_deserialize_options* opts;
+
+    bool read(uint16_t tag, const uint8_t** value, size_t* value_length) {
+        if (static_cast<size_t>(end - data) < k_header_size)
+            return false;
+
+        uint16_t el_tag = static_cast<uint16_t>((data[0] << 8) | data[1]);
+        uint32_t l = (static_cast<uint32_t>(data[2]) << 24) |
+                     (static_cast<uint32_t>(data[3]) << 16) |
+                     (static_cast<uint32_t>(data[4]) << 8) |
+                     static_cast<uint32_t>(data[5]);
+
+        if (el_tag != tag ||
+            l > static_cast<size_t>(end - data) - k_header_size)
+            return false;
+
+        *value = data + k_header_size;
+        *value_length = l;
+        data += k_header_size + l;
+
+        return true;
+    }
+
+    void* allocate(size_t size) const {
+        return opts->allocator->allocate(size, opts->user_data);
+    }
+};
+
+template <typename T>
+bool decode_struct(T& obj, reader& r);
+
+template <typename O, typename F>
+bool decode_field(O& obj, const F&, reader& r) {
+    using path_type = typename F::path_type;
+    using X = std::remove_cv_t<typename path_type::type>;
+
+    if (!F::tag_type::is_present(obj))
+        return true;
+
+    auto& value = path_type::get(obj);
+    const uint8_t* v = nullptr;
+    size_t l = 0;
+
+    if constexpr (F::field_kind == kind::scalar ||
+                  F::field_kind == kind::blob) {
+        if (!r.read(k_tag_field, &v, &l) || l != sizeof(X))
+            return false;
+
+        std::memcpy(&value, v, l);
+    } else if constexpr (F::field_kind == kind::string) {
+        if (!r.read(k_tag_field, &v, &l))
+            return false;
+
+        if constexpr (std::is_array_v<X>) {
+            if (l > sizeof(X))
+                return false;
+
+            std::memcpy(value, v, l);
+        } else if (l) {
+            char* str = static_cast<char*>(r.allocate(l));
+
+            if (!str)
+                return false;
+
+            std::memcpy(str, v, l);
+            value = str;
+        }
+    } else if constexpr (F::field_kind == kind::structure) {
+        if (!r.read(k_tag_nested, &v, &l))
+            return false;
+
+        reader sub = {v, v + l, r.opts};
+
+        return decode_struct(value, sub) && sub.data == sub.end;
+    } else {
+        using traits = array_traits<X>;
+        using E = typename traits::element;
+        constexpr bool is_struct_array = has_schema<E>::value;
+
+        // number of elements must be known, i.e. size field comes first
+        uint32_t n = array_size<typename F::size_path>(obj);
+
+        if ((traits::capacity && n > traits::capacity) ||
+            !r.read(is_struct_array ? k_tag_nested_list : k_tag_list, &v, &l))
+            return false;
+
+        E* elements = nullptr;
+
+        if constexpr (traits::capacity) {
+            elements = value;
+        } else if (n) {
+            elements = static_cast<E*>(r.allocate(n * sizeof(E)));
+
+            if (!elements)
+                return false;
+
+            std::memset(static_cast<void*>(elements), 0, n * sizeof(E));
+            value = elements;
+        }
+
+        if constexpr (is_struct_array) {
+            reader sub = {v, v + l, r.opts};
+
+            for (uint32_t i = 0; i < n; i++) {
+                if (!decode_struct(elements[i], sub))
+                    return false;
+            }
+
+            return sub.data == sub.end;
+        } else {
+            if (l != n * sizeof(E))
+                return false;
+            if (l)
+                std::memcpy(static_cast<void*>(elements), v, l);
+        }
+    }
+
+    return true;
+}
+
+template <typename T>
+bool decode_struct(T& obj, reader& r) {
+    return std::apply(
+        [&](const auto&... f) { return (decode_field(obj, f, r) && ...); },
+        schema<T>::fields);
+}
+
+// releases what compiled decoder allocated before it gave up, obj was zeroed
+// before decoding
+template <typename T>
+void release_struct(T& obj, const s_deserialize_options& opts);
+
+template <typename O, typename F>
+void release_field(O& obj, const F&, const s_deserialize_options& opts) {
+    using path_type = typename F::path_type;
+    using X = std::remove_cv_t<typename path_type::type>;
+
+    if (!F::tag_type::is_present(obj))
+        return;
+
+    auto& value = path_type::get(obj);
+
+    if constexpr (F::field_kind == kind::string && std::is_pointer_v<X>) {
+        if (value)
+            opts.allocator->deallocate(const_cast<char*>(value),
+                                       opts.user_data);
+    } else if constexpr (F::field_kind == kind::structure) {
+        release_struct(value, opts);
+    } else if constexpr (F::field_kind == kind::array) {
+        using traits = array_traits<X>;
+        using E = typename traits::element;
+
+        E* elements = value;
+
+        if (!elements)
+            return;
+
+        if constexpr (has_schema<E>::value) {
+            uint32_t n = array_size<typename F::size_path>(obj);
+
+            if (traits::capacity && n > traits::capacity)
+                n = traits::capacity;
+
+            for (uint32_t i = 0; i < n; i++)
+                release_struct(elements[i], opts);
+        }
+
+        if constexpr (!traits::capacity)
+            opts.allocator->deallocate(elements, opts.user_data);
+    }
+}
+
+template <typename T>
+void release_struct(T& obj, const s_deserialize_options& opts) {
+    std::apply([&](const auto&... f) { (release_field(obj, f, opts), ...); },
+               schema<T>::fields);
+}
+
+template <typename T>
+const s_type_info* build_type_info();
+
+template <typename O, typename F>
+s_field_info make_field_info(const O& dummy, const F& f) {
+    using path_type = typename F::path_type;
+    using X = std::remove_cv_t<typename path_type::type>;
+
+    const auto& value = path_type::get(dummy);
+    s_field_info info = {};
+
+    info.offset = offset_in(dummy, value);
+    info.size = sizeof(X);
+    info.opts = S_FIELD_OPT_NONE;
+    info.name = f.name;
+    info.label = f.label;
+
+    if constexpr (F::field_kind == kind::scalar) {
+        info.type = field_type_of<X>();
+    } else if constexpr (F::field_kind == kind::blob) {
+        info.type = FIELD_TYPE_BLOB;
+    } else if constexpr (F::field_kind == kind::string) {
+        info.type = FIELD_TYPE_STRING;
+
+        if constexpr (std::is_array_v<X>)
+            info.opts |= S_FIELD_OPT_STRING_FIXED;
+    } else if constexpr (F::field_kind == kind::structure) {
+        info.type = FIELD_TYPE_STRUCT;
+        info.struct_type_info = const_cast<s_type_info*>(build_type_info<X>());
+    } else {
+        using traits = array_traits<X>;
+        using E = typename traits::element;
+        using S = std::remove_cv_t<typename F::size_path::type>;
+
+        info.type = FIELD_TYPE_ARRAY;
+        info.size = sizeof(E);
+        info.array_field_info.size_field_size = sizeof(S);
+        info.array_field_info.size_field_offset =
+            offset_in(dummy, F::size_path::get(dummy));
+        info.array_field_info.builtin_type = S_ARRAY_BUILTIN_TYPE_BLOB;
+        info.array_field_info.capacity = traits::capacity;
+
+        if constexpr (!traits::capacity)
+            info.opts |= S_FIELD_OPT_ARRAY_DYNAMIC;
+        if constexpr (has_schema<E>::value)
+            info.struct_type_info =
+                const_cast<s_type_info*>(build_type_info<E>());
+    }
+
+    F::tag_type::fill(dummy, info);
+
+    return info;
+}
+
+template <typename T>
+const s_type_info* build_type_info() {
+    using fields_type = std::remove_cv_t<decltype(schema<T>::fields)>;
+    constexpr size_t n_fields = std::tuple_size_v<fields_type>;
+
+    // function-local statics are initialised once, thread-safe
+    static const auto fields = [] {
+        static const T dummy = {};
+
+        return std::apply(
+            [](const auto&... f) {
+                return std::array<s_field_info, n_fields>{
+                    make_field_info(dummy, f)...};
+            },
+            schema<T>::fields);
+    }();
+    static const s_type_info info = [] {
+        s_type_info built = {};
+
+        built.type_name = schema_name<T>::value;
+        built.fields = fields.data();
+        built.field_count = n_fields;
+        built.type_size = sizeof(T);
+
+        built.schema_hash = s_type_info_hash(&built);
+        built.field_index = s_type_info_build_field_index(&built);
+
+        return built;
+    }();
+
+    return &info;
+}
+
+} // namespace detail
+
+template <typename... F>
+constexpr auto fields(F... f) {
+    return std::make_tuple(f...);
+}
+
+template <auto... Path>
+constexpr auto field(const char* name, const char* label = nullptr) {
+    using path_type = detail::path<Path...>;
+
+    return detail::field_desc<
+        detail::field_kind_of<std::remove_cv_t<typename path_type::type>>(),
+        path_type, void, detail::no_tag>{name, label};
+}
+
+template <auto... Path>
+constexpr auto blob(const char* name, const char* label = nullptr) {
+    return detail::field_desc<detail::kind::blob, detail::path<Path...>, void,
+                              detail::no_tag>{name, label};
+}
+
+template <auto Member, auto SizeMember>
+constexpr auto array(const char* name, const char* label = nullptr) {
+    return detail::field_desc<detail::kind::array, detail::path<Member>,
+                              detail::path<SizeMember>, detail::no_tag>{
+        name, label};
+}
+
+template <auto TagMember, int TagValue, auto... Path>
+constexpr auto tagged(const char* name, const char* label = nullptr) {
+    using path_type = detail::path<Path...>;
+
+    return detail::field_desc<
+        detail::field_kind_of<std::remove_cv_t<typename path_type::type>>(),
+        path_type, void, detail::int_tag<TagMember, TagValue>>{name, label};
+}
+
+// schema of T for the C API
+template <typename T>
+const s_type_info* type_info() {
+    return detail::build_type_info<T>();
+}
+
+// same as s_serialize(opts, type_info<T>(), &value, ...)
+template <typename T>
+s_serializer_error serialize(const s_serialize_options& opts, const T& value,
+                             uint8_t* buffer, size_t buffer_size,
+                             size_t* bytes_written) {
+    if (opts.use_varints || opts.use_compact_format || opts.use_field_ids ||
+        opts.omit_defaults || opts.use_schema_header)
+        return s_serialize(opts, type_info<T>(), &value, buffer, buffer_size,
+                           bytes_written);
+
+    if (!buffer || !bytes_written)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    detail::writer w = {buffer, buffer_size, 0, true};
+
+    detail::encode_struct(value, w);
+
+    if (!w.is_ok)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    *bytes_written = w.length;
+
+    return SERIALIZER_OK;
+}
+
+// same as s_deserialize(opts, type_info<T>(), &value, ...), value is zeroed
+// first
+template <typename T>
+s_serializer_error deserialize(const s_deserialize_options& opts, T& value,
+                               const uint8_t* buffer, size_t buffer_size) {
+    static_assert(std::is_trivially_copyable_v<T>,
+                  "Only C-layout structs can be deserialized");
+
+    if (opts.format != FORMAT_C_STRUCT || !opts.allocator || !buffer)
+        return s_deserialize(opts, type_info<T>(), &value, buffer,
+                             buffer_size);
+
+    std::memset(static_cast<void*>(&value), 0, sizeof(T));
+
+    detail::reader r = {buffer, buffer + buffer_size, &opts};
+
+    if (detail::decode_struct(value, r) && r.data == r.end)
+        return SERIALIZER_OK;
+
+    // not a plain v1 message, let the generic decoder handle it
+    detail::release_struct(value, opts);
+    std::memset(static_cast<void*>(&value), 0, sizeof(T));
+
+    return s_deserialize(opts, type_info<T>(), &value, buffer, buffer_size);
+}
+
+} // namespace sss
+
+#endif
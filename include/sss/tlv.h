@@ -8,6 +8,7 @@
 #ifndef __TLV_H__
 #define __TLV_H__
 
+#include "bits.h"
 #include "sss.h"
 
 typedef enum {
@@ -21,11 +22,83 @@ typedef enum {
 
     TLV_TAG_COMPRESSED_NESTED,
     TLV_TAG_ENCRYPTED_NESTED,
+
+    TLV_TAG_VARINT, // integer scalar as LEB128 varint (zigzag for signed)
+
+    // delta encoding: value starts with varint index of the first array
+    // element, followed by elements as in LIST and NESTED_LIST
+    TLV_TAG_LIST_RANGE,
+    TLV_TAG_NESTED_LIST_RANGE,
+
+    // starts next struct of NESTED_LIST and NESTED_LIST_RANGE with field ids,
+    // has no value and no id
+    TLV_TAG_NESTED_LIST_EL,
 } tlv_tag;
 
+typedef enum {
+    TLV_ENCODE_FLAG_NONE = 0,
+    TLV_ENCODE_FLAG_VARINT = 1 << 0,  // all integer scalars as varints
+    TLV_ENCODE_FLAG_COMPACT = 1 << 1, // compact wire format (v2)
+    TLV_ENCODE_FLAG_FIELD_IDS = 1 << 2,     // field id in element headers
+    TLV_ENCODE_FLAG_OMIT_DEFAULTS = 1 << 3, // skip zero fields, implies ids
+} tlv_encode_flags;
+
+// Compact wire format (v2) starts with a two-byte prefix: magic and version.
+// Elements use 1-byte tags and varint lengths instead of the 6-byte header of
+// v1. v1 streams never start with the magic byte, so s_tlv_decode tells the
+// formats apart by the first byte.
+#define TLV_COMPACT_MAGIC (0xC5)
+#define TLV_COMPACT_VERSION (0x02)
+#define TLV_COMPACT_PREFIX_SIZE (2)
+
+// Schema header (S_SCHEMA_HEADER_SIZE bytes) goes before either format. Its
+// magic is neither the compact magic nor a v1 tag high byte (at most
+// TLV_MAX_FIELD_ID + 1).
+#define TLV_SCHEMA_HEADER_MAGIC (0xA5)
+#define TLV_SCHEMA_HEADER_VERSION (0x01)
+
+// Field ids are indices of fields in s_type_info. When present, v1 stores
+// (id + 1) in the high byte of the tag; compact format sets the high bit of
+// the tag and writes the id as a varint between tag and length. Elements
+// without an id are matched to fields by their order. With ids, fields of a
+// struct may come in any order and each struct of a struct array starts with
+// a TLV_TAG_NESTED_LIST_EL element, so omitted fields never shift elements.
+// Encoder writes ids in ascending order and decoder fills omitted fields in
+// as larger ids pass them, so output keeps declaration order (a field that
+// comes after a larger id overrides its default).
+#define TLV_MAX_FIELD_ID (S_MAX_FIELDS - 1)
+#define TLV_NO_FIELD_ID (-1)
+
+// blobs larger than this are always encoded, even if all bytes are zero
+#define TLV_MAX_DEFAULT_BLOB_SIZE (256)
+
+// Bool arrays of S_ARRAY_BUILTIN_TYPE_BITS are LIST elements holding a bit
+// string: number of unused bits of the last byte, then the bitmap (bits.h);
+// empty arrays have no value. Packed bools are a single FIELD element of the
+// first of them, holding the bitmap of all.
+#define TLV_BIT_STRING_SIZE(n) ((n) ? 1 + S_BITS_SIZE(n) : 0)
+
+// longest LEB128 encoding of a 64-bit value
+#define TLV_VARINT_MAX_SIZE (10)
+
+#define S_ZIGZAG_ENCODE(v) \
+    ((((uint64_t) (v)) << 1) ^ (uint64_t) (((int64_t) (v)) >> 63))
+#define S_ZIGZAG_DECODE(u) \
+    ((int64_t) (((uint64_t) (u)) >> 1) ^ -(int64_t) (((uint64_t) (u)) & 1))
+
 s_serializer_error s_tlv_encode(const s_type_info* info, const void* data,
                                 uint8_t* buffer, size_t buffer_size,
                                 size_t* bytes_written);
+// same as s_tlv_encode, flags is a combination of tlv_encode_flags
+s_serializer_error s_tlv_encode_ex(const s_type_info* info, const void* data,
+                                   uint32_t flags, uint8_t* buffer,
+                                   size_t buffer_size, size_t* bytes_written);
+// encodes fields of cur that differ from prev, always with field ids
+s_serializer_error s_tlv_encode_delta(const s_type_info* info,
+                                      const void* prev, const void* cur,
+                                      uint32_t flags, uint8_t* buffer,
+                                      size_t buffer_size,
+                                      size_t* bytes_written);
 
 typedef struct {
     int idx;
@@ -33,6 +106,8 @@ typedef struct {
     uint16_t type;
     uint32_t length;
     const uint8_t* value;
+    int field_id; // TLV_NO_FIELD_ID if element has no field id
+    uint32_t range_start; // first array element of range elements
 } s_tlv_decoded_element_data;
 
 typedef void (*s_tlv_element_cb)(
@@ -40,7 +115,26 @@ typedef void (*s_tlv_element_cb)(
 s_serializer_error s_tlv_decode(const uint8_t* buffer, size_t buffer_size,
                                 s_tlv_element_cb cb, void* user_data);
 
+// varints
+// returns number of bytes written to out (at most TLV_VARINT_MAX_SIZE)
+size_t s_tlv_varint_encode(uint64_t value, uint8_t* out);
+// returns number of bytes consumed, 0 if buffer holds no valid varint or one
+// that doesn't fit 64 bits
+size_t s_tlv_varint_decode(const uint8_t* buffer, size_t buffer_size,
+                           uint64_t* value);
+
+// number of bools in bit string value, false if value is not a bit string
+bool s_tlv_bit_string_count(const uint8_t* value, uint32_t length,
+                            uint32_t* count);
+
 // helpers
 const char* s_print_decoded_data(s_tlv_decoded_element_data* el);
+// reads number of elements of array field from its size field
+s_serializer_error s_tlv_array_size(const s_field_info* field, const void* data,
+                                    uint32_t* array_size);
+// writes number of elements of array field to its size field, false if it
+// doesn't fit there
+bool s_tlv_set_array_size(const s_field_info* field, void* data,
+                          uint32_t array_size);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,262 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss/base64.h"
+
+// SSE2 has no byte shuffle, so vector code needs SSSE3: used directly when
+// enabled at compile time, otherwise picked at run time on x86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define S_BASE64_SSSE3
+#include <tmmintrin.h>
+#endif
+
+// system includes
+#include <string.h>
+
+static const char k_alphabet[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+// 6-bit values of base64 characters, 0xFF for everything else
+static const uint8_t k_values[256] = {
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+    0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+    0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10, 0x11, 0x12,
+    0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20, 0x21, 0x22, 0x23, 0x24,
+    0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+    0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+    0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+#if defined(S_BASE64_SSSE3)
+static bool s_base64_has_ssse3(void) {
+#if defined(__SSSE3__)
+    return true;
+#else
+    return __builtin_cpu_supports("ssse3");
+#endif
+}
+
+// 12 bytes into 16 characters per step (Mula, Lemire), reads 16 bytes at a
+// time; returns number of bytes encoded
+__attribute__((target("ssse3"))) static size_t
+s_base64_encode_ssse3(const uint8_t* data, size_t size, char* out) {
+    const __m128i k_shuffle =
+        _mm_set_epi8(10, 11, 9, 10, 7, 8, 6, 7, 4, 5, 3, 4, 1, 2, 0, 1);
+    // offsets from 6-bit values to characters by value range
+    const __m128i k_offsets = _mm_setr_epi8(
+        'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+        '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62, '/' - 63, 'A', 0, 0);
+    size_t i = 0;
+
+    for (; i + 16 <= size; i += 12, out += 16) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (data + i));
+
+        // spread every 3 bytes over 4 lanes, then move 6-bit groups in place
+        in = _mm_shuffle_epi8(in, k_shuffle);
+
+        __m128i hi =
+            _mm_mulhi_epu16(_mm_and_si128(in, _mm_set1_epi32(0x0fc0fc00)),
+                            _mm_set1_epi32(0x04000040));
+        __m128i lo =
+            _mm_mullo_epi16(_mm_and_si128(in, _mm_set1_epi32(0x003f03f0)),
+                            _mm_set1_epi32(0x01000010));
+        __m128i values = _mm_or_si128(hi, lo);
+
+        // 0..25 -> 13, 26..51 -> 0, 52..63 -> 1..12
+        __m128i range = _mm_subs_epu8(values, _mm_set1_epi8(51));
+        __m128i is_upper = _mm_cmpgt_epi8(_mm_set1_epi8(26), values);
+
+        range =
+            _mm_or_si128(range, _mm_and_si128(is_upper, _mm_set1_epi8(13)));
+        _mm_storeu_si128(
+            (__m128i*) out,
+            _mm_add_epi8(values, _mm_shuffle_epi8(k_offsets, range)));
+    }
+
+    return i;
+}
+
+// 16 characters into 12 bytes per step; returns number of characters
+// decoded, *is_valid is false if invalid character was met
+__attribute__((target("ssse3"))) static size_t
+s_base64_decode_ssse3(const char* str, size_t len, uint8_t* out,
+                      bool* is_valid) {
+    // characters are classified by low and high nibbles, valid ones have no
+    // common bits in both lookups
+    const __m128i k_lo_classes =
+        _mm_setr_epi8(0x15, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x11,
+                      0x11, 0x13, 0x1A, 0x1B, 0x1B, 0x1B, 0x1A);
+    const __m128i k_hi_classes =
+        _mm_setr_epi8(0x10, 0x10, 0x01, 0x02, 0x04, 0x08, 0x04, 0x08, 0x10,
+                      0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10);
+    // offsets from characters to 6-bit values by high nibble ('/' is 0)
+    const __m128i k_offsets = _mm_setr_epi8(0, 16, 19, 4, -65, -65, -71, -71,
+                                            0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i k_pack = _mm_setr_epi8(2, 1, 0, 6, 5, 4, 10, 9, 8, 14, 13,
+                                         12, -1, -1, -1, -1);
+    const __m128i k_2f = _mm_set1_epi8(0x2F);
+    size_t i = 0;
+
+    *is_valid = true;
+
+    for (; i + 16 <= len; i += 16, out += 12) {
+        __m128i in = _mm_loadu_si128((const __m128i*) (str + i));
+        __m128i hi_nibbles = _mm_and_si128(_mm_srli_epi32(in, 4), k_2f);
+        __m128i lo = _mm_shuffle_epi8(k_lo_classes, _mm_and_si128(in, k_2f));
+        __m128i hi = _mm_shuffle_epi8(k_hi_classes, hi_nibbles);
+
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(lo, hi),
+                                             _mm_setzero_si128())) != 0xFFFF) {
+            *is_valid = false;
+            break;
+        }
+
+        __m128i is_slash = _mm_cmpeq_epi8(in, k_2f);
+        __m128i values = _mm_add_epi8(
+            in,
+            _mm_shuffle_epi8(k_offsets, _mm_add_epi8(is_slash, hi_nibbles)));
+
+        // pack 4 6-bit values into 3 bytes
+        values = _mm_maddubs_epi16(values, _mm_set1_epi32(0x01400140));
+        values = _mm_madd_epi16(values, _mm_set1_epi32(0x00011000));
+        values = _mm_shuffle_epi8(values, k_pack);
+
+        uint8_t bytes[16];
+
+        _mm_storeu_si128((__m128i*) bytes, values);
+        memcpy(out, bytes, 12);
+    }
+
+    return i;
+}
+#endif
+
+size_t s_base64_encode(const uint8_t* data, size_t size, char* out) {
+    char* start = out;
+    size_t i = 0;
+
+#if defined(S_BASE64_SSSE3)
+    if (size >= 16 && s_base64_has_ssse3()) {
+        i = s_base64_encode_ssse3(data, size, out);
+        out += i / 3 * 4;
+    }
+#endif
+
+    for (; i + 3 <= size; i += 3, out += 4) {
+        uint32_t v = (uint32_t) data[i] << 16 | (uint32_t) data[i + 1] << 8 |
+                     data[i + 2];
+
+        out[0] = k_alphabet[v >> 18];
+        out[1] = k_alphabet[v >> 12 & 0x3F];
+        out[2] = k_alphabet[v >> 6 & 0x3F];
+        out[3] = k_alphabet[v & 0x3F];
+    }
+
+    if (i < size) {
+        uint32_t v = (uint32_t) data[i] << 16;
+
+        if (i + 1 < size)
+            v |= (uint32_t) data[i + 1] << 8;
+
+        out[0] = k_alphabet[v >> 18];
+        out[1] = k_alphabet[v >> 12 & 0x3F];
+        out[2] = i + 1 < size ? k_alphabet[v >> 6 & 0x3F] : '=';
+        out[3] = '=';
+        out += 4;
+    }
+
+    return (size_t) (out - start);
+}
+
+size_t s_base64_decoded_size(const char* str, size_t len) {
+    if (len % 4)
+        return SIZE_MAX;
+
+    if (!len)
+        return 0;
+
+    return len / 4 * 3 - (str[len - 1] == '=') -
+           (str[len - 1] == '=' && str[len - 2] == '=');
+}
+
+bool s_base64_decode(const char* str, size_t len, uint8_t* out) {
+    const uint8_t* s = (const uint8_t*) str;
+    size_t i = 0;
+
+    if (len % 4)
+        return false;
+
+    if (!len)
+        return true;
+
+    // last 4 characters may have padding, they are decoded separately
+    len -= 4;
+
+#if defined(S_BASE64_SSSE3)
+    if (len >= 16 && s_base64_has_ssse3()) {
+        bool is_valid;
+
+        i = s_base64_decode_ssse3(str, len, out, &is_valid);
+
+        if (!is_valid)
+            return false;
+
+        out += i / 4 * 3;
+    }
+#endif
+
+    for (; i < len; i += 4, out += 3) {
+        uint8_t a = k_values[s[i]], b = k_values[s[i + 1]],
+                c = k_values[s[i + 2]], d = k_values[s[i + 3]];
+
+        if ((a | b | c | d) & 0x80)
+            return false;
+
+        uint32_t v = (uint32_t) a << 18 | (uint32_t) b << 12 |
+                     (uint32_t) c << 6 | d;
+
+        out[0] = (uint8_t) (v >> 16);
+        out[1] = (uint8_t) (v >> 8);
+        out[2] = (uint8_t) v;
+    }
+
+    // last quantum: "xx==", "xxx=" or "xxxx"
+    uint8_t a = k_values[s[i]], b = k_values[s[i + 1]];
+    uint8_t c = s[i + 2] == '=' ? 0 : k_values[s[i + 2]];
+    uint8_t d = s[i + 3] == '=' ? 0 : k_values[s[i + 3]];
+
+    if ((a | b | c | d) & 0x80 || (s[i + 2] == '=' && s[i + 3] != '='))
+        return false;
+
+    uint32_t v =
+        (uint32_t) a << 18 | (uint32_t) b << 12 | (uint32_t) c << 6 | d;
+
+    out[0] = (uint8_t) (v >> 16);
+
+    if (s[i + 2] != '=')
+        out[1] = (uint8_t) (v >> 8);
+
+    if (s[i + 3] != '=')
+        out[2] = (uint8_t) v;
+
+    return true;
+}
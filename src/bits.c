@@ -0,0 +1,122 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss/bits.h"
+
+// system includes
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#elif defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define S_BITS_SWAR
+#endif
+
+#define SWAR_ONES (0x0101010101010101ull)
+
+void s_bits_pack(const bool* values, size_t count, uint8_t* out) {
+    const uint8_t* bytes = (const uint8_t*) values;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+
+    // 16 bools at a time: mask of nonzero bytes is the bitmap
+    for (; i + 16 <= count; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (bytes + i));
+        int mask = ~_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, zero));
+
+        out[i / 8] = (uint8_t) mask;
+        out[i / 8 + 1] = (uint8_t) (mask >> 8);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t k_weights[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                          1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t weights = vld1q_u8(k_weights);
+
+    // 16 bools at a time: weights of nonzero bytes add up to the bitmap
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t chunk = vld1q_u8(bytes + i);
+        uint8x16_t bits = vandq_u8(vtstq_u8(chunk, chunk), weights);
+
+        out[i / 8] = vaddv_u8(vget_low_u8(bits));
+        out[i / 8 + 1] = vaddv_u8(vget_high_u8(bits));
+    }
+#elif defined(S_BITS_SWAR)
+    // 8 bools at a time: low bit of byte k is moved to bit k by multiplication
+    for (; i + 8 <= count; i += 8) {
+        uint64_t chunk;
+
+        memcpy(&chunk, bytes + i, sizeof(chunk));
+        chunk |= chunk >> 4;
+        chunk |= chunk >> 2;
+        chunk |= chunk >> 1;
+        out[i / 8] =
+            (uint8_t) (((chunk & SWAR_ONES) * 0x0102040810204080ull) >> 56);
+    }
+#endif
+
+    if (i == count)
+        return;
+
+    memset(out + i / 8, 0, S_BITS_SIZE(count) - i / 8);
+
+    for (; i < count; i++) {
+        if (bytes[i])
+            out[i / 8] |= (uint8_t) (1u << (i % 8));
+    }
+}
+
+void s_bits_unpack(const uint8_t* bits, size_t count, bool* out) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i select =
+        _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, (char) 128, 1, 2, 4, 8, 16, 32,
+                      64, (char) 128);
+    const __m128i one = _mm_set1_epi8(1);
+
+    // 16 bools at a time: each byte of the bitmap is spread over 8 lanes,
+    // each lane keeps its own bit
+    for (; i + 16 <= count; i += 16) {
+        __m128i spread =
+            _mm_unpacklo_epi64(_mm_set1_epi8((char) bits[i / 8]),
+                               _mm_set1_epi8((char) bits[i / 8 + 1]));
+        __m128i is_set =
+            _mm_cmpeq_epi8(_mm_and_si128(spread, select), select);
+
+        _mm_storeu_si128((__m128i*) (out + i), _mm_and_si128(is_set, one));
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    static const uint8_t k_select[16] = {1, 2, 4, 8, 16, 32, 64, 128,
+                                         1, 2, 4, 8, 16, 32, 64, 128};
+    const uint8x16_t select = vld1q_u8(k_select);
+    const uint8x16_t one = vdupq_n_u8(1);
+
+    for (; i + 16 <= count; i += 16) {
+        uint8x16_t spread =
+            vcombine_u8(vdup_n_u8(bits[i / 8]), vdup_n_u8(bits[i / 8 + 1]));
+
+        vst1q_u8((uint8_t*) out + i,
+                 vandq_u8(vtstq_u8(spread, select), one));
+    }
+#elif defined(S_BITS_SWAR)
+    // 8 bools at a time: byte k keeps bit k, which is then moved to its low
+    // bit
+    for (; i + 8 <= count; i += 8) {
+        uint64_t chunk = (bits[i / 8] * SWAR_ONES) & 0x8040201008040201ull;
+
+        chunk = ((chunk + 0x7F7F7F7F7F7F7F7Full) >> 7) & SWAR_ONES;
+        memcpy(out + i, &chunk, sizeof(chunk));
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = (bits[i / 8] >> (i % 8)) & 1;
+}
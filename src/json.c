@@ -0,0 +1,1859 @@
+/*
+ * Created on Sun Oct 18 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss/json.h"
+
+#include "sss/base64.h"
+#include "sss/log.h"
+#include "sss/number.h"
+#include "sss/quantize.h"
+#include "sss/serializer.h"
+
+// system includes
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+void s_json_flush(s_json_writer* w) {
+    if (w->err != SERIALIZER_OK || !w->sink || !w->length)
+        return;
+
+    if (!w->sink(w->data, w->length, w->sink_data)) {
+        LOG_DEBUG("ERROR (json): sink failed");
+        w->err = SERIALIZER_ERROR_SINK_FAILED;
+    }
+
+    w->length = 0;
+    w->data[0] = '\0';
+}
+
+// appends len bytes to json output, keeping it zero-terminated
+void s_json_append(s_json_writer* w, const char* str, size_t len) {
+    if (w->err != SERIALIZER_OK)
+        return;
+
+    // with sink, fill up and pass on whole chunks
+    while (w->sink && w->capacity - w->length <= len) {
+        size_t n = w->capacity - 1 - w->length;
+
+        memcpy(w->data + w->length, str, n);
+        w->length += n;
+        str += n;
+        len -= n;
+        s_json_flush(w);
+
+        if (w->err != SERIALIZER_OK)
+            return;
+    }
+
+    if (w->capacity - w->length <= len) {
+        LOG_DEBUG("ERROR (json): output buffer too small");
+        w->err = SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+        return;
+    }
+
+    char* cursor = w->data + w->length;
+
+    memcpy(cursor, str, len);
+    cursor[len] = '\0';
+    w->length += len;
+}
+
+void s_json_append_char(s_json_writer* w, char c) {
+    if (w->err != SERIALIZER_OK)
+        return;
+
+    if (w->capacity - w->length <= 1) {
+        s_json_flush(w);
+
+        if (w->err != SERIALIZER_OK)
+            return;
+
+        if (w->capacity - w->length <= 1) {
+            LOG_DEBUG("ERROR (json): output buffer too small");
+            w->err = SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+            return;
+        }
+    }
+
+    char* cursor = w->data + w->length++;
+
+    cursor[0] = c;
+    cursor[1] = '\0';
+}
+
+void s_json_append_base64(s_json_writer* w, const uint8_t* data,
+                          size_t size) {
+    size_t len = S_BASE64_ENCODED_SIZE(size) + 2; // with quotes
+
+    if (w->err != SERIALIZER_OK)
+        return;
+
+    // blob larger than what is left of chunk goes through in pieces
+    if (w->sink && w->capacity - w->length <= len) {
+        char buf[S_BASE64_ENCODED_SIZE(768)];
+
+        s_json_append_char(w, '"');
+
+        for (size_t i = 0; i < size; i += 768) {
+            size_t n = size - i < 768 ? size - i : 768;
+
+            s_json_append(w, buf, s_base64_encode(data + i, n, buf));
+        }
+
+        s_json_append_char(w, '"');
+        return;
+    }
+
+    if (w->capacity - w->length <= len) {
+        LOG_DEBUG("ERROR (json): output buffer too small");
+        w->err = SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+        return;
+    }
+
+    // encode straight into output
+    char* cursor = w->data + w->length;
+
+    cursor[0] = '"';
+    s_base64_encode(data, size, cursor + 1);
+    cursor[len - 1] = '"';
+    cursor[len] = '\0';
+    w->length += len;
+}
+
+void s_json_append_int(s_json_writer* w, int64_t value) {
+    char buf[S_NUMBER_MAX_CHARS];
+
+    s_json_append(w, buf, s_format_int64(value, buf));
+}
+
+void s_json_append_uint(s_json_writer* w, uint64_t value) {
+    char buf[S_NUMBER_MAX_CHARS];
+
+    s_json_append(w, buf, s_format_uint64(value, buf));
+}
+
+void s_json_append_float(s_json_writer* w, float value) {
+    char buf[S_NUMBER_MAX_CHARS];
+
+    s_json_append(w, buf, s_format_float(value, buf));
+}
+
+void s_json_append_double(s_json_writer* w, double value) {
+    char buf[S_NUMBER_MAX_CHARS];
+
+    s_json_append(w, buf, s_format_double(value, buf));
+}
+
+// bytes of 64-bit word that are zero / less than n have their high bit set
+#define SWAR_ONES (0x0101010101010101ull)
+#define SWAR_HIGHS (0x8080808080808080ull)
+#define SWAR_HAS_LESS(v, n) (((v) - SWAR_ONES * (n)) & ~(v) & SWAR_HIGHS)
+#define SWAR_HAS_ZERO(v) SWAR_HAS_LESS(v, 1)
+
+// index of first character that has to be escaped in json string, or len
+static size_t s_json_find_escape(const char* str, size_t len) {
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i max_control = _mm_set1_epi8(0x1F);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (str + i));
+        // unsigned chunk <= 0x1F
+        __m128i is_control =
+            _mm_cmpeq_epi8(_mm_max_epu8(chunk, max_control), max_control);
+        __m128i needs_escape =
+            _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, quote),
+                                      _mm_cmpeq_epi8(chunk, backslash)),
+                         is_control);
+        int mask = _mm_movemask_epi8(needs_escape);
+
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    const uint8x16_t quote = vdupq_n_u8('"');
+    const uint8x16_t backslash = vdupq_n_u8('\\');
+    const uint8x16_t min_printable = vdupq_n_u8(0x20);
+
+    for (; i + 16 <= len; i += 16) {
+        uint8x16_t chunk = vld1q_u8((const uint8_t*) str + i);
+        uint8x16_t needs_escape =
+            vorrq_u8(vorrq_u8(vceqq_u8(chunk, quote),
+                              vceqq_u8(chunk, backslash)),
+                     vcltq_u8(chunk, min_printable));
+
+        if (vmaxvq_u8(needs_escape))
+            break; // find exact position below
+    }
+#else
+    // 8 characters at a time, exact position is found below
+    for (; i + 8 <= len; i += 8) {
+        uint64_t chunk;
+
+        memcpy(&chunk, str + i, sizeof(chunk));
+
+        uint64_t needs_escape = SWAR_HAS_ZERO(chunk ^ (SWAR_ONES * '"')) |
+                                SWAR_HAS_ZERO(chunk ^ (SWAR_ONES * '\\')) |
+                                SWAR_HAS_LESS(chunk, 0x20);
+
+        if (needs_escape)
+            break;
+    }
+#endif
+
+    for (; i < len; i++) {
+        unsigned char c = (unsigned char) str[i];
+
+        if (c == '"' || c == '\\' || c < 0x20)
+            return i;
+    }
+
+    return len;
+}
+
+void s_json_append_string(s_json_writer* w, const char* str, size_t len) {
+    static const char k_hex_digits[] = "0123456789abcdef";
+
+    s_json_append_char(w, '"');
+
+    while (len) {
+        // copy characters that need no escaping in one go
+        size_t n = s_json_find_escape(str, len);
+
+        s_json_append(w, str, n);
+
+        if (n == len)
+            break;
+
+        unsigned char c = (unsigned char) str[n];
+        char escaped[6] = {'\\', (char) c};
+        size_t escaped_len = 2;
+
+        switch (c) {
+        case '"':
+        case '\\':
+            break;
+        case '\b':
+            escaped[1] = 'b';
+            break;
+        case '\f':
+            escaped[1] = 'f';
+            break;
+        case '\n':
+            escaped[1] = 'n';
+            break;
+        case '\r':
+            escaped[1] = 'r';
+            break;
+        case '\t':
+            escaped[1] = 't';
+            break;
+        default: { // other control characters
+            escaped[1] = 'u';
+            escaped[2] = '0';
+            escaped[3] = '0';
+            escaped[4] = k_hex_digits[c >> 4];
+            escaped[5] = k_hex_digits[c & 0xF];
+            escaped_len = 6;
+        } break;
+        }
+
+        s_json_append(w, escaped, escaped_len);
+        str += n + 1;
+        len -= n + 1;
+    }
+
+    s_json_append_char(w, '"');
+}
+
+
+// direct struct to json
+static void s_json_write_struct(s_json_writer* w, const s_type_info* info,
+                                const uint8_t* data);
+
+// quantized float as it comes out of the wire, same as s_deserialize writes
+static void s_json_write_quantized(s_json_writer* w, const s_field_info* field,
+                                   const uint8_t* value) {
+    uint8_t wire[sizeof(int32_t)];
+
+    s_quantize(field, value, 1, wire);
+
+    if (field->size == sizeof(double)) {
+        double dequantized;
+
+        s_dequantize(field, wire, 1, &dequantized);
+        s_json_append_double(w, dequantized);
+    } else {
+        float dequantized;
+
+        s_dequantize(field, wire, 1, &dequantized);
+        s_json_append_float(w, dequantized);
+    }
+}
+
+static void s_json_write_builtin_array(s_json_writer* w,
+                                       const s_field_info* field,
+                                       const uint8_t* array_data,
+                                       uint32_t array_size) {
+    for (uint32_t i = 0; i < array_size && w->err == SERIALIZER_OK; i++) {
+        const uint8_t* el = array_data + field->size * i;
+
+        if (i != 0)
+            s_json_append_char(w, ',');
+
+        switch (field->array_field_info.builtin_type) {
+        case S_ARRAY_BUILTIN_TYPE_FLOAT: {
+            if (field->opts & S_FIELD_OPTS_QUANTIZED) {
+                s_json_write_quantized(w, field, el);
+                break;
+            }
+
+            switch (field->size) {
+            case 4: {
+                s_json_append_float(w, *(const float*) el);
+            } break;
+            case 8: {
+                s_json_append_double(w, *(const double*) el);
+            } break;
+            default: {
+                LOG_DEBUG("ERROR (to json): invalid float array el size %zu",
+                          field->size);
+                w->err = SERIALIZER_ERROR_INVALID_TYPE;
+            } break;
+            }
+        } break;
+        case S_ARRAY_BUILTIN_TYPE_STRING: {
+            s_json_append_string(w, (const char*) el,
+                                 strlen((const char*) el));
+        } break;
+        case S_ARRAY_BUILTIN_TYPE_BITS: {
+            if (*(const bool*) el)
+                JSON_APPEND(w, "true");
+            else
+                JSON_APPEND(w, "false");
+        } break;
+        default: {
+            switch (field->size) {
+            case 1: {
+                s_json_append_int(w, *(const int8_t*) el);
+            } break;
+            case 2: {
+                s_json_append_int(w, *(const int16_t*) el);
+            } break;
+            case 4: {
+                s_json_append_int(w, *(const int32_t*) el);
+            } break;
+            case 8: {
+                s_json_append_int(w, *(const int64_t*) el);
+            } break;
+            default: {
+                LOG_DEBUG("ERROR (to json): invalid builtin array el size %zu",
+                          field->size);
+                w->err = SERIALIZER_ERROR_INVALID_TYPE;
+            } break;
+            }
+        } break;
+        }
+    }
+}
+
+static void s_json_write_array(s_json_writer* w, const s_field_info* field,
+                               const uint8_t* data) {
+    const uint8_t* field_data = data + field->offset;
+    const uint8_t* array_data = (field->opts & S_FIELD_OPT_ARRAY_DYNAMIC)
+                                    ? *(const uint8_t**) field_data
+                                    : field_data;
+    uint32_t array_size = 0;
+
+    if (s_tlv_array_size(field, data, &array_size) != SERIALIZER_OK ||
+        (array_size && !array_data)) {
+        LOG_DEBUG("ERROR (to json): invalid array %s", field->name);
+        w->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    if (w->base64_blobs && !field->struct_type_info && field->size == 1 &&
+        field->array_field_info.builtin_type == S_ARRAY_BUILTIN_TYPE_BLOB) {
+        s_json_append_base64(w, array_data, array_size);
+        return;
+    }
+
+    s_json_append_char(w, '[');
+
+    if (field->struct_type_info) {
+        for (uint32_t i = 0; i < array_size && w->err == SERIALIZER_OK; i++) {
+            if (i != 0)
+                s_json_append_char(w, ',');
+
+            s_json_write_struct(w, field->struct_type_info,
+                                array_data + field->size * i);
+        }
+    } else
+        s_json_write_builtin_array(w, field, array_data, array_size);
+
+    s_json_append_char(w, ']');
+}
+
+static void s_json_write_field(s_json_writer* w, const s_field_info* field,
+                               const uint8_t* data) {
+    const uint8_t* field_data = data + field->offset;
+
+    switch (field->type) {
+    case FIELD_TYPE_INT8: {
+        s_json_append_int(w, *(const int8_t*) field_data);
+    } break;
+    case FIELD_TYPE_UINT8: {
+        s_json_append_uint(w, *(const uint8_t*) field_data);
+    } break;
+    case FIELD_TYPE_INT16: {
+        s_json_append_int(w, *(const int16_t*) field_data);
+    } break;
+    case FIELD_TYPE_UINT16: {
+        s_json_append_uint(w, *(const uint16_t*) field_data);
+    } break;
+    case FIELD_TYPE_INT32: {
+        s_json_append_int(w, *(const int32_t*) field_data);
+    } break;
+    case FIELD_TYPE_UINT32: {
+        s_json_append_uint(w, *(const uint32_t*) field_data);
+    } break;
+    case FIELD_TYPE_INT64: {
+        s_json_append_int(w, *(const int64_t*) field_data);
+    } break;
+    case FIELD_TYPE_UINT64: {
+        s_json_append_uint(w, *(const uint64_t*) field_data);
+    } break;
+    case FIELD_TYPE_FLOAT: {
+        if (field->opts & S_FIELD_OPTS_QUANTIZED)
+            s_json_write_quantized(w, field, field_data);
+        else
+            s_json_append_float(w, *(const float*) field_data);
+    } break;
+    case FIELD_TYPE_DOUBLE: {
+        if (field->opts & S_FIELD_OPTS_QUANTIZED)
+            s_json_write_quantized(w, field, field_data);
+        else
+            s_json_append_double(w, *(const double*) field_data);
+    } break;
+    case FIELD_TYPE_BOOL: {
+        if (*(const bool*) field_data)
+            JSON_APPEND(w, "true");
+        else
+            JSON_APPEND(w, "false");
+    } break;
+    case FIELD_TYPE_BLOB: {
+        if (w->base64_blobs) {
+            s_json_append_base64(w, field_data, field->size);
+            break;
+        }
+
+        s_json_append_char(w, '[');
+
+        for (size_t i = 0; i < field->size; i++) {
+            if (i != 0)
+                s_json_append_char(w, ',');
+
+            s_json_append_uint(w, field_data[i]);
+        }
+
+        s_json_append_char(w, ']');
+    } break;
+    case FIELD_TYPE_STRING: { // NULL strings are written as empty
+        const char* str;
+
+        if (field->opts & S_FIELD_OPT_STRING_FIXED)
+            str = (const char*) field_data;
+        else
+            memcpy(&str, field_data, sizeof(char*));
+
+        s_json_append_string(w, str ? str : "", str ? strlen(str) : 0);
+    } break;
+    case FIELD_TYPE_ARRAY: {
+        s_json_write_array(w, field, data);
+    } break;
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP: {
+        if (!field->struct_type_info) {
+            w->err = SERIALIZER_ERROR_INVALID_TYPE;
+            break;
+        }
+
+        s_json_write_struct(w, field->struct_type_info, field_data);
+    } break;
+    default: {
+        LOG_DEBUG("ERROR (to json): invalid field type %d", field->type);
+        w->err = SERIALIZER_ERROR_INVALID_TYPE;
+    } break;
+    }
+}
+
+static void s_json_write_struct(s_json_writer* w, const s_type_info* info,
+                                const uint8_t* data) {
+    bool is_first = true;
+
+    if (s_type_info_is_failed(info)) {
+        w->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+        return;
+    }
+
+    s_json_append_char(w, '{');
+
+    for (size_t i = 0; i < info->field_count && w->err == SERIALIZER_OK; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* label = field->label ? field->label : field->name;
+
+        // skip inactive union members
+        if (!is_field_present(data, field))
+            continue;
+
+        if (!is_first)
+            s_json_append_char(w, ',');
+
+        is_first = false;
+        s_json_append_string(w, label, strlen(label));
+        s_json_append_char(w, ':');
+        s_json_write_field(w, field, data);
+    }
+
+    s_json_append_char(w, '}');
+}
+
+s_serializer_error s_to_json(s_deserialize_options opts,
+                             const s_type_info* info, const void* data,
+                             char* out, size_t out_size) {
+    char chunk[S_JSON_CHUNK_SIZE];
+
+    if (!info || !data || (!out && !opts.json_sink)) {
+        LOG_DEBUG("ERROR (to json): invalid arguments");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    if (!opts.json_sink && !out_size)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    s_json_writer w = {
+        .data = opts.json_sink ? chunk : out,
+        .length = 0,
+        .capacity = opts.json_sink ? sizeof(chunk) : out_size,
+        .base64_blobs = opts.json_base64_blobs,
+        .sink = opts.json_sink,
+        .sink_data = opts.json_sink_data,
+        .err = SERIALIZER_OK,
+    };
+
+    w.data[0] = '\0';
+    s_json_write_struct(&w, info, (const uint8_t*) data);
+    s_json_flush(&w);
+
+    return w.err;
+}
+
+// json to struct
+//
+// Stage 1 indexes structural characters 64 bytes at a time (simdjson-style):
+// per-block bitmasks of quotes, backslashes, operators and whitespace give
+// string interiors via prefix xor, and positions of operators, opening quotes
+// and scalar starts outside of strings are written out as tokens. Stage 2
+// walks the tokens guided by type info and writes the struct.
+
+#define JSON_BLOCK_SIZE (64)
+#define JSON_MAX_NUMBER_LENGTH (128)
+#define JSON_MAX_KEY_LENGTH (256)
+
+typedef struct {
+    uint64_t backslash;
+    uint64_t quote;
+    uint64_t op; // {}[]:,
+    uint64_t whitespace;
+} s_json_block_masks;
+
+typedef struct {
+    bool is_escaped;       // last block ended with unescaped backslash
+    uint64_t in_string;    // all ones when last block ended inside string
+    uint64_t after_scalar; // last block ended with scalar character
+} s_json_index_state;
+
+typedef struct {
+    const char* json;
+    size_t json_size;
+    uint32_t* tokens; // offsets of structural characters
+    size_t n_tokens;
+    size_t pos; // current token
+    s_allocator* allocator;
+    void* user_data;
+    s_serializer_error err;
+} s_json_parser;
+
+#if defined(__SSE2__)
+static uint64_t s_json_movemask(__m128i m0, __m128i m1, __m128i m2,
+                                __m128i m3) {
+    return (uint64_t) (uint16_t) _mm_movemask_epi8(m0) |
+           (uint64_t) (uint16_t) _mm_movemask_epi8(m1) << 16 |
+           (uint64_t) (uint16_t) _mm_movemask_epi8(m2) << 32 |
+           (uint64_t) (uint16_t) _mm_movemask_epi8(m3) << 48;
+}
+
+static uint64_t s_json_eq_mask(const __m128i* chunks, char c) {
+    const __m128i v = _mm_set1_epi8(c);
+
+    return s_json_movemask(
+        _mm_cmpeq_epi8(chunks[0], v), _mm_cmpeq_epi8(chunks[1], v),
+        _mm_cmpeq_epi8(chunks[2], v), _mm_cmpeq_epi8(chunks[3], v));
+}
+#endif
+
+static s_json_block_masks s_json_classify_block(const char* block) {
+    s_json_block_masks masks;
+
+#if defined(__SSE2__)
+    __m128i chunks[4];
+
+    for (int i = 0; i < 4; i++)
+        chunks[i] = _mm_loadu_si128((const __m128i*) (block + 16 * i));
+
+    masks.backslash = s_json_eq_mask(chunks, '\\');
+    masks.quote = s_json_eq_mask(chunks, '"');
+    masks.op = s_json_eq_mask(chunks, '{') | s_json_eq_mask(chunks, '}') |
+               s_json_eq_mask(chunks, '[') | s_json_eq_mask(chunks, ']') |
+               s_json_eq_mask(chunks, ':') | s_json_eq_mask(chunks, ',');
+    masks.whitespace =
+        s_json_eq_mask(chunks, ' ') | s_json_eq_mask(chunks, '\t') |
+        s_json_eq_mask(chunks, '\n') | s_json_eq_mask(chunks, '\r');
+#else
+    memset(&masks, 0, sizeof(masks));
+
+    for (int i = 0; i < JSON_BLOCK_SIZE; i++) {
+        uint64_t bit = 1ull << i;
+
+        switch (block[i]) {
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '{':
+        case '}':
+        case '[':
+        case ']':
+        case ':':
+        case ',':
+            masks.op |= bit;
+            break;
+        case ' ':
+        case '\t':
+        case '\n':
+        case '\r':
+            masks.whitespace |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+#endif
+
+    return masks;
+}
+
+// characters escaped by backslashes, runs of backslashes escape each other
+static uint64_t s_json_escaped_mask(uint64_t backslash, bool* is_escaped) {
+    uint64_t escaped = 0;
+
+    if (*is_escaped) {
+        escaped = 1;
+        backslash &= ~1ull;
+        *is_escaped = false;
+    }
+
+    while (backslash) {
+        int i = __builtin_ctzll(backslash);
+
+        if (i == 63) {
+            *is_escaped = true;
+            break;
+        }
+
+        escaped |= 1ull << (i + 1);
+        backslash &= ~(3ull << i);
+    }
+
+    return escaped;
+}
+
+// bit i set when odd number of bits are set in 0..i
+static uint64_t s_json_prefix_xor(uint64_t x) {
+    x ^= x << 1;
+    x ^= x << 2;
+    x ^= x << 4;
+    x ^= x << 8;
+    x ^= x << 16;
+    x ^= x << 32;
+
+    return x;
+}
+
+static size_t s_json_index_block(const char* block, size_t offset,
+                                 s_json_index_state* state, uint32_t* tokens) {
+    s_json_block_masks masks = s_json_classify_block(block);
+    uint64_t escaped = 0;
+
+    if (masks.backslash || state->is_escaped)
+        escaped = s_json_escaped_mask(masks.backslash, &state->is_escaped);
+
+    uint64_t quote = masks.quote & ~escaped;
+    // from opening quote up to closing one, excluding the latter
+    uint64_t in_string = s_json_prefix_xor(quote) ^ state->in_string;
+    uint64_t string_tail = in_string ^ quote;
+    uint64_t scalar =
+        ~(masks.op | masks.whitespace | in_string | string_tail);
+    uint64_t scalar_start = scalar & ~(scalar << 1 | state->after_scalar);
+    uint64_t structurals =
+        (masks.op & ~in_string) | (quote & in_string) | scalar_start;
+    size_t n_tokens = 0;
+
+    state->in_string = (uint64_t) ((int64_t) in_string >> 63);
+    state->after_scalar = scalar >> 63;
+
+    while (structurals) {
+        tokens[n_tokens++] = (uint32_t) (offset + __builtin_ctzll(structurals));
+        structurals &= structurals - 1;
+    }
+
+    return n_tokens;
+}
+
+// stage 1, tokens has room for json_size + 1 entries
+static s_serializer_error s_json_index(const char* json, size_t json_size,
+                                       uint32_t* tokens, size_t* n_tokens) {
+    s_json_index_state state = {0};
+    size_t offset = 0;
+
+    *n_tokens = 0;
+
+    for (; offset + JSON_BLOCK_SIZE <= json_size; offset += JSON_BLOCK_SIZE)
+        *n_tokens += s_json_index_block(json + offset, offset, &state,
+                                        tokens + *n_tokens);
+
+    if (offset < json_size) { // pad last block with whitespace
+        char block[JSON_BLOCK_SIZE];
+
+        memset(block, ' ', sizeof(block));
+        memcpy(block, json + offset, json_size - offset);
+        *n_tokens +=
+            s_json_index_block(block, offset, &state, tokens + *n_tokens);
+    }
+
+    if (state.in_string) {
+        LOG_DEBUG("ERROR (from json): unterminated string");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    return SERIALIZER_OK;
+}
+
+// stage 2
+static void s_json_fail(s_json_parser* p, const char* what) {
+    LOG_DEBUG("ERROR (from json): %s at token %zu", what, p->pos);
+    (void) what;
+
+    if (p->err == SERIALIZER_OK)
+        p->err = SERIALIZER_ERROR_INVALID_TYPE;
+}
+
+static size_t s_json_offset(const s_json_parser* p) {
+    return p->pos < p->n_tokens ? p->tokens[p->pos] : p->json_size;
+}
+
+static char s_json_token(const s_json_parser* p) {
+    return p->pos < p->n_tokens ? p->json[p->tokens[p->pos]] : '\0';
+}
+
+static bool s_json_expect(s_json_parser* p, char c) {
+    if (s_json_token(p) != c) {
+        s_json_fail(p, "unexpected token");
+        return false;
+    }
+
+    p->pos++;
+
+    return true;
+}
+
+static bool s_json_is_terminator(const s_json_parser* p, size_t offset) {
+    if (offset >= p->json_size)
+        return true;
+
+    switch (p->json[offset]) {
+    case ' ':
+    case '\t':
+    case '\n':
+    case '\r':
+    case ',':
+    case '}':
+    case ']':
+        return true;
+    default:
+        return false;
+    }
+}
+
+static bool s_json_is_literal(s_json_parser* p, const char* literal) {
+    size_t offset = s_json_offset(p);
+    size_t len = strlen(literal);
+
+    return offset + len <= p->json_size &&
+           memcmp(p->json + offset, literal, len) == 0 &&
+           s_json_is_terminator(p, offset + len);
+}
+
+// offset of closing quote of string token
+static size_t s_json_string_end(const s_json_parser* p, size_t start) {
+    size_t i = start + 1;
+
+    for (;;) {
+        const char* quote = memchr(p->json + i, '"', p->json_size - i);
+
+        if (!quote)
+            return p->json_size;
+
+        size_t end = (size_t) (quote - p->json);
+        size_t n_backslashes = 0;
+
+        while (p->json[end - n_backslashes - 1] == '\\')
+            n_backslashes++;
+
+        if (!(n_backslashes & 1))
+            return end;
+
+        i = end + 1;
+    }
+}
+
+static bool s_json_parse_hex4(const char* str, size_t len, uint32_t* value) {
+    *value = 0;
+
+    if (len < 4)
+        return false;
+
+    for (int i = 0; i < 4; i++) {
+        char c = str[i];
+        uint32_t digit;
+
+        if (c >= '0' && c <= '9')
+            digit = c - '0';
+        else if (c >= 'a' && c <= 'f')
+            digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F')
+            digit = c - 'A' + 10;
+        else
+            return false;
+
+        *value = *value << 4 | digit;
+    }
+
+    return true;
+}
+
+static size_t s_json_utf8_encode(uint32_t cp, char* out) {
+    if (cp < 0x80) {
+        out[0] = (char) cp;
+        return 1;
+    }
+
+    if (cp < 0x800) {
+        out[0] = (char) (0xC0 | cp >> 6);
+        out[1] = (char) (0x80 | (cp & 0x3F));
+        return 2;
+    }
+
+    if (cp < 0x10000) {
+        out[0] = (char) (0xE0 | cp >> 12);
+        out[1] = (char) (0x80 | (cp >> 6 & 0x3F));
+        out[2] = (char) (0x80 | (cp & 0x3F));
+        return 3;
+    }
+
+    out[0] = (char) (0xF0 | cp >> 18);
+    out[1] = (char) (0x80 | (cp >> 12 & 0x3F));
+    out[2] = (char) (0x80 | (cp >> 6 & 0x3F));
+    out[3] = (char) (0x80 | (cp & 0x3F));
+
+    return 4;
+}
+
+// unescapes string contents into out, which has room for len bytes; escaped
+// strings only get shorter
+static bool s_json_unescape(const char* str, size_t len, char* out,
+                            size_t* out_len) {
+    size_t n = 0;
+
+    while (len) {
+        // copy characters that need no unescaping in one go
+        size_t run = s_json_find_escape(str, len);
+
+        memcpy(out + n, str, run);
+        n += run;
+        str += run;
+        len -= run;
+
+        if (!len)
+            break;
+
+        // control characters have to be escaped
+        if (*str != '\\' || len < 2)
+            return false;
+
+        char c = str[1];
+
+        str += 2;
+        len -= 2;
+
+        switch (c) {
+        case '"':
+        case '\\':
+        case '/':
+            out[n++] = c;
+            break;
+        case 'b':
+            out[n++] = '\b';
+            break;
+        case 'f':
+            out[n++] = '\f';
+            break;
+        case 'n':
+            out[n++] = '\n';
+            break;
+        case 'r':
+            out[n++] = '\r';
+            break;
+        case 't':
+            out[n++] = '\t';
+            break;
+        case 'u': {
+            uint32_t cp, low;
+
+            if (!s_json_parse_hex4(str, len, &cp))
+                return false;
+
+            str += 4;
+            len -= 4;
+
+            if (cp >= 0xDC00 && cp <= 0xDFFF)
+                return false;
+
+            if (cp >= 0xD800 && cp <= 0xDBFF) { // surrogate pair
+                if (len < 6 || str[0] != '\\' || str[1] != 'u' ||
+                    !s_json_parse_hex4(str + 2, len - 2, &low) ||
+                    low < 0xDC00 || low > 0xDFFF)
+                    return false;
+
+                cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                str += 6;
+                len -= 6;
+            }
+
+            n += s_json_utf8_encode(cp, out + n);
+        } break;
+        default:
+            return false;
+        }
+    }
+
+    *out_len = n;
+
+    return true;
+}
+
+// string token contents, escaped if *out_len differs from raw length
+static bool s_json_string_token(s_json_parser* p, const char** str,
+                                size_t* len) {
+    if (s_json_token(p) != '"') {
+        s_json_fail(p, "string expected");
+        return false;
+    }
+
+    size_t start = s_json_offset(p);
+    size_t end = s_json_string_end(p, start);
+
+    *str = p->json + start + 1;
+    *len = end - start - 1;
+    p->pos++;
+
+    return true;
+}
+
+typedef struct {
+    bool is_negative;
+    bool is_integer; // no fraction or exponent, magnitude fits 64 bits
+    uint64_t magnitude;
+    double value;
+} s_json_number;
+
+static bool s_json_parse_number(s_json_parser* p, s_json_number* num) {
+    static const double k_pow10[] = {
+        1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22,
+    };
+    size_t start = s_json_offset(p);
+    const char* s = p->json + start;
+    const char* end = p->json + p->json_size;
+    uint64_t mantissa = 0;
+    int exp10 = 0;
+    bool is_truncated = false;
+
+#define IS_DIGIT(c) ((c) >= '0' && (c) <= '9')
+    num->is_negative = s < end && *s == '-';
+    num->is_integer = true;
+
+    if (num->is_negative)
+        s++;
+
+    // no leading zeros
+    if (s == end || !IS_DIGIT(*s) ||
+        (*s == '0' && s + 1 < end && IS_DIGIT(s[1]))) {
+        s_json_fail(p, "invalid number");
+        return false;
+    }
+
+    for (; s < end && IS_DIGIT(*s); s++) {
+        unsigned digit = *s - '0';
+
+        if (mantissa > (UINT64_MAX - digit) / 10)
+            is_truncated = true;
+        else
+            mantissa = mantissa * 10 + digit;
+    }
+
+    if (s < end && *s == '.') {
+        num->is_integer = false;
+
+        if (++s == end || !IS_DIGIT(*s)) {
+            s_json_fail(p, "invalid number");
+            return false;
+        }
+
+        for (; s < end && IS_DIGIT(*s); s++) {
+            unsigned digit = *s - '0';
+
+            if (mantissa > (UINT64_MAX - digit) / 10) {
+                is_truncated = true;
+                continue;
+            }
+
+            mantissa = mantissa * 10 + digit;
+            exp10--;
+        }
+    }
+
+    if (s < end && (*s == 'e' || *s == 'E')) {
+        bool is_exp_negative = false;
+        int exp = 0;
+
+        num->is_integer = false;
+        s++;
+
+        if (s < end && (*s == '+' || *s == '-'))
+            is_exp_negative = *s++ == '-';
+
+        if (s == end || !IS_DIGIT(*s)) {
+            s_json_fail(p, "invalid number");
+            return false;
+        }
+
+        for (; s < end && IS_DIGIT(*s); s++) {
+            if (exp < 100000)
+                exp = exp * 10 + (*s - '0');
+        }
+
+        exp10 += is_exp_negative ? -exp : exp;
+    }
+#undef IS_DIGIT
+
+    if (!s_json_is_terminator(p, (size_t) (s - p->json))) {
+        s_json_fail(p, "invalid number");
+        return false;
+    }
+
+    num->is_integer = num->is_integer && !is_truncated;
+    num->magnitude = mantissa;
+
+    if (!is_truncated && mantissa <= (1ull << 53) && exp10 >= -22 &&
+        exp10 <= 22) { // exact
+        double value = (double) mantissa;
+
+        value = exp10 < 0 ? value / k_pow10[-exp10] : value * k_pow10[exp10];
+        num->value = num->is_negative ? -value : value;
+    } else {
+        char buf[JSON_MAX_NUMBER_LENGTH];
+        size_t len = (size_t) (s - (p->json + start));
+
+        if (len >= sizeof(buf)) {
+            s_json_fail(p, "number too long");
+            return false;
+        }
+
+        memcpy(buf, p->json + start, len);
+        buf[len] = '\0';
+        num->value = strtod(buf, NULL);
+    }
+
+    p->pos++;
+
+    return true;
+}
+
+static bool s_json_parse_int(s_json_parser* p, int64_t min, int64_t max,
+                             int64_t* value) {
+    s_json_number num;
+
+    if (!s_json_parse_number(p, &num))
+        return false;
+
+    if (num.is_integer) {
+        if (num.is_negative && num.magnitude <= (uint64_t) -(min + 1) + 1) {
+            *value = num.magnitude ? -(int64_t) (num.magnitude - 1) - 1 : 0;
+            return true;
+        }
+
+        if (!num.is_negative && num.magnitude <= (uint64_t) max) {
+            *value = (int64_t) num.magnitude;
+            return true;
+        }
+    }
+
+    p->pos--;
+    s_json_fail(p, "integer out of range");
+
+    return false;
+}
+
+static bool s_json_parse_uint(s_json_parser* p, uint64_t max,
+                              uint64_t* value) {
+    s_json_number num;
+
+    if (!s_json_parse_number(p, &num))
+        return false;
+
+    if (num.is_integer && (!num.is_negative || num.magnitude == 0) &&
+        num.magnitude <= max) {
+        *value = num.magnitude;
+        return true;
+    }
+
+    p->pos--;
+    s_json_fail(p, "integer out of range");
+
+    return false;
+}
+
+static bool s_json_parse_double(s_json_parser* p, double* value) {
+    // non-finite values are written as null
+    if (s_json_is_literal(p, "null")) {
+        *value = NAN;
+        p->pos++;
+        return true;
+    }
+
+    s_json_number num;
+
+    if (!s_json_parse_number(p, &num))
+        return false;
+
+    *value = num.value;
+
+    return true;
+}
+
+// skips value of unknown field
+static void s_json_skip_value(s_json_parser* p) {
+    int depth = 0;
+
+    do {
+        switch (s_json_token(p)) {
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            depth--;
+            break;
+        case ',':
+        case ':':
+            if (depth == 0) {
+                s_json_fail(p, "value expected");
+                return;
+            }
+            break;
+        case '\0':
+            s_json_fail(p, "unexpected end");
+            return;
+        default:
+            break;
+        }
+
+        p->pos++;
+    } while (depth > 0);
+
+    if (depth < 0)
+        s_json_fail(p, "unexpected token");
+}
+
+// elements of array which opening bracket is the previous token
+static uint32_t s_json_count_elements(const s_json_parser* p) {
+    uint32_t count = 1;
+    int depth = 0;
+
+    if (s_json_token(p) == ']')
+        return 0;
+
+    for (size_t i = p->pos; i < p->n_tokens; i++) {
+        switch (p->json[p->tokens[i]]) {
+        case '{':
+        case '[':
+            depth++;
+            break;
+        case '}':
+        case ']':
+            if (depth-- == 0)
+                return count;
+            break;
+        case ',':
+            if (depth == 0)
+                count++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return count; // unterminated array fails while parsing elements
+}
+
+// field with label or name equal to key, the first present one at or after
+// expected one
+static int s_json_find_field(const s_type_info* info, const uint8_t* data,
+                             const char* key, size_t key_len, int hint) {
+    int found = -1;
+    size_t found_distance = 0;
+
+    for (const s_field_info* field = s_find_field(info, key, key_len); field;
+         field = s_find_next_field(info, field, key, key_len)) {
+        size_t i = (size_t) (field - info->fields);
+        size_t distance =
+            (i + info->field_count - (size_t) hint) % info->field_count;
+
+        // union members share labels, the one selected by tag is present
+        if ((found < 0 || distance < found_distance) &&
+            is_field_present(data, field)) {
+            found = (int) i;
+            found_distance = distance;
+        }
+    }
+
+    return found;
+}
+
+// array sizes are taken from arrays themselves
+static bool s_json_is_array_size_field(const s_type_info* info,
+                                       const s_field_info* field) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        if (info->fields[i].type == FIELD_TYPE_ARRAY &&
+            info->fields[i].array_field_info.size_field_offset ==
+                field->offset)
+            return true;
+    }
+
+    return false;
+}
+
+// tag of union member that has already been parsed
+static bool s_json_is_locked_tag(const s_type_info* info,
+                                 const uint64_t* seen_fields,
+                                 const s_field_info* field) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* member = &info->fields[i];
+
+        if ((seen_fields[i / 64] >> (i % 64) & 1) &&
+            (member->opts & S_FIELD_OPT_OPTIONAL) &&
+            member->optional_field_info.tag_offset == field->offset)
+            return true;
+    }
+
+    return false;
+}
+
+// size field of array has been set by another array
+static bool s_json_is_array_size_set(const s_type_info* info,
+                                     const uint64_t* seen_fields,
+                                     const s_field_info* field) {
+    if (field->type != FIELD_TYPE_ARRAY)
+        return false;
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* other = &info->fields[i];
+
+        if ((seen_fields[i / 64] >> (i % 64) & 1) &&
+            other->type == FIELD_TYPE_ARRAY &&
+            other->array_field_info.size_field_offset ==
+                field->array_field_info.size_field_offset)
+            return true;
+    }
+
+    return false;
+}
+
+static void s_json_parse_struct(s_json_parser* p, const s_type_info* info,
+                                uint8_t* data, int level);
+
+static void s_json_parse_string(s_json_parser* p, const s_field_info* field,
+                                uint8_t* field_data) {
+    const char* str;
+    size_t len;
+    bool is_fixed = field->opts & S_FIELD_OPT_STRING_FIXED;
+
+    if (!is_fixed && s_json_is_literal(p, "null")) {
+        p->pos++;
+        return; // stays NULL
+    }
+
+    if (!s_json_string_token(p, &str, &len))
+        return;
+
+    char* dest;
+
+    if (is_fixed) {
+        // raw string is never shorter than unescaped one, so only strings
+        // that don't fit raw need scratch space
+        bool is_scratch = len >= field->size;
+
+        dest = is_scratch ? p->allocator->allocate(len, p->user_data)
+                          : (char*) field_data;
+
+        if (!dest) {
+            p->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+            return;
+        }
+
+        if (!s_json_unescape(str, len, dest, &len))
+            s_json_fail(p, "invalid string");
+        else if (len >= field->size)
+            s_json_fail(p, "string too long");
+        else {
+            if (is_scratch)
+                memcpy(field_data, dest, len);
+
+            field_data[len] = '\0';
+        }
+
+        if (is_scratch)
+            p->allocator->deallocate(dest, p->user_data);
+
+        return;
+    }
+
+    dest = p->allocator->allocate(len + 1, p->user_data);
+
+    if (!dest) {
+        p->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+        return;
+    }
+
+    memcpy(field_data, &dest, sizeof(char*));
+
+    if (!s_json_unescape(str, len, dest, &len)) {
+        s_json_fail(p, "invalid string");
+        return;
+    }
+
+    dest[len] = '\0';
+}
+
+static void s_json_parse_builtin_el(s_json_parser* p, const s_field_info* field,
+                                    uint8_t* el) {
+    switch (field->array_field_info.builtin_type) {
+    case S_ARRAY_BUILTIN_TYPE_FLOAT: {
+        double value;
+
+        if (!s_json_parse_double(p, &value))
+            return;
+
+        if (field->size == sizeof(float)) {
+            float f = (float) value;
+            memcpy(el, &f, sizeof(f));
+        } else if (field->size == sizeof(double))
+            memcpy(el, &value, sizeof(value));
+        else
+            s_json_fail(p, "invalid float array el size");
+    } break;
+    case S_ARRAY_BUILTIN_TYPE_STRING: {
+        s_field_info el_field = *field;
+
+        el_field.opts |= S_FIELD_OPT_STRING_FIXED;
+        s_json_parse_string(p, &el_field, el);
+    } break;
+    case S_ARRAY_BUILTIN_TYPE_BITS: {
+        bool value = s_json_is_literal(p, "true");
+
+        if (!value && !s_json_is_literal(p, "false")) {
+            s_json_fail(p, "bool expected");
+            break;
+        }
+
+        memcpy(el, &value, sizeof(value));
+        p->pos++;
+    } break;
+    default: {
+        int64_t value;
+
+        if (field->size > sizeof(value)) {
+            s_json_fail(p, "invalid builtin array el size");
+            return;
+        }
+
+        int bits = (int) field->size * 8;
+        int64_t max = (int64_t) (UINT64_MAX >> (65 - bits));
+
+        if (!s_json_parse_int(p, -max - 1, max, &value))
+            return;
+
+        // little and big endian alike
+        switch (field->size) {
+        case 1: {
+            int8_t v = (int8_t) value;
+            memcpy(el, &v, sizeof(v));
+        } break;
+        case 2: {
+            int16_t v = (int16_t) value;
+            memcpy(el, &v, sizeof(v));
+        } break;
+        case 4: {
+            int32_t v = (int32_t) value;
+            memcpy(el, &v, sizeof(v));
+        } break;
+        case 8: {
+            memcpy(el, &value, sizeof(value));
+        } break;
+        default:
+            s_json_fail(p, "invalid builtin array el size");
+            break;
+        }
+    } break;
+    }
+}
+
+// expected_size is set when another array with the same size field has been
+// parsed already
+static void s_json_parse_array(s_json_parser* p, const s_field_info* field,
+                               uint8_t* data, const uint32_t* expected_size,
+                               int level) {
+    uint8_t* field_data = data + field->offset;
+    bool is_dynamic = field->opts & S_FIELD_OPT_ARRAY_DYNAMIC;
+    // byte arrays may come as base64 strings
+    bool is_base64 =
+        s_json_token(p) == '"' && !field->struct_type_info &&
+        field->size == 1 &&
+        field->array_field_info.builtin_type == S_ARRAY_BUILTIN_TYPE_BLOB;
+    const char* base64 = NULL;
+    size_t base64_len = 0;
+    uint32_t array_size;
+
+    if (is_base64) {
+        s_json_string_token(p, &base64, &base64_len);
+
+        size_t size = s_base64_decoded_size(base64, base64_len);
+
+        if (size > UINT32_MAX) {
+            s_json_fail(p, "invalid base64");
+            return;
+        }
+
+        array_size = (uint32_t) size;
+    } else {
+        if (!s_json_expect(p, '['))
+            return;
+
+        array_size = s_json_count_elements(p);
+    }
+
+    size_t capacity = field->array_field_info.capacity;
+
+    if (!is_dynamic && capacity && array_size > capacity) {
+        s_json_fail(p, "too many array elements");
+        return;
+    }
+
+    if (expected_size && array_size != *expected_size) {
+        s_json_fail(p, "arrays sharing size field differ in size");
+        return;
+    }
+
+    uint8_t* array_data = field_data;
+
+    if (is_dynamic && array_size) {
+        array_data = p->allocator->allocate(field->size * array_size,
+                                            p->user_data);
+
+        if (!array_data) {
+            p->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+            return;
+        }
+
+        memset(array_data, 0, field->size * array_size);
+        memcpy(field_data, &array_data, sizeof(array_data));
+    }
+
+    // set right away, so partially parsed array can be released
+    if (!s_tlv_set_array_size(field, data, array_size)) {
+        s_json_fail(p, "array size does not fit size field");
+        return;
+    }
+
+    if (is_base64) {
+        if (!s_base64_decode(base64, base64_len, array_data))
+            s_json_fail(p, "invalid base64");
+
+        return;
+    }
+
+    for (uint32_t i = 0; i < array_size && p->err == SERIALIZER_OK; i++) {
+        uint8_t* el = array_data + field->size * i;
+
+        if (i != 0 && !s_json_expect(p, ','))
+            return;
+
+        if (field->struct_type_info)
+            s_json_parse_struct(p, field->struct_type_info, el, level + 1);
+        else
+            s_json_parse_builtin_el(p, field, el);
+    }
+
+    if (p->err == SERIALIZER_OK)
+        s_json_expect(p, ']');
+}
+
+static void s_json_parse_field(s_json_parser* p, const s_field_info* field,
+                               uint8_t* data, const uint32_t* expected_size,
+                               int level) {
+    uint8_t* field_data = data + field->offset;
+
+    switch (field->type) {
+    case FIELD_TYPE_INT8:
+    case FIELD_TYPE_INT16:
+    case FIELD_TYPE_INT32:
+    case FIELD_TYPE_INT64: {
+        int bits = (int) field->size * 8;
+        int64_t max = (int64_t) (UINT64_MAX >> (65 - bits));
+        int64_t value;
+
+        if (field->size > sizeof(value) ||
+            !s_json_parse_int(p, -max - 1, max, &value))
+            break;
+
+        switch (field->size) {
+        case 1: {
+            int8_t v = (int8_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        case 2: {
+            int16_t v = (int16_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        case 4: {
+            int32_t v = (int32_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        default:
+            memcpy(field_data, &value, sizeof(value));
+            break;
+        }
+    } break;
+    case FIELD_TYPE_UINT8:
+    case FIELD_TYPE_UINT16:
+    case FIELD_TYPE_UINT32:
+    case FIELD_TYPE_UINT64: {
+        uint64_t value;
+
+        if (field->size > sizeof(value) ||
+            !s_json_parse_uint(p, UINT64_MAX >> (64 - field->size * 8),
+                               &value))
+            break;
+
+        switch (field->size) {
+        case 1: {
+            uint8_t v = (uint8_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        case 2: {
+            uint16_t v = (uint16_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        case 4: {
+            uint32_t v = (uint32_t) value;
+            memcpy(field_data, &v, sizeof(v));
+        } break;
+        default:
+            memcpy(field_data, &value, sizeof(value));
+            break;
+        }
+    } break;
+    case FIELD_TYPE_FLOAT: {
+        double value;
+
+        if (s_json_parse_double(p, &value)) {
+            float f = (float) value;
+            memcpy(field_data, &f, sizeof(f));
+        }
+    } break;
+    case FIELD_TYPE_DOUBLE: {
+        double value;
+
+        if (s_json_parse_double(p, &value))
+            memcpy(field_data, &value, sizeof(value));
+    } break;
+    case FIELD_TYPE_BOOL: {
+        bool value = s_json_is_literal(p, "true");
+
+        if (!value && !s_json_is_literal(p, "false")) {
+            s_json_fail(p, "bool expected");
+            break;
+        }
+
+        memcpy(field_data, &value, sizeof(value));
+        p->pos++;
+    } break;
+    case FIELD_TYPE_BLOB: {
+        if (s_json_token(p) == '"') { // base64
+            const char* str;
+            size_t len;
+
+            s_json_string_token(p, &str, &len);
+
+            if (s_base64_decoded_size(str, len) > field->size ||
+                !s_base64_decode(str, len, field_data))
+                s_json_fail(p, "invalid base64 blob");
+
+            break;
+        }
+
+        if (!s_json_expect(p, '['))
+            break;
+
+        for (size_t i = 0; s_json_token(p) != ']' && p->err == SERIALIZER_OK;
+             i++) {
+            uint64_t value;
+
+            if (i == field->size) {
+                s_json_fail(p, "blob too long");
+                break;
+            }
+
+            if ((i != 0 && !s_json_expect(p, ',')) ||
+                !s_json_parse_uint(p, UINT8_MAX, &value))
+                break;
+
+            field_data[i] = (uint8_t) value;
+        }
+
+        if (p->err == SERIALIZER_OK)
+            s_json_expect(p, ']');
+    } break;
+    case FIELD_TYPE_STRING: {
+        s_json_parse_string(p, field, field_data);
+    } break;
+    case FIELD_TYPE_ARRAY: {
+        s_json_parse_array(p, field, data, expected_size, level);
+    } break;
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP: {
+        if (!field->struct_type_info) {
+            s_json_fail(p, "no struct type info");
+            break;
+        }
+
+        s_json_parse_struct(p, field->struct_type_info, field_data, level + 1);
+
+        if (field->type == FIELD_TYPE_MAP && p->err == SERIALIZER_OK)
+            p->err = s_map_finish(field, (s_map*) field_data, p->allocator,
+                                  p->user_data);
+    } break;
+    default: {
+        s_json_fail(p, "invalid field type");
+    } break;
+    }
+}
+
+static void s_json_parse_struct(s_json_parser* p, const s_type_info* info,
+                                uint8_t* data, int level) {
+    uint64_t seen_fields[(S_MAX_FIELDS + 63) / 64] = {0};
+    int hint = 0; // keys usually follow declaration order
+
+    if (level >= MAX_NESTED_LEVELS) {
+        s_json_fail(p, "too deep");
+        return;
+    }
+
+    if (s_type_info_is_failed(info)) {
+        p->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+        return;
+    }
+
+    if (!s_json_expect(p, '{'))
+        return;
+
+    if (s_json_token(p) == '}') {
+        p->pos++;
+        return;
+    }
+
+    while (p->err == SERIALIZER_OK) {
+        char key_buf[JSON_MAX_KEY_LENGTH];
+        const char* key;
+        size_t key_len;
+
+        if (!s_json_string_token(p, &key, &key_len) || !s_json_expect(p, ':'))
+            return;
+
+        // unescape keys that need it, too long ones can't be field names
+        if (s_json_find_escape(key, key_len) != key_len) {
+            if (key_len > sizeof(key_buf) ||
+                !s_json_unescape(key, key_len, key_buf, &key_len) ||
+                memchr(key_buf, '\0', key_len))
+                key_len = 0;
+
+            key = key_buf;
+        }
+
+        int field_idx =
+            key_len ? s_json_find_field(info, data, key, key_len, hint) : -1;
+        const s_field_info* field = field_idx >= 0 ? &info->fields[field_idx]
+                                                   : NULL;
+
+        if (field && (seen_fields[field_idx / 64] >> (field_idx % 64) & 1)) {
+            s_json_fail(p, "duplicate key");
+            return;
+        }
+
+        if (field && s_json_is_locked_tag(info, seen_fields, field)) {
+            s_json_fail(p, "union tag after its member");
+            return;
+        }
+
+        if (!field || ((field->type != FIELD_TYPE_ARRAY &&
+                        field->type != FIELD_TYPE_STRUCT &&
+                        field->type != FIELD_TYPE_MAP) &&
+                       s_json_is_array_size_field(info, field)))
+            s_json_skip_value(p);
+        else {
+            uint32_t array_size = 0;
+            bool is_size_set =
+                s_json_is_array_size_set(info, seen_fields, field);
+
+            if (is_size_set)
+                s_tlv_array_size(field, data, &array_size);
+
+            seen_fields[field_idx / 64] |= 1ull << (field_idx % 64);
+            hint = field_idx + 1;
+            s_json_parse_field(p, field, data,
+                               is_size_set ? &array_size : NULL, level);
+        }
+
+        if (p->err != SERIALIZER_OK)
+            return;
+
+        if (s_json_token(p) != ',')
+            break;
+
+        p->pos++;
+    }
+
+    s_json_expect(p, '}');
+}
+
+s_serializer_error s_from_json(s_deserialize_options opts,
+                               const s_type_info* info, void* data,
+                               const char* json, size_t json_size) {
+    if (!info || !data || !json || !opts.allocator ||
+        opts.format != FORMAT_C_STRUCT || json_size >= UINT32_MAX) {
+        LOG_DEBUG("ERROR (from json): invalid arguments");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    s_json_parser p = {
+        .json = json,
+        .json_size = json_size,
+        .allocator = opts.allocator,
+        .user_data = opts.user_data,
+        .err = SERIALIZER_OK,
+    };
+
+    p.tokens = opts.allocator->allocate((json_size + 1) * sizeof(uint32_t),
+                                        opts.user_data);
+
+    if (!p.tokens)
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+    memset(data, 0, info->type_size);
+    p.err = s_json_index(json, json_size, p.tokens, &p.n_tokens);
+
+    if (p.err == SERIALIZER_OK) {
+        s_json_parse_struct(&p, info, (uint8_t*) data, 0);
+
+        if (p.err == SERIALIZER_OK && p.pos != p.n_tokens)
+            s_json_fail(&p, "trailing characters");
+
+        if (p.err != SERIALIZER_OK)
+            s_release_struct(info, (uint8_t*) data, opts.allocator,
+                             opts.user_data);
+    }
+
+    opts.allocator->deallocate(p.tokens, opts.user_data);
+
+    return p.err;
+}
+
+s_serializer_error s_json_to_tlv(s_serialize_options opts,
+                                 s_deserialize_options dopts,
+                                 const s_type_info* info, const char* json,
+                                 size_t json_size, uint8_t* buffer,
+                                 size_t buffer_size, size_t* bytes_written) {
+    s_allocator* allocator = dopts.allocator;
+
+    if (!info || !allocator) {
+        LOG_DEBUG("ERROR (json to tlv): invalid arguments");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    dopts.format = FORMAT_C_STRUCT;
+
+    uint8_t* data = allocator->allocate(info->type_size, dopts.user_data);
+
+    if (!data)
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+    s_serializer_error err = s_from_json(dopts, info, data, json, json_size);
+
+    if (err == SERIALIZER_OK) {
+        err = s_serialize(opts, info, data, buffer, buffer_size,
+                          bytes_written);
+        s_release_struct(info, data, allocator, dopts.user_data);
+    }
+
+    allocator->deallocate(data, dopts.user_data);
+
+    return err;
+}
@@ -0,0 +1,433 @@
+/*
+ * Created on Sat Oct 17 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss/number.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+static const char k_digit_pairs[201] = "00010203040506070809"
+                                       "10111213141516171819"
+                                       "20212223242526272829"
+                                       "30313233343536373839"
+                                       "40414243444546474849"
+                                       "50515253545556575859"
+                                       "60616263646566676869"
+                                       "70717273747576777879"
+                                       "80818283848586878889"
+                                       "90919293949596979899";
+
+int s_format_uint64(uint64_t value, char* buf) {
+    char digits[20];
+    char* p = digits + sizeof(digits);
+
+    // two digits per division
+    while (value >= 100) {
+        unsigned pair = (unsigned) (value % 100) * 2;
+
+        value /= 100;
+        *--p = k_digit_pairs[pair + 1];
+        *--p = k_digit_pairs[pair];
+    }
+
+    if (value >= 10) {
+        *--p = k_digit_pairs[value * 2 + 1];
+        *--p = k_digit_pairs[value * 2];
+    } else
+        *--p = (char) ('0' + value);
+
+    int len = (int) (digits + sizeof(digits) - p);
+
+    memcpy(buf, p, len);
+
+    return len;
+}
+
+int s_format_int64(int64_t value, char* buf) {
+    if (value >= 0)
+        return s_format_uint64((uint64_t) value, buf);
+
+    buf[0] = '-';
+
+    // negate as unsigned, INT64_MIN has no positive counterpart
+    return 1 + s_format_uint64(0 - (uint64_t) value, buf + 1);
+}
+
+// Grisu2 (Loitsch, "Printing Floating-Point Numbers Quickly and Accurately
+// with Integers"), produces shortest digits in the vast majority of cases and
+// correctly rounded digits always.
+
+typedef struct {
+    uint64_t f;
+    int e;
+} s_diyfp;
+
+typedef struct {
+    s_diyfp w;
+    s_diyfp minus;
+    s_diyfp plus;
+} s_boundaries;
+
+typedef struct {
+    uint64_t f;
+    int e;
+    int k;
+} s_cached_power;
+
+// normalized 10^k for k = -300, -292, ..., 324
+static const s_cached_power k_cached_powers[] = {
+    {0xAB70FE17C79AC6CAULL, -1060, -300},
+    {0xFF77B1FCBEBCDC4FULL, -1034, -292},
+    {0xBE5691EF416BD60CULL, -1007, -284},
+    {0x8DD01FAD907FFC3CULL, -980, -276},
+    {0xD3515C2831559A83ULL, -954, -268},
+    {0x9D71AC8FADA6C9B5ULL, -927, -260},
+    {0xEA9C227723EE8BCBULL, -901, -252},
+    {0xAECC49914078536DULL, -874, -244},
+    {0x823C12795DB6CE57ULL, -847, -236},
+    {0xC21094364DFB5637ULL, -821, -228},
+    {0x9096EA6F3848984FULL, -794, -220},
+    {0xD77485CB25823AC7ULL, -768, -212},
+    {0xA086CFCD97BF97F4ULL, -741, -204},
+    {0xEF340A98172AACE5ULL, -715, -196},
+    {0xB23867FB2A35B28EULL, -688, -188},
+    {0x84C8D4DFD2C63F3BULL, -661, -180},
+    {0xC5DD44271AD3CDBAULL, -635, -172},
+    {0x936B9FCEBB25C996ULL, -608, -164},
+    {0xDBAC6C247D62A584ULL, -582, -156},
+    {0xA3AB66580D5FDAF6ULL, -555, -148},
+    {0xF3E2F893DEC3F126ULL, -529, -140},
+    {0xB5B5ADA8AAFF80B8ULL, -502, -132},
+    {0x87625F056C7C4A8BULL, -475, -124},
+    {0xC9BCFF6034C13053ULL, -449, -116},
+    {0x964E858C91BA2655ULL, -422, -108},
+    {0xDFF9772470297EBDULL, -396, -100},
+    {0xA6DFBD9FB8E5B88FULL, -369, -92},
+    {0xF8A95FCF88747D94ULL, -343, -84},
+    {0xB94470938FA89BCFULL, -316, -76},
+    {0x8A08F0F8BF0F156BULL, -289, -68},
+    {0xCDB02555653131B6ULL, -263, -60},
+    {0x993FE2C6D07B7FACULL, -236, -52},
+    {0xE45C10C42A2B3B06ULL, -210, -44},
+    {0xAA242499697392D3ULL, -183, -36},
+    {0xFD87B5F28300CA0EULL, -157, -28},
+    {0xBCE5086492111AEBULL, -130, -20},
+    {0x8CBCCC096F5088CCULL, -103, -12},
+    {0xD1B71758E219652CULL, -77, -4},
+    {0x9C40000000000000ULL, -50, 4},
+    {0xE8D4A51000000000ULL, -24, 12},
+    {0xAD78EBC5AC620000ULL, 3, 20},
+    {0x813F3978F8940984ULL, 30, 28},
+    {0xC097CE7BC90715B3ULL, 56, 36},
+    {0x8F7E32CE7BEA5C70ULL, 83, 44},
+    {0xD5D238A4ABE98068ULL, 109, 52},
+    {0x9F4F2726179A2245ULL, 136, 60},
+    {0xED63A231D4C4FB27ULL, 162, 68},
+    {0xB0DE65388CC8ADA8ULL, 189, 76},
+    {0x83C7088E1AAB65DBULL, 216, 84},
+    {0xC45D1DF942711D9AULL, 242, 92},
+    {0x924D692CA61BE758ULL, 269, 100},
+    {0xDA01EE641A708DEAULL, 295, 108},
+    {0xA26DA3999AEF774AULL, 322, 116},
+    {0xF209787BB47D6B85ULL, 348, 124},
+    {0xB454E4A179DD1877ULL, 375, 132},
+    {0x865B86925B9BC5C2ULL, 402, 140},
+    {0xC83553C5C8965D3DULL, 428, 148},
+    {0x952AB45CFA97A0B3ULL, 455, 156},
+    {0xDE469FBD99A05FE3ULL, 481, 164},
+    {0xA59BC234DB398C25ULL, 508, 172},
+    {0xF6C69A72A3989F5CULL, 534, 180},
+    {0xB7DCBF5354E9BECEULL, 561, 188},
+    {0x88FCF317F22241E2ULL, 588, 196},
+    {0xCC20CE9BD35C78A5ULL, 614, 204},
+    {0x98165AF37B2153DFULL, 641, 212},
+    {0xE2A0B5DC971F303AULL, 667, 220},
+    {0xA8D9D1535CE3B396ULL, 694, 228},
+    {0xFB9B7CD9A4A7443CULL, 720, 236},
+    {0xBB764C4CA7A44410ULL, 747, 244},
+    {0x8BAB8EEFB6409C1AULL, 774, 252},
+    {0xD01FEF10A657842CULL, 800, 260},
+    {0x9B10A4E5E9913129ULL, 827, 268},
+    {0xE7109BFBA19C0C9DULL, 853, 276},
+    {0xAC2820D9623BF429ULL, 880, 284},
+    {0x80444B5E7AA7CF85ULL, 907, 292},
+    {0xBF21E44003ACDD2DULL, 933, 300},
+    {0x8E679C2F5E44FF8FULL, 960, 308},
+    {0xD433179D9C8CB841ULL, 986, 316},
+    {0x9E19DB92B4E31BA9ULL, 1013, 324},
+};
+
+#define CACHED_POWERS_MIN_DEC_EXP (-300)
+#define CACHED_POWERS_DEC_STEP (8)
+
+// binary exponent range of scaled value, keeps digit generation in 32 bits
+#define GRISU_ALPHA (-60)
+
+static s_diyfp s_diyfp_sub(s_diyfp x, s_diyfp y) {
+    return (s_diyfp) {x.f - y.f, x.e};
+}
+
+// rounded upper 64 bits of 128-bit product
+static s_diyfp s_diyfp_mul(s_diyfp x, s_diyfp y) {
+    uint64_t x_lo = x.f & 0xFFFFFFFFu, x_hi = x.f >> 32;
+    uint64_t y_lo = y.f & 0xFFFFFFFFu, y_hi = y.f >> 32;
+    uint64_t p0 = x_lo * y_lo;
+    uint64_t p1 = x_lo * y_hi;
+    uint64_t p2 = x_hi * y_lo;
+    uint64_t p3 = x_hi * y_hi;
+    uint64_t q = (p0 >> 32) + (p1 & 0xFFFFFFFFu) + (p2 & 0xFFFFFFFFu);
+
+    q += 1u << 31; // round
+
+    return (s_diyfp) {p3 + (p2 >> 32) + (p1 >> 32) + (q >> 32),
+                      x.e + y.e + 64};
+}
+
+static s_diyfp s_diyfp_normalize(s_diyfp x) {
+    while ((x.f >> 63) == 0) {
+        x.f <<= 1;
+        x.e--;
+    }
+
+    return x;
+}
+
+// value with precision-bit significand (hidden bit included) and exponent
+// bias, and boundaries halfway to its neighbours
+static s_boundaries s_compute_boundaries(uint64_t bits, int precision,
+                                         int bias) {
+    uint64_t hidden_bit = 1ull << (precision - 1);
+    uint64_t fraction = bits & (hidden_bit - 1);
+    int exponent = (int) (bits >> (precision - 1));
+    s_diyfp v = exponent == 0
+                    ? (s_diyfp) {fraction, 1 - bias} // denormal
+                    : (s_diyfp) {fraction + hidden_bit, exponent - bias};
+    // lower neighbour is closer at powers of two
+    bool lower_is_closer = fraction == 0 && exponent > 1;
+    s_diyfp plus = {2 * v.f + 1, v.e - 1};
+    s_diyfp minus = lower_is_closer ? (s_diyfp) {4 * v.f - 1, v.e - 2}
+                                    : (s_diyfp) {2 * v.f - 1, v.e - 1};
+    s_boundaries b;
+
+    b.w = s_diyfp_normalize(v);
+    b.plus = s_diyfp_normalize(plus);
+    b.minus = (s_diyfp) {minus.f << (minus.e - b.plus.e), b.plus.e};
+
+    return b;
+}
+
+static s_cached_power s_get_cached_power(int e) {
+    int f = GRISU_ALPHA - e - 1;
+    // ceil(f * log10(2))
+    int k = (f * 78913) / (1 << 18) + (f > 0);
+    int idx = (-CACHED_POWERS_MIN_DEC_EXP + k + (CACHED_POWERS_DEC_STEP - 1)) /
+              CACHED_POWERS_DEC_STEP;
+
+    return k_cached_powers[idx];
+}
+
+// number of decimal digits in n and the power of ten of the leading one
+static int s_find_largest_pow10(uint32_t n, uint32_t* pow10) {
+    static const uint32_t k_pow10[] = {
+        1,      10,      100,      1000,      10000,
+        100000, 1000000, 10000000, 100000000, 1000000000,
+    };
+    int k = 10;
+
+    while (k > 1 && n < k_pow10[k - 1])
+        k--;
+
+    *pow10 = k_pow10[k - 1];
+
+    return k;
+}
+
+// move last digit closer to the exact value while staying inside boundaries
+static void s_grisu2_round(char* buf, int len, uint64_t dist, uint64_t delta,
+                           uint64_t rest, uint64_t ten_k) {
+    while (rest < dist && delta - rest >= ten_k &&
+           (rest + ten_k < dist || dist - rest > rest + ten_k - dist)) {
+        buf[len - 1]--;
+        rest += ten_k;
+    }
+}
+
+static int s_grisu2_digit_gen(char* buf, int* decimal_exponent,
+                              s_diyfp m_minus, s_diyfp w, s_diyfp m_plus) {
+    uint64_t delta = s_diyfp_sub(m_plus, m_minus).f;
+    uint64_t dist = s_diyfp_sub(m_plus, w).f;
+    s_diyfp one = {1ull << -m_plus.e, m_plus.e};
+    uint32_t p1 = (uint32_t) (m_plus.f >> -one.e); // integral part
+    uint64_t p2 = m_plus.f & (one.f - 1);         // fractional part
+    uint32_t pow10;
+    int n = s_find_largest_pow10(p1, &pow10);
+    int len = 0;
+
+    while (n > 0) {
+        buf[len++] = (char) ('0' + p1 / pow10);
+        p1 %= pow10;
+        n--;
+
+        uint64_t rest = ((uint64_t) p1 << -one.e) + p2;
+
+        if (rest <= delta) {
+            *decimal_exponent += n;
+            s_grisu2_round(buf, len, dist, delta, rest,
+                           (uint64_t) pow10 << -one.e);
+            return len;
+        }
+
+        pow10 /= 10;
+    }
+
+    int m = 0;
+
+    for (;;) {
+        p2 *= 10;
+        buf[len++] = (char) ('0' + (p2 >> -one.e));
+        p2 &= one.f - 1;
+        m++;
+        delta *= 10;
+        dist *= 10;
+
+        if (p2 <= delta)
+            break;
+    }
+
+    *decimal_exponent -= m;
+    s_grisu2_round(buf, len, dist, delta, p2, one.f);
+
+    return len;
+}
+
+// digits of positive value v, v = digits * 10^decimal_exponent
+static int s_grisu2(char* buf, int* decimal_exponent, s_boundaries b) {
+    s_cached_power cached = s_get_cached_power(b.plus.e);
+    s_diyfp c = {cached.f, cached.e};
+    s_diyfp w = s_diyfp_mul(b.w, c);
+    s_diyfp w_minus = s_diyfp_mul(b.minus, c);
+    s_diyfp w_plus = s_diyfp_mul(b.plus, c);
+    // shrink boundaries by one ulp to account for rounding errors
+    s_diyfp m_minus = {w_minus.f + 1, w_minus.e};
+    s_diyfp m_plus = {w_plus.f - 1, w_plus.e};
+
+    *decimal_exponent = -cached.k;
+
+    return s_grisu2_digit_gen(buf, decimal_exponent, m_minus, w, m_plus);
+}
+
+static int s_append_exponent(char* buf, int e) {
+    int len = 0;
+
+    buf[len++] = 'e';
+    buf[len++] = e < 0 ? '-' : '+';
+
+    return len + s_format_uint64(e < 0 ? -e : e, buf + len);
+}
+
+#define FORMAT_MIN_EXP (-4)
+#define FORMAT_MAX_EXP (15)
+
+// place decimal point into digits, buf has room for S_NUMBER_MAX_CHARS
+static int s_format_digits(char* buf, int len, int decimal_exponent) {
+    int n = len + decimal_exponent; // digits before decimal point
+
+    if (len <= n && n <= FORMAT_MAX_EXP) { // digits[000].0
+        memset(buf + len, '0', n - len);
+        buf[n] = '.';
+        buf[n + 1] = '0';
+        return n + 2;
+    }
+
+    if (0 < n && n <= FORMAT_MAX_EXP) { // dig.its
+        memmove(buf + n + 1, buf + n, len - n);
+        buf[n] = '.';
+        return len + 1;
+    }
+
+    if (FORMAT_MIN_EXP < n && n <= 0) { // 0.[000]digits
+        memmove(buf + 2 - n, buf, len);
+        buf[0] = '0';
+        buf[1] = '.';
+        memset(buf + 2, '0', -n);
+        return 2 - n + len;
+    }
+
+    if (len == 1) // de+123
+        return 1 + s_append_exponent(buf + 1, n - 1);
+
+    // d.igitse+123
+    memmove(buf + 2, buf + 1, len - 1);
+    buf[1] = '.';
+
+    return len + 1 + s_append_exponent(buf + len + 1, n - 1);
+}
+
+static int s_format_special(bool is_negative, bool is_zero, char* buf) {
+    int len = 0;
+
+    if (!is_zero) {
+        memcpy(buf, "null", 4);
+        return 4;
+    }
+
+    if (is_negative)
+        buf[len++] = '-';
+
+    memcpy(buf + len, "0.0", 3);
+
+    return len + 3;
+}
+
+int s_format_double(double value, char* buf) {
+    uint64_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool is_negative = bits >> 63;
+    int exponent = (int) ((bits >> 52) & 0x7FF);
+
+    bits &= ~(1ull << 63);
+
+    if (bits == 0 || exponent == 0x7FF)
+        return s_format_special(is_negative, bits == 0, buf);
+
+    int len = 0, decimal_exponent;
+
+    if (is_negative)
+        buf[len++] = '-';
+
+    int n_digits = s_grisu2(buf + len, &decimal_exponent,
+                            s_compute_boundaries(bits, 53, 1075));
+
+    return len + s_format_digits(buf + len, n_digits, decimal_exponent);
+}
+
+int s_format_float(float value, char* buf) {
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    bool is_negative = bits >> 31;
+    int exponent = (int) ((bits >> 23) & 0xFF);
+
+    bits &= ~(1u << 31);
+
+    if (bits == 0 || exponent == 0xFF)
+        return s_format_special(is_negative, bits == 0, buf);
+
+    int len = 0, decimal_exponent;
+
+    if (is_negative)
+        buf[len++] = '-';
+
+    // float boundaries give shortest digits that read back as the same float
+    int n_digits = s_grisu2(buf + len, &decimal_exponent,
+                            s_compute_boundaries(bits, 24, 150));
+
+    return len + s_format_digits(buf + len, n_digits, decimal_exponent);
+}
@@ -0,0 +1,289 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss/quantize.h"
+
+// F16C comes with AVX on every CPU that has it: used directly when enabled at
+// compile time, otherwise picked at run time on x86
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define S_QUANTIZE_F16C
+#include <immintrin.h>
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+// system includes
+#include <float.h>
+#include <math.h>
+#include <string.h>
+
+// values converted at a time through aligned buffers on the stack
+#define QUANTIZE_CHUNK 64
+
+uint16_t s_float_to_half(float value) {
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+
+    uint16_t sign = (uint16_t) ((bits >> 16) & 0x8000);
+    uint32_t abs = bits & 0x7FFFFFFF;
+
+    // infinity, NaN keeps its top payload bits and becomes quiet
+    if (abs >= 0x7F800000)
+        return sign | (abs > 0x7F800000 ? 0x7E00 | ((abs >> 13) & 0x3FF)
+                                        : 0x7C00);
+    // 65520 and above round past the largest half, 65504
+    if (abs >= 0x477FF000)
+        return sign | 0x7C00;
+    // below 2^-14: subnormal half, 2^-25 and below round to zero
+    if (abs < 0x38800000) {
+        if (abs <= 0x33000000)
+            return sign;
+
+        uint32_t mantissa = (abs & 0x7FFFFF) | 0x800000;
+        uint32_t shift = 126 - (abs >> 23);
+        uint32_t half = mantissa >> shift;
+        uint32_t rest = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+
+        if (rest > halfway || (rest == halfway && (half & 1)))
+            half++;
+
+        return sign | (uint16_t) half;
+    }
+
+    // normal: rebias exponent, round away 13 bits of mantissa; carry may
+    // move into exponent, which is still a correctly rounded half
+    uint32_t half = (abs - 0x38000000) >> 13;
+    uint32_t rest = abs & 0x1FFF;
+
+    if (rest > 0x1000 || (rest == 0x1000 && (half & 1)))
+        half++;
+
+    return sign | (uint16_t) half;
+}
+
+float s_half_to_float(uint16_t half) {
+    uint32_t sign = (uint32_t) (half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1F;
+    uint32_t mantissa = half & 0x3FF;
+    uint32_t bits;
+    float value;
+
+    // infinity, NaN becomes quiet as in hardware conversion
+    if (exponent == 0x1F)
+        bits = sign | 0x7F800000 | (mantissa ? 0x400000 : 0) | (mantissa << 13);
+    else if (exponent)
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    else {
+        // zero or subnormal: mantissa * 2^-24 is exact in float
+        value = (float) mantissa * (1.0f / 16777216.0f);
+        return sign ? -value : value;
+    }
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#if defined(S_QUANTIZE_F16C)
+static bool s_quantize_has_f16c(void) {
+#if defined(__F16C__) && defined(__AVX__)
+    return true;
+#else
+    return __builtin_cpu_supports("avx") && __builtin_cpu_supports("f16c");
+#endif
+}
+
+// 8 values per step; returns number of values converted
+__attribute__((target("avx,f16c"))) static size_t
+s_floats_to_halves_f16c(const float* values, size_t count, uint16_t* out) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i halves = _mm256_cvtps_ph(_mm256_loadu_ps(values + i),
+                                         _MM_FROUND_TO_NEAREST_INT);
+
+        _mm_storeu_si128((__m128i*) (out + i), halves);
+    }
+
+    return i;
+}
+
+__attribute__((target("avx,f16c"))) static size_t
+s_halves_to_floats_f16c(const uint16_t* halves, size_t count, float* out) {
+    size_t i = 0;
+
+    for (; i + 8 <= count; i += 8) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*) (halves + i));
+
+        _mm256_storeu_ps(out + i, _mm256_cvtph_ps(chunk));
+    }
+
+    return i;
+}
+#endif
+
+void s_floats_to_halves(const float* values, size_t count, uint16_t* out) {
+    size_t i = 0;
+
+#if defined(S_QUANTIZE_F16C)
+    if (count >= 8 && s_quantize_has_f16c())
+        i = s_floats_to_halves_f16c(values, count, out);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        float16x4_t halves = vcvt_f16_f32(vld1q_f32(values + i));
+
+        vst1_u16(out + i, vreinterpret_u16_f16(halves));
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = s_float_to_half(values[i]);
+}
+
+void s_halves_to_floats(const uint16_t* halves, size_t count, float* out) {
+    size_t i = 0;
+
+#if defined(S_QUANTIZE_F16C)
+    if (count >= 8 && s_quantize_has_f16c())
+        i = s_halves_to_floats_f16c(halves, count, out);
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+    for (; i + 4 <= count; i += 4) {
+        float16x4_t chunk = vreinterpret_f16_u16(vld1_u16(halves + i));
+
+        vst1q_f32(out + i, vcvt_f32_f16(chunk));
+    }
+#endif
+
+    for (; i < count; i++)
+        out[i] = s_half_to_float(halves[i]);
+}
+
+size_t s_quantized_size(const s_field_info* field) {
+    if (field->opts & S_FIELD_OPT_FIXED)
+        return field->quantized_field_info.size;
+    if (field->opts & S_FIELD_OPT_HALF)
+        return sizeof(uint16_t);
+
+    return field->size;
+}
+
+// doubles out of float range become infinities, as they would in half
+static float s_double_to_float(double value) {
+    if (value > FLT_MAX)
+        return INFINITY;
+    if (value < -FLT_MAX)
+        return -INFINITY;
+
+    return (float) value;
+}
+
+static int32_t s_fixed_round(double value, size_t size) {
+    double max = size == sizeof(int16_t) ? INT16_MAX : INT32_MAX;
+    double min = size == sizeof(int16_t) ? INT16_MIN : INT32_MIN;
+
+    if (value != value)
+        return 0;
+    if (value >= max)
+        return (int32_t) max;
+    if (value <= min)
+        return (int32_t) min;
+
+    return (int32_t) (value < 0 ? value - 0.5 : value + 0.5);
+}
+
+void s_quantize(const s_field_info* field, const void* values, size_t count,
+                uint8_t* out) {
+    bool is_double = field->size == sizeof(double);
+
+    if (field->opts & S_FIELD_OPT_FIXED) {
+        double scale = field->quantized_field_info.scale;
+        size_t size = field->quantized_field_info.size;
+
+        for (size_t i = 0; i < count; i++) {
+            double value = is_double ? ((const double*) values)[i]
+                                     : ((const float*) values)[i];
+            int32_t fixed = s_fixed_round(value * scale, size);
+
+            if (size == sizeof(int16_t)) {
+                int16_t fixed16 = (int16_t) fixed;
+
+                memcpy(out + i * size, &fixed16, size);
+            } else
+                memcpy(out + i * size, &fixed, size);
+        }
+    } else if (field->opts & S_FIELD_OPT_HALF) {
+        float floats[QUANTIZE_CHUNK];
+        uint16_t halves[QUANTIZE_CHUNK];
+
+        for (size_t i = 0; i < count; i += QUANTIZE_CHUNK) {
+            size_t n = count - i < QUANTIZE_CHUNK ? count - i : QUANTIZE_CHUNK;
+            const float* chunk = (const float*) values + i;
+
+            if (is_double) {
+                for (size_t j = 0; j < n; j++)
+                    floats[j] =
+                        s_double_to_float(((const double*) values)[i + j]);
+                chunk = floats;
+            }
+
+            s_floats_to_halves(chunk, n, halves);
+            memcpy(out + i * sizeof(uint16_t), halves, n * sizeof(uint16_t));
+        }
+    } else
+        memcpy(out, values, count * field->size);
+}
+
+void s_dequantize(const s_field_info* field, const uint8_t* wire,
+                  size_t count, void* values) {
+    bool is_double = field->size == sizeof(double);
+
+    if (field->opts & S_FIELD_OPT_FIXED) {
+        double scale = field->quantized_field_info.scale;
+        size_t size = field->quantized_field_info.size;
+
+        for (size_t i = 0; i < count; i++) {
+            double value;
+
+            if (size == sizeof(int16_t)) {
+                int16_t fixed;
+
+                memcpy(&fixed, wire + i * size, size);
+                value = fixed / scale;
+            } else {
+                int32_t fixed;
+
+                memcpy(&fixed, wire + i * size, size);
+                value = fixed / scale;
+            }
+
+            if (is_double)
+                ((double*) values)[i] = value;
+            else
+                ((float*) values)[i] = (float) value;
+        }
+    } else if (field->opts & S_FIELD_OPT_HALF) {
+        float floats[QUANTIZE_CHUNK];
+        uint16_t halves[QUANTIZE_CHUNK];
+
+        for (size_t i = 0; i < count; i += QUANTIZE_CHUNK) {
+            size_t n = count - i < QUANTIZE_CHUNK ? count - i : QUANTIZE_CHUNK;
+
+            memcpy(halves, wire + i * sizeof(uint16_t), n * sizeof(uint16_t));
+
+            if (!is_double) {
+                s_halves_to_floats(halves, n, (float*) values + i);
+                continue;
+            }
+
+            s_halves_to_floats(halves, n, floats);
+            for (size_t j = 0; j < n; j++)
+                ((double*) values)[i + j] = floats[j];
+        }
+    } else
+        memcpy(values, wire, count * field->size);
+}
@@ -7,59 +7,1882 @@
 
 #include "sss/serializer.h"
 
+#include "sss/bits.h"
+#include "sss/json.h"
 #include "sss/log.h"
+#include "sss/quantize.h"
 #include "sss/sss.h"
 #include "sss/tlv.h"
 
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+// union tables
+#define S_UNION_MIN_DENSE_SLOTS (16)
+#define S_UNION_MAX_SLOTS (4096)
+#define S_UNION_MAX_SEEDS (256)
+
+static uint32_t s_union_hash(const char* str, uint32_t seed) {
+    uint32_t hash = 0x811C9DC5u ^ seed;
+
+    while (*str) {
+        hash ^= (uint8_t) *str++;
+        hash *= 0x01000193u;
+    }
+
+    return hash ^ (hash >> 15);
+}
+
+// run of tagged fields starting at first that share its tag
+static size_t s_union_run_length(const s_field_info* fields, size_t first,
+                                 size_t field_count) {
+    const s_field_info* head = &fields[first];
+    size_t n = 0;
+
+    while (first + n < field_count) {
+        const s_field_info* field = &fields[first + n];
+
+        if (!(field->opts & S_FIELD_OPT_OPTIONAL) ||
+            field->optional_field_info.tag_offset !=
+                head->optional_field_info.tag_offset ||
+            field->optional_field_info.tag_type !=
+                head->optional_field_info.tag_type)
+            break;
+
+        n++;
+    }
+
+    return n;
+}
+
+// slots of int tags, false if values repeat or are too sparse
+static bool s_union_fill_int(const s_field_info* fields, size_t n,
+                             s_union_table* table, uint8_t* slots) {
+    for (size_t i = 0; i < n; i++) {
+        uint32_t slot = (uint32_t) fields[i].optional_field_info.tag_value_int -
+                        (uint32_t) table->min_tag;
+
+        if (slots[slot])
+            return false;
+
+        slots[slot] = (uint8_t) (i + 1);
+    }
+
+    return true;
+}
+
+// searches for a seed that gives every string tag its own slot
+static bool s_union_fill_string(const s_field_info* fields, size_t n,
+                                s_union_table* table, uint8_t* slots) {
+    for (uint32_t seed = 0; seed < S_UNION_MAX_SEEDS; seed++) {
+        bool is_perfect = true;
+
+        memset(slots, 0, table->n_slots);
+
+        for (size_t i = 0; i < n && is_perfect; i++) {
+            const char* tag = fields[i].optional_field_info.tag_value_string;
+            uint32_t slot = s_union_hash(tag, seed) & (table->n_slots - 1);
+
+            // same strings never separate
+            if (slots[slot] &&
+                !strcmp(tag, fields[slots[slot] - 1]
+                                 .optional_field_info.tag_value_string))
+                return false;
+
+            is_perfect = !slots[slot];
+            slots[slot] = (uint8_t) (i + 1);
+        }
+
+        if (is_perfect) {
+            table->seed = seed;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static const s_union_table* s_union_table_build(const s_field_info* fields,
+                                                size_t first, size_t n) {
+    const s_field_info* alternatives = &fields[first];
+    s_union_table table = {
+        .fields = alternatives, .first_field = first, .field_count = n};
+    bool is_int = alternatives->optional_field_info.tag_type ==
+                  FIELD_TYPE_INT32;
+
+    // slots hold alternative index + 1 in a byte
+    if (n >= UINT8_MAX)
+        return NULL;
+
+    if (is_int) {
+        int32_t max_tag = alternatives->optional_field_info.tag_value_int;
+
+        table.min_tag = max_tag;
+
+        for (size_t i = 1; i < n; i++) {
+            int32_t tag = alternatives[i].optional_field_info.tag_value_int;
+
+            table.min_tag = tag < table.min_tag ? tag : table.min_tag;
+            max_tag = tag > max_tag ? tag : max_tag;
+        }
+
+        uint64_t range = (uint64_t) ((int64_t) max_tag - table.min_tag) + 1;
+
+        if (range > S_UNION_MIN_DENSE_SLOTS && range > 4 * n)
+            return NULL;
+
+        table.n_slots = (uint32_t) range;
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            if (!alternatives[i].optional_field_info.tag_value_string)
+                return NULL;
+        }
+
+        table.n_slots = 1;
+
+        while (table.n_slots < 2 * n)
+            table.n_slots <<= 1;
+    }
+
+    // never released, same as fields
+    for (; table.n_slots <= S_UNION_MAX_SLOTS; table.n_slots <<= 1) {
+        s_union_table* stored =
+            (s_union_table*) calloc(1, sizeof(s_union_table) + table.n_slots);
+
+        if (!stored)
+            return NULL;
+
+        uint8_t* slots = (uint8_t*) (stored + 1);
+        bool is_filled = is_int
+                             ? s_union_fill_int(alternatives, n, &table, slots)
+                             : s_union_fill_string(alternatives, n, &table,
+                                                   slots);
+
+        if (is_filled) {
+            *stored = table;
+            stored->slots = slots;
+            return stored;
+        }
+
+        free(stored);
+
+        // int tables don't get better with size
+        if (is_int)
+            return NULL;
+    }
+
+    return NULL;
+}
+
+const s_field_info* s_union_table_find(const s_union_table* table,
+                                       const void* tag) {
+    uint32_t slot;
+
+    if (table->fields->optional_field_info.tag_type == FIELD_TYPE_INT32) {
+        int32_t value;
+
+        memcpy(&value, tag, sizeof(value));
+        // tags below min_tag wrap around past n_slots
+        slot = (uint32_t) value - (uint32_t) table->min_tag;
+
+        if (slot >= table->n_slots || !table->slots[slot])
+            return NULL;
+
+        return &table->fields[table->slots[slot] - 1];
+    }
+
+    slot = s_union_hash((const char*) tag, table->seed) & (table->n_slots - 1);
+
+    if (!table->slots[slot])
+        return NULL;
+
+    const s_field_info* field = &table->fields[table->slots[slot] - 1];
+
+    return strcmp((const char*) tag,
+                  field->optional_field_info.tag_value_string) == 0
+               ? field
+               : NULL;
+}
+
+// packed bools share a bitmap with the ones declared next to them, as long as
+// they are next to each other in memory too
+static bool s_is_bool_packed(const s_field_info* field) {
+    return field->type == FIELD_TYPE_BOOL && field->size == sizeof(bool) &&
+           (field->opts & S_FIELD_OPT_BOOL_PACKED) &&
+           !(field->opts & S_FIELD_OPT_OPTIONAL);
+}
+
+static size_t s_bool_run_length(const s_field_info* fields, size_t first,
+                                size_t field_count) {
+    size_t n = 1;
+
+    while (first + n < field_count && s_is_bool_packed(&fields[first + n]) &&
+           fields[first + n].offset == fields[first].offset + n)
+        n++;
+
+    return n;
+}
+
+// floats and doubles, alone or in builtin arrays, can be quantized; fixed point
+// needs positive scale and 16- or 32-bit integers
+static bool s_is_quantized_valid(const s_field_info* field) {
+    bool is_float_array =
+        field->type == FIELD_TYPE_ARRAY && !field->struct_type_info &&
+        field->array_field_info.builtin_type == S_ARRAY_BUILTIN_TYPE_FLOAT;
+
+    if ((field->type != FIELD_TYPE_FLOAT && field->type != FIELD_TYPE_DOUBLE &&
+         !is_float_array) ||
+        (field->size != sizeof(float) && field->size != sizeof(double)))
+        return false;
+
+    if (!(field->opts & S_FIELD_OPT_FIXED))
+        return true;
+
+    return field->quantized_field_info.scale > 0 &&
+           (field->quantized_field_info.size == sizeof(int16_t) ||
+            field->quantized_field_info.size == sizeof(int32_t));
+}
+
+const s_field_info* s_type_info_store_fields(const s_field_info* fields,
+                                             size_t field_count) {
+    // type info is never released, same as static tables it replaces
+    s_field_info* stored =
+        (s_field_info*) malloc((field_count ? field_count : 1) *
+                               sizeof(s_field_info));
+
+    if (!stored || !field_count)
+        return stored;
+
+    memcpy(stored, fields, field_count * sizeof(s_field_info));
+
+    // unions without table are resolved field by field
+    for (size_t i = 0; i < field_count; i++) {
+        s_field_type tag_type = stored[i].optional_field_info.tag_type;
+
+        if (!(stored[i].opts & S_FIELD_OPT_OPTIONAL) ||
+            (tag_type != FIELD_TYPE_INT32 && tag_type != FIELD_TYPE_STRING))
+            continue;
+
+        size_t n = s_union_run_length(stored, i, field_count);
+        const s_union_table* table =
+            n > 1 ? s_union_table_build(stored, i, n) : NULL;
+
+        for (size_t j = i; j < i + n; j++)
+            stored[j].optional_field_info.table = table;
+
+        i += n - 1;
+    }
+
+    for (size_t i = 0; i < field_count; i++) {
+        if (!s_is_bool_packed(&stored[i])) {
+            stored[i].opts &= ~S_FIELD_OPT_BOOL_PACKED;
+            continue;
+        }
+
+        size_t n = s_bool_run_length(stored, i, field_count);
+
+        for (size_t j = 0; j < n; j++) {
+            stored[i + j].packed_field_info.bit = (uint32_t) j;
+            stored[i + j].packed_field_info.count = (uint32_t) n;
+        }
+
+        i += n - 1;
+    }
+
+    for (size_t i = 0; i < field_count; i++) {
+        if (!s_is_quantized_valid(&stored[i]))
+            stored[i].opts &= ~S_FIELD_OPTS_QUANTIZED;
+    }
+
+    return stored;
+}
+
+// field index: minimal perfect hash (hash and displace) over names and labels.
+// Keys are split into buckets of about S_FIELD_INDEX_BUCKET_SIZE; every bucket
+// gets displacements that put its keys into free slots, largest buckets first.
+#define S_FIELD_INDEX_BUCKET_SIZE (4)
+#define S_FIELD_INDEX_MAX_SEEDS (16)
+#define S_FIELD_INDEX_MAX_ENTRIES (2 * S_MAX_FIELDS)
+#define S_FIELD_INDEX_FREE (UINT16_MAX)
+
+typedef struct {
+    const char* key;
+    size_t len;
+    uint16_t field_idx;
+    uint16_t next; // entry of next field with the same key + 1, 0 -- none
+} s_field_index_entry;
+
+typedef struct s_field_index {
+    uint32_t seed;
+    uint32_t n_keys; // distinct keys, one slot each
+    uint32_t n_buckets;
+    const uint16_t* displacements; // two per bucket
+    const uint16_t* slots;         // entry of first field with the key
+    const s_field_index_entry* entries;
+} s_field_index;
+
+static uint64_t s_name_hash(const char* name, size_t len, uint32_t seed) {
+    uint64_t hash = 0xCBF29CE484222325ULL ^ seed;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t) name[i];
+        hash *= 0x100000001B3ULL;
+    }
+
+    // FNV-1a leaves high bits of short keys poorly mixed
+    hash ^= hash >> 31;
+    hash *= 0xBF58476D1CE4E5B9ULL;
+
+    return hash ^ (hash >> 29);
+}
+
+static uint32_t s_field_index_bucket(uint64_t hash, uint32_t n_buckets) {
+    return (uint32_t) (hash % n_buckets);
+}
+
+static uint32_t s_field_index_slot(uint64_t hash, uint32_t n_keys,
+                                   uint32_t d0, uint32_t d1) {
+    uint32_t f1 = (uint32_t) (hash >> 32) % n_keys;
+    uint32_t f2 = (uint32_t) (hash >> 16) % n_keys;
+
+    return (uint32_t) ((f1 + (uint64_t) d0 * f2 + d1) % n_keys);
+}
+
+static bool s_field_index_key_equals(const char* key, const char* name,
+                                     size_t len) {
+    return key && strncmp(key, name, len) == 0 && key[len] == '\0';
+}
+
+static uint32_t s_field_index_bucket_size(const uint16_t* bucket_start,
+                                          uint32_t bucket) {
+    return (uint32_t) (bucket_start[bucket + 1] - bucket_start[bucket]);
+}
+
+// places keys of heads (one entry per distinct key) with seed of index
+static bool s_field_index_place(s_field_index* index, const uint16_t* heads,
+                                uint16_t* displacements, uint16_t* slots) {
+    const s_field_index_entry* entries = index->entries;
+    uint64_t hashes[S_FIELD_INDEX_MAX_ENTRIES];
+    uint16_t members[S_FIELD_INDEX_MAX_ENTRIES];
+    uint16_t bucket_start[S_FIELD_INDEX_MAX_ENTRIES + 1] = {0};
+    uint16_t order[S_FIELD_INDEX_MAX_ENTRIES];
+    uint32_t n_keys = index->n_keys;
+    uint32_t n_buckets = index->n_buckets;
+
+    // counting sort of keys by bucket
+    for (uint32_t k = 0; k < n_keys; k++) {
+        const s_field_index_entry* entry = &entries[heads[k]];
+
+        hashes[k] = s_name_hash(entry->key, entry->len, index->seed);
+        bucket_start[s_field_index_bucket(hashes[k], n_buckets) + 1]++;
+    }
+
+    for (uint32_t b = 0; b < n_buckets; b++) {
+        bucket_start[b + 1] += bucket_start[b];
+        order[b] = (uint16_t) b;
+    }
+
+    uint16_t fill[S_FIELD_INDEX_MAX_ENTRIES];
+
+    memcpy(fill, bucket_start, n_buckets * sizeof(uint16_t));
+    for (uint32_t k = 0; k < n_keys; k++)
+        members[fill[s_field_index_bucket(hashes[k], n_buckets)]++] =
+            (uint16_t) k;
+
+    // largest buckets first, while most slots are free
+    for (uint32_t i = 1; i < n_buckets; i++) {
+        uint16_t b = order[i];
+        uint32_t j = i;
+
+        while (j > 0 &&
+               s_field_index_bucket_size(bucket_start, order[j - 1]) <
+                   s_field_index_bucket_size(bucket_start, b)) {
+            order[j] = order[j - 1];
+            j--;
+        }
+
+        order[j] = b;
+    }
+
+    for (uint32_t i = 0; i < n_keys; i++)
+        slots[i] = S_FIELD_INDEX_FREE;
+
+    for (uint32_t i = 0; i < n_buckets; i++) {
+        uint16_t b = order[i];
+        const uint16_t* keys = &members[bucket_start[b]];
+        uint32_t size = s_field_index_bucket_size(bucket_start, b);
+        bool is_placed = size == 0;
+
+        displacements[2 * b] = displacements[2 * b + 1] = 0;
+
+        for (uint32_t d0 = 0; d0 < n_keys && !is_placed; d0++) {
+            for (uint32_t d1 = 0; d1 < n_keys && !is_placed; d1++) {
+                uint32_t taken[S_FIELD_INDEX_MAX_ENTRIES];
+                uint32_t n_taken = 0;
+
+                for (; n_taken < size; n_taken++) {
+                    uint32_t slot =
+                        s_field_index_slot(hashes[keys[n_taken]], n_keys, d0, d1);
+                    bool is_free = slots[slot] == S_FIELD_INDEX_FREE;
+
+                    for (uint32_t t = 0; t < n_taken && is_free; t++)
+                        is_free = taken[t] != slot;
+
+                    if (!is_free)
+                        break;
+
+                    taken[n_taken] = slot;
+                }
+
+                if (n_taken < size)
+                    continue;
+
+                for (uint32_t t = 0; t < size; t++)
+                    slots[taken[t]] = heads[keys[t]];
+
+                displacements[2 * b] = (uint16_t) d0;
+                displacements[2 * b + 1] = (uint16_t) d1;
+                is_placed = true;
+            }
+        }
+
+        if (!is_placed)
+            return false;
+    }
+
+    return true;
+}
+
+const s_field_index* s_type_info_build_field_index(const s_type_info* info) {
+    if (!info || !info->fields || !info->field_count ||
+        info->field_count > S_MAX_FIELDS)
+        return NULL;
+
+    s_field_index_entry entries[S_FIELD_INDEX_MAX_ENTRIES];
+    uint16_t heads[S_FIELD_INDEX_MAX_ENTRIES];
+    uint32_t n_entries = 0, n_keys = 0;
+
+    // entries in field order, fields sharing a key are chained
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* keys[2] = {field->name, field->label};
+
+        for (int k = 0; k < 2; k++) {
+            if (!keys[k] || (k == 1 && keys[0] && !strcmp(keys[0], keys[1])))
+                continue;
+
+            s_field_index_entry* entry = &entries[n_entries];
+            uint32_t head = 0;
+
+            entry->key = keys[k];
+            entry->len = strlen(keys[k]);
+            entry->field_idx = (uint16_t) i;
+            entry->next = 0;
+
+            while (head < n_keys &&
+                   !s_field_index_key_equals(entries[heads[head]].key,
+                                             entry->key, entry->len))
+                head++;
+
+            if (head == n_keys) {
+                heads[n_keys++] = (uint16_t) n_entries;
+            } else {
+                s_field_index_entry* tail = &entries[heads[head]];
+
+                while (tail->next)
+                    tail = &entries[tail->next - 1];
+                tail->next = (uint16_t) (n_entries + 1);
+            }
+
+            n_entries++;
+        }
+    }
+
+    if (!n_keys)
+        return NULL;
+
+    uint32_t n_buckets =
+        (n_keys + S_FIELD_INDEX_BUCKET_SIZE - 1) / S_FIELD_INDEX_BUCKET_SIZE;
+
+    // never released, same as fields
+    s_field_index* index = (s_field_index*) malloc(
+        sizeof(s_field_index) + n_entries * sizeof(s_field_index_entry) +
+        (2 * n_buckets + n_keys) * sizeof(uint16_t));
+
+    if (!index)
+        return NULL;
+
+    s_field_index_entry* stored_entries = (s_field_index_entry*) (index + 1);
+    uint16_t* displacements = (uint16_t*) (stored_entries + n_entries);
+    uint16_t* slots = displacements + 2 * n_buckets;
+
+    memcpy(stored_entries, entries, n_entries * sizeof(s_field_index_entry));
+    index->n_keys = n_keys;
+    index->n_buckets = n_buckets;
+    index->displacements = displacements;
+    index->slots = slots;
+    index->entries = stored_entries;
+
+    for (uint32_t seed = 0; seed < S_FIELD_INDEX_MAX_SEEDS; seed++) {
+        index->seed = seed;
+
+        if (s_field_index_place(index, heads, displacements, slots))
+            return index;
+    }
+
+    free(index);
+    return NULL;
+}
+
+// first entry with the key
+static const s_field_index_entry*
+s_field_index_find(const s_field_index* index, const char* name, size_t len) {
+    uint64_t hash = s_name_hash(name, len, index->seed);
+    uint32_t b = s_field_index_bucket(hash, index->n_buckets);
+    uint32_t slot =
+        s_field_index_slot(hash, index->n_keys, index->displacements[2 * b],
+                           index->displacements[2 * b + 1]);
+    const s_field_index_entry* entry = &index->entries[index->slots[slot]];
+
+    return entry->len == len && memcmp(entry->key, name, len) == 0 ? entry
+                                                                   : NULL;
+}
+
+static const s_field_info* s_find_field_from(const s_type_info* info,
+                                             size_t first, const char* name,
+                                             size_t len) {
+    for (size_t i = first; i < info->field_count; i++) {
+        if (s_field_index_key_equals(info->fields[i].name, name, len) ||
+            s_field_index_key_equals(info->fields[i].label, name, len))
+            return &info->fields[i];
+    }
+
+    return NULL;
+}
+
+const s_field_info* s_find_field(const s_type_info* info, const char* name,
+                                 size_t len) {
+    if (!info || !name)
+        return NULL;
+
+    if (!info->field_index)
+        return s_find_field_from(info, 0, name, len);
+
+    const s_field_index_entry* entry =
+        s_field_index_find(info->field_index, name, len);
+
+    return entry ? &info->fields[entry->field_idx] : NULL;
+}
+
+const s_field_info* s_find_next_field(const s_type_info* info,
+                                      const s_field_info* field,
+                                      const char* name, size_t len) {
+    if (!info || !field || !name)
+        return NULL;
+
+    size_t field_idx = (size_t) (field - info->fields);
+
+    if (!info->field_index)
+        return s_find_field_from(info, field_idx + 1, name, len);
+
+    const s_field_index* index = info->field_index;
+    const s_field_index_entry* entry = s_field_index_find(index, name, len);
+
+    while (entry && entry->field_idx != field_idx)
+        entry = entry->next ? &index->entries[entry->next - 1] : NULL;
+
+    if (!entry || !entry->next)
+        return NULL;
+
+    return &info->fields[index->entries[entry->next - 1].field_idx];
+}
+
+// maps
+typedef struct {
+    const char* str; // string keys
+    uint64_t value;  // integer keys, sign bit flipped so that order holds
+} s_map_key;
+
+static const s_field_info* s_map_key_field(const s_type_info* entry_info) {
+    if (!entry_info || !entry_info->field_count)
+        return NULL;
+
+    const s_field_info* field = &entry_info->fields[0];
+
+    if (field->type == FIELD_TYPE_STRING ||
+        (field->type >= FIELD_TYPE_INT8 && field->type <= FIELD_TYPE_UINT64))
+        return field;
+
+    return NULL;
+}
+
+// key is either in entry or passed to lookup, where strings come as they are
+static s_map_key s_map_read_key(const s_field_info* key_field,
+                                const void* key, bool is_entry) {
+    s_map_key map_key = {0};
+
+    if (key_field->type == FIELD_TYPE_STRING) {
+        if (is_entry && !(key_field->opts & S_FIELD_OPT_STRING_FIXED))
+            memcpy(&map_key.str, key, sizeof(map_key.str));
+        else
+            map_key.str = (const char*) key;
+
+        if (!map_key.str)
+            map_key.str = "";
+
+        return map_key;
+    }
+
+    bool is_signed = key_field->type == FIELD_TYPE_INT8 ||
+                     key_field->type == FIELD_TYPE_INT16 ||
+                     key_field->type == FIELD_TYPE_INT32 ||
+                     key_field->type == FIELD_TYPE_INT64;
+
+    switch (key_field->size) {
+    case 1: {
+        uint8_t value;
+        memcpy(&value, key, sizeof(value));
+        map_key.value = is_signed ? (uint64_t) (int64_t) (int8_t) value : value;
+    } break;
+    case 2: {
+        uint16_t value;
+        memcpy(&value, key, sizeof(value));
+        map_key.value =
+            is_signed ? (uint64_t) (int64_t) (int16_t) value : value;
+    } break;
+    case 4: {
+        uint32_t value;
+        memcpy(&value, key, sizeof(value));
+        map_key.value =
+            is_signed ? (uint64_t) (int64_t) (int32_t) value : value;
+    } break;
+    default: {
+        memcpy(&map_key.value, key, sizeof(map_key.value));
+    } break;
+    }
+
+    if (is_signed)
+        map_key.value ^= 1ULL << 63;
+
+    return map_key;
+}
+
+static s_map_key s_map_entry_key(const s_field_info* key_field,
+                                 const uint8_t* entry) {
+    return s_map_read_key(key_field, entry + key_field->offset, true);
+}
+
+static int s_map_compare(s_map_key a, s_map_key b) {
+    if (a.str)
+        return strcmp(a.str, b.str);
+
+    return a.value < b.value ? -1 : a.value > b.value;
+}
+
+static uint64_t s_map_hash(s_map_key key) {
+    if (key.str)
+        return s_name_hash(key.str, strlen(key.str), 0);
+
+    uint64_t hash = key.value * 0x9E3779B97F4A7C15ULL;
+
+    return hash ^ (hash >> 32);
+}
+
+static void s_map_swap(uint8_t* a, uint8_t* b, size_t size) {
+    while (size--) {
+        uint8_t tmp = *a;
+        *a++ = *b;
+        *b++ = tmp;
+    }
+}
+
+// heap sort, entries are sorted in place
+static void s_map_sift_down(const s_field_info* key_field, uint8_t* entries,
+                            size_t entry_size, size_t root, size_t count) {
+    for (size_t child; (child = 2 * root + 1) < count; root = child) {
+        if (child + 1 < count &&
+            s_map_compare(
+                s_map_entry_key(key_field, entries + child * entry_size),
+                s_map_entry_key(key_field,
+                                entries + (child + 1) * entry_size)) < 0)
+            child++;
+
+        if (s_map_compare(
+                s_map_entry_key(key_field, entries + root * entry_size),
+                s_map_entry_key(key_field, entries + child * entry_size)) >= 0)
+            return;
+
+        s_map_swap(entries + root * entry_size, entries + child * entry_size,
+                   entry_size);
+    }
+}
+
+void s_map_sort(const s_type_info* entry_info, s_map* map) {
+    const s_field_info* key_field = s_map_key_field(entry_info);
+
+    if (!key_field || !map || !map->entries || map->count < 2)
+        return;
+
+    uint8_t* entries = (uint8_t*) map->entries;
+    size_t entry_size = entry_info->type_size;
+
+    for (size_t i = map->count / 2; i-- > 0;)
+        s_map_sift_down(key_field, entries, entry_size, i, map->count);
+
+    for (size_t end = map->count - 1; end > 0; end--) {
+        s_map_swap(entries, entries + end * entry_size, entry_size);
+        s_map_sift_down(key_field, entries, entry_size, 0, end);
+    }
+}
+
+s_serializer_error s_map_build_index(const s_type_info* entry_info, s_map* map,
+                                     s_allocator* allocator, void* user_data) {
+    const s_field_info* key_field = s_map_key_field(entry_info);
+
+    if (!key_field || !map || !allocator || map->count > UINT32_MAX / 4 ||
+        (map->count && !map->entries))
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    if (map->slots)
+        allocator->deallocate(map->slots, user_data);
+
+    map->slots = NULL;
+    map->n_slots = 0;
+
+    if (!map->count)
+        return SERIALIZER_OK;
+
+    // at most half full, probes stay short
+    uint32_t n_slots = 1;
+
+    while (n_slots < 2 * map->count)
+        n_slots <<= 1;
+
+    uint32_t* slots =
+        (uint32_t*) allocator->allocate(n_slots * sizeof(uint32_t), user_data);
+
+    if (!slots)
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+    memset(slots, 0, n_slots * sizeof(uint32_t));
+
+    const uint8_t* entries = (const uint8_t*) map->entries;
+
+    for (uint32_t i = 0; i < map->count; i++) {
+        uint32_t slot = (uint32_t) s_map_hash(s_map_entry_key(
+                            key_field, entries + i * entry_info->type_size)) &
+                        (n_slots - 1);
+
+        while (slots[slot])
+            slot = (slot + 1) & (n_slots - 1);
+
+        slots[slot] = i + 1;
+    }
+
+    map->slots = slots;
+    map->n_slots = n_slots;
+
+    return SERIALIZER_OK;
+}
+
+void* s_map_find(const s_type_info* entry_info, const s_map* map,
+                 const void* key) {
+    const s_field_info* key_field = s_map_key_field(entry_info);
+
+    if (!key_field || !map || !key || !map->count || !map->entries)
+        return NULL;
+
+    uint8_t* entries = (uint8_t*) map->entries;
+    size_t entry_size = entry_info->type_size;
+    s_map_key map_key = s_map_read_key(key_field, key, false);
+
+    if (map->n_slots) {
+        uint32_t mask = map->n_slots - 1;
+
+        for (uint32_t slot = (uint32_t) s_map_hash(map_key) & mask;
+             map->slots[slot]; slot = (slot + 1) & mask) {
+            uint8_t* entry = entries + (map->slots[slot] - 1) * entry_size;
+
+            if (!s_map_compare(s_map_entry_key(key_field, entry), map_key))
+                return entry;
+        }
+
+        return NULL;
+    }
+
+    size_t lo = 0, hi = map->count;
+
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        uint8_t* entry = entries + mid * entry_size;
+        int cmp = s_map_compare(s_map_entry_key(key_field, entry), map_key);
+
+        if (!cmp)
+            return entry;
+
+        if (cmp < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    return NULL;
+}
+
+void s_map_free(s_map* map, s_allocator* allocator, void* user_data) {
+    if (!map || !allocator)
+        return;
+
+    if (map->entries)
+        allocator->deallocate(map->entries, user_data);
+
+    if (map->slots)
+        allocator->deallocate(map->slots, user_data);
+
+    *map = (s_map) {0};
+}
+
+s_serializer_error s_map_finish(const s_field_info* field, s_map* map,
+                                s_allocator* allocator, void* user_data) {
+    const s_type_info* entry_info =
+        field->struct_type_info->fields[1].struct_type_info;
+
+    if (field->opts & S_FIELD_OPT_MAP_HASHED)
+        return s_map_build_index(entry_info, map, allocator, user_data);
+
+    if (map->slots)
+        allocator->deallocate(map->slots, user_data);
+
+    map->slots = NULL;
+    map->n_slots = 0;
+    s_map_sort(entry_info, map);
+
+    return SERIALIZER_OK;
+}
+
+s_type_info* s_map_type_info_init(s_type_info* map_info,
+                                  s_field_info* map_fields,
+                                  const char* type_name,
+                                  s_type_info* entry_info) {
+    assert(s_map_key_field(entry_info) &&
+           "Map key must be the first field, integer or string");
+
+    map_fields[0] = (s_field_info) {.type = FIELD_TYPE_UINT32,
+                                    .offset = offsetof(s_map, count),
+                                    .size = sizeof(uint32_t),
+                                    .name = "count"};
+    map_fields[1] = (s_field_info) {.type = FIELD_TYPE_ARRAY,
+                                    .opts = S_FIELD_OPT_ARRAY_DYNAMIC,
+                                    .offset = offsetof(s_map, entries),
+                                    .size = entry_info->type_size,
+                                    .struct_type_info = entry_info,
+                                    .name = "entries"};
+    map_fields[1].array_field_info.size_field_size = sizeof(uint32_t);
+    map_fields[1].array_field_info.size_field_offset =
+        offsetof(s_map, count);
+
+    *map_info = (s_type_info) {.type_name = type_name,
+                               .fields = map_fields,
+                               .field_count = 2,
+                               .type_size = sizeof(s_map)};
+    map_info->schema_hash = s_type_info_hash(map_info);
+    map_info->field_index = s_type_info_build_field_index(map_info);
+
+    return map_info;
+}
+
+// schema hash: FNV-1a over field descriptions, values are hashed byte by
+// byte in little endian order so that the hash is the same on all platforms
+#define S_HASH_OFFSET_BASIS (0xCBF29CE484222325ULL)
+#define S_HASH_PRIME (0x100000001B3ULL)
+#define S_HASH_NO_FIELD (UINT64_MAX)
+
+static uint64_t s_hash_u64(uint64_t hash, uint64_t value) {
+    for (int i = 0; i < 8; i++) {
+        hash ^= (uint8_t) (value >> (8 * i));
+        hash *= S_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+// terminating zero included, so that adjacent strings can't run together
+static uint64_t s_hash_string(uint64_t hash, const char* str) {
+    if (!str)
+        return s_hash_u64(hash, 0);
+
+    do {
+        hash ^= (uint8_t) *str;
+        hash *= S_HASH_PRIME;
+    } while (*str++);
+
+    return hash;
+}
+
+// fields are referred to by index, offsets depend on layout
+static uint64_t s_hash_field_idx(const s_type_info* info, size_t offset) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        if (info->fields[i].offset == offset)
+            return i;
+    }
+
+    return S_HASH_NO_FIELD;
+}
+
+uint64_t s_type_info_hash(const s_type_info* info) {
+    if (!info)
+        return 0;
+
+    if (info->schema_hash)
+        return info->schema_hash;
+
+    uint64_t hash = s_hash_u64(S_HASH_OFFSET_BASIS, info->field_count);
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        bool is_pointer = field->type == FIELD_TYPE_STRING &&
+                          !(field->opts & S_FIELD_OPT_STRING_FIXED);
+
+        hash = s_hash_string(hash, field->name);
+        hash = s_hash_u64(hash, (uint64_t) field->type);
+        // layout of decoded maps is not on the wire
+        hash = s_hash_u64(hash,
+                          (uint32_t) (field->opts & ~S_FIELD_OPT_MAP_HASHED));
+
+        // sizes of pointers and structs are not on the wire
+        if (!is_pointer && !field->struct_type_info)
+            hash = s_hash_u64(hash, field->size);
+
+        // packed bools make up bitmaps by runs, which depend on layout
+        if (field->opts & S_FIELD_OPT_BOOL_PACKED)
+            hash = s_hash_u64(hash, field->packed_field_info.count);
+
+        if (field->opts & S_FIELD_OPT_FIXED) {
+            uint64_t scale;
+
+            memcpy(&scale, &field->quantized_field_info.scale, sizeof(scale));
+            hash = s_hash_u64(hash, scale);
+            hash = s_hash_u64(hash, field->quantized_field_info.size);
+        }
+
+        if (field->type == FIELD_TYPE_ARRAY) {
+            size_t count_offset = field->array_field_info.size_field_offset;
+
+            hash = s_hash_u64(hash, field->array_field_info.builtin_type);
+            hash = s_hash_u64(hash, field->array_field_info.capacity);
+            hash = s_hash_u64(hash, field->array_field_info.size_field_size);
+            hash = s_hash_u64(hash, s_hash_field_idx(info, count_offset));
+        }
+
+        if (field->opts & S_FIELD_OPT_OPTIONAL) {
+            size_t tag_offset = field->optional_field_info.tag_offset;
+
+            hash = s_hash_u64(hash, field->optional_field_info.tag_type);
+            hash = s_hash_u64(hash, s_hash_field_idx(info, tag_offset));
+
+            if (field->optional_field_info.tag_type == FIELD_TYPE_INT32)
+                hash = s_hash_u64(
+                    hash, (uint32_t) field->optional_field_info.tag_value_int);
+            else
+                hash = s_hash_string(
+                    hash, field->optional_field_info.tag_value_string);
+        }
+
+        // nested types come in by their hash
+        if (field->struct_type_info == info)
+            hash = s_hash_u64(hash, S_HASH_NO_FIELD);
+        else if (field->struct_type_info)
+            hash = s_hash_u64(hash, s_type_info_hash(field->struct_type_info));
+    }
+
+    // zero means "not computed yet"
+    return hash ? hash : 1;
+}
+
+static uint32_t s_serialize_flags(s_serialize_options opts) {
+    uint32_t flags = TLV_ENCODE_FLAG_NONE;
+
+    if (opts.use_varints)
+        flags |= TLV_ENCODE_FLAG_VARINT;
+    if (opts.use_compact_format)
+        flags |= TLV_ENCODE_FLAG_COMPACT;
+    if (opts.use_field_ids)
+        flags |= TLV_ENCODE_FLAG_FIELD_IDS;
+    if (opts.omit_defaults)
+        flags |= TLV_ENCODE_FLAG_OMIT_DEFAULTS;
+
+    return flags;
+}
+
+// schema header
+static void s_write_u64_be(uint8_t* buffer, uint64_t value) {
+    for (int i = 0; i < 8; i++)
+        buffer[i] = (uint8_t) (value >> (56 - 8 * i));
+}
+
+static uint64_t s_read_u64_be(const uint8_t* buffer) {
+    uint64_t value = 0;
+
+    for (int i = 0; i < 8; i++)
+        value = (value << 8) | buffer[i];
+
+    return value;
+}
+
+s_serializer_error s_read_schema_header(const uint8_t* buffer,
+                                        size_t buffer_size,
+                                        s_schema_header* header) {
+    if (!buffer || !header || buffer_size < S_SCHEMA_HEADER_SIZE ||
+        buffer[0] != TLV_SCHEMA_HEADER_MAGIC ||
+        buffer[1] != TLV_SCHEMA_HEADER_VERSION)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    header->version = buffer[1];
+    header->schema_hash = s_read_u64_be(buffer + 2);
+    header->length = ((uint32_t) buffer[10] << 24) |
+                     ((uint32_t) buffer[11] << 16) |
+                     ((uint32_t) buffer[12] << 8) | (uint32_t) buffer[13];
+
+    return SERIALIZER_OK;
+}
+
+// leaves buffer at the message if it starts with a header that matches info
+static s_serializer_error s_skip_schema_header(const s_type_info* info,
+                                               const uint8_t** buffer,
+                                               size_t* buffer_size) {
+    s_schema_header header;
+
+    if (!*buffer_size || (*buffer)[0] != TLV_SCHEMA_HEADER_MAGIC)
+        return SERIALIZER_OK;
+
+    if (s_read_schema_header(*buffer, *buffer_size, &header) !=
+            SERIALIZER_OK ||
+        header.length > *buffer_size - S_SCHEMA_HEADER_SIZE) {
+        LOG_DEBUG("ERROR (deserialize): invalid schema header");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    if (header.schema_hash != s_type_info_hash(info)) {
+        LOG_DEBUG("ERROR (deserialize): schema hash mismatch for %s",
+                  info->type_name);
+        return SERIALIZER_ERROR_SCHEMA_MISMATCH;
+    }
+
+    *buffer += S_SCHEMA_HEADER_SIZE;
+    *buffer_size = header.length;
+
+    return SERIALIZER_OK;
+}
+
+// encodes data (or delta of prev and data) after optional schema header
+static s_serializer_error s_serialize_message(s_serialize_options opts,
+                                              const s_type_info* info,
+                                              const void* prev,
+                                              const void* data,
+                                              uint8_t* buffer,
+                                              size_t buffer_size,
+                                              size_t* bytes_written) {
+    uint32_t flags = s_serialize_flags(opts);
+    size_t header_size = opts.use_schema_header ? S_SCHEMA_HEADER_SIZE : 0;
+    size_t length = 0;
+
+    if (!info || !buffer || !bytes_written)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    if (buffer_size < header_size)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    s_serializer_error err =
+        prev ? s_tlv_encode_delta(info, prev, data, flags,
+                                  buffer + header_size,
+                                  buffer_size - header_size, &length)
+             : s_tlv_encode_ex(info, data, flags, buffer + header_size,
+                               buffer_size - header_size, &length);
+
+    if (err != SERIALIZER_OK)
+        return err;
+
+    if (header_size) {
+        if (length > UINT32_MAX)
+            return SERIALIZER_ERROR_INVALID_TYPE;
+
+        buffer[0] = TLV_SCHEMA_HEADER_MAGIC;
+        buffer[1] = TLV_SCHEMA_HEADER_VERSION;
+        s_write_u64_be(buffer + 2, s_type_info_hash(info));
+        buffer[10] = (uint8_t) (length >> 24);
+        buffer[11] = (uint8_t) (length >> 16);
+        buffer[12] = (uint8_t) (length >> 8);
+        buffer[13] = (uint8_t) length;
+    }
+
+    *bytes_written = header_size + length;
+
+    return SERIALIZER_OK;
+}
+
 s_serializer_error s_serialize(s_serialize_options opts,
                                const s_type_info* info, const void* data,
                                uint8_t* buffer, size_t buffer_size,
                                size_t* bytes_written) {
     // TODO: handle compression and encryption
-    return s_tlv_encode(info, data, buffer, buffer_size, bytes_written);
+    if (!opts.use_schema_header)
+        return s_tlv_encode_ex(info, data, s_serialize_flags(opts), buffer,
+                               buffer_size, bytes_written);
+
+    return s_serialize_message(opts, info, NULL, data, buffer, buffer_size,
+                               bytes_written);
+}
+
+s_serializer_error s_serialize_delta(s_serialize_options opts,
+                                     const s_type_info* info, const void* prev,
+                                     const void* cur, uint8_t* buffer,
+                                     size_t buffer_size,
+                                     size_t* bytes_written) {
+    if (!prev)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    return s_serialize_message(opts, info, prev, cur, buffer, buffer_size,
+                               bytes_written);
+}
+
+s_serializer_error s_serialize_record(s_serialize_options opts,
+                                      const s_type_info* info,
+                                      const void* data, uint8_t* buffer,
+                                      size_t buffer_size,
+                                      size_t* bytes_written) {
+    if (!buffer || buffer_size < 1)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    // message is written after 1-byte length prefix and moved if the prefix
+    // turns out longer
+    size_t length = 0;
+    s_serializer_error err =
+        s_serialize(opts, info, data, buffer + 1, buffer_size - 1, &length);
+
+    if (err != SERIALIZER_OK)
+        return err;
+
+    uint8_t prefix[16];
+    size_t prefix_size = s_tlv_varint_encode(length, prefix);
+
+    if (prefix_size + length > buffer_size)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    if (prefix_size > 1)
+        memmove(buffer + prefix_size, buffer + 1, length);
+
+    memcpy(buffer, prefix, prefix_size);
+
+    if (bytes_written)
+        *bytes_written = prefix_size + length;
+
+    return SERIALIZER_OK;
+}
+
+struct tlv_el_context {
+    int prev_level;
+    int prev_idx;
+    const s_type_info* field_type_info;
+    const s_field_info* field_info;
+    const s_type_info* parent_type_info;
+    const s_field_info* parent_info;
+    int parent_field_idx;
+};
+
+void s_deserialize_field_c_struct(
+    s_deserialize_context* ctx, int field_idx, const void* type_data,
+    const s_type_info* type_info, const s_field_info* parent_info,
+    const s_tlv_decoded_element_data* decoded_el_data);
+void s_deserialize_field_json_string(
+    s_deserialize_context* ctx, int field_idx, const s_type_info* type_info,
+    const s_field_info* parent_info,
+    const s_tlv_decoded_element_data* decoded_el_data);
+void s_deserialize_field(s_deserialize_context* ctx, int field_idx,
+                         const void* type_data, const s_type_info* type_info,
+                         const s_field_info* parent_info,
+                         const s_tlv_decoded_element_data* decoded_el_data);
+
+#define ENABLE_FOR_C_STRUCT(ctx, block)        \
+    if (ctx->opts.format == FORMAT_C_STRUCT) { \
+        block                                  \
+    }
+
+// decodes varint element value into fixed-width native representation of the
+// field, so that the rest of deserializer can treat it as a regular field
+static s_serializer_error
+s_normalize_varint_el(const s_field_info* field_info,
+                      s_tlv_decoded_element_data* el, uint8_t* scalar) {
+    uint64_t raw = 0;
+    bool is_signed = false;
+
+    switch (field_info->type) {
+    case FIELD_TYPE_INT8:
+    case FIELD_TYPE_INT16:
+    case FIELD_TYPE_INT32:
+    case FIELD_TYPE_INT64:
+        is_signed = true;
+        break;
+    case FIELD_TYPE_UINT8:
+    case FIELD_TYPE_UINT16:
+    case FIELD_TYPE_UINT32:
+    case FIELD_TYPE_UINT64:
+        break;
+    default:
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    // varint fills the element exactly
+    size_t varint_size = s_tlv_varint_decode(el->value, el->length, &raw);
+
+    if (!varint_size || varint_size != el->length)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    uint64_t value = is_signed ? (uint64_t) S_ZIGZAG_DECODE(raw) : raw;
+
+    // values that don't fit the field are refused, not wrapped
+    if (field_info->size < sizeof(uint64_t)) {
+        unsigned bits = (unsigned) field_info->size * 8;
+
+        if (is_signed ? (int64_t) value < -(INT64_C(1) << (bits - 1)) ||
+                            (int64_t) value >= (INT64_C(1) << (bits - 1))
+                      : value >> bits)
+            return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    switch (field_info->size) {
+    case 1: {
+        uint8_t v = (uint8_t) value;
+        memcpy(scalar, &v, sizeof(v));
+    } break;
+    case 2: {
+        uint16_t v = (uint16_t) value;
+        memcpy(scalar, &v, sizeof(v));
+    } break;
+    case 4: {
+        uint32_t v = (uint32_t) value;
+        memcpy(scalar, &v, sizeof(v));
+    } break;
+    case 8: {
+        memcpy(scalar, &value, sizeof(value));
+    } break;
+    default:
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    el->type = TLV_TAG_FIELD;
+    el->value = scalar;
+    el->length = (uint32_t) field_info->size;
+
+    return SERIALIZER_OK;
+}
+
+// value of omitted fields
+static const uint8_t k_zero_value[TLV_MAX_DEFAULT_BLOB_SIZE] = {0};
+
+static void s_deserialize_fill_defaults(s_deserialize_context* ctx, int first,
+                                        int last);
+
+static bool s_is_field_seen(const s_deserialize_frame* frame, int field_idx) {
+    return frame->seen_fields[field_idx / 64] & (1ull << (field_idx % 64));
+}
+
+static bool s_is_struct_array(const s_field_info* field_info) {
+    return field_info && field_info->type == FIELD_TYPE_ARRAY &&
+           field_info->struct_type_info;
+}
+
+// checks that element tag can hold value of the field
+static bool s_is_el_type_valid(const s_field_info* field_info, uint16_t type,
+                               bool is_delta) {
+    switch (field_info->type) {
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP:
+        return type == TLV_TAG_NESTED;
+    case FIELD_TYPE_ARRAY:
+        if (field_info->struct_type_info)
+            return type == TLV_TAG_NESTED_LIST ||
+                   (is_delta && type == TLV_TAG_NESTED_LIST_RANGE);
+
+        return type == TLV_TAG_LIST ||
+               (is_delta && type == TLV_TAG_LIST_RANGE);
+    default:
+        return type == TLV_TAG_FIELD;
+    }
+}
+
+static void s_deserialize_push_frame(s_deserialize_context* ctx,
+                                     const s_field_info* field_info,
+                                     uint8_t* data, uint32_t array_size) {
+    if (ctx->level + 1 >= MAX_NESTED_LEVELS) {
+        LOG_DEBUG("ERROR (decode cb): too many nested levels");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    if (field_info->struct_type_info &&
+        s_type_info_is_failed(field_info->struct_type_info)) {
+        LOG_DEBUG("ERROR (decode cb): no fields of %s",
+                  field_info->struct_type_info->type_name);
+        ctx->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+        return;
+    }
+
+    ctx->level++;
+    ctx->frames[ctx->level] = (s_deserialize_frame){
+        .type_info = field_info->struct_type_info,
+        .parent_info = field_info,
+        .data = data,
+        .array_data = data,
+        .array_size = array_size,
+        .first_decoded_el = ctx->n_decoded_els,
+    };
+    ctx->array_el_started = s_is_struct_array(field_info);
+}
+
+// finishes struct decoded at the top level: fills omitted fields and drops its
+// decoded elements
+static void s_deserialize_end_struct(s_deserialize_context* ctx) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+
+    // delta leaves fields it doesn't carry untouched
+    if (frame->has_field_ids && !ctx->is_delta)
+        s_deserialize_fill_defaults(ctx, 0,
+                                    (int) frame->type_info->field_count);
+
+    ctx->n_decoded_els = frame->first_decoded_el;
+}
+
+static void s_deserialize_pop_frame(s_deserialize_context* ctx) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+
+    s_deserialize_end_struct(ctx);
+
+    if (ctx->opts.format == FORMAT_C_STRUCT && ctx->err == SERIALIZER_OK &&
+        frame->parent_info && frame->parent_info->type == FIELD_TYPE_MAP)
+        ctx->err = s_map_finish(frame->parent_info, (s_map*) frame->data,
+                                ctx->opts.allocator, ctx->opts.user_data);
+
+    ctx->level--;
+    ctx->array_el_started = false;
+}
+
+// moves top level of struct array to the next struct, returns false if top
+// level is not an array or array is over
+static bool s_deserialize_next_array_el(s_deserialize_context* ctx) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+
+    if (!s_is_struct_array(frame->parent_info) ||
+        frame->array_el_idx + 1 >= frame->array_size)
+        return false;
+
+    s_deserialize_end_struct(ctx);
+
+    frame->array_el_idx++;
+    frame->field_idx = 0;
+    frame->has_field_ids = false;
+    memset(frame->seen_fields, 0, sizeof(frame->seen_fields));
+    ENABLE_FOR_C_STRUCT(ctx, {
+        frame->data = frame->array_data +
+                      frame->type_info->type_size * frame->array_el_idx;
+    })
+    ctx->array_el_started = true;
+
+    return true;
+}
+
+// start element of struct of struct array, the first struct is open already
+static void s_deserialize_start_array_el(s_deserialize_context* ctx) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+
+    if (!s_is_struct_array(frame->parent_info)) {
+        LOG_DEBUG("ERROR (decode cb): array element start outside of array");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    if (!frame->has_el_starts) {
+        frame->has_el_starts = true;
+        return;
+    }
+
+    if (!s_deserialize_next_array_el(ctx)) {
+        LOG_DEBUG("ERROR (decode cb): more array elements than array size");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+    }
+}
+
+static bool s_deserialize_array_size(s_deserialize_context* ctx,
+                                     const s_field_info* field_info,
+                                     uint32_t* array_size) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+    size_t size_field_offset = field_info->array_field_info.size_field_offset;
+    const uint8_t* size_data = NULL;
+
+    // find array size in previously decoded element
+    for (int i = ctx->n_decoded_els - 1; i >= frame->first_decoded_el; i--) {
+        if (frame->type_info->fields[ctx->decoded_els[i].field_idx].offset ==
+            size_field_offset) {
+            size_data = ctx->decoded_els[i].el.value;
+            break;
+        }
+    }
+
+    if (!size_data) {
+        LOG_DEBUG("ERROR (decode cb): no size field data found in array field");
+        return false;
+    }
+
+    switch (field_info->array_field_info.size_field_size) {
+    case 1: {
+        *array_size = (uint32_t) *(uint8_t*) size_data;
+    } break;
+    case 2: {
+        uint16_t size;
+        memcpy(&size, size_data, sizeof(size));
+        *array_size = (uint32_t) size;
+    } break;
+    case 4:
+    case 8: {
+        memcpy(array_size, size_data, sizeof(*array_size));
+    } break;
+    default: {
+        LOG_DEBUG("ERROR (decode cb): invalid size field size");
+    }
+        return false;
+    }
+
+    return true;
+}
+
+// marks union members selected by the tag at tag_offset in data, false if the
+// field at tag_offset isn't a tag
+static bool s_union_members_present(const s_type_info* type_info,
+                                    const uint8_t* data, size_t tag_offset,
+                                    uint64_t* present) {
+    bool is_tag = false;
+
+    for (size_t i = 0; i < type_info->field_count; i++) {
+        const s_field_info* field = &type_info->fields[i];
+
+        if (!(field->opts & S_FIELD_OPT_OPTIONAL) ||
+            field->optional_field_info.tag_offset != tag_offset)
+            continue;
+
+        is_tag = true;
+
+        if (is_field_present(data, field))
+            present[i / 64] |= 1ull << (i % 64);
+    }
+
+    return is_tag;
+}
+
+// bytes of struct taken by the field itself
+static size_t s_field_storage_size(const s_field_info* field) {
+    if (field->type == FIELD_TYPE_ARRAY)
+        return (field->opts & S_FIELD_OPT_ARRAY_DYNAMIC)
+                   ? sizeof(void*)
+                   : field->size * field->array_field_info.capacity;
+
+    return field->size;
+}
+
+// delta changed union tag: the old member's allocations are released and the
+// new member starts zeroed, its storage still holds bytes of the old one which
+// must not be taken for pointers
+static void s_deserialize_switch_union(s_deserialize_context* ctx,
+                                       const s_type_info* type_info,
+                                       uint8_t* data, size_t tag_offset,
+                                       const uint64_t* was_present) {
+    for (size_t i = 0; i < type_info->field_count; i++) {
+        const s_field_info* field = &type_info->fields[i];
+
+        if (!(field->opts & S_FIELD_OPT_OPTIONAL) ||
+            field->optional_field_info.tag_offset != tag_offset)
+            continue;
+
+        bool was = was_present[i / 64] & (1ull << (i % 64));
+
+        if (was && !is_field_present(data, field))
+            s_release_field(field, data, ctx->opts.allocator,
+                            ctx->opts.user_data);
+    }
+
+    for (size_t i = 0; i < type_info->field_count; i++) {
+        const s_field_info* field = &type_info->fields[i];
+
+        if (!(field->opts & S_FIELD_OPT_OPTIONAL) ||
+            field->optional_field_info.tag_offset != tag_offset)
+            continue;
+
+        bool was = was_present[i / 64] & (1ull << (i % 64));
+
+        if (!was && is_field_present(data, field))
+            memset(data + field->offset, 0, s_field_storage_size(field));
+    }
+}
+
+// reports element as value of field_idx in the struct at the top level and
+// opens new level for structs and struct arrays
+static void
+s_deserialize_element(s_deserialize_context* ctx, int field_idx,
+                      const s_tlv_decoded_element_data* decoded_el_data) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+    const s_type_info* type_info = frame->type_info;
+    const s_field_info* field_info = &type_info->fields[field_idx];
+
+    if (ctx->n_decoded_els >= MAX_TLV_ELEMS) {
+        LOG_DEBUG("ERROR (decode cb): too many decoded elements");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    // store decoded data for later use
+    int decoded_idx = ctx->n_decoded_els++;
+    s_tlv_decoded_element_data* el = &ctx->decoded_els[decoded_idx].el;
+
+    *el = *decoded_el_data;
+    el->idx = frame->el_idx++;
+    ctx->decoded_els[decoded_idx].type_info = type_info;
+    ctx->decoded_els[decoded_idx].field_idx = field_idx;
+
+    if (el->type == TLV_TAG_VARINT) {
+        s_serializer_error err = s_normalize_varint_el(
+            field_info, el, ctx->decoded_els[decoded_idx].scalar);
+
+        if (err != SERIALIZER_OK) {
+            LOG_DEBUG("ERROR (decode cb): invalid varint");
+            ctx->err = err;
+            return;
+        }
+    }
+
+    if (!s_is_el_type_valid(field_info, el->type, ctx->is_delta)) {
+        LOG_DEBUG("ERROR (decode cb): element type %d doesn't match field %s",
+                  el->type, field_info->name);
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    // packed bools come as bitmap of the first of them
+    int n_fields = 1;
+
+    if (field_info->opts & S_FIELD_OPT_BOOL_PACKED) {
+        n_fields = (int) field_info->packed_field_info.count;
+
+        if (field_info->packed_field_info.bit ||
+            el->length != S_BITS_SIZE(field_info->packed_field_info.count)) {
+            LOG_DEBUG("ERROR (decode cb): invalid bitmap of %s",
+                      field_info->name);
+            ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+            return;
+        }
+    }
+
+    // quantized floats have their own size, arrays of them come whole
+    if (field_info->opts & S_FIELD_OPTS_QUANTIZED) {
+        size_t wire_size = s_quantized_size(field_info);
+        bool is_valid = field_info->type == FIELD_TYPE_ARRAY
+                            ? el->type == TLV_TAG_LIST &&
+                                  el->length % wire_size == 0
+                            : el->length == wire_size;
+
+        if (!is_valid) {
+            LOG_DEBUG("ERROR (decode cb): invalid quantized value of %s",
+                      field_info->name);
+            ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+            return;
+        }
+    }
+
+    LOG_DEBUG("%d MATCH %s::%s (PARENT %s)", ctx->tlv_el_idx,
+              type_info->type_name, field_info->name,
+              frame->parent_info ? frame->parent_info->name : "none");
+
+    // union members selected before the tag changes
+    uint64_t was_present[(S_MAX_FIELDS + 63) / 64] = {0};
+    bool is_tag = false;
+
+    ENABLE_FOR_C_STRUCT(ctx, {
+        if (ctx->is_delta)
+            is_tag = s_union_members_present(type_info, frame->data,
+                                             field_info->offset, was_present);
+    })
+
+    s_deserialize_field(ctx, field_idx, frame->data, type_info,
+                        frame->parent_info, el);
+
+    if (is_tag && ctx->err == SERIALIZER_OK)
+        s_deserialize_switch_union(ctx, type_info, frame->data,
+                                   field_info->offset, was_present);
+
+    ctx->array_el_started = false;
+    frame->field_idx = field_idx + n_fields;
+
+    for (int i = field_idx; i < field_idx + n_fields; i++)
+        frame->seen_fields[i / 64] |= 1ull << (i % 64);
+    ctx->tlv_el_idx++;
+    ctx->prev_level = el->level;
+
+    if (ctx->err != SERIALIZER_OK)
+        return;
+
+    if (field_info->type == FIELD_TYPE_STRUCT ||
+        field_info->type == FIELD_TYPE_MAP) {
+        uint8_t* data = NULL;
+
+        ENABLE_FOR_C_STRUCT(ctx, { data = frame->data + field_info->offset; })
+        s_deserialize_push_frame(ctx, field_info, data, 0);
+    } else if (s_is_struct_array(field_info)) {
+        uint32_t array_size = 0;
+        uint8_t* data = NULL;
+
+        // delta may skip unchanged size, it's already in the struct
+        if (ctx->is_delta ? s_tlv_array_size(field_info, frame->data,
+                                             &array_size) != SERIALIZER_OK
+                          : !s_deserialize_array_size(ctx, field_info,
+                                                      &array_size)) {
+            ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+            return;
+        }
+
+        ENABLE_FOR_C_STRUCT(ctx, {
+            data = frame->data + field_info->offset;
+
+            // special case for c structs -- allocate dynamic array here
+            if (field_info->opts & S_FIELD_OPT_ARRAY_DYNAMIC) {
+                void** array_data_ptr = (void**) data;
+                size_t array_data_size =
+                    array_size * field_info->struct_type_info->type_size;
+
+                // whole array is replaced by delta
+                if (ctx->is_delta && el->type == TLV_TAG_NESTED_LIST &&
+                    *array_data_ptr) {
+                    ctx->opts.allocator->deallocate(*array_data_ptr,
+                                                    ctx->opts.user_data);
+                    *array_data_ptr = NULL;
+                }
+
+                if (!array_size) {
+                    *array_data_ptr = NULL;
+                } else if (!*array_data_ptr) {
+                    *array_data_ptr = ctx->opts.allocator->allocate(
+                        array_data_size, ctx->opts.user_data);
+
+                    if (!*array_data_ptr) {
+                        LOG_DEBUG("ERROR (decode cb): failed to allocate "
+                                  "memory for dynamic array");
+                        ctx->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+                        return;
+                    }
+
+                    ctx->n_allocations++;
+                    memset(*array_data_ptr, 0, array_data_size);
+                }
+
+                data = *array_data_ptr;
+            }
+        })
+
+        s_deserialize_push_frame(ctx, field_info, data, array_size);
+
+        // range of array elements starts in the middle of array
+        if (el->type == TLV_TAG_NESTED_LIST_RANGE &&
+            ctx->err == SERIALIZER_OK) {
+            frame = &ctx->frames[ctx->level];
+            frame->array_el_idx = el->range_start;
+            ENABLE_FOR_C_STRUCT(ctx, {
+                frame->data = frame->array_data +
+                              frame->type_info->type_size * el->range_start;
+            })
+        }
+    }
 }
 
-struct tlv_el_context {
-    int prev_level;
-    int prev_idx;
-    const s_type_info* field_type_info;
-    const s_field_info* field_info;
-    const s_type_info* parent_type_info;
-    const s_field_info* parent_info;
-    int parent_field_idx;
-};
+// reports fields from first to last (exclusive) of the struct at the top
+// level that had no elements, in declaration order
+static void s_deserialize_fill_defaults(s_deserialize_context* ctx, int first,
+                                        int last) {
+    int level = ctx->level;
+    s_deserialize_frame* frame = &ctx->frames[level];
+
+    for (int field_idx = first; field_idx < last && ctx->err == SERIALIZER_OK;
+         field_idx++) {
+        const s_field_info* field_info = &frame->type_info->fields[field_idx];
+
+        if (s_is_field_seen(frame, field_idx) ||
+            !is_field_present_ctx(ctx, field_idx, frame->type_info))
+            continue;
+
+        s_tlv_decoded_element_data el = {
+            .level = level,
+            .type = TLV_TAG_FIELD,
+            .length = 0,
+            .value = k_zero_value,
+            .field_id = field_idx,
+        };
+
+        switch (field_info->type) {
+        case FIELD_TYPE_STRUCT:
+        case FIELD_TYPE_MAP: {
+            el.type = TLV_TAG_NESTED;
+        } break;
+        case FIELD_TYPE_ARRAY: {
+            el.type = field_info->struct_type_info ? TLV_TAG_NESTED_LIST
+                                                   : TLV_TAG_LIST;
+        } break;
+        case FIELD_TYPE_STRING: {
+            el.length = (field_info->opts & S_FIELD_OPT_STRING_FIXED) ? 1 : 0;
+        } break;
+        case FIELD_TYPE_BOOL: {
+            el.length = (field_info->opts & S_FIELD_OPT_BOOL_PACKED)
+                            ? S_BITS_SIZE(field_info->packed_field_info.count)
+                            : (uint32_t) field_info->size;
+        } break;
+        default: {
+            if (field_info->size > sizeof(k_zero_value)) {
+                LOG_DEBUG("ERROR (decode cb): field %s can't be omitted",
+                          field_info->name);
+                ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+                return;
+            }
 
-void s_deserialize_field_c_struct(
-    s_deserialize_context* ctx, int field_idx, const void* type_data,
-    const s_type_info* type_info, const s_field_info* parent_info,
-    const s_tlv_decoded_element_data* decoded_el_data);
-void s_deserialize_field_json_string(
-    s_deserialize_context* ctx, int field_idx, const s_type_info* type_info,
-    const s_field_info* parent_info,
-    const s_tlv_decoded_element_data* decoded_el_data);
-void s_deserialize_field(s_deserialize_context* ctx, int field_idx,
-                         const void* type_data, const s_type_info* type_info,
-                         const s_field_info* parent_info,
-                         const s_tlv_decoded_element_data* decoded_el_data);
+            el.length = (uint32_t) s_quantized_size(field_info);
+        } break;
+        }
 
-#define ENABLE_FOR_C_STRUCT(ctx, block)        \
-    if (ctx->opts.format == FORMAT_C_STRUCT) { \
-        block                                  \
+        s_deserialize_element(ctx, field_idx, &el);
+
+        // omitted struct has no elements of its own, all its fields are
+        // defaults too; omitted struct arrays are empty
+        if (ctx->level > level) {
+            ctx->frames[ctx->level].has_field_ids =
+                field_info->type == FIELD_TYPE_STRUCT ||
+                field_info->type == FIELD_TYPE_MAP;
+            s_deserialize_pop_frame(ctx);
+        }
+    }
+}
+
+// returns index of the field in the struct at the top level that decoded
+// element holds, -1 if element should be skipped or doesn't match any field
+// (ctx->err is set then)
+static int
+s_deserialize_match_field(s_deserialize_context* ctx,
+                          const s_tlv_decoded_element_data* decoded_el_data) {
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+    int field_id = decoded_el_data->field_id;
+
+    while (ctx->err == SERIALIZER_OK) {
+        const s_type_info* type_info = frame->type_info;
+
+        // field id indexes fields directly, fields of plain structs may come
+        // in any order
+        if (field_id != TLV_NO_FIELD_ID) {
+            // structs of struct arrays are told apart by their start elements
+            // only, never by ids
+            if (s_is_struct_array(frame->parent_info) &&
+                !frame->has_el_starts) {
+                LOG_DEBUG("ERROR (decode cb): no start of array element");
+                break;
+            }
+
+            frame->has_field_ids = true;
+
+            // field of newer schema version
+            if ((size_t) field_id >= type_info->field_count) {
+                LOG_DEBUG("skipping unknown field %d of %s", field_id,
+                          type_info->type_name);
+                return -1;
+            }
+
+            // omitted fields the id skips go first, so that output keeps
+            // declaration order
+            if (!ctx->is_delta && field_id > frame->field_idx)
+                s_deserialize_fill_defaults(ctx, frame->field_idx, field_id);
+
+            if (ctx->err != SERIALIZER_OK)
+                break;
+
+            return field_id;
+        }
+
+        // no id -- element holds next present field
+        if ((size_t) frame->field_idx >= type_info->field_count) {
+            if (!s_deserialize_next_array_el(ctx))
+                break;
+            continue;
+        }
+
+        // union is resolved once, absent alternatives are skipped together
+        const s_union_table* table =
+            type_info->fields[frame->field_idx].optional_field_info.table;
+
+        if (table) {
+            const uint8_t* tag = s_deserialize_find_tag(
+                ctx, type_info, table->fields->optional_field_info.tag_offset);
+            const s_field_info* active =
+                tag ? s_union_table_find(table, tag) : NULL;
+            int active_idx = active ? (int) (active - type_info->fields) : -1;
+
+            if (active_idx >= frame->field_idx) {
+                frame->field_idx = active_idx;
+                return active_idx;
+            }
+
+            frame->field_idx = (int) (table->first_field + table->field_count);
+            continue;
+        }
+
+        if (!is_field_present_ctx(ctx, frame->field_idx, type_info)) {
+            frame->field_idx++;
+            continue;
+        }
+
+        return frame->field_idx;
     }
 
+    LOG_DEBUG("ERROR (decode cb): no field for element at level %d",
+              decoded_el_data->level);
+
+    if (ctx->err == SERIALIZER_OK)
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+
+    return -1;
+}
+
 void tlv_decode_deserializer_cb(
     const s_tlv_decoded_element_data* decoded_el_data, void* user_data) {
     s_deserialize_context* ctx = (s_deserialize_context*) user_data;
 
+    if (ctx->err != SERIALIZER_OK)
+        return;
+
+    if (decoded_el_data && ctx->skip_level >= 0) {
+        if (decoded_el_data->level >= ctx->skip_level)
+            return;
+
+        ctx->skip_level = -1;
+    }
+
     // end of decoding call
     if (!decoded_el_data) {
+        // finish all open structs, including the root one
+        while (ctx->level > 0 && ctx->err == SERIALIZER_OK)
+            s_deserialize_pop_frame(ctx);
+
+        if (ctx->err == SERIALIZER_OK)
+            s_deserialize_end_struct(ctx);
+
+        if (ctx->err != SERIALIZER_OK)
+            return;
+
         switch (ctx->opts.format) {
         case FORMAT_JSON_STRING:
             s_deserialize_field_json_string(ctx, 0, ctx->info, NULL, NULL);
+            ctx->err = ctx->json_context.writer.err;
             break;
         case FORMAT_CUSTOM: {
             if (ctx->opts.custom_deserializer)
@@ -70,313 +1893,639 @@ void tlv_decode_deserializer_cb(
             break;
         }
 
-        return;
+        return;
+    }
+
+    if (decoded_el_data->level > ctx->level) {
+        LOG_DEBUG("ERROR (decode cb): invalid nested level");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    // nested structs are over
+    while (ctx->level > decoded_el_data->level && ctx->err == SERIALIZER_OK)
+        s_deserialize_pop_frame(ctx);
+
+    if (decoded_el_data->type == TLV_TAG_NESTED_LIST_EL) {
+        s_deserialize_start_array_el(ctx);
+        return;
+    }
+
+    int field_idx = s_deserialize_match_field(ctx, decoded_el_data);
+
+    if (field_idx < 0) {
+        // skip unknown field together with its nested elements
+        if (ctx->err == SERIALIZER_OK)
+            ctx->skip_level = decoded_el_data->level + 1;
+        return;
+    }
+
+    s_deserialize_frame* frame = &ctx->frames[ctx->level];
+
+    if (s_is_struct_array(frame->parent_info) &&
+        frame->array_el_idx >= frame->array_size) {
+        LOG_DEBUG("ERROR (decode cb): more array elements than array size");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    s_deserialize_element(ctx, field_idx, decoded_el_data);
+}
+
+// resets context for the next message; arrays that are filled up as decoding
+// goes are left as they are, as zeroing the whole context costs more than
+// decoding of small messages
+static void s_deserialize_ctx_init(s_deserialize_context* ctx,
+                                   s_deserialize_options opts,
+                                   const s_type_info* info, void* data,
+                                   bool is_delta) {
+    ctx->tlv_el_idx = 0;
+    ctx->prev_level = -1;
+    ctx->level = 0;
+    ctx->n_decoded_els = 0;
+    ctx->array_el_started = false;
+    ctx->skip_level = -1;
+    ctx->is_delta = is_delta;
+    ctx->frames[0] =
+        (s_deserialize_frame){.type_info = info, .data = (uint8_t*) data};
+    ctx->info = info;
+    ctx->opts = opts;
+    ctx->data = data;
+    ctx->n_allocations = 0;
+    ctx->err = SERIALIZER_OK;
+    ctx->json_context.count = 0;
+    ctx->json_context.n_braces = 0;
+}
+
+// json output of FORMAT_JSON_STRING, chunk is used when streaming to sink
+static s_json_writer s_deserialize_json_writer(s_deserialize_options opts,
+                                               void* data, char* chunk) {
+    s_json_writer w = {
+        .data = opts.json_sink ? chunk : (char*) data,
+        .length = 0,
+        .capacity = opts.json_sink ? S_JSON_CHUNK_SIZE : opts.data_size,
+        .base64_blobs = opts.json_base64_blobs,
+        .sink = opts.json_sink,
+        .sink_data = opts.json_sink_data,
+        .err = SERIALIZER_OK,
+    };
+
+    if (w.data)
+        w.data[0] = '\0';
+
+    return w;
+}
+
+// json output goes to sink or to data of opts.data_size bytes, never unbounded
+static s_serializer_error s_json_output_check(s_deserialize_options opts,
+                                              const void* data) {
+    if (opts.json_sink)
+        return SERIALIZER_OK;
+    if (!data)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    if (!opts.data_size) {
+        LOG_DEBUG("ERROR (deserialize): no room for json output");
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    return SERIALIZER_OK;
+}
+
+static s_serializer_error s_deserialize_impl(s_deserialize_options opts,
+                                             const s_type_info* info,
+                                             void* data, const uint8_t* buffer,
+                                             size_t buffer_size,
+                                             bool is_delta) {
+    if (!info || !buffer || !opts.allocator ||
+        (opts.format == FORMAT_C_STRUCT && !data)) {
+        LOG_DEBUG("ERROR (deserialize): invalid arguments");
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    if (opts.format == FORMAT_JSON_STRING) {
+        s_serializer_error err = s_json_output_check(opts, data);
+
+        if (err != SERIALIZER_OK)
+            return err;
+    }
+
+    if (s_type_info_is_failed(info)) {
+        LOG_DEBUG("ERROR (deserialize): no fields of %s", info->type_name);
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+    }
+
+    // wrong schema is refused before any decoding
+    s_serializer_error err = s_skip_schema_header(info, &buffer, &buffer_size);
+
+    if (err != SERIALIZER_OK)
+        return err;
+
+    // per-type decoder takes plain v1 buffers, the rest goes generic way
+    if (opts.format == FORMAT_C_STRUCT && !is_delta && info->decode &&
+        info->decode(data, buffer, buffer_size, opts.allocator,
+                     opts.user_data) == SERIALIZER_OK)
+        return SERIALIZER_OK;
+
+    s_deserialize_context ctx;
+    char json_chunk[S_JSON_CHUNK_SIZE]; // json output streamed to sink
+
+    s_deserialize_ctx_init(&ctx, opts, info, data, is_delta);
+
+    if (opts.format == FORMAT_JSON_STRING)
+        ctx.json_context.writer =
+            s_deserialize_json_writer(opts, data, json_chunk);
+
+    err = s_tlv_decode(buffer, buffer_size, tlv_decode_deserializer_cb, &ctx);
+
+    if (err == SERIALIZER_OK && ctx.err == SERIALIZER_OK &&
+        opts.format == FORMAT_JSON_STRING) {
+        s_json_flush(&ctx.json_context.writer);
+        ctx.err = ctx.json_context.writer.err;
+    }
+
+    if (err != SERIALIZER_OK || ctx.err != SERIALIZER_OK) {
+        // TODO: this has to be replaced with allocations list for easier
+        // cleanup
+        if (ctx.n_allocations) {
+            // for (int i = 0; i < ctx.info->field_count; i++) {
+            //     const s_field_info* field = &info->fields[i];
+
+            //     if (field->type == FIELD_TYPE_STRING) {
+            //         char* str = *(char**) ((uint8_t*) ctx.data +
+            //         field->offset); if (str) {
+            //             opts.allocator->deallocate(str, opts.user_data);
+            //         }
+            //     }
+            // }
+        }
+
+        return err != SERIALIZER_OK ? err : ctx.err;
+    }
+
+    return SERIALIZER_OK;
+}
+
+s_serializer_error s_deserialize(s_deserialize_options opts,
+                                 const s_type_info* info, void* data,
+                                 const uint8_t* buffer, size_t buffer_size) {
+    return s_deserialize_impl(opts, info, data, buffer, buffer_size, false);
+}
+
+s_serializer_error s_apply_delta(s_deserialize_options opts,
+                                 const s_type_info* info, void* data,
+                                 const uint8_t* buffer, size_t buffer_size) {
+    // delta is only applied to c structs
+    opts.format = FORMAT_C_STRUCT;
+
+    return s_deserialize_impl(opts, info, data, buffer, buffer_size, true);
+}
+
+// type registry
+//
+// Open addressing with linear probing. Writers claim a slot by swapping its
+// hash from zero and then publish info; readers see either no info yet or
+// the complete entry. Slots are never freed, so the probe sequence of a hash
+// always ends at its entry or at the first free slot.
+#if defined(__GNUC__)
+static inline uint64_t s_registry_load_hash(const uint64_t* hash) {
+    return __atomic_load_n(hash, __ATOMIC_ACQUIRE);
+}
+
+static inline bool s_registry_claim(uint64_t* hash, uint64_t* expected,
+                                    uint64_t desired) {
+    return __atomic_compare_exchange_n(hash, expected, desired, false,
+                                       __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE);
+}
+
+static inline const s_type_info*
+s_registry_load_info(const s_type_info* const* info) {
+    return __atomic_load_n(info, __ATOMIC_ACQUIRE);
+}
+
+static inline void s_registry_store_info(const s_type_info** info,
+                                         const s_type_info* value) {
+    __atomic_store_n(info, value, __ATOMIC_RELEASE);
+}
+#else
+// no atomics: registry must not be written while in use
+static inline uint64_t s_registry_load_hash(const uint64_t* hash) {
+    return *hash;
+}
+
+static inline bool s_registry_claim(uint64_t* hash, uint64_t* expected,
+                                    uint64_t desired) {
+    if (*hash != *expected) {
+        *expected = *hash;
+        return false;
+    }
+
+    *hash = desired;
+
+    return true;
+}
+
+static inline const s_type_info*
+s_registry_load_info(const s_type_info* const* info) {
+    return *info;
+}
+
+static inline void s_registry_store_info(const s_type_info** info,
+                                         const s_type_info* value) {
+    *info = value;
+}
+#endif
+
+static inline size_t s_registry_slot(uint64_t schema_hash) {
+    return (size_t) (schema_hash ^ (schema_hash >> 32)) &
+           (S_TYPE_REGISTRY_CAPACITY - 1);
+}
+
+s_serializer_error s_type_registry_add(s_type_registry* registry,
+                                       const s_type_info* info) {
+    if (!registry || !info)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    uint64_t schema_hash = s_type_info_hash(info);
+    size_t slot = s_registry_slot(schema_hash);
+
+    for (size_t i = 0; i < S_TYPE_REGISTRY_CAPACITY; i++) {
+        s_type_registry_entry* entry = &registry->entries[slot];
+        uint64_t expected = 0;
+
+        if (s_registry_claim(&entry->schema_hash, &expected, schema_hash)) {
+            s_registry_store_info(&entry->info, info);
+            return SERIALIZER_OK;
+        }
+
+        if (expected == schema_hash) {
+            // slot owner may still be publishing, info is written once
+            const s_type_info* existing;
+
+            while (!(existing = s_registry_load_info(&entry->info)))
+                ;
+
+            return existing == info ? SERIALIZER_OK
+                                    : SERIALIZER_ERROR_SCHEMA_MISMATCH;
+        }
+
+        slot = (slot + 1) & (S_TYPE_REGISTRY_CAPACITY - 1);
+    }
+
+    LOG_DEBUG("ERROR (registry): no room for %s", info->type_name);
+
+    return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+}
+
+const s_type_info* s_type_registry_find(const s_type_registry* registry,
+                                        uint64_t schema_hash) {
+    if (!registry || !schema_hash)
+        return NULL;
+
+    size_t slot = s_registry_slot(schema_hash);
+
+    for (size_t i = 0; i < S_TYPE_REGISTRY_CAPACITY; i++) {
+        const s_type_registry_entry* entry = &registry->entries[slot];
+        uint64_t entry_hash = s_registry_load_hash(&entry->schema_hash);
+
+        if (entry_hash == schema_hash)
+            return s_registry_load_info(&entry->info);
+
+        if (!entry_hash)
+            return NULL;
+
+        slot = (slot + 1) & (S_TYPE_REGISTRY_CAPACITY - 1);
+    }
+
+    return NULL;
+}
+
+s_serializer_error s_deserialize_any(s_deserialize_options opts,
+                                     const s_type_registry* registry,
+                                     const s_type_info** info, void* data,
+                                     size_t data_size, const uint8_t* buffer,
+                                     size_t buffer_size) {
+    s_schema_header header;
+
+    if (!info)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    *info = NULL;
+
+    if (s_read_schema_header(buffer, buffer_size, &header) != SERIALIZER_OK)
+        return SERIALIZER_ERROR_INVALID_TYPE;
+
+    const s_type_info* type = s_type_registry_find(registry, header.schema_hash);
+
+    if (!type) {
+        LOG_DEBUG("ERROR (deserialize): unknown schema hash %016llx",
+                  (unsigned long long) header.schema_hash);
+        return SERIALIZER_ERROR_SCHEMA_MISMATCH;
+    }
+
+    if (opts.format == FORMAT_C_STRUCT && type->type_size > data_size)
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+
+    *info = type;
+
+    return s_deserialize_impl(opts, type, data, buffer, buffer_size, false);
+}
+
+// record streams
+static const uint8_t* s_next_record(const uint8_t** buffer, size_t* buffer_size,
+                                    size_t* length) {
+    uint64_t record_length = 0;
+    size_t prefix_size =
+        s_tlv_varint_decode(*buffer, *buffer_size, &record_length);
+
+    if (!prefix_size || record_length > *buffer_size - prefix_size) {
+        LOG_DEBUG("ERROR (ndjson): invalid record length");
+        return NULL;
+    }
+
+    const uint8_t* record = *buffer + prefix_size;
+
+    *length = (size_t) record_length;
+    *buffer = record + record_length;
+    *buffer_size -= prefix_size + record_length;
+
+    return record;
+}
+
+// converts records into w, one line each; ctx is reused between records
+static s_serializer_error
+s_ndjson_convert(s_deserialize_context* ctx, s_deserialize_options opts,
+                 const s_type_info* info, s_json_writer* w,
+                 const uint8_t* buffer, size_t buffer_size, size_t max_records,
+                 size_t* n_records) {
+    *n_records = 0;
+
+    while (buffer_size && *n_records < max_records) {
+        size_t length = 0;
+        const uint8_t* record = s_next_record(&buffer, &buffer_size, &length);
+
+        if (!record)
+            return SERIALIZER_ERROR_INVALID_TYPE;
+
+        s_serializer_error err = s_skip_schema_header(info, &record, &length);
+
+        if (err != SERIALIZER_OK)
+            return err;
+
+        s_deserialize_ctx_init(ctx, opts, info, w->data, false);
+        ctx->json_context.writer = *w;
+
+        err = s_tlv_decode(record, length, tlv_decode_deserializer_cb, ctx);
+
+        *w = ctx->json_context.writer;
+
+        if (err == SERIALIZER_OK)
+            err = ctx->err;
+        if (err != SERIALIZER_OK)
+            return err;
+
+        s_json_append_char(w, '\n');
+
+        if (w->err != SERIALIZER_OK)
+            return w->err;
+
+        (*n_records)++;
+    }
+
+    return SERIALIZER_OK;
+}
+
+#if defined(SSS_HAVE_THREADS)
+#include <pthread.h>
+
+// converts a group of records into its own buffer, which is appended to
+// output once all groups are done
+typedef struct {
+    s_deserialize_options opts;
+    const s_type_info* info;
+    const uint8_t* buffer;
+    size_t buffer_size;
+    size_t max_records;
+
+    char* out;
+    size_t out_length;
+    size_t out_capacity;
+
+    size_t n_records;
+    s_serializer_error err;
+} s_ndjson_worker;
+
+static bool s_ndjson_worker_sink(const char* chunk, size_t length,
+                                 void* user_data) {
+    s_ndjson_worker* worker = (s_ndjson_worker*) user_data;
+    s_allocator* allocator = worker->opts.allocator;
+
+    if (worker->out_length + length > worker->out_capacity) {
+        size_t capacity = worker->out_capacity ? worker->out_capacity * 2
+                                               : S_JSON_CHUNK_SIZE * 4;
+
+        while (capacity < worker->out_length + length)
+            capacity *= 2;
+
+        char* out = (char*) allocator->allocate(capacity,
+                                                worker->opts.user_data);
+
+        if (!out)
+            return false;
+
+        if (worker->out) {
+            memcpy(out, worker->out, worker->out_length);
+            allocator->deallocate(worker->out, worker->opts.user_data);
+        }
+
+        worker->out = out;
+        worker->out_capacity = capacity;
     }
 
-    int lvl = 0;
-    struct type_info_stack_el {
-        const s_field_info* parent_info;
-        const s_type_info* type_info;
-        int last_field_idx;
-        const void* data;
-        void* array_data;
-        uint32_t array_size;
-        uint32_t pending_array_el_count;
-    } type_info_stack[MAX_NESTED_LEVELS] = {{NULL, ctx->info, 0, ctx->data}};
-
-    // find field_info for current element
-    const s_type_info* type_info = type_info_stack[0].type_info;
-    const void* data = type_info_stack[0].data;
-    const s_type_info* parent_type_info = NULL;
-    const s_field_info* parent_info = NULL;
-    const s_field_info* field_info = NULL;
-    int field_idx = 0;
-    int tlv_idx = 0;
-
-    while (!field_info) {
-        if (field_idx < type_info->field_count) {
-            // skip optional, non-present fields
-            bool decoded_el_is_optional =
-                type_info->fields[field_idx].opts & S_FIELD_OPT_OPTIONAL;
-
-            if (!is_field_present_ctx(ctx, field_idx, type_info)) {
-                field_idx++;
-                continue;
-            }
+    memcpy(worker->out + worker->out_length, chunk, length);
+    worker->out_length += length;
 
-            switch (type_info->fields[field_idx].type) {
-            case FIELD_TYPE_STRUCT: {
-                ENABLE_FOR_C_STRUCT(ctx, {
-                    data =
-                        (uint8_t*) data + type_info->fields[field_idx].offset;
-                })
-
-                type_info_stack[lvl].last_field_idx = field_idx;
-                lvl += 1;
-
-                type_info_stack[lvl].parent_info =
-                    &type_info->fields[field_idx];
-                type_info_stack[lvl].type_info =
-                    type_info->fields[field_idx].struct_type_info;
-                type_info_stack[lvl].last_field_idx = 0;
-                type_info_stack[lvl].data = data;
-                type_info_stack[lvl].array_data = NULL;
-                type_info_stack[lvl].array_size = 0;
-                type_info_stack[lvl].pending_array_el_count = 0;
-
-                // if we got nested element callback -- quit here
-                bool decoded_el_parent_is_array =
-                    type_info_stack[decoded_el_data->level].parent_info
-                        ? type_info_stack[decoded_el_data->level]
-                                  .parent_info->type == FIELD_TYPE_ARRAY
-                        : false;
-
-                if (decoded_el_data->type == TLV_TAG_NESTED &&
-                    lvl == decoded_el_data->level + 1 &&
-                    (field_idx == decoded_el_data->idx ||
-                     decoded_el_parent_is_array || decoded_el_is_optional)) {
-                    // type_info = parent_type_info;
-                    field_info =
-                        type_info_stack[lvl].parent_info; // parent_info;
-                    lvl -= 1;
-                } else {
-                    parent_type_info = type_info;
-                    parent_info = type_info_stack[lvl].parent_info;
-                    type_info = type_info_stack[lvl].type_info;
-
-                    field_idx = 0;
-                }
+    return true;
+}
 
-                tlv_idx++;
-                continue;
-            } break;
-            case FIELD_TYPE_ARRAY: { // only handle struct arrays, otherwise --
-                                     // fall through
-                bool is_struct_array =
-                    type_info->fields[field_idx].struct_type_info;
-                bool is_dynamic = type_info->fields[field_idx].opts &
-                                  S_FIELD_OPT_ARRAY_DYNAMIC;
-
-                if (is_struct_array) {
-                    uint32_t array_size = 0;
-                    size_t array_size_field_offset =
-                        type_info->fields[field_idx]
-                            .array_field_info.size_field_offset;
-                    const uint8_t* size_type_data = NULL;
-                    // find array size in previously decoded element
-                    for (int i = ctx->tlv_el_idx; i >= 0, !size_type_data;
-                         i--) {
-                        if (ctx->decoded_els[i].type_info == type_info &&
-                            type_info->fields[ctx->decoded_els[i].field_idx]
-                                    .offset == array_size_field_offset) {
-                            size_type_data = ctx->decoded_els[i].el.value;
-                        }
-                    }
+static void* s_ndjson_worker_run(void* arg) {
+    s_ndjson_worker* worker = (s_ndjson_worker*) arg;
+    s_allocator* allocator = worker->opts.allocator;
+    s_deserialize_context* ctx = (s_deserialize_context*) allocator->allocate(
+        sizeof(s_deserialize_context), worker->opts.user_data);
 
-                    if (!size_type_data) {
-                        LOG_DEBUG("ERROR (decode cb): no size field data found "
-                                  "in array field");
-                        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
-                        return;
-                    }
+    if (!ctx) {
+        worker->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+        return NULL;
+    }
 
-                    switch (type_info->fields[field_idx]
-                                .array_field_info.size_field_size) {
-                    case 1: {
-                        array_size = (uint32_t) *(uint8_t*) size_type_data;
-                    } break;
-                    case 2: {
-                        array_size = (uint32_t) *(uint16_t*) size_type_data;
-                    } break;
-                    case 4:
-                    case 8: {
-                        array_size = *(uint32_t*) size_type_data;
-                    } break;
-                    default: {
-                        LOG_DEBUG("ERROR (decode cb): invalid size field size");
-                        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
-                    }
-                        return;
-                    }
+    char chunk[S_JSON_CHUNK_SIZE];
+    s_deserialize_options opts = worker->opts;
 
-                    if (is_dynamic) {
-                        // special case for c structs -- allocate dynamic array
-                        // here
-                        ENABLE_FOR_C_STRUCT(ctx, {
-                            void** array_data_ptr =
-                                (void**) ((uint8_t*) data +
-                                          type_info->fields[field_idx].offset);
-
-                            if (!*array_data_ptr && array_size) {
-                                *array_data_ptr = ctx->opts.allocator->allocate(
-                                    array_size *
-                                        type_info->fields[field_idx]
-                                            .struct_type_info->type_size,
-                                    ctx->opts.user_data);
-                            }
-
-                            if (!*array_data_ptr) {
-                                LOG_DEBUG(
-                                    "ERROR (decode cb): failed to allocate "
-                                    "memory for dynamic array");
-                                ctx->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
-                                return;
-                            }
-
-                            data = *array_data_ptr;
-                        })
-                    } else {
-                        ENABLE_FOR_C_STRUCT(ctx, {
-                            data = (uint8_t*) data +
-                                   type_info->fields[field_idx].offset;
-                        })
-                    }
+    opts.json_sink = s_ndjson_worker_sink;
+    opts.json_sink_data = worker;
 
-                    type_info_stack[lvl].last_field_idx = field_idx;
-                    lvl += 1;
-
-                    // push array field info
-                    type_info_stack[lvl].parent_info =
-                        &type_info->fields[field_idx];
-                    type_info_stack[lvl].type_info =
-                        type_info->fields[field_idx].struct_type_info;
-                    type_info_stack[lvl].last_field_idx = 0;
-                    type_info_stack[lvl].data = data;
-                    type_info_stack[lvl].array_data = data;
-                    type_info_stack[lvl].array_size = array_size;
-                    type_info_stack[lvl].pending_array_el_count = array_size;
-
-                    if (decoded_el_data->type == TLV_TAG_NESTED_LIST &&
-                        lvl == decoded_el_data->level + 1 &&
-                        field_idx == decoded_el_data->idx) {
-                        // if that's the field of array itself -- dont go level
-                        // up
-                        field_info = &type_info->fields[field_idx];
-                        lvl -= 1;
-                    } else {
-                        field_idx = 0;
-                        parent_type_info = type_info;
-                        parent_info = type_info_stack[lvl].parent_info;
-                        type_info = type_info_stack[lvl].type_info;
-                    }
+    s_json_writer w = s_deserialize_json_writer(opts, NULL, chunk);
 
-                    tlv_idx++;
-                    continue;
-                    // break;
-                }
-            } // fallthrough for non-struct arrays
-            default: {
-                if (tlv_idx == ctx->tlv_el_idx) {
-                    field_info = &type_info->fields[field_idx];
-
-                    // store decoded data for later use
-                    if (ctx->tlv_el_idx < MAX_TLV_ELEMS) {
-                        ctx->decoded_els[ctx->tlv_el_idx].el = *decoded_el_data;
-                        ctx->decoded_els[ctx->tlv_el_idx].type_info = type_info;
-                        ctx->decoded_els[ctx->tlv_el_idx].field_idx = field_idx;
-                    } else {
-                        LOG_DEBUG(
-                            "ERROR (decode cb): too many decoded elements");
-                        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
-                        return;
-                    }
-                } else {
-                    tlv_idx++;
-                    field_idx++;
-                }
-            } break;
-            }
-        } else {
-            // if we're iterating array, check if we're not done yet
-            if (type_info_stack[lvl].pending_array_el_count > 0) {
-                type_info_stack[lvl].pending_array_el_count -= 1;
-                int idx = type_info_stack[lvl].array_size -
-                          type_info_stack[lvl].pending_array_el_count;
-                ENABLE_FOR_C_STRUCT(ctx, {
-                    // shift data pointer to next element
-                    data = type_info_stack[lvl].array_data +
-                           type_info_stack[lvl].type_info->type_size * idx;
-                })
-                field_idx = 0;
-
-                if (type_info_stack[lvl].pending_array_el_count)
-                    continue;
-            }
+    worker->err = s_ndjson_convert(ctx, opts, worker->info, &w, worker->buffer,
+                                   worker->buffer_size, worker->max_records,
+                                   &worker->n_records);
+    // partial line of a failed record is kept, same as without workers
+    s_json_flush(&w);
 
-            lvl -= 1;
+    if (worker->err == SERIALIZER_OK)
+        worker->err = w.err;
 
-            if (lvl < 0) {
-                LOG_DEBUG("ERROR (decode cb): invalid nested level");
-                ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
-                return;
+    allocator->deallocate(ctx, worker->opts.user_data);
+
+    return NULL;
+}
+
+static s_serializer_error
+s_ndjson_convert_parallel(s_deserialize_options opts, const s_type_info* info,
+                          s_json_writer* w, const uint8_t* buffer,
+                          size_t buffer_size, int n_threads,
+                          size_t* n_records) {
+    // split records into contiguous groups, one per thread
+    size_t total = 0;
+    const uint8_t* it = buffer;
+    size_t it_size = buffer_size;
+
+    while (it_size) {
+        size_t length = 0;
+
+        // invalid record stops at the group it belongs to
+        if (!s_next_record(&it, &it_size, &length))
+            break;
+
+        total++;
+    }
+
+    if ((size_t) n_threads > total)
+        n_threads = total ? (int) total : 1;
+
+    s_ndjson_worker workers[S_NDJSON_MAX_THREADS];
+    pthread_t threads[S_NDJSON_MAX_THREADS];
+    bool started[S_NDJSON_MAX_THREADS];
+
+    it = buffer;
+    it_size = buffer_size;
+
+    for (int i = 0; i < n_threads; i++) {
+        size_t group_size =
+            total / n_threads + ((size_t) i < total % (size_t) n_threads);
+
+        workers[i] = (s_ndjson_worker){
+            .opts = opts,
+            .info = info,
+            .buffer = it,
+            .buffer_size = it_size,
+            .max_records = group_size,
+            .err = SERIALIZER_OK,
+        };
+
+        // last group takes the rest, including invalid tail if any
+        if (i == n_threads - 1) {
+            workers[i].max_records = SIZE_MAX;
+        } else {
+            for (size_t j = 0; j < group_size; j++) {
+                size_t length = 0;
+                s_next_record(&it, &it_size, &length);
             }
 
-            parent_type_info =
-                lvl > 0 ? type_info_stack[lvl - 1].type_info : NULL;
-            parent_info = type_info_stack[lvl].parent_info;
-            type_info = type_info_stack[lvl].type_info;
-            field_idx = type_info_stack[lvl].last_field_idx + 1;
-            data = type_info_stack[lvl].data;
+            workers[i].buffer_size = (size_t) (it - workers[i].buffer);
         }
+
+        started[i] = i > 0 && pthread_create(&threads[i], NULL,
+                                             s_ndjson_worker_run,
+                                             &workers[i]) == 0;
     }
 
-    assert(decoded_el_data->level == lvl);
-    LOG_DEBUG("%d MATCH %s::%s (PARENT %s::%s)", ctx->tlv_el_idx,
-              type_info->type_name, field_info->name,
-              parent_type_info ? parent_type_info->type_name : "none",
-              parent_info ? parent_info->name : "none");
+    // first group is converted on the calling thread, as are groups whose
+    // thread failed to start
+    for (int i = 0; i < n_threads; i++) {
+        if (started[i])
+            pthread_join(threads[i], NULL);
+        else
+            s_ndjson_worker_run(&workers[i]);
+    }
 
-    s_deserialize_field(ctx, field_idx, data, type_info, parent_info,
-                        decoded_el_data);
+    s_serializer_error err = SERIALIZER_OK;
 
-    ctx->tlv_el_idx++;
-    ctx->prev_level = decoded_el_data->level;
+    *n_records = 0;
+
+    for (int i = 0; i < n_threads; i++) {
+        if (err == SERIALIZER_OK) {
+            if (workers[i].out_length)
+                s_json_append(w, workers[i].out, workers[i].out_length);
+            *n_records += workers[i].n_records;
+            err = workers[i].err != SERIALIZER_OK ? workers[i].err : w->err;
+        }
+
+        if (workers[i].out)
+            opts.allocator->deallocate(workers[i].out, opts.user_data);
+    }
+
+    return err;
 }
+#endif
 
-s_serializer_error s_deserialize(s_deserialize_options opts,
-                                 const s_type_info* info, void* data,
-                                 const uint8_t* buffer, size_t buffer_size) {
-    if (!info || !buffer || !opts.allocator ||
-        (opts.format == FORMAT_C_STRUCT && !data)) {
-        LOG_DEBUG("ERROR (deserialize): invalid arguments");
+s_serializer_error s_deserialize_ndjson(s_deserialize_options opts,
+                                        const s_type_info* info, void* data,
+                                        const uint8_t* buffer,
+                                        size_t buffer_size, int n_threads,
+                                        size_t* n_records) {
+    size_t n_converted = 0;
+
+    if (n_records)
+        *n_records = 0;
+
+    if (!info || (!buffer && buffer_size) || !opts.allocator ||
+        opts.format != FORMAT_JSON_STRING) {
+        LOG_DEBUG("ERROR (ndjson): invalid arguments");
         return SERIALIZER_ERROR_INVALID_TYPE;
     }
 
-    s_deserialize_context ctx = {
-        .tlv_el_idx = 0,
-        .prev_level = -1,
-        .info = info,
-        .opts = opts,
-        .data = data,
-        .n_allocations = 0,
-        .err = SERIALIZER_OK,
-        .decoded_els = {},
-        .json_context = {},
-    };
+    s_serializer_error err = s_json_output_check(opts, data);
 
-    s_serializer_error err =
-        s_tlv_decode(buffer, buffer_size, tlv_decode_deserializer_cb, &ctx);
+    if (err != SERIALIZER_OK)
+        return err;
 
-    if (err != SERIALIZER_OK || ctx.err != SERIALIZER_OK) {
-        // TODO: this has to be replaced with allocations list for easier
-        // cleanup
-        if (ctx.n_allocations) {
-            // for (int i = 0; i < ctx.info->field_count; i++) {
-            //     const s_field_info* field = &info->fields[i];
+    char chunk[S_JSON_CHUNK_SIZE];
+    s_json_writer w = s_deserialize_json_writer(opts, data, chunk);
 
-            //     if (field->type == FIELD_TYPE_STRING) {
-            //         char* str = *(char**) ((uint8_t*) ctx.data +
-            //         field->offset); if (str) {
-            //             opts.allocator->deallocate(str, opts.user_data);
-            //         }
-            //     }
-            // }
-        }
+#if defined(SSS_HAVE_THREADS)
+    if (n_threads > S_NDJSON_MAX_THREADS)
+        n_threads = S_NDJSON_MAX_THREADS;
 
-        return err != SERIALIZER_OK ? err : ctx.err;
+    if (n_threads > 1) {
+        err = s_ndjson_convert_parallel(opts, info, &w, buffer, buffer_size,
+                                        n_threads, &n_converted);
+    } else
+#else
+    (void) n_threads;
+#endif
+    {
+        s_deserialize_context* ctx = (s_deserialize_context*)
+            opts.allocator->allocate(sizeof(s_deserialize_context),
+                                     opts.user_data);
+
+        if (!ctx)
+            return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+        err = s_ndjson_convert(ctx, opts, info, &w, buffer, buffer_size,
+                               SIZE_MAX, &n_converted);
+
+        opts.allocator->deallocate(ctx, opts.user_data);
     }
 
-    return SERIALIZER_OK;
+    s_json_flush(&w);
+
+    if (err == SERIALIZER_OK)
+        err = w.err;
+    if (n_records)
+        *n_records = n_converted;
+
+    return err;
 }
 
 // helpers
@@ -385,6 +2534,10 @@ int is_field_present(const void* struct_data, const s_field_info* field) {
         void* tag = (void*) ((uint8_t*) struct_data +
                              field->optional_field_info.tag_offset);
 
+        if (field->optional_field_info.table)
+            return s_union_table_find(field->optional_field_info.table, tag) ==
+                   field;
+
         if (field->optional_field_info.tag_type == FIELD_TYPE_INT32) {
             if (*(int32_t*) tag != field->optional_field_info.tag_value_int) {
                 return 0;
@@ -400,27 +2553,36 @@ int is_field_present(const void* struct_data, const s_field_info* field) {
     return 1;
 }
 
+const uint8_t* s_deserialize_find_tag(s_deserialize_context* ctx,
+                                      const s_type_info* type_info,
+                                      size_t tag_offset) {
+    // find tag in previously decoded elements of the struct
+    for (int i = ctx->n_decoded_els - 1;
+         i >= ctx->frames[ctx->level].first_decoded_el; i--) {
+        if (ctx->decoded_els[i].type_info == type_info &&
+            type_info->fields[ctx->decoded_els[i].field_idx].offset ==
+                tag_offset)
+            return ctx->decoded_els[i].el.value;
+    }
+
+    return NULL;
+}
+
 int is_field_present_ctx(s_deserialize_context* ctx, int field_idx,
                          const s_type_info* field_type_info) {
     const s_field_info* field = &field_type_info->fields[field_idx];
 
     if (field->opts & S_FIELD_OPT_OPTIONAL) {
-        // find tag in previously decoded elements
-        const uint8_t* tag_data = NULL;
-        size_t tag_field_offset = field->optional_field_info.tag_offset;
-
-        for (int i = ctx->tlv_el_idx; i >= 0; i--) {
-            if (ctx->decoded_els[i].type_info == field_type_info &&
-                field_type_info->fields[ctx->decoded_els[i].field_idx].offset ==
-                    tag_field_offset) {
-                tag_data = ctx->decoded_els[i].el.value;
-                break;
-            }
-        }
+        const uint8_t* tag_data = s_deserialize_find_tag(
+            ctx, field_type_info, field->optional_field_info.tag_offset);
 
         if (!tag_data)
             return 0;
 
+        if (field->optional_field_info.table)
+            return s_union_table_find(field->optional_field_info.table,
+                                      tag_data) == field;
+
         void* tag = (void*) tag_data;
 
         if (field->optional_field_info.tag_type == FIELD_TYPE_INT32) {
@@ -442,6 +2604,70 @@ int is_field_present_ctx(s_deserialize_context* ctx, int field_idx,
     return 1;
 }
 
+void s_release_field(const s_field_info* field, uint8_t* data,
+                     s_allocator* allocator, void* user_data) {
+    uint8_t* field_data = data + field->offset;
+
+    switch (field->type) {
+    case FIELD_TYPE_STRING: {
+        char* str;
+
+        if (field->opts & S_FIELD_OPT_STRING_FIXED)
+            break;
+
+        memcpy(&str, field_data, sizeof(str));
+
+        if (str)
+            allocator->deallocate(str, user_data);
+
+        memset(field_data, 0, sizeof(str));
+    } break;
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP: {
+        if (field->struct_type_info)
+            s_release_struct(field->struct_type_info, field_data, allocator,
+                             user_data);
+
+        if (field->type == FIELD_TYPE_MAP)
+            s_map_free((s_map*) field_data, allocator, user_data);
+    } break;
+    case FIELD_TYPE_ARRAY: {
+        bool is_dynamic = field->opts & S_FIELD_OPT_ARRAY_DYNAMIC;
+        uint8_t* array_data = field_data;
+        uint32_t array_size = 0;
+
+        if (is_dynamic)
+            memcpy(&array_data, field_data, sizeof(array_data));
+
+        if (!array_data ||
+            s_tlv_array_size(field, data, &array_size) != SERIALIZER_OK)
+            break;
+
+        for (uint32_t j = 0; field->struct_type_info && j < array_size; j++)
+            s_release_struct(field->struct_type_info,
+                             array_data + field->size * j, allocator,
+                             user_data);
+
+        if (is_dynamic) {
+            allocator->deallocate(array_data, user_data);
+            memset(field_data, 0, sizeof(void*));
+        }
+
+        s_tlv_set_array_size(field, data, 0);
+    } break;
+    default:
+        break;
+    }
+}
+
+void s_release_struct(const s_type_info* info, uint8_t* data,
+                      s_allocator* allocator, void* user_data) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        if (is_field_present(data, &info->fields[i]))
+            s_release_field(&info->fields[i], data, allocator, user_data);
+    }
+}
+
 // helpers
 void s_deserialize_field(s_deserialize_context* ctx, int field_idx,
                          const void* type_data, const s_type_info* type_info,
@@ -459,6 +2685,9 @@ void s_deserialize_field(s_deserialize_context* ctx, int field_idx,
     case FORMAT_JSON_STRING: {
         s_deserialize_field_json_string(ctx, field_idx, type_info, parent_info,
                                         decoded_el_data);
+
+        if (ctx->err == SERIALIZER_OK)
+            ctx->err = ctx->json_context.writer.err;
     } break;
 
     case FORMAT_CUSTOM: {
@@ -477,6 +2706,170 @@ void s_deserialize_field(s_deserialize_context* ctx, int field_idx,
     }
 }
 
+// writes range of builtin array elements received in delta
+static void s_deserialize_array_range_c_struct(
+    s_deserialize_context* ctx, const s_field_info* field_info,
+    const void* type_data, const s_tlv_decoded_element_data* decoded_el_data) {
+    bool is_string_array = field_info->array_field_info.builtin_type ==
+                           S_ARRAY_BUILTIN_TYPE_STRING;
+    uint8_t* dest_ptr = (uint8_t*) type_data + field_info->offset;
+    uint32_t array_size = 0;
+    size_t n_elements = 0;
+
+    if (is_string_array) {
+        // last string must be terminated too
+        for (size_t i = 0; i < decoded_el_data->length; i++)
+            n_elements += decoded_el_data->value[i] == '\0';
+
+        if (!decoded_el_data->length ||
+            decoded_el_data->value[decoded_el_data->length - 1] != '\0')
+            n_elements = 0;
+    } else if (decoded_el_data->length % field_info->size == 0) {
+        n_elements = decoded_el_data->length / field_info->size;
+    }
+
+    if (field_info->opts & S_FIELD_OPT_ARRAY_DYNAMIC)
+        dest_ptr = *(uint8_t**) dest_ptr;
+
+    if (!dest_ptr || !n_elements ||
+        s_tlv_array_size(field_info, type_data, &array_size) !=
+            SERIALIZER_OK ||
+        decoded_el_data->range_start + n_elements > array_size) {
+        LOG_DEBUG("ERROR (deserialize): invalid array range of %s",
+                  field_info->name);
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    dest_ptr += field_info->size * decoded_el_data->range_start;
+
+    if (!is_string_array) {
+        memcpy(dest_ptr, decoded_el_data->value, decoded_el_data->length);
+        return;
+    }
+
+    // unpack strings - separated by null terminators
+    size_t offset = 0;
+
+    while (offset < decoded_el_data->length) {
+        const char* str = (const char*) decoded_el_data->value + offset;
+        size_t str_len = strlen(str) + 1;
+
+        if (str_len > field_info->size) {
+            ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+            return;
+        }
+
+        memcpy(dest_ptr, str, str_len);
+        dest_ptr += field_info->size;
+        offset += str_len;
+    }
+}
+
+// unpacks bit string of bool array
+static void
+s_deserialize_bits_c_struct(s_deserialize_context* ctx,
+                            const s_field_info* field_info,
+                            const void* type_data,
+                            const s_tlv_decoded_element_data* decoded_el_data) {
+    uint8_t* field_data = (uint8_t*) type_data + field_info->offset;
+    bool is_dynamic_array = field_info->opts & S_FIELD_OPT_ARRAY_DYNAMIC;
+    size_t capacity = field_info->array_field_info.capacity;
+    bool* dest_ptr = (bool*) field_data;
+    uint32_t count = 0;
+
+    if (decoded_el_data->type != TLV_TAG_LIST ||
+        field_info->size != sizeof(bool) ||
+        !s_tlv_bit_string_count(decoded_el_data->value,
+                                decoded_el_data->length, &count) ||
+        (!is_dynamic_array && capacity && count > capacity)) {
+        LOG_DEBUG("ERROR (deserialize): invalid bit string of %s",
+                  field_info->name);
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    if (is_dynamic_array) {
+        bool** array_data_ptr = (bool**) field_data;
+
+        // array replaced by delta
+        if (ctx->is_delta && *array_data_ptr) {
+            ctx->opts.allocator->deallocate(*array_data_ptr,
+                                            ctx->opts.user_data);
+            *array_data_ptr = NULL;
+        }
+
+        if (!count)
+            return;
+
+        dest_ptr = ctx->opts.allocator->allocate(count, ctx->opts.user_data);
+
+        if (!dest_ptr) {
+            if (ctx->err == SERIALIZER_OK)
+                ctx->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+            LOG_DEBUG("ERROR (deserialize): failed to allocate memory for "
+                      "bool array field");
+            return;
+        }
+
+        ctx->n_allocations++;
+        *array_data_ptr = dest_ptr;
+    }
+
+    if (count)
+        s_bits_unpack(decoded_el_data->value + 1, count, dest_ptr);
+}
+
+// converts quantized float array back to floats or doubles
+static void s_deserialize_quantized_c_struct(
+    s_deserialize_context* ctx, const s_field_info* field_info,
+    const void* type_data, const s_tlv_decoded_element_data* decoded_el_data) {
+    uint8_t* field_data = (uint8_t*) type_data + field_info->offset;
+    bool is_dynamic_array = field_info->opts & S_FIELD_OPT_ARRAY_DYNAMIC;
+    size_t capacity = field_info->array_field_info.capacity;
+    size_t count = decoded_el_data->length / s_quantized_size(field_info);
+    void* dest_ptr = field_data;
+
+    if (!is_dynamic_array && capacity && count > capacity) {
+        LOG_DEBUG("ERROR (deserialize): too many values of %s",
+                  field_info->name);
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    if (is_dynamic_array) {
+        void** array_data_ptr = (void**) field_data;
+
+        // array replaced by delta
+        if (ctx->is_delta && *array_data_ptr) {
+            ctx->opts.allocator->deallocate(*array_data_ptr,
+                                            ctx->opts.user_data);
+            *array_data_ptr = NULL;
+        }
+
+        if (!count)
+            return;
+
+        dest_ptr = ctx->opts.allocator->allocate(count * field_info->size,
+                                                 ctx->opts.user_data);
+
+        if (!dest_ptr) {
+            if (ctx->err == SERIALIZER_OK)
+                ctx->err = SERIALIZER_ERROR_ALLOCATOR_FAILED;
+
+            LOG_DEBUG("ERROR (deserialize): failed to allocate memory for "
+                      "quantized array field");
+            return;
+        }
+
+        ctx->n_allocations++;
+        *array_data_ptr = dest_ptr;
+    }
+
+    s_dequantize(field_info, decoded_el_data->value, count, dest_ptr);
+}
+
 void s_deserialize_field_c_struct(
     s_deserialize_context* ctx, int field_idx, const void* type_data,
     const s_type_info* type_info, const s_field_info* parent_info,
@@ -498,13 +2891,30 @@ void s_deserialize_field_c_struct(
     case FIELD_TYPE_BOOL:
     case FIELD_TYPE_BLOB: {
         dest_ptr = (uint8_t*) type_data + field_info->offset;
-        memcpy(dest_ptr, decoded_el_data->value, decoded_el_data->length);
+
+        if (field_info->opts & S_FIELD_OPT_BOOL_PACKED)
+            s_bits_unpack(decoded_el_data->value,
+                          field_info->packed_field_info.count,
+                          (bool*) dest_ptr);
+        else if (field_info->opts & S_FIELD_OPTS_QUANTIZED)
+            s_dequantize(field_info, decoded_el_data->value, 1, dest_ptr);
+        else
+            memcpy(dest_ptr, decoded_el_data->value, decoded_el_data->length);
     } break;
     case FIELD_TYPE_STRING: {
         if (field_info->opts & S_FIELD_OPT_STRING_FIXED) {
             dest_ptr = (uint8_t*) type_data + field_info->offset;
             memcpy(dest_ptr, decoded_el_data->value, decoded_el_data->length);
         } else {
+            char** str_ptr =
+                (char**) ((uint8_t*) type_data + field_info->offset);
+
+            // string replaced by delta
+            if (ctx->is_delta && *str_ptr) {
+                ctx->opts.allocator->deallocate(*str_ptr, ctx->opts.user_data);
+                *str_ptr = NULL;
+            }
+
             // need allocation
             if (decoded_el_data->length) {
                 dest_ptr = ctx->opts.allocator->allocate(
@@ -525,7 +2935,7 @@ void s_deserialize_field_c_struct(
                        decoded_el_data->length);
             }
 
-            *(char**) ((uint8_t*) type_data + field_info->offset) = dest_ptr;
+            *str_ptr = dest_ptr;
         }
     } break;
     case FIELD_TYPE_ARRAY: {
@@ -537,7 +2947,41 @@ void s_deserialize_field_c_struct(
             break;
         }
 
+        if (field_info->array_field_info.builtin_type ==
+            S_ARRAY_BUILTIN_TYPE_BITS) {
+            s_deserialize_bits_c_struct(ctx, field_info, type_data,
+                                        decoded_el_data);
+            break;
+        }
+
+        if (field_info->opts & S_FIELD_OPTS_QUANTIZED) {
+            s_deserialize_quantized_c_struct(ctx, field_info, type_data,
+                                             decoded_el_data);
+            break;
+        }
+
+        if (decoded_el_data->type == TLV_TAG_LIST_RANGE) {
+            s_deserialize_array_range_c_struct(ctx, field_info, type_data,
+                                               decoded_el_data);
+            break;
+        }
+
         if (is_dynamic_array) {
+            void** array_data_ptr =
+                (void**) ((uint8_t*) type_data + field_info->offset);
+
+            // array replaced by delta
+            if (ctx->is_delta && *array_data_ptr) {
+                ctx->opts.allocator->deallocate(*array_data_ptr,
+                                                ctx->opts.user_data);
+                *array_data_ptr = NULL;
+            }
+
+            if (!decoded_el_data->length) {
+                *(void**) ((uint8_t*) type_data + field_info->offset) = NULL;
+                break;
+            }
+
             dest_ptr = ctx->opts.allocator->allocate(decoded_el_data->length,
                                                      ctx->opts.user_data);
 
@@ -555,7 +2999,7 @@ void s_deserialize_field_c_struct(
 
             *(void**) ((uint8_t*) type_data + field_info->offset) = dest_ptr;
         } else {
-            if (field_info->array_field_info.builtin_type &
+            if (field_info->array_field_info.builtin_type ==
                 S_ARRAY_BUILTIN_TYPE_STRING) {
                 dest_ptr = (uint8_t*) type_data + field_info->offset;
                 // unpack strings - separated by null terminators
@@ -576,7 +3020,8 @@ void s_deserialize_field_c_struct(
             }
         }
     } break;
-    case FIELD_TYPE_STRUCT: { // do nothing
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP: { // do nothing
     } break;
 
     default: {
@@ -593,86 +3038,166 @@ void s_deserialize_field_c_struct(
 #define JSON_CLOSE_BRACE_ARRAY ("]")
 // #define JSON_CLOSE_BRACE_OBJECT_ARRAY ("}]")
 
-#define JSON_APPEND(buf, str) sprintf(buf + strlen(buf), "%s", str)
-#define JSON_APPENDF(buf, fmt, ...) sprintf(buf + strlen(buf), fmt, __VA_ARGS__)
-#define JSON_PUSH_BRACE(ctx, lvl, brace)                                      \
-    ctx->json_context                                                         \
-        .closing_braces[lvl][strlen(ctx->json_context.closing_braces[lvl])] = \
-        brace[0]
+#define JSON_PUSH_BRACE(ctx, lvl, brace) s_json_push_brace(ctx, lvl, brace[0])
+
+static void s_json_push_brace(s_deserialize_context* ctx, int level,
+                              char brace) {
+    int n = ctx->json_context.n_braces;
+
+    if (n == sizeof(ctx->json_context.braces) /
+                 sizeof(ctx->json_context.braces[0])) {
+        LOG_DEBUG("ERROR (json deserialize): too many open braces");
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    ctx->json_context.braces[n].brace = brace;
+    ctx->json_context.braces[n].level = level;
+    ctx->json_context.n_braces++;
+}
+
+// closes braces of levels deeper than level, -1 closes all
+static void s_json_close_braces(s_deserialize_context* ctx, int level) {
+    s_json_writer* w = &ctx->json_context.writer;
+
+    while (ctx->json_context.n_braces > 0 &&
+           ctx->json_context.braces[ctx->json_context.n_braces - 1].level >
+               level) {
+        ctx->json_context.n_braces--;
+        s_json_append_char(
+            w, ctx->json_context.braces[ctx->json_context.n_braces].brace);
+    }
+}
+
+// bools of bitmap, label of the first one is written already
+static void s_json_append_packed_bools(s_json_writer* w,
+                                       const s_field_info* field_info,
+                                       const uint8_t* bitmap) {
+    for (uint32_t i = 0; i < field_info->packed_field_info.count; i++) {
+        const s_field_info* bool_info = field_info + i;
+
+        if (i != 0) {
+            const char* label =
+                bool_info->label ? bool_info->label : bool_info->name;
+
+            s_json_append_char(w, ',');
+            s_json_append_string(w, label, strlen(label));
+            s_json_append_char(w, ':');
+        }
+
+        if ((bitmap[i / 8] >> (i % 8)) & 1)
+            JSON_APPEND(w, "true");
+        else
+            JSON_APPEND(w, "false");
+    }
+}
+
+static void
+s_json_append_bit_string(s_deserialize_context* ctx,
+                         const s_field_info* field_info,
+                         const s_tlv_decoded_element_data* decoded_el_data) {
+    s_json_writer* w = &ctx->json_context.writer;
+    uint32_t count = 0;
+
+    if (!s_tlv_bit_string_count(decoded_el_data->value,
+                                decoded_el_data->length, &count)) {
+        LOG_DEBUG("ERROR (json deserialize): invalid bit string of %s",
+                  field_info->name);
+        ctx->err = SERIALIZER_ERROR_INVALID_TYPE;
+        return;
+    }
+
+    JSON_APPEND(w, JSON_OPEN_BRACE_ARRAY);
+
+    for (uint32_t i = 0; i < count; i++) {
+        if (i != 0)
+            JSON_APPEND(w, ",");
+
+        if ((decoded_el_data->value[1 + i / 8] >> (i % 8)) & 1)
+            JSON_APPEND(w, "true");
+        else
+            JSON_APPEND(w, "false");
+    }
+
+    JSON_APPEND(w, JSON_CLOSE_BRACE_ARRAY);
+}
+
+// one quantized value converted back to float or double
+static void s_json_append_quantized(s_json_writer* w,
+                                    const s_field_info* field_info,
+                                    const uint8_t* wire) {
+    if (field_info->size == sizeof(double)) {
+        double value;
+
+        s_dequantize(field_info, wire, 1, &value);
+        s_json_append_double(w, value);
+    } else {
+        float value;
+
+        s_dequantize(field_info, wire, 1, &value);
+        s_json_append_float(w, value);
+    }
+}
 
 void s_deserialize_field_json_string(
     s_deserialize_context* ctx, int field_idx, const s_type_info* type_info,
     const s_field_info* parent_info,
     const s_tlv_decoded_element_data* decoded_el_data) {
+    s_json_writer* w = &ctx->json_context.writer;
 
     // check for endo of decoding here
     if (!decoded_el_data) {
-        // close all pending braces
-        for (int i = ctx->prev_level; i >= 0; i--) {
-            for (int j = strlen(ctx->json_context.closing_braces[i]) - 1;
-                 j >= 0; j--) {
-                JSON_APPENDF(ctx->data, "%c",
-                             ctx->json_context.closing_braces[i][j]);
-            }
-        }
-
+        // close all pending braces, including ones of trailing empty array
+        s_json_close_braces(ctx, -1);
         return;
     }
 
-    char* json_str_buffer = (char*) ctx->data;
     const s_field_info* field_info = &type_info->fields[field_idx];
     const char* field_label =
         field_info->label ? field_info->label : field_info->name;
     bool root_start = ctx->prev_level == -1;
-    bool level_dropped = ctx->prev_level > decoded_el_data->level;
-    bool new_nested_started =
-        field_idx == 0 && ctx->prev_level == decoded_el_data->level;
+    // previous element may have opened an empty array one level deeper
+    bool level_dropped = ctx->prev_level + 1 > decoded_el_data->level;
+    bool new_nested_started = ctx->array_el_started;
     bool is_struct_array =
         field_info->type == FIELD_TYPE_ARRAY && field_info->struct_type_info;
 
     // check closing braces
     // 1. when level went down
     // 2. when level same, index 0
-    if (level_dropped) {
-        for (int i = ctx->prev_level; i > decoded_el_data->level; i--) {
-            for (int j = strlen(ctx->json_context.closing_braces[i]) - 1;
-                 j >= 0; j--) {
-                JSON_APPENDF(json_str_buffer, "%c",
-                             ctx->json_context.closing_braces[i][j]);
-                ctx->json_context.closing_braces[i][j] = 0;
-            }
-        }
-    }
+    if (level_dropped)
+        s_json_close_braces(ctx, decoded_el_data->level);
 
-    if (new_nested_started) {
-        JSON_APPENDF(json_str_buffer, "%s", JSON_CLOSE_BRACE_OBJECT);
+    // close previous struct of struct array
+    if (new_nested_started && decoded_el_data->idx != 0) {
+        JSON_APPEND(w, JSON_CLOSE_BRACE_OBJECT);
     }
 
     // add coma if not first element
     if (decoded_el_data->idx != 0) {
-        JSON_APPEND(json_str_buffer, ",");
+        JSON_APPEND(w, ",");
     }
 
     if (new_nested_started || root_start) {
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_OBJECT);
-        if (root_start)
+        JSON_APPEND(w, JSON_OPEN_BRACE_OBJECT);
+        if (root_start || decoded_el_data->idx == 0)
             JSON_PUSH_BRACE(ctx, decoded_el_data->level,
                             JSON_CLOSE_BRACE_OBJECT);
     }
 
-    JSON_APPENDF(json_str_buffer, "\"%s\":", field_label);
+    s_json_append_string(w, field_label, strlen(field_label));
+    s_json_append_char(w, ':');
 
+    // struct braces are opened by the first element of each struct
     if (is_struct_array) {
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_ARRAY);
+        JSON_APPEND(w, JSON_OPEN_BRACE_ARRAY);
         JSON_PUSH_BRACE(ctx, decoded_el_data->level + 1,
                         JSON_CLOSE_BRACE_ARRAY);
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_OBJECT);
-        JSON_PUSH_BRACE(ctx, decoded_el_data->level + 1,
-                        JSON_CLOSE_BRACE_OBJECT);
     }
 
-    if (field_info->type == FIELD_TYPE_STRUCT) {
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_OBJECT);
+    if (field_info->type == FIELD_TYPE_STRUCT ||
+        field_info->type == FIELD_TYPE_MAP) {
+        JSON_APPEND(w, JSON_OPEN_BRACE_OBJECT);
         JSON_PUSH_BRACE(ctx, decoded_el_data->level + 1,
                         JSON_CLOSE_BRACE_OBJECT);
     }
@@ -680,57 +3205,79 @@ void s_deserialize_field_json_string(
     // print field value
     switch (field_info->type) {
     case FIELD_TYPE_INT8: {
-        JSON_APPENDF(json_str_buffer, "%d", *(int8_t*) decoded_el_data->value);
+        s_json_append_int(w, *(int8_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_UINT8: {
-        JSON_APPENDF(json_str_buffer, "%d", *(uint8_t*) decoded_el_data->value);
+        s_json_append_uint(w, *(uint8_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_INT16: {
-        JSON_APPENDF(json_str_buffer, "%d", *(int16_t*) decoded_el_data->value);
+        s_json_append_int(w, *(int16_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_UINT16: {
-        JSON_APPENDF(json_str_buffer, "%d",
-                     *(uint16_t*) decoded_el_data->value);
+        s_json_append_uint(w, *(uint16_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_INT32: {
-        JSON_APPENDF(json_str_buffer, "%d", *(int32_t*) decoded_el_data->value);
+        s_json_append_int(w, *(int32_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_UINT32: {
-        JSON_APPENDF(json_str_buffer, "%d",
-                     *(uint32_t*) decoded_el_data->value);
+        s_json_append_uint(w, *(uint32_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_INT64: {
-        JSON_APPENDF(json_str_buffer, "%d", *(int64_t*) decoded_el_data->value);
+        s_json_append_int(w, *(int64_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_UINT64: {
-        JSON_APPENDF(json_str_buffer, "%d",
-                     *(uint64_t*) decoded_el_data->value);
+        s_json_append_uint(w, *(uint64_t*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_FLOAT: {
-        JSON_APPENDF(json_str_buffer, "%f", *(float*) decoded_el_data->value);
+        if (field_info->opts & S_FIELD_OPTS_QUANTIZED)
+            s_json_append_quantized(w, field_info, decoded_el_data->value);
+        else
+            s_json_append_float(w, *(float*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_DOUBLE: {
-        JSON_APPENDF(json_str_buffer, "%f", *(double*) decoded_el_data->value);
+        if (field_info->opts & S_FIELD_OPTS_QUANTIZED)
+            s_json_append_quantized(w, field_info, decoded_el_data->value);
+        else
+            s_json_append_double(w, *(double*) decoded_el_data->value);
     } break;
     case FIELD_TYPE_BOOL: {
-        JSON_APPEND(json_str_buffer,
-                    *(bool*) decoded_el_data->value ? "true" : "false");
+        if (field_info->opts & S_FIELD_OPT_BOOL_PACKED) {
+            s_json_append_packed_bools(w, field_info, decoded_el_data->value);
+            break;
+        }
+
+        if (*(bool*) decoded_el_data->value)
+            JSON_APPEND(w, "true");
+        else
+            JSON_APPEND(w, "false");
     } break;
     case FIELD_TYPE_BLOB: {
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_ARRAY);
+        if (w->base64_blobs) {
+            s_json_append_base64(w, decoded_el_data->value,
+                                 decoded_el_data->length);
+            break;
+        }
+
+        JSON_APPEND(w, JSON_OPEN_BRACE_ARRAY);
 
         for (size_t i = 0; i < decoded_el_data->length; i++) {
             if (i != 0)
-                JSON_APPEND(json_str_buffer, ",");
+                JSON_APPEND(w, ",");
 
-            JSON_APPENDF(json_str_buffer, "%d",
-                         ((uint8_t*) decoded_el_data->value)[i]);
+            s_json_append_uint(w, ((uint8_t*) decoded_el_data->value)[i]);
         }
 
-        JSON_APPEND(json_str_buffer, JSON_CLOSE_BRACE_ARRAY);
+        JSON_APPEND(w, JSON_CLOSE_BRACE_ARRAY);
     } break;
-    case FIELD_TYPE_STRING: {
-        JSON_APPENDF(json_str_buffer, "\"%s\"", (char*) decoded_el_data->value);
+    case FIELD_TYPE_STRING: { // NULL strings have no value
+        const char* str = (const char*) decoded_el_data->value;
+        const char* str_end =
+            decoded_el_data->length
+                ? memchr(str, '\0', decoded_el_data->length)
+                : str;
+
+        s_json_append_string(w, str,
+                             str_end ? str_end - str : decoded_el_data->length);
     } break;
     case FIELD_TYPE_ARRAY: {
         bool is_struct_array = field_info->struct_type_info;
@@ -739,6 +3286,12 @@ void s_deserialize_field_json_string(
         if (is_struct_array)
             break;
 
+        if (field_info->array_field_info.builtin_type ==
+            S_ARRAY_BUILTIN_TYPE_BITS) {
+            s_json_append_bit_string(ctx, field_info, decoded_el_data);
+            break;
+        }
+
         // builtin arrays
         bool is_float_array = field_info->array_field_info.builtin_type ==
                               S_ARRAY_BUILTIN_TYPE_FLOAT;
@@ -757,25 +3310,40 @@ void s_deserialize_field_json_string(
                 p++;
             }
         } else
-            n_elements = decoded_el_data->length / field_info->size;
+            n_elements = decoded_el_data->length / s_quantized_size(field_info);
+
+        if (w->base64_blobs && field_info->size == 1 &&
+            field_info->array_field_info.builtin_type ==
+                S_ARRAY_BUILTIN_TYPE_BLOB) {
+            s_json_append_base64(w, decoded_el_data->value, n_elements);
+            break;
+        }
 
-        JSON_APPEND(json_str_buffer, JSON_OPEN_BRACE_ARRAY);
+        JSON_APPEND(w, JSON_OPEN_BRACE_ARRAY);
         const uint8_t* p = decoded_el_data->value;
 
         for (int i = 0; i < n_elements; i++) {
             if (i != 0)
-                JSON_APPEND(json_str_buffer, ",");
+                JSON_APPEND(w, ",");
 
             switch (field_info->array_field_info.builtin_type) {
             case S_ARRAY_BUILTIN_TYPE_FLOAT: {
+                if (field_info->opts & S_FIELD_OPTS_QUANTIZED) {
+                    s_json_append_quantized(
+                        w, field_info,
+                        decoded_el_data->value +
+                            i * s_quantized_size(field_info));
+                    break;
+                }
+
                 switch (field_info->size) {
                 case 4: {
-                    JSON_APPENDF(json_str_buffer, "%f",
-                                 ((float*) decoded_el_data->value)[i]);
+                    s_json_append_float(w,
+                                        ((float*) decoded_el_data->value)[i]);
                 } break;
                 case 8: {
-                    JSON_APPENDF(json_str_buffer, "%f",
-                                 ((double*) decoded_el_data->value)[i]);
+                    s_json_append_double(w,
+                                         ((double*) decoded_el_data->value)[i]);
                 } break;
                 default: {
                     LOG_DEBUG("ERROR (json deserialize): invalid float array "
@@ -786,27 +3354,28 @@ void s_deserialize_field_json_string(
                 }
             } break;
             case S_ARRAY_BUILTIN_TYPE_STRING: {
-                JSON_APPENDF(json_str_buffer, "\"%s\"", (char*) p);
+                size_t str_len = strlen((char*) p);
 
-                p += strlen((char*) p) + 1;
+                s_json_append_string(w, (char*) p, str_len);
+                p += str_len + 1;
             } break;
             default: {
                 switch (field_info->size) {
                 case 1: {
-                    JSON_APPENDF(json_str_buffer, "%d",
-                                 ((int8_t*) decoded_el_data->value)[i]);
+                    s_json_append_int(w,
+                                      ((int8_t*) decoded_el_data->value)[i]);
                 } break;
                 case 2: {
-                    JSON_APPENDF(json_str_buffer, "%d",
-                                 ((int16_t*) decoded_el_data->value)[i]);
+                    s_json_append_int(w,
+                                      ((int16_t*) decoded_el_data->value)[i]);
                 } break;
                 case 4: {
-                    JSON_APPENDF(json_str_buffer, "%d",
-                                 ((int32_t*) decoded_el_data->value)[i]);
+                    s_json_append_int(w,
+                                      ((int32_t*) decoded_el_data->value)[i]);
                 } break;
                 case 8: {
-                    JSON_APPENDF(json_str_buffer, "%d",
-                                 ((int64_t*) decoded_el_data->value)[i]);
+                    s_json_append_int(w,
+                                      ((int64_t*) decoded_el_data->value)[i]);
                 } break;
                 default: {
                     LOG_DEBUG("ERROR (json deserialize): invalid builtin array "
@@ -822,11 +3391,12 @@ void s_deserialize_field_json_string(
                 return;
         }
 
-        JSON_APPEND(json_str_buffer, JSON_CLOSE_BRACE_ARRAY);
+        JSON_APPEND(w, JSON_CLOSE_BRACE_ARRAY);
 
     } break;
 
     case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP:
         break; // do nothing here
     default: {
         LOG_DEBUG("ERROR (json deserialize): invalid field type %d",
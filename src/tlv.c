@@ -8,6 +8,7 @@
 #include "sss/tlv.h"
 
 #include "sss/log.h"
+#include "sss/quantize.h"
 #include "sss/serializer.h"
 
 // system includes
@@ -32,13 +33,363 @@ static s_tlv_element k_dummy_el; // helper struct for macro
 #define TLV_AS_L(buffer) (((uint32_t*) (buffer + TLV_SIZEOF_T))[0])
 #define TLV_AS_V(buffer) (buffer + TLV_SIZEOF_TL)
 
-s_serializer_error s_tlv_decode_level(int level, const uint8_t* buffer,
+// compact (v2) element header: 1-byte tag, optional varint field id, varint
+// length
+#define TLV_COMPACT_SIZEOF_T (1)
+#define TLV_COMPACT_MAX_SIZEOF_L (5)  // varint of uint32_t
+#define TLV_COMPACT_MAX_SIZEOF_ID (5) // varint of uint32_t
+#define TLV_COMPACT_MAX_SIZEOF_TL \
+    (TLV_COMPACT_SIZEOF_T + TLV_COMPACT_MAX_SIZEOF_L)
+#define TLV_COMPACT_TAG_MASK (0x7F)
+#define TLV_COMPACT_TAG_FIELD_ID (0x80)
+// v1 element header: field id + 1 in the high byte of the tag
+#define TLV_TAG_MASK (0xFF)
+#define TLV_TAG_FIELD_ID_SHIFT (8)
+
+static size_t s_tlv_header_size(uint32_t flags, int field_id,
+                                uint32_t length) {
+    if (!(flags & TLV_ENCODE_FLAG_COMPACT))
+        return TLV_SIZEOF_TL;
+
+    uint8_t varint_buffer[TLV_VARINT_MAX_SIZE];
+    size_t size =
+        TLV_COMPACT_SIZEOF_T + s_tlv_varint_encode(length, varint_buffer);
+
+    if (flags & TLV_ENCODE_FLAG_FIELD_IDS)
+        size += s_tlv_varint_encode((uint64_t) field_id, varint_buffer);
+
+    return size;
+}
+
+// space reserved in front of values that are encoded directly into the buffer
+// (nested structs, arrays), before their length is known
+static size_t s_tlv_max_header_size(uint32_t flags) {
+    if (!(flags & TLV_ENCODE_FLAG_COMPACT))
+        return TLV_SIZEOF_TL;
+
+    return (flags & TLV_ENCODE_FLAG_FIELD_IDS)
+               ? TLV_COMPACT_MAX_SIZEOF_TL + TLV_COMPACT_MAX_SIZEOF_ID
+               : TLV_COMPACT_MAX_SIZEOF_TL;
+}
+
+static size_t s_tlv_write_header(uint32_t flags, uint16_t tag, int field_id,
+                                 uint32_t length, uint8_t* buffer) {
+    bool has_field_id = flags & TLV_ENCODE_FLAG_FIELD_IDS;
+
+    if (flags & TLV_ENCODE_FLAG_COMPACT) {
+        size_t size = TLV_COMPACT_SIZEOF_T;
+
+        buffer[0] = (uint8_t) (tag & TLV_COMPACT_TAG_MASK);
+
+        if (has_field_id) {
+            buffer[0] |= TLV_COMPACT_TAG_FIELD_ID;
+            size += s_tlv_varint_encode((uint64_t) field_id, buffer + size);
+        }
+
+        return size + s_tlv_varint_encode(length, buffer + size);
+    }
+
+    if (has_field_id)
+        tag = (uint16_t) ((tag & TLV_TAG_MASK) |
+                          ((field_id + 1) << TLV_TAG_FIELD_ID_SHIFT));
+
+    uint16_t type_net = htons(tag);
+    uint32_t length_net = htonl(length);
+    memcpy(buffer, &type_net, TLV_SIZEOF_T);
+    memcpy(buffer + TLV_SIZEOF_T, &length_net, TLV_SIZEOF_L);
+
+    return TLV_SIZEOF_TL;
+}
+
+// returns header size, 0 if header is malformed
+static size_t s_tlv_read_header(bool is_compact, const uint8_t* buffer,
+                                size_t buffer_size, uint16_t* tag,
+                                int* field_id, uint32_t* length) {
+    if (!is_compact) {
+        if (buffer_size < TLV_SIZEOF_TL)
+            return 0;
+
+        const s_tlv_element* tlv_el = (const s_tlv_element*) buffer;
+        uint16_t tag_value = ntohs(tlv_el->tag);
+
+        *tag = tag_value & TLV_TAG_MASK;
+        *field_id = (int) (tag_value >> TLV_TAG_FIELD_ID_SHIFT) - 1;
+        *length = ntohl(tlv_el->length);
+
+        return TLV_SIZEOF_TL;
+    }
+
+    uint64_t value = 0;
+    size_t size = TLV_COMPACT_SIZEOF_T;
+    size_t varint_size = 0;
+
+    if (buffer_size < TLV_COMPACT_SIZEOF_T + 1)
+        return 0;
+
+    *tag = buffer[0] & TLV_COMPACT_TAG_MASK;
+    *field_id = TLV_NO_FIELD_ID;
+
+    if (buffer[0] & TLV_COMPACT_TAG_FIELD_ID) {
+        varint_size =
+            s_tlv_varint_decode(buffer + size, buffer_size - size, &value);
+
+        if (!varint_size || value > TLV_MAX_FIELD_ID)
+            return 0;
+
+        *field_id = (int) value;
+        size += varint_size;
+    }
+
+    varint_size =
+        s_tlv_varint_decode(buffer + size, buffer_size - size, &value);
+
+    if (!varint_size || value > UINT32_MAX)
+        return 0;
+
+    *length = (uint32_t) value;
+
+    return size + varint_size;
+}
+
+s_serializer_error s_tlv_decode_level(int level, bool is_compact,
+                                      const uint8_t* buffer,
                                       size_t buffer_size, s_tlv_element_cb cb,
                                       void* user_data);
+s_serializer_error s_tlv_encode_level(const s_type_info* info,
+                                      const void* data, uint32_t flags,
+                                      uint8_t* buffer, size_t buffer_size,
+                                      size_t* bytes_written);
+static s_serializer_error
+s_tlv_finish_element(uint32_t flags, uint16_t tag, int field_id,
+                     uint32_t length, const void* value_ptr,
+                     uint8_t* tlv_buffer, size_t buffer_size,
+                     size_t* bytes_written);
+
+static bool s_tlv_is_varint_field(const s_field_info* field, uint32_t flags) {
+    switch (field->type) {
+    case FIELD_TYPE_INT8:
+    case FIELD_TYPE_UINT8:
+        return field->opts & S_FIELD_OPT_VARINT;
+    case FIELD_TYPE_INT16:
+    case FIELD_TYPE_UINT16:
+    case FIELD_TYPE_INT32:
+    case FIELD_TYPE_UINT32:
+    case FIELD_TYPE_INT64:
+    case FIELD_TYPE_UINT64:
+        return (flags & TLV_ENCODE_FLAG_VARINT) ||
+               (field->opts & S_FIELD_OPT_VARINT);
+    default:
+        return false;
+    }
+}
 
-s_serializer_error s_tlv_encode_field(const s_field_info* field,
-                                      const void* data, uint8_t* tlv_buffer,
-                                      size_t buffer_size,
+// reads integer field value and maps it to unsigned varint domain
+static uint64_t s_tlv_varint_value(const s_field_info* field,
+                                   const uint8_t* field_data) {
+    bool is_signed =
+        field->type == FIELD_TYPE_INT8 || field->type == FIELD_TYPE_INT16 ||
+        field->type == FIELD_TYPE_INT32 || field->type == FIELD_TYPE_INT64;
+    int64_t value = 0;
+
+    switch (field->size) {
+    case 1: {
+        uint8_t v;
+        memcpy(&v, field_data, sizeof(v));
+        value = is_signed ? (int64_t) (int8_t) v : (int64_t) v;
+    } break;
+    case 2: {
+        uint16_t v;
+        memcpy(&v, field_data, sizeof(v));
+        value = is_signed ? (int64_t) (int16_t) v : (int64_t) v;
+    } break;
+    case 4: {
+        uint32_t v;
+        memcpy(&v, field_data, sizeof(v));
+        value = is_signed ? (int64_t) (int32_t) v : (int64_t) v;
+    } break;
+    case 8: {
+        memcpy(&value, field_data, sizeof(value));
+    } break;
+    default:
+        break;
+    }
+
+    return is_signed ? S_ZIGZAG_ENCODE(value) : (uint64_t) value;
+}
+
+s_serializer_error s_tlv_array_size(const s_field_info* field, const void* data,
+                                    uint32_t* array_size) {
+    const uint8_t* size_field_data =
+        (const uint8_t*) data + field->array_field_info.size_field_offset;
+
+    switch (field->array_field_info.size_field_size) {
+    case 1: {
+        *array_size = (uint32_t) *(uint8_t*) size_field_data;
+    } break;
+    case 2: {
+        *array_size = (uint32_t) (*(uint16_t*) size_field_data);
+    } break;
+    case 4:
+    case 8: {
+        *array_size = (uint32_t) (*(uint32_t*) size_field_data);
+    } break;
+    default:
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    return SERIALIZER_OK;
+}
+
+bool s_tlv_set_array_size(const s_field_info* field, void* data,
+                          uint32_t array_size) {
+    uint8_t* size_field_data =
+        (uint8_t*) data + field->array_field_info.size_field_offset;
+
+    switch (field->array_field_info.size_field_size) {
+    case 1: {
+        uint8_t size = (uint8_t) array_size;
+        memcpy(size_field_data, &size, sizeof(size));
+        return size == array_size;
+    }
+    case 2: {
+        uint16_t size = (uint16_t) array_size;
+        memcpy(size_field_data, &size, sizeof(size));
+        return size == array_size;
+    }
+    case 4: {
+        memcpy(size_field_data, &array_size, sizeof(array_size));
+        return true;
+    }
+    case 8: {
+        uint64_t size = array_size;
+        memcpy(size_field_data, &size, sizeof(size));
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+static bool s_tlv_is_zero(const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (data[i])
+            return false;
+    }
+
+    return true;
+}
+
+// checks if field holds the value decoder fills in for omitted fields: zero
+// scalars and blobs, NULL strings, empty fixed strings, empty arrays. Empty
+// strings behind pointers are kept, decoder would give NULL for them. Structs
+// are never omitted, their fields are checked one by one instead
+static bool s_tlv_is_default_value(const s_field_info* field,
+                                   const void* data) {
+    const uint8_t* field_data = (const uint8_t*) data + field->offset;
+
+    switch (field->type) {
+    case FIELD_TYPE_INT8:
+    case FIELD_TYPE_UINT8:
+    case FIELD_TYPE_INT16:
+    case FIELD_TYPE_UINT16:
+    case FIELD_TYPE_INT32:
+    case FIELD_TYPE_UINT32:
+    case FIELD_TYPE_INT64:
+    case FIELD_TYPE_UINT64:
+    case FIELD_TYPE_FLOAT:
+    case FIELD_TYPE_DOUBLE:
+    case FIELD_TYPE_BOOL:
+        return s_tlv_is_zero(field_data, field->size);
+    case FIELD_TYPE_BLOB:
+        return field->size <= TLV_MAX_DEFAULT_BLOB_SIZE &&
+               s_tlv_is_zero(field_data, field->size);
+    case FIELD_TYPE_STRING: {
+        if (field->opts & S_FIELD_OPT_STRING_FIXED)
+            return field_data[0] == 0;
+
+        char* str;
+        memcpy(&str, field_data, sizeof(char*));
+        return str == NULL;
+    }
+    case FIELD_TYPE_ARRAY: {
+        uint32_t array_size = 0;
+        return s_tlv_array_size(field, data, &array_size) == SERIALIZER_OK &&
+               array_size == 0;
+    }
+    default:
+        return false;
+    }
+}
+
+// writes element header and value. NULL value_ptr means value was encoded in
+// place, after s_tlv_max_header_size bytes reserved for the header
+static s_serializer_error
+s_tlv_finish_element(uint32_t flags, uint16_t tag, int field_id,
+                     uint32_t length, const void* value_ptr,
+                     uint8_t* tlv_buffer, size_t buffer_size,
+                     size_t* bytes_written) {
+    size_t header_reserve = s_tlv_max_header_size(flags);
+    size_t header_size = s_tlv_header_size(flags, field_id, length);
+
+    if (buffer_size < header_size + length) {
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    // copy data
+    if (value_ptr) {
+        memcpy(tlv_buffer + header_size, value_ptr, length);
+    } else if (header_size != header_reserve) {
+        // value was encoded in place, shift it to the actual header end
+        memmove(tlv_buffer + header_size, tlv_buffer + header_reserve, length);
+    }
+
+    s_tlv_write_header(flags, tag, field_id, length, tlv_buffer);
+
+    *bytes_written = header_size + length;
+
+    return SERIALIZER_OK;
+}
+
+// with field ids each struct of struct array starts with an element of its
+// own: omitted fields leave no other trace of where the struct begins
+static s_serializer_error s_tlv_encode_array_el_start(uint32_t flags,
+                                                      uint8_t* tlv_buffer,
+                                                      size_t buffer_size,
+                                                      size_t* bytes_written) {
+    *bytes_written = 0;
+
+    if (!(flags & TLV_ENCODE_FLAG_FIELD_IDS))
+        return SERIALIZER_OK;
+
+    return s_tlv_finish_element(flags & ~TLV_ENCODE_FLAG_FIELD_IDS,
+                                TLV_TAG_NESTED_LIST_EL, TLV_NO_FIELD_ID, 0, "",
+                                tlv_buffer, buffer_size, bytes_written);
+}
+
+// packed bools go as one bitmap element of the first of them
+static s_serializer_error
+s_tlv_encode_bitmap(const s_field_info* field, int field_id, const void* data,
+                    uint32_t flags, uint8_t* tlv_buffer, size_t buffer_size,
+                    size_t* bytes_written) {
+    uint32_t length = S_BITS_SIZE(field->packed_field_info.count);
+    uint8_t bitmap[S_BITS_SIZE(S_MAX_FIELDS)];
+
+    s_bits_pack((const bool*) ((const uint8_t*) data + field->offset),
+                field->packed_field_info.count, bitmap);
+
+    if ((flags & TLV_ENCODE_FLAG_OMIT_DEFAULTS) &&
+        s_tlv_is_zero(bitmap, length)) {
+        *bytes_written = 0;
+        return SERIALIZER_OK;
+    }
+
+    return s_tlv_finish_element(flags, TLV_TAG_FIELD, field_id, length, bitmap,
+                                tlv_buffer, buffer_size, bytes_written);
+}
+
+s_serializer_error s_tlv_encode_field(const s_field_info* field, int field_id,
+                                      const void* data, uint32_t flags,
+                                      uint8_t* tlv_buffer, size_t buffer_size,
                                       size_t* bytes_written) {
     const uint8_t* field_data = (const uint8_t*) data + field->offset;
 
@@ -48,8 +399,26 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
         return SERIALIZER_OK;
     }
 
+    if (field->opts & S_FIELD_OPT_BOOL_PACKED) {
+        uint32_t bit = field->packed_field_info.bit;
+
+        return s_tlv_encode_bitmap(field - bit, field_id - (int) bit, data,
+                                   flags, tlv_buffer, buffer_size,
+                                   bytes_written);
+    }
+
+    if ((flags & TLV_ENCODE_FLAG_OMIT_DEFAULTS) &&
+        s_tlv_is_default_value(field, data)) {
+        *bytes_written = 0;
+        return SERIALIZER_OK;
+    }
+
     const void* value_ptr = NULL;
     s_tlv_element tlv_el = {0};
+    uint8_t varint_buffer[TLV_VARINT_MAX_SIZE];
+    uint8_t quantized_buffer[sizeof(int32_t)];
+    // offset of values encoded in place, header is written after the value
+    size_t header_reserve = s_tlv_max_header_size(flags);
 
     switch (field->type) {
     case FIELD_TYPE_INT8:
@@ -81,15 +450,26 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
                 tlv_el.length = 0;
                 value_ptr = NULL;
             }
+            tlv_el.tag = (uint16_t) TLV_TAG_FIELD;
+        } else if (s_tlv_is_varint_field(field, flags)) {
+            tlv_el.length = (uint32_t) s_tlv_varint_encode(
+                s_tlv_varint_value(field, field_data), varint_buffer);
+            value_ptr = varint_buffer;
+            tlv_el.tag = (uint16_t) TLV_TAG_VARINT;
+        } else if (field->opts & S_FIELD_OPTS_QUANTIZED) {
+            s_quantize(field, field_data, 1, quantized_buffer);
+            tlv_el.length = (uint32_t) s_quantized_size(field);
+            value_ptr = quantized_buffer;
+            tlv_el.tag = (uint16_t) TLV_TAG_FIELD;
         } else {
             tlv_el.length = (uint32_t) field->size;
             value_ptr = field_data;
+            tlv_el.tag = (uint16_t) TLV_TAG_FIELD;
         }
-
-        tlv_el.tag = (uint16_t) TLV_TAG_FIELD;
     } break;
 
-    case FIELD_TYPE_STRUCT: {
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP: {
         const s_type_info* sub_info = field->struct_type_info;
         if (!sub_info) {
             return SERIALIZER_ERROR_INVALID_TYPE;
@@ -98,15 +478,15 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
         tlv_el.tag = (uint16_t) TLV_TAG_NESTED;
         value_ptr = NULL;
 
-        if (buffer_size < TLV_SIZEOF_TL) {
+        if (buffer_size < header_reserve) {
             return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
         }
 
         // encode directly into buffer
         size_t sub_bytes_written = 0;
-        s_serializer_error err =
-            s_tlv_encode(sub_info, field_data, tlv_buffer + TLV_SIZEOF_TL,
-                         buffer_size - TLV_SIZEOF_TL, &sub_bytes_written);
+        s_serializer_error err = s_tlv_encode_level(
+            sub_info, field_data, flags, tlv_buffer + header_reserve,
+            buffer_size - header_reserve, &sub_bytes_written);
 
         if (err != SERIALIZER_OK) {
             return err;
@@ -117,21 +497,8 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
 
     case FIELD_TYPE_ARRAY: {
         uint32_t array_size = 0;
-        const uint8_t* size_field_data =
-            (const uint8_t*) data + field->array_field_info.size_field_offset;
-
-        switch (field->array_field_info.size_field_size) {
-        case 1: {
-            array_size = (uint32_t) *(uint8_t*) size_field_data;
-        } break;
-        case 2: {
-            array_size = (uint32_t) (*(uint16_t*) size_field_data);
-        } break;
-        case 4:
-        case 8: {
-            array_size = (uint32_t) (*(uint32_t*) size_field_data);
-        } break;
-        default:
+
+        if (s_tlv_array_size(field, data, &array_size) != SERIALIZER_OK) {
             return SERIALIZER_ERROR_INVALID_TYPE;
         }
 
@@ -143,25 +510,63 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
         if (!is_struct_array) {
             if (field->array_field_info.builtin_type ==
                 S_ARRAY_BUILTIN_TYPE_STRING) {
-                int tlv_length = 0;
+                size_t tlv_length = 0;
 
                 // copy strings one by one, include null terminator
                 for (int i = 0; i < array_size; ++i) {
                     char* str = (char*) field_data + field->size * i;
-                    int str_len = strlen(str) + 1;
+                    size_t str_len = strlen(str) + 1;
 
                     // copy
-                    if (buffer_size < str_len) {
+                    if (buffer_size < header_reserve + tlv_length + str_len) {
                         return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
                     }
 
-                    memcpy(tlv_buffer + TLV_SIZEOF_TL + tlv_length, str,
+                    memcpy(tlv_buffer + header_reserve + tlv_length, str,
                            str_len);
                     tlv_length += str_len;
-                    buffer_size -= str_len;
                 }
 
-                tlv_el.length = tlv_length;
+                tlv_el.length = (uint32_t) tlv_length;
+                value_ptr = NULL;
+            } else if (field->array_field_info.builtin_type ==
+                       S_ARRAY_BUILTIN_TYPE_BITS) {
+                const bool* values =
+                    is_dynamic ? *(const bool**) field_data
+                               : (const bool*) field_data;
+                uint8_t* bit_string = tlv_buffer + header_reserve;
+
+                if (field->size != sizeof(bool)) {
+                    return SERIALIZER_ERROR_INVALID_TYPE;
+                }
+
+                tlv_el.length = TLV_BIT_STRING_SIZE(array_size);
+
+                if (buffer_size < header_reserve + tlv_el.length) {
+                    return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+                }
+
+                // encode in place: unused bits, then bitmap
+                if (array_size) {
+                    bit_string[0] =
+                        (uint8_t) (S_BITS_SIZE(array_size) * 8 - array_size);
+                    s_bits_pack(values, array_size, bit_string + 1);
+                }
+
+                value_ptr = NULL;
+            } else if (field->opts & S_FIELD_OPTS_QUANTIZED) {
+                const void* values =
+                    is_dynamic ? *(const void**) field_data : field_data;
+
+                tlv_el.length = array_size * (uint32_t) s_quantized_size(field);
+
+                if (buffer_size < header_reserve + tlv_el.length) {
+                    return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+                }
+
+                // encode in place
+                s_quantize(field, values, array_size,
+                           tlv_buffer + header_reserve);
                 value_ptr = NULL;
             } else { // just serialize as a blob
                 tlv_el.length = array_size * field->size;
@@ -173,7 +578,7 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
 
             value_ptr = NULL;
 
-            if (buffer_size < TLV_SIZEOF_TL) {
+            if (buffer_size < header_reserve) {
                 return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
             }
 
@@ -184,11 +589,22 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
                 const void* array_element_data =
                     is_dynamic ? *(const void**) field_data + field->size * i
                                : field_data + field->size * i;
+                size_t start_bytes = 0;
                 size_t bytes_written = 0;
-                s_serializer_error err = s_tlv_encode(
-                    sub_info, array_element_data,
-                    tlv_buffer + TLV_SIZEOF_TL + sub_bytes_written,
-                    buffer_size - TLV_SIZEOF_TL - sub_bytes_written,
+                s_serializer_error err = s_tlv_encode_array_el_start(
+                    flags, tlv_buffer + header_reserve + sub_bytes_written,
+                    buffer_size - header_reserve - sub_bytes_written,
+                    &start_bytes);
+
+                if (err != SERIALIZER_OK) {
+                    return err;
+                }
+
+                sub_bytes_written += start_bytes;
+                err = s_tlv_encode_level(
+                    sub_info, array_element_data, flags,
+                    tlv_buffer + header_reserve + sub_bytes_written,
+                    buffer_size - header_reserve - sub_bytes_written,
                     &bytes_written);
 
                 if (err != SERIALIZER_OK) {
@@ -206,41 +622,101 @@ s_serializer_error s_tlv_encode_field(const s_field_info* field,
         return SERIALIZER_ERROR_INVALID_TYPE;
     }
 
-    if (buffer_size < TLV_SIZEOF(&tlv_el)) {
+    return s_tlv_finish_element(flags, tlv_el.tag, field_id, tlv_el.length,
+                                value_ptr, tlv_buffer, buffer_size,
+                                bytes_written);
+}
+
+s_serializer_error s_tlv_encode(const s_type_info* info, const void* data,
+                                uint8_t* buffer, size_t buffer_size,
+                                size_t* bytes_written) {
+    return s_tlv_encode_ex(info, data, TLV_ENCODE_FLAG_NONE, buffer,
+                           buffer_size, bytes_written);
+}
+
+s_serializer_error s_tlv_encode_ex(const s_type_info* info, const void* data,
+                                   uint32_t flags, uint8_t* buffer,
+                                   size_t buffer_size, size_t* bytes_written) {
+    // decoder can only tell which fields were omitted by ids of the rest
+    if (flags & TLV_ENCODE_FLAG_OMIT_DEFAULTS)
+        flags |= TLV_ENCODE_FLAG_FIELD_IDS;
+
+    if (!(flags & TLV_ENCODE_FLAG_COMPACT)) {
+        return s_tlv_encode_level(info, data, flags, buffer, buffer_size,
+                                  bytes_written);
+    }
+
+    if (!buffer || !bytes_written) {
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    if (buffer_size < TLV_COMPACT_PREFIX_SIZE) {
         return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
     }
 
-    // copy data
-    uint16_t type_net = htons(tlv_el.tag);
-    uint32_t length_net = htonl(tlv_el.length);
-    memcpy(tlv_buffer, &type_net, TLV_SIZEOF_T);
-    memcpy(tlv_buffer + TLV_SIZEOF_T, &length_net, TLV_SIZEOF_L);
+    // compact format is marked with magic prefix
+    size_t level_bytes_written = 0;
+    s_serializer_error err = s_tlv_encode_level(
+        info, data, flags, buffer + TLV_COMPACT_PREFIX_SIZE,
+        buffer_size - TLV_COMPACT_PREFIX_SIZE, &level_bytes_written);
 
-    if (value_ptr) {
-        memcpy(TLV_AS_V(tlv_buffer), value_ptr, tlv_el.length);
+    if (err != SERIALIZER_OK) {
+        return err;
     }
 
-    *bytes_written = TLV_SIZEOF(&tlv_el);
+    buffer[0] = TLV_COMPACT_MAGIC;
+    buffer[1] = TLV_COMPACT_VERSION;
+    *bytes_written = TLV_COMPACT_PREFIX_SIZE + level_bytes_written;
 
     return SERIALIZER_OK;
 }
 
-s_serializer_error s_tlv_encode(const s_type_info* info, const void* data,
-                                uint8_t* buffer, size_t buffer_size,
-                                size_t* bytes_written) {
+s_serializer_error s_tlv_encode_level(const s_type_info* info,
+                                      const void* data, uint32_t flags,
+                                      uint8_t* buffer, size_t buffer_size,
+                                      size_t* bytes_written) {
     if (!info || !data || !buffer || !bytes_written) {
         return SERIALIZER_ERROR_INVALID_TYPE;
     }
 
+    if (s_type_info_is_failed(info)) {
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+    }
+
+    if (flags == TLV_ENCODE_FLAG_NONE && info->encode) {
+        return info->encode(data, buffer, buffer_size, bytes_written);
+    }
+
     size_t total_bytes = 0;
     uint8_t* current_buffer = buffer;
     size_t remaining_size = buffer_size;
 
     for (size_t i = 0; i < info->field_count; i++) {
+        size_t field_idx = i;
+        const s_union_table* table = info->fields[i].optional_field_info.table;
+
+        // only active alternative of union is encoded
+        if (table) {
+            const s_field_info* active = s_union_table_find(
+                table, (const uint8_t*) data +
+                           table->fields->optional_field_info.tag_offset);
+
+            i = table->first_field + table->field_count - 1;
+
+            if (!active)
+                continue;
+
+            field_idx = (size_t) (active - info->fields);
+        }
+
+        // packed bools went out with the first of them
+        if (info->fields[i].opts & S_FIELD_OPT_BOOL_PACKED)
+            i += info->fields[i].packed_field_info.count - 1;
+
         size_t field_bytes = 0;
-        s_serializer_error err =
-            s_tlv_encode_field(&info->fields[i], data, current_buffer,
-                               remaining_size, &field_bytes);
+        s_serializer_error err = s_tlv_encode_field(
+            &info->fields[field_idx], (int) field_idx, data, flags,
+            current_buffer, remaining_size, &field_bytes);
 
         if (err != SERIALIZER_OK) {
             return err;
@@ -251,40 +727,388 @@ s_serializer_error s_tlv_encode(const s_type_info* info, const void* data,
         total_bytes += field_bytes;
     }
 
+    // struct with all fields omitted still needs one element: decoder fills
+    // omitted fields in only when it sees ids
+    if (total_bytes == 0 && (flags & TLV_ENCODE_FLAG_OMIT_DEFAULTS)) {
+        for (size_t i = 0; i < info->field_count && total_bytes == 0; i++) {
+            s_serializer_error err = s_tlv_encode_field(
+                &info->fields[i], (int) i, data,
+                flags & ~TLV_ENCODE_FLAG_OMIT_DEFAULTS, buffer, buffer_size,
+                &total_bytes);
+
+            if (err != SERIALIZER_OK) {
+                return err;
+            }
+        }
+    }
+
     *bytes_written = total_bytes;
     return SERIALIZER_OK;
 }
 
-s_serializer_error s_tlv_decode_element(int idx, int level,
-                                        const s_tlv_element* tlv_el,
-                                        s_tlv_element_cb cb, void* user_data) {
+// delta encoding
+static bool s_tlv_is_struct_equal(const s_type_info* info, const void* prev,
+                                  const void* cur);
+
+static const uint8_t* s_tlv_array_data(const s_field_info* field,
+                                       const void* data) {
+    const uint8_t* field_data = (const uint8_t*) data + field->offset;
+
+    return (field->opts & S_FIELD_OPT_ARRAY_DYNAMIC)
+               ? *(const uint8_t**) field_data
+               : field_data;
+}
+
+static bool s_tlv_is_array_el_equal(const s_field_info* field,
+                                    const uint8_t* prev, const uint8_t* cur) {
+    if (field->struct_type_info)
+        return s_tlv_is_struct_equal(field->struct_type_info, prev, cur);
+
+    if (field->array_field_info.builtin_type == S_ARRAY_BUILTIN_TYPE_STRING)
+        return strcmp((const char*) prev, (const char*) cur) == 0;
+
+    return memcmp(prev, cur, field->size) == 0;
+}
+
+// finds first and last differing elements of arrays of the same size, returns
+// false if arrays are equal
+static bool s_tlv_array_diff(const s_field_info* field, const void* prev,
+                             const void* cur, uint32_t array_size,
+                             uint32_t* first, uint32_t* last) {
+    const uint8_t* prev_data = s_tlv_array_data(field, prev);
+    const uint8_t* cur_data = s_tlv_array_data(field, cur);
+    bool has_diff = false;
+
+    for (uint32_t i = 0; i < array_size; i++) {
+        if (s_tlv_is_array_el_equal(field, prev_data + field->size * i,
+                                    cur_data + field->size * i))
+            continue;
+
+        if (!has_diff)
+            *first = i;
+
+        *last = i;
+        has_diff = true;
+    }
+
+    return has_diff;
+}
+
+static bool s_tlv_is_field_equal(const s_field_info* field, const void* prev,
+                                 const void* cur) {
+    const uint8_t* prev_data = (const uint8_t*) prev + field->offset;
+    const uint8_t* cur_data = (const uint8_t*) cur + field->offset;
+
+    switch (field->type) {
+    case FIELD_TYPE_STRING: {
+        if (field->opts & S_FIELD_OPT_STRING_FIXED)
+            return strcmp((const char*) prev_data, (const char*) cur_data) == 0;
 
-    uint16_t tag = ntohs(tlv_el->tag);
-    uint32_t length = ntohl(tlv_el->length);
+        const char* prev_str;
+        const char* cur_str;
+        memcpy(&prev_str, prev_data, sizeof(char*));
+        memcpy(&cur_str, cur_data, sizeof(char*));
+
+        if (!prev_str || !cur_str)
+            return prev_str == cur_str;
+
+        return strcmp(prev_str, cur_str) == 0;
+    }
+    case FIELD_TYPE_STRUCT:
+    case FIELD_TYPE_MAP:
+        return s_tlv_is_struct_equal(field->struct_type_info, prev_data,
+                                     cur_data);
+    case FIELD_TYPE_ARRAY: {
+        uint32_t prev_size = 0, cur_size = 0, first, last;
+
+        if (s_tlv_array_size(field, prev, &prev_size) != SERIALIZER_OK ||
+            s_tlv_array_size(field, cur, &cur_size) != SERIALIZER_OK)
+            return false;
+
+        return prev_size == cur_size &&
+               !s_tlv_array_diff(field, prev, cur, cur_size, &first, &last);
+    }
+    default:
+        return memcmp(prev_data, cur_data, field->size) == 0;
+    }
+}
+
+static bool s_tlv_is_struct_equal(const s_type_info* info, const void* prev,
+                                  const void* cur) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        int is_present = is_field_present(cur, field);
+
+        if (is_present != is_field_present(prev, field))
+            return false;
+
+        if (is_present && !s_tlv_is_field_equal(field, prev, cur))
+            return false;
+    }
+
+    return true;
+}
+
+// encodes elements first..last of array field as range element
+static s_serializer_error
+s_tlv_encode_array_range(const s_field_info* field, int field_id,
+                         const void* data, uint32_t first, uint32_t last,
+                         uint32_t flags, uint8_t* tlv_buffer,
+                         size_t buffer_size, size_t* bytes_written) {
+    const uint8_t* array_data = s_tlv_array_data(field, data);
+    size_t header_reserve = s_tlv_max_header_size(flags);
+    uint8_t varint_buffer[TLV_VARINT_MAX_SIZE];
+    size_t length = s_tlv_varint_encode(first, varint_buffer);
+
+    if (buffer_size < header_reserve + length) {
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    memcpy(tlv_buffer + header_reserve, varint_buffer, length);
+
+    for (uint32_t i = first; i <= last; i++) {
+        const uint8_t* el_data = array_data + field->size * i;
+        uint8_t* el_buffer = tlv_buffer + header_reserve + length;
+        size_t el_buffer_size = buffer_size - header_reserve - length;
+        size_t el_size = 0;
+
+        if (field->struct_type_info) {
+            size_t start_bytes = 0;
+            s_serializer_error err = s_tlv_encode_array_el_start(
+                flags, el_buffer, el_buffer_size, &start_bytes);
+
+            if (err == SERIALIZER_OK)
+                err = s_tlv_encode_level(
+                    field->struct_type_info, el_data, flags,
+                    el_buffer + start_bytes, el_buffer_size - start_bytes,
+                    &el_size);
+
+            if (err != SERIALIZER_OK) {
+                return err;
+            }
+
+            el_size += start_bytes;
+        } else {
+            el_size = field->array_field_info.builtin_type ==
+                              S_ARRAY_BUILTIN_TYPE_STRING
+                          ? strlen((const char*) el_data) + 1
+                          : field->size;
+
+            if (el_buffer_size < el_size) {
+                return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+            }
+
+            memcpy(el_buffer, el_data, el_size);
+        }
+
+        length += el_size;
+    }
+
+    return s_tlv_finish_element(
+        flags,
+        field->struct_type_info ? TLV_TAG_NESTED_LIST_RANGE
+                                : TLV_TAG_LIST_RANGE,
+        field_id, (uint32_t) length, NULL, tlv_buffer, buffer_size,
+        bytes_written);
+}
+
+s_serializer_error s_tlv_encode_delta_level(const s_type_info* info,
+                                            const void* prev, const void* cur,
+                                            uint32_t flags, uint8_t* buffer,
+                                            size_t buffer_size,
+                                            size_t* bytes_written) {
+    size_t total_bytes = 0;
+
+    if (s_type_info_is_failed(info)) {
+        return SERIALIZER_ERROR_ALLOCATOR_FAILED;
+    }
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        size_t field_bytes = 0;
+        s_serializer_error err = SERIALIZER_OK;
+
+        // packed bools are sent together when any of them changed
+        if (field->opts & S_FIELD_OPT_BOOL_PACKED) {
+            uint32_t count = field->packed_field_info.count;
+
+            if (memcmp((const uint8_t*) prev + field->offset,
+                       (const uint8_t*) cur + field->offset, count) != 0)
+                err = s_tlv_encode_bitmap(field, (int) i, cur, flags,
+                                          buffer + total_bytes,
+                                          buffer_size - total_bytes,
+                                          &field_bytes);
+
+            if (err != SERIALIZER_OK) {
+                return err;
+            }
+
+            total_bytes += field_bytes;
+            i += count - 1;
+            continue;
+        }
+
+        // fields missing in cur are not sent, their union tag changed
+        if (!is_field_present(cur, field))
+            continue;
+
+        bool was_present = is_field_present(prev, field);
+
+        if (was_present && s_tlv_is_field_equal(field, prev, cur))
+            continue;
+
+        uint8_t* field_buffer = buffer + total_bytes;
+        size_t field_buffer_size = buffer_size - total_bytes;
+        uint32_t first = 0, last = 0;
+        bool is_array_range = false;
+
+        // arrays of the same size only send changed elements, bool and
+        // quantized float arrays are sent whole as their elements differ in
+        // size from memory
+        if (was_present && field->type == FIELD_TYPE_ARRAY &&
+            (field->struct_type_info ||
+             (field->array_field_info.builtin_type !=
+                  S_ARRAY_BUILTIN_TYPE_BITS &&
+              !(field->opts & S_FIELD_OPTS_QUANTIZED)))) {
+            uint32_t prev_size = 0, cur_size = 0;
+
+            if (s_tlv_array_size(field, prev, &prev_size) != SERIALIZER_OK ||
+                s_tlv_array_size(field, cur, &cur_size) != SERIALIZER_OK) {
+                return SERIALIZER_ERROR_INVALID_TYPE;
+            }
+
+            is_array_range = prev_size == cur_size &&
+                             s_tlv_array_diff(field, prev, cur, cur_size,
+                                              &first, &last);
+        }
+
+        // maps are sent whole, receiver may have ordered entries differently
+        if (was_present && field->type == FIELD_TYPE_STRUCT) {
+            // only changed fields of nested struct
+            size_t header_reserve = s_tlv_max_header_size(flags);
+            size_t sub_bytes_written = 0;
+
+            if (field_buffer_size < header_reserve) {
+                return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+            }
+
+            err = s_tlv_encode_delta_level(
+                field->struct_type_info, (const uint8_t*) prev + field->offset,
+                (const uint8_t*) cur + field->offset, flags,
+                field_buffer + header_reserve,
+                field_buffer_size - header_reserve, &sub_bytes_written);
+
+            if (err == SERIALIZER_OK)
+                err = s_tlv_finish_element(flags, TLV_TAG_NESTED, (int) i,
+                                           (uint32_t) sub_bytes_written, NULL,
+                                           field_buffer, field_buffer_size,
+                                           &field_bytes);
+        } else if (is_array_range) {
+            err = s_tlv_encode_array_range(field, (int) i, cur, first, last,
+                                           flags, field_buffer,
+                                           field_buffer_size, &field_bytes);
+        } else {
+            err = s_tlv_encode_field(field, (int) i, cur, flags, field_buffer,
+                                     field_buffer_size, &field_bytes);
+        }
+
+        if (err != SERIALIZER_OK) {
+            return err;
+        }
+
+        total_bytes += field_bytes;
+    }
+
+    *bytes_written = total_bytes;
+    return SERIALIZER_OK;
+}
+
+s_serializer_error s_tlv_encode_delta(const s_type_info* info,
+                                      const void* prev, const void* cur,
+                                      uint32_t flags, uint8_t* buffer,
+                                      size_t buffer_size,
+                                      size_t* bytes_written) {
+    if (!info || !prev || !cur || !buffer || !bytes_written) {
+        return SERIALIZER_ERROR_INVALID_TYPE;
+    }
+
+    // changed values are sent as is, even if they are zero
+    flags |= TLV_ENCODE_FLAG_FIELD_IDS;
+    flags &= ~TLV_ENCODE_FLAG_OMIT_DEFAULTS;
+
+    size_t prefix_size =
+        (flags & TLV_ENCODE_FLAG_COMPACT) ? TLV_COMPACT_PREFIX_SIZE : 0;
+
+    if (buffer_size < prefix_size) {
+        return SERIALIZER_ERROR_BUFFER_TOO_SMALL;
+    }
+
+    size_t level_bytes_written = 0;
+    s_serializer_error err = s_tlv_encode_delta_level(
+        info, prev, cur, flags, buffer + prefix_size,
+        buffer_size - prefix_size, &level_bytes_written);
+
+    if (err != SERIALIZER_OK) {
+        return err;
+    }
+
+    if (prefix_size) {
+        buffer[0] = TLV_COMPACT_MAGIC;
+        buffer[1] = TLV_COMPACT_VERSION;
+    }
+
+    *bytes_written = prefix_size + level_bytes_written;
+
+    return SERIALIZER_OK;
+}
+
+s_serializer_error s_tlv_decode_element(int idx, int level, bool is_compact,
+                                        uint16_t tag, int field_id,
+                                        uint32_t length, const uint8_t* value,
+                                        s_tlv_element_cb cb, void* user_data) {
     s_tlv_decoded_element_data decoded_el_data = {
         .idx = idx,
         .level = level,
         .type = tag,
         .length = length,
-        .value = tlv_el->value,
+        .value = value,
+        .field_id = field_id,
     };
 
+    if (tag == TLV_TAG_LIST_RANGE || tag == TLV_TAG_NESTED_LIST_RANGE) {
+        uint64_t range_start = 0;
+        size_t prefix_size = s_tlv_varint_decode(value, length, &range_start);
+
+        if (!prefix_size || range_start > UINT32_MAX)
+            return SERIALIZER_ERROR_INVALID_TYPE;
+
+        decoded_el_data.range_start = (uint32_t) range_start;
+        decoded_el_data.value += prefix_size;
+        decoded_el_data.length -= (uint32_t) prefix_size;
+    }
+
     LOG_DEBUG("TLV DECODE %s", s_print_decoded_data(&decoded_el_data));
 
     switch (tag) {
     case TLV_TAG_FIELD:
-    case TLV_TAG_LIST: {
+    case TLV_TAG_LIST:
+    case TLV_TAG_VARINT:
+    case TLV_TAG_LIST_RANGE:
+    case TLV_TAG_NESTED_LIST_EL: {
         cb(&decoded_el_data, user_data);
     } break;
 
-    case TLV_TAG_NESTED_LIST: {
+    case TLV_TAG_NESTED_LIST:
+    case TLV_TAG_NESTED_LIST_RANGE: {
         cb(&decoded_el_data, user_data);
-        s_tlv_decode_level(level + 1, tlv_el->value, length, cb, user_data);
+        s_tlv_decode_level(level + 1, is_compact, decoded_el_data.value,
+                           decoded_el_data.length, cb, user_data);
     } break;
 
     case TLV_TAG_NESTED: {
         cb(&decoded_el_data, user_data);
-        s_tlv_decode_level(level + 1, tlv_el->value, length, cb, user_data);
+        s_tlv_decode_level(level + 1, is_compact, value, length, cb,
+                           user_data);
     } break;
 
     default:
@@ -294,7 +1118,8 @@ s_serializer_error s_tlv_decode_element(int idx, int level,
     return SERIALIZER_OK;
 }
 
-s_serializer_error s_tlv_decode_level(int level, const uint8_t* buffer,
+s_serializer_error s_tlv_decode_level(int level, bool is_compact,
+                                      const uint8_t* buffer,
                                       size_t buffer_size, s_tlv_element_cb cb,
                                       void* user_data) {
 
@@ -307,24 +1132,29 @@ s_serializer_error s_tlv_decode_level(int level, const uint8_t* buffer,
     int idx = 0;
 
     while (remaining_size > 0) {
-        const s_tlv_element* tlv_el = (const s_tlv_element*) tlv_buffer;
-        uint32_t tlv_el_length = ntohl(tlv_el->length);
+        uint16_t tag = 0;
+        int field_id = TLV_NO_FIELD_ID;
+        uint32_t tlv_el_length = 0;
+        size_t header_size =
+            s_tlv_read_header(is_compact, tlv_buffer, remaining_size, &tag,
+                              &field_id, &tlv_el_length);
 
         // sanity check
-        if (remaining_size < TLV_SIZEOF_TL + tlv_el_length) {
+        if (!header_size || remaining_size - header_size < tlv_el_length) {
             return SERIALIZER_ERROR_INVALID_TYPE;
         }
 
-        s_serializer_error err =
-            s_tlv_decode_element(idx, level, tlv_el, cb, user_data);
+        s_serializer_error err = s_tlv_decode_element(
+            idx, level, is_compact, tag, field_id, tlv_el_length,
+            tlv_buffer + header_size, cb, user_data);
 
         // if uknown tag - silently ignore
         if (!(err == SERIALIZER_OK || err == SERIALIZER_ERROR_INVALID_TYPE)) {
             return err;
         }
 
-        tlv_buffer += (TLV_SIZEOF_TL + tlv_el_length);
-        remaining_size -= (TLV_SIZEOF_TL + tlv_el_length);
+        tlv_buffer += (header_size + tlv_el_length);
+        remaining_size -= (header_size + tlv_el_length);
         idx += 1;
     }
 
@@ -333,8 +1163,23 @@ s_serializer_error s_tlv_decode_level(int level, const uint8_t* buffer,
 
 s_serializer_error s_tlv_decode(const uint8_t* buffer, size_t buffer_size,
                                 s_tlv_element_cb cb, void* user_data) {
+    bool is_compact = false;
+
+    // compact streams start with magic prefix, v1 streams -- with high byte
+    // of the tag, which is either zero or (field id + 1) and never the magic
+    if (buffer && buffer_size && buffer[0] == TLV_COMPACT_MAGIC) {
+        if (buffer_size < TLV_COMPACT_PREFIX_SIZE ||
+            buffer[1] != TLV_COMPACT_VERSION) {
+            return SERIALIZER_ERROR_INVALID_TYPE;
+        }
+
+        is_compact = true;
+        buffer += TLV_COMPACT_PREFIX_SIZE;
+        buffer_size -= TLV_COMPACT_PREFIX_SIZE;
+    }
+
     s_serializer_error err =
-        s_tlv_decode_level(0, buffer, buffer_size, cb, user_data);
+        s_tlv_decode_level(0, is_compact, buffer, buffer_size, cb, user_data);
 
     if (err == SERIALIZER_OK) {
         // call final callback to indicate end of decoding
@@ -344,6 +1189,53 @@ s_serializer_error s_tlv_decode(const uint8_t* buffer, size_t buffer_size,
     return err;
 }
 
+size_t s_tlv_varint_encode(uint64_t value, uint8_t* out) {
+    size_t n = 0;
+
+    while (value >= 0x80) {
+        out[n++] = (uint8_t) (value | 0x80);
+        value >>= 7;
+    }
+    out[n++] = (uint8_t) value;
+
+    return n;
+}
+
+size_t s_tlv_varint_decode(const uint8_t* buffer, size_t buffer_size,
+                           uint64_t* value) {
+    uint64_t result = 0;
+
+    for (size_t i = 0; i < buffer_size && i < TLV_VARINT_MAX_SIZE; i++) {
+        // last byte holds only the 64th bit
+        if (i == TLV_VARINT_MAX_SIZE - 1 && buffer[i] > 1)
+            return 0;
+
+        result |= (uint64_t) (buffer[i] & 0x7F) << (7 * i);
+
+        if (!(buffer[i] & 0x80)) {
+            *value = result;
+            return i + 1;
+        }
+    }
+
+    return 0;
+}
+
+bool s_tlv_bit_string_count(const uint8_t* value, uint32_t length,
+                            uint32_t* count) {
+    if (!length) {
+        *count = 0;
+        return true;
+    }
+
+    // last byte holds at least one bit
+    if (length < 2 || value[0] > 7 || length - 1 > UINT32_MAX / 8)
+        return false;
+
+    *count = (length - 1) * 8 - value[0];
+    return true;
+}
+
 // helpers
 #define MAX_BYTE_DUMP (32)
 #define MAX(a, b) ((a) > (b) ? (a) : (b))
@@ -397,7 +1289,9 @@ const char* s_print_decoded_data(s_tlv_decoded_element_data* el) {
         "NESTED",           "LIST",
         "NESTED_LIST",      "COMPRESSED_VALUE",
         "ENCRYPTED_VALUE",  "COMPRESSED_NESTED",
-        "ENCRYPTED_NESTED",
+        "ENCRYPTED_NESTED", "VARINT",
+        "LIST_RANGE",       "NESTED_LIST_RANGE",
+        "NESTED_LIST_EL",
     };
     const char* type_label = "UNKNOWN";
 
@@ -41,6 +41,38 @@ S_FIELD_TAGGED_INT(data.name, ENUM_VALUE_4)
 S_UNION_END()
 S_SERIALIZE_END()
 
+S_SERIALIZE_BEGIN(wide_union_struct)
+S_FIELD_INT32(kind)
+S_UNION_BEGIN_TAG(value, kind)
+S_FIELD_INT8(value.i8)
+S_FIELD_TAGGED_INT(value.i8, 1)
+S_FIELD_INT16(value.i16)
+S_FIELD_TAGGED_INT(value.i16, 2)
+S_FIELD_INT32(value.i32)
+S_FIELD_TAGGED_INT(value.i32, 3)
+S_FIELD_INT64(value.i64)
+S_FIELD_TAGGED_INT(value.i64, 4)
+S_FIELD_FLOAT(value.f32)
+S_FIELD_TAGGED_INT(value.f32, 6)
+S_FIELD_DOUBLE(value.f64)
+S_FIELD_TAGGED_INT(value.f64, 7)
+S_FIELD_STRING_FIXED(value.str)
+S_FIELD_TAGGED_INT(value.str, 8)
+S_UNION_END()
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(string_union_struct)
+S_FIELD_STRING_FIXED(kind)
+S_UNION_BEGIN_TAG(value, kind)
+S_FIELD_INT32(value.count)
+S_FIELD_TAGGED_STRING(value.count, "count")
+S_FIELD_DOUBLE(value.ratio)
+S_FIELD_TAGGED_STRING(value.ratio, "ratio")
+S_FIELD_STRING_FIXED(value.label)
+S_FIELD_TAGGED_STRING(value.label, "label")
+S_UNION_END()
+S_SERIALIZE_END()
+
 S_SERIALIZE_BEGIN(builtin_arrays_struct)
 S_FIELD_INT32(n_static_ints)
 S_FIELD_ARRAY_STATIC(static_ints, n_static_ints, "StaticInts")
@@ -83,6 +115,38 @@ S_FIELD_ARRAY_STATIC(ints_, nInts_)
 S_FIELD_ARRAY_DYNAMIC(ints2_, nInts2_)
 S_SERIALIZE_END()
 
+S_SERIALIZE_BEGIN(counters_struct)
+S_FIELD_INT16(i16)
+S_FIELD_UINT16(u16)
+S_FIELD_INT32(i32)
+S_FIELD_UINT32(u32)
+S_FIELD_INT64(i64)
+S_FIELD_UINT64(u64)
+S_FIELD_UINT8(u8)
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(byte_arrays_struct)
+S_FIELD_INT32(n_static_bytes)
+S_FIELD_ARRAY_STATIC(static_bytes, n_static_bytes, "StaticBytes")
+S_FIELD_UINT32(n_dynamic_bytes)
+S_FIELD_ARRAY_DYNAMIC(dynamic_bytes, n_dynamic_bytes, "DynamicBytes")
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(concurrent_init_struct)
+S_FIELD_INT32(id)
+S_FIELD_STRUCT(nested, nested_struct)
+S_FIELD_INT32(n_values)
+S_FIELD_ARRAY_STATIC(values, n_values)
+S_SERIALIZE_END()
+
+S_SERIALIZE_CODEC(codec_point, CODEC_POINT_FIELDS)
+
+S_SERIALIZE_CODEC(codec_record, CODEC_RECORD_FIELDS)
+
+S_SERIALIZE_BEGIN(codec_record_generic)
+CODEC_RECORD_FIELDS(S_CODEC_FIELD_INFO)
+S_SERIALIZE_END()
+
 S_SERIALIZE_BEGIN(sss_generic_value)
 S_FIELD_ENUM(type_, "type")
 S_UNION_BEGIN_TAG(as_, type_)
@@ -118,4 +182,68 @@ S_FIELD_STRUCT(as_.blob_data_, sss_blob_data, "data")
 S_FIELD_TAGGED_INT(as_.blob_data_, SSS_MSG_TYPE_BLOB)
 S_UNION_END()
 S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(sss_dict_entry)
+S_FIELD_STRING_FIXED(key_, "key")
+S_FIELD_STRUCT(value_, sss_generic_value, "value")
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(sss_name_entry)
+S_FIELD_INT64(id_, "id")
+S_FIELD_STRING(name_, "name")
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(sss_map_message)
+S_FIELD_INT32(seq_no_, "seqNo")
+S_FIELD_MAP(dict_, sss_dict_entry, "dict")
+S_FIELD_MAP(names_, sss_name_entry, "names")
+S_FIELD_SET_MAP_HASHED(names_)
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(feature_flags_struct)
+S_FIELD_INT32(id)
+S_BOOL_PACK_BEGIN()
+S_FIELD_BOOL(enabled)
+S_FIELD_BOOL(visible)
+S_FIELD_BOOL(locked)
+S_FIELD_BOOL(archived)
+S_FIELD_BOOL(shared)
+S_FIELD_BOOL(pinned)
+S_FIELD_BOOL(muted, "Muted")
+S_FIELD_BOOL(starred)
+S_FIELD_BOOL(synced)
+S_FIELD_BOOL(trusted)
+S_BOOL_PACK_END()
+S_FIELD_INT32(level)
+S_FIELD_BOOL(dark_mode)
+S_FIELD_BOOL(legacy)
+S_FIELD_SET_BOOL_PACKED(dark_mode)
+S_FIELD_INT32(n_flags)
+S_FIELD_ARRAY_STATIC(flags, n_flags, "Flags")
+S_BUILTIN_ARRAY_FIELD_SET_TYPE(flags, S_ARRAY_BUILTIN_TYPE_BITS)
+S_FIELD_UINT32(n_dynamic_flags)
+S_FIELD_ARRAY_DYNAMIC(dynamic_flags, n_dynamic_flags)
+S_BUILTIN_ARRAY_FIELD_SET_TYPE(dynamic_flags, S_ARRAY_BUILTIN_TYPE_BITS)
+S_SERIALIZE_END()
+
+S_SERIALIZE_BEGIN(telemetry_struct)
+S_FIELD_INT32(id)
+S_FIELD_FLOAT(temperature)
+S_FIELD_DOUBLE(altitude)
+S_FIELD_FLOAT(pressure)
+S_FIELD_DOUBLE(latitude, "lat")
+S_FIELD_FLOAT(raw)
+S_FIELD_SET_HALF(temperature)
+S_FIELD_SET_HALF(altitude)
+S_FIELD_SET_FIXED16(pressure, 10)
+S_FIELD_SET_FIXED32(latitude, 1e6)
+S_FIELD_INT32(n_samples)
+S_FIELD_ARRAY_STATIC(samples, n_samples)
+S_BUILTIN_ARRAY_FIELD_SET_FLOAT(samples)
+S_FIELD_SET_HALF(samples)
+S_FIELD_UINT32(n_levels)
+S_FIELD_ARRAY_DYNAMIC(levels, n_levels)
+S_BUILTIN_ARRAY_FIELD_SET_FLOAT(levels)
+S_FIELD_SET_FIXED16(levels, 100)
+S_SERIALIZE_END()
 // ---
\ No newline at end of file
@@ -8,6 +8,7 @@
 #ifndef __COMMON_H__
 #define __COMMON_H__
 
+#include <sss/codec.h>
 #include <sss/sss.h>
 
 // system includes
@@ -56,6 +57,31 @@ typedef struct {
 } nested_union_struct;
 S_DEFINE_TYPE_INFO(nested_union_struct);
 
+// unions resolved by tag tables: int tags and string tags
+typedef struct {
+    int32_t kind;
+    union {
+        int8_t i8;
+        int16_t i16;
+        int32_t i32;
+        int64_t i64;
+        float f32;
+        double f64;
+        char str[16];
+    } value;
+} wide_union_struct;
+S_DEFINE_TYPE_INFO(wide_union_struct);
+
+typedef struct {
+    char kind[16];
+    union {
+        int32_t count;
+        double ratio;
+        char label[16];
+    } value;
+} string_union_struct;
+S_DEFINE_TYPE_INFO(string_union_struct);
+
 // struct with builtin arrays
 typedef struct {
     int32_t n_static_ints;
@@ -105,6 +131,79 @@ typedef struct {
 } TestStruct3;
 S_DEFINE_TYPE_INFO(TestStruct3);
 
+// struct with integer counters
+typedef struct {
+    int16_t i16;
+    uint16_t u16;
+    int32_t i32;
+    uint32_t u32;
+    int64_t i64;
+    uint64_t u64;
+    uint8_t u8;
+} counters_struct;
+S_DEFINE_TYPE_INFO(counters_struct);
+
+// struct with byte arrays
+typedef struct {
+    int32_t n_static_bytes;
+    int8_t static_bytes[64];
+    uint32_t n_dynamic_bytes;
+    int8_t* dynamic_bytes;
+} byte_arrays_struct;
+S_DEFINE_TYPE_INFO(byte_arrays_struct);
+
+// only used for concurrent type info initialization
+typedef struct {
+    int32_t id;
+    nested_struct nested;
+    double values[4];
+    int32_t n_values;
+} concurrent_init_struct;
+S_DEFINE_TYPE_INFO(concurrent_init_struct);
+
+// structs with per-type codecs
+typedef struct {
+    int32_t x;
+    double y;
+    bool is_set;
+    char label[16];
+} codec_point;
+
+#define CODEC_POINT_FIELDS(X) \
+    X(INT32, x)               \
+    X(DOUBLE, y)              \
+    X(BOOL, is_set, "IsSet")  \
+    X(STRING_FIXED, label)
+S_DEFINE_CODEC(codec_point);
+
+typedef struct {
+    uint64_t id;
+    char* name;
+    const char* kind;
+    codec_point origin;
+    int32_t n_samples;
+    float samples[8];
+    uint16_t n_bytes;
+    uint8_t* bytes;
+    int8_t level;
+} codec_record;
+
+#define CODEC_RECORD_FIELDS(X)            \
+    X(UINT64, id, "Id")                   \
+    X(STRING, name)                       \
+    X(STRING_CONST, kind)                 \
+    X(STRUCT, origin, codec_point)        \
+    X(INT32, n_samples)                   \
+    X(ARRAY_STATIC, samples, n_samples)   \
+    X(UINT16, n_bytes)                    \
+    X(ARRAY_DYNAMIC, bytes, n_bytes)      \
+    X(INT8, level)
+S_DEFINE_CODEC(codec_record);
+
+// same fields without codec, for comparison
+typedef codec_record codec_record_generic;
+S_DEFINE_TYPE_INFO(codec_record_generic);
+
 // sample generic "message" struct
 enum sss_message_type {
     SSS_MSG_TYPE_CUSTOM_DICT = 0,
@@ -157,4 +256,56 @@ typedef struct {
 } sss_system_message;
 S_DEFINE_TYPE_INFO(sss_system_message);
 
+// native maps: the dictionary above keyed by string, and one keyed by integer
+typedef struct {
+    char key_[32];
+    sss_generic_value value_;
+} sss_dict_entry;
+S_DEFINE_TYPE_INFO(sss_dict_entry);
+
+typedef struct {
+    int64_t id_;
+    char* name_;
+} sss_name_entry;
+S_DEFINE_TYPE_INFO(sss_name_entry);
+
+typedef struct {
+    int seq_no_;
+    s_map dict_;  // sorted
+    s_map names_; // hashed
+} sss_map_message;
+S_DEFINE_TYPE_INFO(sss_map_message);
+
+// bools packed into bitmaps: a run of ten, a run of one and a plain bool, and
+// bool arrays sent as bit strings
+typedef struct {
+    int32_t id;
+    bool enabled, visible, locked, archived, shared;
+    bool pinned, muted, starred, synced, trusted;
+    int32_t level;
+    bool dark_mode; // packed alone
+    bool legacy;    // not packed
+    int32_t n_flags;
+    bool flags[64];
+    uint32_t n_dynamic_flags;
+    bool* dynamic_flags;
+} feature_flags_struct;
+S_DEFINE_TYPE_INFO(feature_flags_struct);
+
+// floats quantized on the wire: half precision, 16- and 32-bit fixed point,
+// static and dynamic float arrays, and a float sent in full
+typedef struct {
+    int32_t id;
+    float temperature; // half
+    double altitude;   // half
+    float pressure;    // fixed point, 0.1
+    double latitude;   // fixed point, 1e-6
+    float raw;
+    int32_t n_samples;
+    float samples[40]; // half
+    uint32_t n_levels;
+    double* levels; // fixed point, 0.01
+} telemetry_struct;
+S_DEFINE_TYPE_INFO(telemetry_struct);
+
 #endif
\ No newline at end of file
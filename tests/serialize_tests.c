@@ -6,18 +6,96 @@
  */
 
 #include "common.h"
+#if defined(SSS_TESTS_GENERATED)
+#include "test_schemas.h"
+#endif
+#include "sss/bits.h"
+#include "sss/json.h"
+#include "sss/number.h"
+#include "sss/quantize.h"
+#include "sss/tlv.h"
 
 // unity
 #include <unity.h>
 
 // system includes
 #include <stdlib.h>
+#if defined(SSS_TESTS_HAVE_THREADS)
+#include <pthread.h>
+#endif
 
 static s_allocator g_default_allocator = {
     .allocate = malloc,
     .deallocate = free,
 };
 
+// allocator that needs its context: counts calls in user_data
+typedef struct {
+    int n_allocated;
+    int n_released;
+} counting_allocator_ctx;
+
+static void* counting_allocate(size_t size, void* user_data) {
+    ((counting_allocator_ctx*) user_data)->n_allocated++;
+    return malloc(size);
+}
+
+static void counting_deallocate(void* ptr, void* user_data) {
+    if (ptr)
+        ((counting_allocator_ctx*) user_data)->n_released++;
+    free(ptr);
+}
+
+static s_allocator g_counting_allocator = {
+    .allocate = counting_allocate,
+    .deallocate = counting_deallocate,
+};
+
+// allocator that keeps track of its blocks in user_data, so that whatever
+// a parsed struct holds can be released at once
+#define TRACKING_ALLOCATOR_MAX_BLOCKS (1024)
+
+typedef struct {
+    void* blocks[TRACKING_ALLOCATOR_MAX_BLOCKS];
+    int n_blocks;
+} tracking_allocator_ctx;
+
+static void* tracking_allocate(size_t size, void* user_data) {
+    tracking_allocator_ctx* ctx = (tracking_allocator_ctx*) user_data;
+
+    if (ctx->n_blocks == TRACKING_ALLOCATOR_MAX_BLOCKS)
+        return NULL;
+
+    void* ptr = malloc(size);
+
+    if (ptr)
+        ctx->blocks[ctx->n_blocks++] = ptr;
+
+    return ptr;
+}
+
+static void tracking_deallocate(void* ptr, void* user_data) {
+    tracking_allocator_ctx* ctx = (tracking_allocator_ctx*) user_data;
+
+    for (int i = 0; ptr && i < ctx->n_blocks; i++)
+        if (ctx->blocks[i] == ptr) {
+            ctx->blocks[i] = ctx->blocks[--ctx->n_blocks];
+            break;
+        }
+
+    free(ptr);
+}
+
+static void tracking_release_all(tracking_allocator_ctx* ctx) {
+    while (ctx->n_blocks)
+        free(ctx->blocks[--ctx->n_blocks]);
+}
+
+static s_allocator g_tracking_allocator = {
+    .allocate = tracking_allocate,
+    .deallocate = tracking_deallocate,
+};
+
 void test_serialize_deserialize_simple_struct() {
     simple_struct ss = {
         .id = 42,
@@ -434,6 +512,7 @@ void test_serialize_deserialize_into_json_string() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
 
         err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
@@ -441,7 +520,7 @@ void test_serialize_deserialize_into_json_string() {
 
         TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
         TEST_ASSERT_EQUAL_STRING(
-            "{\"Id\":42,\"value\":3.140000,\"active\":true,\"name\":\"Hello, "
+            "{\"Id\":42,\"value\":3.14,\"active\":true,\"name\":\"Hello, "
             "World!\",\"PassportNumber\":\"1234567890\",\"Data\":[1,2,3,4,0,0,"
             "0,0,"
             "0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]}",
@@ -479,6 +558,7 @@ void test_serialize_deserialize_into_json_string() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
 
         err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
@@ -486,7 +566,7 @@ void test_serialize_deserialize_into_json_string() {
 
         TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
         TEST_ASSERT_EQUAL_STRING(
-            "{\"id\":1,\"sub\":{\"Id\":42,\"value\":3.140000,\"active\":true,"
+            "{\"id\":1,\"sub\":{\"Id\":42,\"value\":3.14,\"active\":true,"
             "\"name\":\"Hello, World!\",\"PassportNumber\":\"1234567890\","
             "\"Data\":[1,2,3,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0]},\"name\":"
@@ -538,6 +618,7 @@ void test_serialize_deserialize_into_json_string() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
 
         err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(super_nested_struct),
@@ -545,11 +626,11 @@ void test_serialize_deserialize_into_json_string() {
 
         TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
         TEST_ASSERT_EQUAL_STRING(
-            "{\"sub\":{\"id\":1,\"sub\":{\"Id\":42,\"value\":3.140000,"
+            "{\"sub\":{\"id\":1,\"sub\":{\"Id\":42,\"value\":3.14,"
             "\"active\":true,\"name\":\"Hello, World!\",\"PassportNumber\":"
             "\"1234567890\",\"Data\":[1,2,3,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0,0,0,0,0,0,0,0,0,0,0]},\"name\":\"Hello, World2!\"},"
-            "\"id\":123,\"ss\":{\"Id\":42,\"value\":3.140000,\"active\":true,"
+            "\"id\":123,\"ss\":{\"Id\":42,\"value\":3.14,\"active\":true,"
             "\"name\":\"Hello, World!\",\"PassportNumber\":\"1234567890\","
             "\"Data\":[1,2,3,4,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0,0]}}",
@@ -695,6 +776,7 @@ void test_serialize_deserialize_arrays_into_json_string() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
 
         err =
@@ -746,6 +828,7 @@ void test_serialize_deserialize_arrays_into_json_string() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
 
         err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
@@ -753,26 +836,25 @@ void test_serialize_deserialize_arrays_into_json_string() {
 
         TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
         const char* expected_json =
-            "{\"n_static_structs\":2,\"static_structs\":[{\"Id\":1,\"value\":0."
-            "000000,"
+            "{\"n_static_structs\":2,\"static_structs\":[{\"Id\":1,\"value\":0.0,"
             "\"active\":false,\"name\":"
             "\"12345\",\"PassportNumber\":\"\",\"Data\":[0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0,0,0,0,0,0,0,0,0,0,"
-            "0,0,0,0,0,0,0,0]},{\"Id\":2,\"value\":0.000000,\"active\":false,"
+            "0,0,0,0,0,0,0,0]},{\"Id\":2,\"value\":0.0,\"active\":false,"
             "\"name\":"
             "\"1234567890\",\"PassportNumber"
             "\":\"\",\"Data\":[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0,0,0,0,0]}],"
             "\"n_dynamic_structs\":3,\"DynamicStructs\":[{\"Id\":1,\"value\":"
-            "0.000000,\"active\":false,"
+            "0.0,\"active\":false,"
             "\"name\":\"Name\",\"PassportNumber\":\"\",\"Data\":[0,0,0,0,0,0,0,"
             "0,0,0,0,0,0,0,0,0,0,0,0,0,"
-            "0,0,0,0,0,0,0,0,0,0,0,0]},{\"Id\":2,\"value\":0.000000,\"active\":"
+            "0,0,0,0,0,0,0,0,0,0,0,0]},{\"Id\":2,\"value\":0.0,\"active\":"
             "false,"
             "\"name\":\"Name\",\"PassportNumber"
             "\":\"\",\"Data\":[0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,"
             "0,0,0,0,0,0,0,0]},"
-            "{\"Id\":3,\"value\":0.000000,\"active\":false,\"name\":\"Name\","
+            "{\"Id\":3,\"value\":0.0,\"active\":false,\"name\":\"Name\","
             "\"PassportNumber\":\"\",\"Data\":[0,0,0,0,"
             "0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0]}]}";
 
@@ -781,7 +863,7 @@ void test_serialize_deserialize_arrays_into_json_string() {
         //     "{\"n_static_structs\":2,\"static_structs\":[{\"id\":1,\"name\":"
         //     "\"12345"
         //     "\"},{\"id\":2,\"name\":\"1234567890\"}],\"n_dynamic_structs\":3,"
-        //     "\"dynamic_structs\":[{\"Id\":1,\"value\":0.000000,\"active\":"
+        //     "\"dynamic_structs\":[{\"Id\":1,\"value\":0.0,\"active\":"
         //     "false,"
         //     "\"name\":\"Name\",\"PassportNumber\":"
         //     ",\"Data\":[0,0,0,0,0,0,"
@@ -942,6 +1024,7 @@ void test_serialize_deserialize_test_structs() {
             s_deserialize_options dopts = {
                 .format = FORMAT_JSON_STRING,
                 .allocator = &g_default_allocator,
+                .data_size = sizeof(deserialized_json),
             };
 
             err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(TestStruct3),
@@ -1064,15 +1147,17 @@ void test_serialize_deserialize_sample_system_message() {
         s_deserialize_options dopts = {
             .format = FORMAT_JSON_STRING,
             .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
         };
         err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
                             deserialized_json, buffer, bytes_written);
         TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
         TEST_ASSERT_EQUAL_STRING(
-            "{\"type\":0,\"tsUsec\":1234567890.000000,\"seqNo\":42,\"data\":{"
+            "{\"type\":0,\"tsUsec\":1234567890.0,\"seqNo\":42,\"data\":{"
             "\"length\":"
             "3,\"keys\":[\"key1\",\"key2\",\"key3\"],\"values\":[{\"type\":1,"
-            "\"value\":42},{\"type\":2,\"value\":3.140000},{\"type\":3,"
+            "\"value\":42},{\"type\":2,\"value\":3.140000104904175},{"
+            "\"type\":3,"
             "\"value\":\"Hello\"}]}}",
             deserialized_json);
     }
@@ -1094,18 +1179,2942 @@ void test_serialize_deserialize_sample_system_message() {
     }
 }
 
-void setUp() {}
-void tearDown() {}
+// per-field varint option
+typedef counters_struct varint_counters_struct;
+S_SERIALIZE_BEGIN(varint_counters_struct)
+S_FIELD_INT16(i16)
+S_FIELD_UINT16(u16)
+S_FIELD_INT32(i32)
+S_FIELD_UINT32(u32)
+S_FIELD_INT64(i64)
+S_FIELD_UINT64(u64)
+S_FIELD_UINT8(u8)
+S_FIELD_SET_VARINT(i32)
+S_FIELD_SET_VARINT(u8)
+S_SERIALIZE_END()
+
+void test_serialize_deserialize_varints() {
+    counters_struct cs = {
+        .i16 = INT16_MIN,
+        .u16 = 7,
+        .i32 = -123456,
+        .u32 = 0,
+        .i64 = INT64_MIN,
+        .u64 = 1,
+        .u8 = 255,
+    };
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {.use_varints = true};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(counters_struct), &cs, buffer,
+                    sizeof(buffer), &bytes_written);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(7 * 6 + 3 + 1 + 3 + 1 + 10 + 1 + 1, bytes_written);
+
+    { // deserialize to c struct
+        counters_struct deserialized_cs = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            &deserialized_cs, buffer, bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT16(cs.i16, deserialized_cs.i16);
+        TEST_ASSERT_EQUAL_UINT16(cs.u16, deserialized_cs.u16);
+        TEST_ASSERT_EQUAL_INT32(cs.i32, deserialized_cs.i32);
+        TEST_ASSERT_EQUAL_UINT32(cs.u32, deserialized_cs.u32);
+        TEST_ASSERT_EQUAL_INT64(cs.i64, deserialized_cs.i64);
+        TEST_ASSERT_EQUAL_UINT64(cs.u64, deserialized_cs.u64);
+        TEST_ASSERT_EQUAL_UINT8(cs.u8, deserialized_cs.u8);
+    }
+
+    { // varints that don't fit the field or the element are refused
+        counters_struct deserialized_cs = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        uint8_t broken[1024];
+        // i16 is the first element, i64 the fifth one
+        size_t i16_offset = 6, i64_offset = 9 + 7 + 9 + 7 + 6;
+
+        // 70000 into int16
+        memcpy(broken, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(3, s_tlv_varint_encode(S_ZIGZAG_ENCODE(70000),
+                                                 broken + i16_offset));
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            &deserialized_cs, broken, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+
+        // bytes after varint
+        memcpy(broken, buffer, bytes_written);
+        broken[i16_offset] = 0x01;
+        broken[i16_offset + 1] = 0x00;
+        broken[i16_offset + 2] = 0x00;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            &deserialized_cs, broken, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+
+        // 10th byte carries bits past 64
+        memcpy(broken, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(0x01, broken[i64_offset + 9]);
+        broken[i64_offset + 9] = 0x03;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            &deserialized_cs, broken, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+    }
+
+    { // deserialize to json
+        char deserialized_json[1024] = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_JSON_STRING,
+            .allocator = &g_default_allocator,
+            .data_size = sizeof(deserialized_json),
+        };
+
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            deserialized_json, buffer, bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        // 64-bit values are checked in c struct test above
+        const char* expected_json =
+            "{\"i16\":-32768,\"u16\":7,\"i32\":-123456,\"u32\":0,";
+        TEST_ASSERT_EQUAL_MEMORY(expected_json, deserialized_json,
+                                 strlen(expected_json));
+    }
+
+    { // per-field option, no per-message option
+        s_serialize_options opts = {0};
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(varint_counters_struct),
+                          &cs, buffer, sizeof(buffer), &bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(7 * 6 + 2 + 2 + 3 + 4 + 8 + 8 + 2, bytes_written);
+
+        varint_counters_struct deserialized_cs = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+
+        err = s_deserialize(dopts,
+                            S_GET_STRUCT_TYPE_INFO(varint_counters_struct),
+                            &deserialized_cs, buffer, bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT16(cs.i16, deserialized_cs.i16);
+        TEST_ASSERT_EQUAL_UINT16(cs.u16, deserialized_cs.u16);
+        TEST_ASSERT_EQUAL_INT32(cs.i32, deserialized_cs.i32);
+        TEST_ASSERT_EQUAL_UINT32(cs.u32, deserialized_cs.u32);
+        TEST_ASSERT_EQUAL_INT64(cs.i64, deserialized_cs.i64);
+        TEST_ASSERT_EQUAL_UINT64(cs.u64, deserialized_cs.u64);
+        TEST_ASSERT_EQUAL_UINT8(cs.u8, deserialized_cs.u8);
+    }
+}
+
+void test_serialize_deserialize_compact_format() {
+    sss_system_message ssm = {
+        .type_ = SSS_MSG_TYPE_CUSTOM_DICT,
+        .timestamp_usec_ = 1234567890,
+        .seq_no_ = 42,
+        .as_.custom_dict_data_ = {
+            .n_entries_ = 2,
+            .keys_ = {"key1", "key2"},
+            .values_ = {
+                {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 42},
+                {.type_ = SSS_GENERIC_VALUE_TYPE_STRING,
+                 .as_.string_ = "Hello"},
+            }}};
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm,
+                    buffer, sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    size_t v1_bytes_written = bytes_written;
+    char v1_json[1024] = {0};
+    s_deserialize_options json_dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(v1_json),
+    };
+    err = s_deserialize(json_dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                        v1_json, buffer, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    opts.use_compact_format = true;
+    opts.use_varints = true;
+    err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm,
+                      buffer, sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_LESS_THAN(v1_bytes_written / 2, bytes_written);
+
+    { // deserialize to c struct
+        sss_system_message deserialized_ssm = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            &deserialized_ssm, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(SSS_MSG_TYPE_CUSTOM_DICT, deserialized_ssm.type_);
+        TEST_ASSERT_EQUAL_INT(42, deserialized_ssm.seq_no_);
+        TEST_ASSERT_EQUAL_INT(
+            2, deserialized_ssm.as_.custom_dict_data_.n_entries_);
+        TEST_ASSERT_EQUAL_STRING(
+            "key2", deserialized_ssm.as_.custom_dict_data_.keys_[1]);
+        TEST_ASSERT_EQUAL_INT(
+            42, deserialized_ssm.as_.custom_dict_data_.values_[0].as_.int_);
+        TEST_ASSERT_EQUAL_STRING(
+            "Hello",
+            deserialized_ssm.as_.custom_dict_data_.values_[1].as_.string_);
+    }
+
+    { // json output does not depend on wire format
+        char deserialized_json[1024] = {0};
+        err = s_deserialize(json_dopts,
+                            S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            deserialized_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(v1_json, deserialized_json);
+    }
+}
+
+void test_serialize_deserialize_omit_defaults() {
+    sss_system_message ssm = {
+        .type_ = SSS_MSG_TYPE_CUSTOM_DICT,
+        .timestamp_usec_ = 0,
+        .seq_no_ = 7,
+        .as_.custom_dict_data_ = {
+            .n_entries_ = 3,
+            .keys_ = {"key1", "", "key3"},
+            .values_ = {
+                {.type_ = SSS_GENERIC_VALUE_TYPE_NONE},
+                {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 0},
+                {.type_ = SSS_GENERIC_VALUE_TYPE_STRING, .as_.string_ = "Hi"},
+            }}};
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm,
+                    buffer, sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    size_t full_bytes_written = bytes_written;
+    char full_json[1024] = {0};
+    s_deserialize_options json_dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(full_json),
+    };
+    err = s_deserialize(json_dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                        full_json, buffer, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    opts.omit_defaults = true;
+    err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm,
+                      buffer, sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_LESS_THAN(full_bytes_written, bytes_written);
+
+    { // omitted fields overwrite previous values
+        sss_system_message deserialized_ssm;
+        memset(&deserialized_ssm, 0xFF, sizeof(deserialized_ssm));
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            &deserialized_ssm, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(SSS_MSG_TYPE_CUSTOM_DICT, deserialized_ssm.type_);
+        TEST_ASSERT_EQUAL_FLOAT(0, deserialized_ssm.timestamp_usec_);
+        TEST_ASSERT_EQUAL_INT(7, deserialized_ssm.seq_no_);
+
+        sss_custom_dict_data* dict = &deserialized_ssm.as_.custom_dict_data_;
+        TEST_ASSERT_EQUAL_INT(3, dict->n_entries_);
+        TEST_ASSERT_EQUAL_STRING("key1", dict->keys_[0]);
+        TEST_ASSERT_EQUAL_STRING("", dict->keys_[1]);
+        TEST_ASSERT_EQUAL_STRING("key3", dict->keys_[2]);
+        TEST_ASSERT_EQUAL_INT(SSS_GENERIC_VALUE_TYPE_NONE,
+                              dict->values_[0].type_);
+        TEST_ASSERT_EQUAL_INT(SSS_GENERIC_VALUE_TYPE_INT32,
+                              dict->values_[1].type_);
+        TEST_ASSERT_EQUAL_INT(0, dict->values_[1].as_.int_);
+        TEST_ASSERT_EQUAL_INT(SSS_GENERIC_VALUE_TYPE_STRING,
+                              dict->values_[2].type_);
+        TEST_ASSERT_EQUAL_STRING("Hi", dict->values_[2].as_.string_);
+    }
+
+    { // json holds all fields in declaration order, as for full message
+        char deserialized_json[1024] = {0};
+        err = s_deserialize(json_dopts,
+                            S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            deserialized_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(full_json, deserialized_json);
+    }
+
+    { // structs of struct arrays keep their places when all fields after
+      // the first are omitted
+        simple_struct dynamic_structs[] = {{.value = 1.5f}, {.id = 3}};
+        struct_arrays_struct sas = {
+            .n_static_structs = 2,
+            .static_structs = {{.id = 1}, {.value = 2.5f}},
+            .n_dynamic_structs = 2,
+            .dynamic_structs = dynamic_structs,
+        };
+        s_serialize_options array_opts = {0};
+        char array_full_json[2048] = {0};
+        s_deserialize_options array_json_dopts = json_dopts;
+
+        array_json_dopts.data_size = sizeof(array_full_json);
+        err = s_serialize(array_opts,
+                          S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &sas,
+                          buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(array_json_dopts,
+                            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                            array_full_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        array_opts.omit_defaults = true;
+
+        // v1, then compact format
+        for (int i = 0; i < 2; i++) {
+            struct_arrays_struct deserialized_sas = {0};
+            char deserialized_json[2048] = {0};
+            s_deserialize_options dopts = {
+                .format = FORMAT_C_STRUCT,
+                .allocator = &g_default_allocator,
+            };
+
+            array_opts.use_compact_format = i == 1;
+            err = s_serialize(array_opts,
+                              S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                              &sas, buffer, sizeof(buffer), &bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            err = s_deserialize(dopts,
+                                S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                                &deserialized_sas, buffer, bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_EQUAL_INT(2, deserialized_sas.n_static_structs);
+            TEST_ASSERT_EQUAL_INT(1, deserialized_sas.static_structs[0].id);
+            TEST_ASSERT_EQUAL_FLOAT(0, deserialized_sas.static_structs[0].value);
+            TEST_ASSERT_EQUAL_INT(0, deserialized_sas.static_structs[1].id);
+            TEST_ASSERT_EQUAL_FLOAT(2.5f,
+                                    deserialized_sas.static_structs[1].value);
+            TEST_ASSERT_EQUAL_INT(2, deserialized_sas.n_dynamic_structs);
+            TEST_ASSERT_EQUAL_INT(0, deserialized_sas.dynamic_structs[0].id);
+            TEST_ASSERT_EQUAL_FLOAT(1.5f,
+                                    deserialized_sas.dynamic_structs[0].value);
+            TEST_ASSERT_EQUAL_INT(3, deserialized_sas.dynamic_structs[1].id);
+            TEST_ASSERT_EQUAL_FLOAT(0,
+                                    deserialized_sas.dynamic_structs[1].value);
+            free(deserialized_sas.dynamic_structs);
+
+            err = s_deserialize(array_json_dopts,
+                                S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                                deserialized_json, buffer, bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_EQUAL_STRING(array_full_json, deserialized_json);
+        }
+    }
+
+    { // struct arrays in compact format
+        struct_arrays_struct sas = {
+            .n_static_structs = 2,
+            .static_structs = {{.id = 1}, {0}},
+            .n_dynamic_structs = 0,
+            .dynamic_structs = NULL,
+        };
+        struct_arrays_struct deserialized_sas;
+        memset(&deserialized_sas, 0xFF, sizeof(deserialized_sas));
+
+        opts.use_compact_format = true;
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                          &sas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                            &deserialized_sas, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(2, deserialized_sas.n_static_structs);
+        TEST_ASSERT_EQUAL_INT(1, deserialized_sas.static_structs[0].id);
+        TEST_ASSERT_NULL(deserialized_sas.static_structs[0].name);
+        TEST_ASSERT_EQUAL_INT(0, deserialized_sas.static_structs[1].id);
+        TEST_ASSERT_FALSE(deserialized_sas.static_structs[1].active);
+        TEST_ASSERT_NULL(deserialized_sas.static_structs[1].passport_number);
+        TEST_ASSERT_EQUAL_INT(0, deserialized_sas.static_structs[1].blob[31]);
+        TEST_ASSERT_EQUAL_INT(0, deserialized_sas.n_dynamic_structs);
+        TEST_ASSERT_NULL(deserialized_sas.dynamic_structs);
+
+        char deserialized_json[2048] = {0};
+        err = s_deserialize(json_dopts,
+                            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                            deserialized_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_NOT_NULL(
+            strstr(deserialized_json, "\"DynamicStructs\":[]}"));
+    }
+}
+
+// older version of nested_struct schema, knows only first field
+typedef nested_struct nested_struct_v0;
+S_SERIALIZE_BEGIN(nested_struct_v0)
+S_FIELD_ENUM(id)
+S_SERIALIZE_END()
+
+void test_serialize_deserialize_field_ids() {
+    nested_struct ns = {
+        .id = ENUM_VALUE_3,
+        .sub =
+            {
+                .id = 42,
+                .value = 3.14f,
+                .name = "Hello, World!",
+            },
+        .name = "Hello, World2!",
+    };
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(nested_struct), &ns, buffer,
+                    sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    char v1_json[1024] = {0};
+    s_deserialize_options json_dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(v1_json),
+    };
+    err = s_deserialize(json_dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                        v1_json, buffer, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    opts.use_field_ids = true;
+    err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(nested_struct), &ns, buffer,
+                      sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    { // same json as without field ids
+        char deserialized_json[1024] = {0};
+        err = s_deserialize(json_dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                            deserialized_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(v1_json, deserialized_json);
+    }
+
+    { // fields of a struct may come in any order
+        uint8_t reversed[1024];
+        size_t offset = 0;
+
+        // v1 header: 2-byte tag, 4-byte length in network byte order
+        while (offset < bytes_written) {
+            uint32_t length = (uint32_t) buffer[offset + 2] << 24 |
+                              (uint32_t) buffer[offset + 3] << 16 |
+                              (uint32_t) buffer[offset + 4] << 8 |
+                              (uint32_t) buffer[offset + 5];
+            size_t el_size = 6 + length;
+
+            memcpy(reversed + bytes_written - offset - el_size,
+                   buffer + offset, el_size);
+            offset += el_size;
+        }
+
+        nested_struct deserialized_ns = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                            &deserialized_ns, reversed, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(ENUM_VALUE_3, deserialized_ns.id);
+        TEST_ASSERT_EQUAL_INT(42, deserialized_ns.sub.id);
+        TEST_ASSERT_EQUAL_FLOAT(3.14f, deserialized_ns.sub.value);
+        TEST_ASSERT_EQUAL_STRING("Hello, World!", deserialized_ns.sub.name);
+        TEST_ASSERT_EQUAL_STRING("Hello, World2!", deserialized_ns.name);
+        free((char*) deserialized_ns.sub.name);
+        free((char*) deserialized_ns.name);
+    }
+
+    { // older schema skips unknown fields with their nested elements
+        char deserialized_json[1024] = {0};
+        err = s_deserialize(json_dopts, S_GET_STRUCT_TYPE_INFO(nested_struct_v0),
+                            deserialized_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING("{\"id\":2}", deserialized_json);
+
+        // without field ids old schema can't tell fields apart
+        opts.use_field_ids = false;
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(nested_struct), &ns,
+                          buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        nested_struct deserialized_ns = {0};
+        s_deserialize_options dopts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(nested_struct_v0),
+                            &deserialized_ns, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+    }
+}
+
+void test_serialize_deserialize_delta() {
+    sss_system_message prev = {
+        .type_ = SSS_MSG_TYPE_CUSTOM_DICT,
+        .timestamp_usec_ = 1000,
+        .seq_no_ = 1,
+        .as_.custom_dict_data_ = {
+            .n_entries_ = 3,
+            .keys_ = {"key1", "key2", "key3"},
+            .values_ = {
+                {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 42},
+                {.type_ = SSS_GENERIC_VALUE_TYPE_DOUBLE, .as_.double_ = 3.14},
+                {.type_ = SSS_GENERIC_VALUE_TYPE_STRING,
+                 .as_.string_ = "Hello"},
+            }}};
+    sss_system_message cur = prev;
+    cur.timestamp_usec_ = 2000;
+    cur.seq_no_ = 2;
+    cur.as_.custom_dict_data_.values_[1].as_.double_ = 0;
+    cur.as_.custom_dict_data_.values_[2].type_ = SSS_GENERIC_VALUE_TYPE_INT32;
+    cur.as_.custom_dict_data_.values_[2].as_.int_ = 7;
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message), &cur,
+                    buffer, sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    size_t full_bytes_written = bytes_written;
+
+    err = s_serialize_delta(opts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            &prev, &cur, buffer, sizeof(buffer),
+                            &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_LESS_THAN(full_bytes_written, bytes_written);
+
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_default_allocator,
+    };
+
+    { // apply delta to previous message
+        sss_system_message applied = prev;
+        err = s_apply_delta(dopts, S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_DOUBLE(2000, applied.timestamp_usec_);
+        TEST_ASSERT_EQUAL_INT(2, applied.seq_no_);
+
+        sss_custom_dict_data* dict = &applied.as_.custom_dict_data_;
+        TEST_ASSERT_EQUAL_INT(3, dict->n_entries_);
+        TEST_ASSERT_EQUAL_STRING("key3", dict->keys_[2]);
+        TEST_ASSERT_EQUAL_INT(42, dict->values_[0].as_.int_);
+        TEST_ASSERT_EQUAL_DOUBLE(0, dict->values_[1].as_.double_);
+        TEST_ASSERT_EQUAL_INT(SSS_GENERIC_VALUE_TYPE_INT32,
+                              dict->values_[2].type_);
+        TEST_ASSERT_EQUAL_INT(7, dict->values_[2].as_.int_);
+    }
+
+    { // no changes -- empty delta
+        err = s_serialize_delta(opts,
+                                S_GET_STRUCT_TYPE_INFO(sss_system_message),
+                                &cur, &cur, buffer, sizeof(buffer),
+                                &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(0, bytes_written);
+    }
+
+    { // arrays: changed range of the same size, reallocated on resize
+        int32_t prev_ints[] = {1, 2, 3, 4, 5, 6, 7, 8};
+        int32_t cur_ints[] = {1, 2, 3, 40, 50, 6, 7, 8};
+        builtin_arrays_struct bas = {
+            .n_static_ints = 4,
+            .static_ints = {1, 2, 3, 4},
+            .n_dynamic_ints = 8,
+            .dynamic_ints = prev_ints,
+        };
+
+        // previous state owns its memory
+        builtin_arrays_struct applied = {0};
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                          &bas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        builtin_arrays_struct cur_bas = bas;
+        cur_bas.dynamic_ints = cur_ints;
+        cur_bas.n_static_ints = 5;
+        cur_bas.static_ints[4] = 9;
+
+        opts.use_compact_format = true;
+        err = s_serialize_delta(
+            opts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct), &bas,
+            &cur_bas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        // prefix, size and static array, then a range of two dynamic ints
+        // (header, first index, values)
+        TEST_ASSERT_EQUAL(2 + 7 + 23 + (3 + 1 + 8), bytes_written);
+
+        err = s_apply_delta(dopts,
+                            S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(5, applied.n_static_ints);
+        TEST_ASSERT_EQUAL_INT_ARRAY(cur_bas.static_ints, applied.static_ints,
+                                    5);
+        TEST_ASSERT_EQUAL_INT(8, applied.n_dynamic_ints);
+        TEST_ASSERT_EQUAL_INT_ARRAY(cur_ints, applied.dynamic_ints, 8);
+
+        cur_bas.n_dynamic_ints = 2;
+        err = s_serialize_delta(
+            opts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct), &applied,
+            &cur_bas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_apply_delta(dopts,
+                            S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(2, applied.n_dynamic_ints);
+        TEST_ASSERT_EQUAL_INT_ARRAY(cur_ints, applied.dynamic_ints, 2);
+        free(applied.dynamic_ints);
+    }
+
+    { // struct arrays and strings
+        simple_struct prev_structs[] = {
+            {.id = 1, .name = "one"},
+            {.id = 2, .name = "two"},
+            {.id = 3, .name = "three"},
+        };
+        struct_arrays_struct sas = {
+            .n_static_structs = 2,
+            .static_structs = {{.id = 1}, {.id = 2}},
+            .n_dynamic_structs = 3,
+            .dynamic_structs = prev_structs,
+        };
+        struct_arrays_struct applied = {0};
+
+        opts.use_compact_format = false;
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                          &sas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        simple_struct cur_structs[] = {
+            {.id = 1, .name = "one"},
+            {.id = 2, .name = "TWO", .active = true},
+            {.id = 3, .name = "three"},
+        };
+        struct_arrays_struct cur_sas = sas;
+        cur_sas.dynamic_structs = cur_structs;
+
+        err = s_serialize_delta(
+            opts, S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &applied,
+            &cur_sas, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_apply_delta(dopts,
+                            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(3, applied.n_dynamic_structs);
+        TEST_ASSERT_EQUAL_STRING("one", applied.dynamic_structs[0].name);
+        TEST_ASSERT_EQUAL_STRING("TWO", applied.dynamic_structs[1].name);
+        TEST_ASSERT_TRUE(applied.dynamic_structs[1].active);
+        TEST_ASSERT_EQUAL_INT(3, applied.dynamic_structs[2].id);
+        TEST_ASSERT_EQUAL_STRING("three", applied.dynamic_structs[2].name);
+        TEST_ASSERT_EQUAL_INT(2, applied.static_structs[1].id);
+
+        for (int32_t i = 0; i < applied.n_static_structs; i++) {
+            free((char*) applied.static_structs[i].name);
+            free(applied.static_structs[i].passport_number);
+        }
+        for (int32_t i = 0; i < applied.n_dynamic_structs; i++) {
+            free((char*) applied.dynamic_structs[i].name);
+            free(applied.dynamic_structs[i].passport_number);
+        }
+        free(applied.dynamic_structs);
+    }
+
+    { // union switched between scalar and pointer members
+        nested_union_struct nus = {.id = ENUM_VALUE_3, .data.value = 0x12345};
+        nested_union_struct applied = {0};
+
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                          &nus, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        // scalar bytes must not be taken for the string pointer
+        nested_union_struct cur_nus = {.id = ENUM_VALUE_2,
+                                       .data.str.str = "hello"};
+        err = s_serialize_delta(
+            opts, S_GET_STRUCT_TYPE_INFO(nested_union_struct), &applied,
+            &cur_nus, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_apply_delta(dopts, S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(ENUM_VALUE_2, applied.id);
+        TEST_ASSERT_EQUAL_STRING("hello", applied.data.str.str);
+
+        // string of the old member is released
+        cur_nus = (nested_union_struct){.id = ENUM_VALUE_3, .data.value = 7};
+        err = s_serialize_delta(
+            opts, S_GET_STRUCT_TYPE_INFO(nested_union_struct), &applied,
+            &cur_nus, buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_apply_delta(dopts, S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                            &applied, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_INT(ENUM_VALUE_3, applied.id);
+        TEST_ASSERT_EQUAL_INT(7, applied.data.value);
+    }
+}
+
+void test_deserialize_json_string_buffer_size() {
+    simple_struct ss = {
+        .id = 42,
+        .value = 3.14f,
+        .active = true,
+        .name = "Hello, World!",
+        .passport_number = "1234567890",
+        .blob = {0x01, 0x02, 0x03, 0x04},
+    };
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss, buffer,
+                    sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    char expected_json[1024];
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(expected_json),
+    };
+
+    err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                        expected_json, buffer, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    size_t json_size = strlen(expected_json) + 1;
+    char json[1024];
+
+    { // exact fit
+        memset(json, 0xFF, sizeof(json));
+        dopts.data_size = json_size;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                            buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(expected_json, json);
+    }
+    { // no room for terminating zero
+        memset(json, 0xFF, sizeof(json));
+        dopts.data_size = json_size - 1;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                            buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_EQUAL_UINT8(0xFF, (uint8_t) json[json_size - 1]);
+    }
+    { // buffer ends in the middle of a number
+        memset(json, 0xFF, sizeof(json));
+        dopts.data_size = 7;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                            buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_EQUAL_UINT8(0xFF, (uint8_t) json[7]);
+    }
+    { // output is never unbounded: no size and no sink leaves no room
+        memset(json, 0xFF, sizeof(json));
+        dopts.data_size = 0;
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                            buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_EQUAL_UINT8(0xFF, (uint8_t) json[0]);
+
+        size_t n_converted = 1;
+        err = s_deserialize_ndjson(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                                   json, buffer, 0, 1, &n_converted);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_EQUAL(0, n_converted);
+    }
+
+    { // large message is converted in linear time
+        const int n_ints = 100000;
+        int32_t* ints = malloc(n_ints * sizeof(int32_t));
+        for (int i = 0; i < n_ints; i++)
+            ints[i] = i;
+
+        builtin_arrays_struct bas = {
+            .n_static_ints = 1,
+            .static_ints = {1},
+            .n_dynamic_ints = n_ints,
+            .dynamic_ints = ints,
+        };
+
+        size_t large_buffer_size = n_ints * sizeof(int32_t) + 1024;
+        uint8_t* large_buffer = malloc(large_buffer_size);
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                          &bas, large_buffer, large_buffer_size,
+                          &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        size_t large_json_size = n_ints * 8;
+        char* large_json = malloc(large_json_size);
+        dopts.data_size = large_json_size;
+        err = s_deserialize(dopts,
+                            S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                            large_json, large_buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING("99998,99999]}",
+                                 large_json + strlen(large_json) - 13);
+
+        free(large_json);
+        free(large_buffer);
+        free(ints);
+    }
+}
+
+typedef struct {
+    char* data;
+    size_t length;
+    size_t capacity;
+    int n_chunks;
+    bool is_chunk_size_fixed; // all chunks but last are full
+    size_t last_chunk_length;
+    int fail_at_chunk; // 0 -- never
+} json_sink_ctx;
+
+static bool json_sink_cb(const char* chunk, size_t length, void* user_data) {
+    json_sink_ctx* sink = (json_sink_ctx*) user_data;
+
+    if (sink->n_chunks && sink->last_chunk_length != S_JSON_CHUNK_SIZE - 1)
+        sink->is_chunk_size_fixed = false;
+
+    if (++sink->n_chunks == sink->fail_at_chunk)
+        return false;
+
+    if (sink->length + length + 1 > sink->capacity) {
+        sink->capacity = (sink->length + length + 1) * 2;
+        sink->data = realloc(sink->data, sink->capacity);
+    }
+
+    memcpy(sink->data + sink->length, chunk, length);
+    sink->length += length;
+    sink->data[sink->length] = '\0';
+    sink->last_chunk_length = length;
+
+    return true;
+}
+
+void test_deserialize_json_string_sink() {
+    const int n_ints = 100000;
+    int32_t* ints = malloc(n_ints * sizeof(int32_t));
+    int8_t* bytes = malloc(n_ints);
+
+    for (int i = 0; i < n_ints; i++) {
+        ints[i] = i * 7919;
+        bytes[i] = (int8_t) i;
+    }
+
+    builtin_arrays_struct bas = {
+        .n_static_ints = 1,
+        .static_ints = {1},
+        .n_dynamic_ints = n_ints,
+        .dynamic_ints = ints,
+    };
+    byte_arrays_struct bys = {
+        .n_static_bytes = 3,
+        .static_bytes = {1, 2, 3},
+        .n_dynamic_bytes = n_ints,
+        .dynamic_bytes = bytes,
+    };
+    const s_type_info* infos[] = {
+        S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+        S_GET_STRUCT_TYPE_INFO(byte_arrays_struct),
+    };
+    const void* structs[] = {&bas, &bys};
+
+    size_t buffer_size = n_ints * sizeof(int32_t) + 1024;
+    uint8_t* buffer = malloc(buffer_size);
+    size_t json_size = n_ints * 16;
+    char* expected_json = malloc(json_size);
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+
+    for (int i = 0; i < 2; i++) {
+        s_deserialize_options dopts = {
+            .format = FORMAT_JSON_STRING,
+            .allocator = &g_default_allocator,
+            .data_size = json_size,
+            .json_base64_blobs = i == 1,
+        };
+
+        s_serializer_error err = s_serialize(opts, infos[i], structs[i],
+                                             buffer, buffer_size,
+                                             &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, infos[i], expected_json, buffer,
+                            bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        // streamed output is the same, in fixed-size chunks
+        json_sink_ctx sink = {.is_chunk_size_fixed = true};
+
+        dopts.json_sink = json_sink_cb;
+        dopts.json_sink_data = &sink;
+        err = s_deserialize(dopts, infos[i], NULL, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(expected_json, sink.data);
+        TEST_ASSERT_TRUE(sink.n_chunks > 1);
+        TEST_ASSERT_TRUE(sink.is_chunk_size_fixed);
+
+        // direct conversion streams the same output
+        sink.length = 0;
+        sink.n_chunks = 0;
+        err = s_to_json(dopts, infos[i], structs[i], NULL, 0);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(expected_json, sink.data);
+        TEST_ASSERT_TRUE(sink.is_chunk_size_fixed);
+
+        // sink stops output
+        sink.length = 0;
+        sink.n_chunks = 0;
+        sink.fail_at_chunk = 2;
+        err = s_deserialize(dopts, infos[i], NULL, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_SINK_FAILED, err);
+        TEST_ASSERT_EQUAL(2, sink.n_chunks);
+
+        free(sink.data);
+    }
+
+    free(expected_json);
+    free(buffer);
+    free(bytes);
+    free(ints);
+}
+
+void test_deserialize_ndjson() {
+    const int n_records = 1000;
+    size_t stream_size = n_records * 256;
+    uint8_t* stream = malloc(stream_size);
+    size_t json_size = n_records * 512;
+    char* expected_json = malloc(json_size);
+    char* json = malloc(json_size);
+    size_t offset = 0;
+    size_t expected_length = 0;
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = json_size,
+    };
+    char names[2][32];
+
+    for (int i = 0; i < n_records; i++) {
+        snprintf(names[0], sizeof(names[0]), "record %d", i);
+        snprintf(names[1], sizeof(names[1]), "sub %d", i * 31);
+
+        nested_struct ns = {
+            .id = (enum some_enum)(i % 3),
+            .sub = {.id = i,
+                    .value = i * 0.5f,
+                    .active = i % 2,
+                    .name = names[1]},
+            .name = names[0],
+        };
+        size_t bytes_written = 0;
+        s_serializer_error err = s_serialize_record(
+            opts, S_GET_STRUCT_TYPE_INFO(nested_struct), &ns, stream + offset,
+            stream_size - offset, &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        // record is a length-prefixed message
+        uint8_t buffer[256];
+        size_t message_size = 0;
+        err = s_serialize(opts, S_GET_STRUCT_TYPE_INFO(nested_struct), &ns,
+                          buffer, sizeof(buffer), &message_size);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_TRUE(bytes_written > message_size);
+        TEST_ASSERT_EQUAL_MEMORY(buffer,
+                                 stream + offset + bytes_written - message_size,
+                                 message_size);
+
+        s_deserialize_options record_opts = dopts;
+
+        record_opts.data_size = json_size - expected_length;
+        err = s_deserialize(record_opts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                            expected_json + expected_length, buffer,
+                            message_size);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        expected_length += strlen(expected_json + expected_length);
+        expected_json[expected_length++] = '\n';
+        expected_json[expected_length] = '\0';
+        offset += bytes_written;
+    }
+
+    // output and its order don't depend on number of threads
+    int n_threads[] = {0, 1, 4, 7, 1000};
+
+    for (size_t i = 0; i < sizeof(n_threads) / sizeof(n_threads[0]); i++) {
+        size_t n_converted = 0;
+        s_serializer_error err = s_deserialize_ndjson(
+            dopts, S_GET_STRUCT_TYPE_INFO(nested_struct), json, stream,
+            offset, n_threads[i], &n_converted);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(n_records, n_converted);
+        TEST_ASSERT_EQUAL_STRING(expected_json, json);
+
+        // streamed to sink
+        json_sink_ctx sink = {.is_chunk_size_fixed = true};
+        s_deserialize_options sink_opts = dopts;
+
+        sink_opts.json_sink = json_sink_cb;
+        sink_opts.json_sink_data = &sink;
+        err = s_deserialize_ndjson(sink_opts,
+                                   S_GET_STRUCT_TYPE_INFO(nested_struct), NULL,
+                                   stream, offset, n_threads[i], &n_converted);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(n_records, n_converted);
+        TEST_ASSERT_EQUAL_STRING(expected_json, sink.data);
+        TEST_ASSERT_TRUE(sink.is_chunk_size_fixed);
+        free(sink.data);
+
+        // truncated stream stops at the last complete record
+        err = s_deserialize_ndjson(dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                                   json, stream, offset - 3, n_threads[i],
+                                   &n_converted);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+        TEST_ASSERT_EQUAL(n_records - 1, n_converted);
+        size_t last_line = expected_length - 1;
+
+        while (expected_json[last_line - 1] != '\n')
+            last_line--;
+
+        TEST_ASSERT_EQUAL_MEMORY(expected_json, json, last_line);
+        TEST_ASSERT_EQUAL(last_line, strlen(json));
+
+        // output buffer too small
+        s_deserialize_options small_opts = dopts;
+
+        small_opts.data_size = expected_length / 2;
+        err = s_deserialize_ndjson(
+            small_opts, S_GET_STRUCT_TYPE_INFO(nested_struct), json, stream,
+            offset, n_threads[i], &n_converted);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_TRUE(n_converted < (size_t) n_records);
+    }
+
+    // empty stream
+    size_t n_converted = 1;
+    s_serializer_error err = s_deserialize_ndjson(
+        dopts, S_GET_STRUCT_TYPE_INFO(nested_struct), json, stream, 0, 4,
+        &n_converted);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(0, n_converted);
+    TEST_ASSERT_EQUAL_STRING("", json);
+
+    free(json);
+    free(expected_json);
+    free(stream);
+}
+
+void test_deserialize_json_string_numbers() {
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    char json[1024];
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(json),
+    };
+
+    { // integers of all sizes keep their full range
+        counters_struct cs = {
+            .i16 = INT16_MIN,
+            .u16 = UINT16_MAX,
+            .i32 = INT32_MIN,
+            .u32 = UINT32_MAX,
+            .i64 = INT64_MIN,
+            .u64 = UINT64_MAX,
+            .u8 = 100,
+        };
+
+        s_serializer_error err =
+            s_serialize(opts, S_GET_STRUCT_TYPE_INFO(counters_struct), &cs,
+                        buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                            json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(
+            "{\"i16\":-32768,\"u16\":65535,\"i32\":-2147483648,\"u32\":"
+            "4294967295,\"i64\":-9223372036854775808,\"u64\":"
+            "18446744073709551615,\"u8\":100}",
+            json);
+    }
+
+    { // shortest floating point representation
+        struct {
+            double value;
+            const char* json;
+        } doubles[] = {
+            {0.1, "{\"type\":2,\"value\":0.1}"},
+            {-2.5, "{\"type\":2,\"value\":-2.5}"},
+            {100, "{\"type\":2,\"value\":100.0}"},
+            {0.0001, "{\"type\":2,\"value\":0.0001}"},
+            {1e-7, "{\"type\":2,\"value\":1e-7}"},
+            {1.7976931348623157e308,
+             "{\"type\":2,\"value\":1.7976931348623157e+308}"},
+        };
+
+        for (size_t i = 0; i < sizeof(doubles) / sizeof(doubles[0]); i++) {
+            sss_generic_value gv = {
+                .type_ = SSS_GENERIC_VALUE_TYPE_DOUBLE,
+                .as_.double_ = doubles[i].value,
+            };
+
+            s_serializer_error err =
+                s_serialize(opts, S_GET_STRUCT_TYPE_INFO(sss_generic_value),
+                            &gv, buffer, sizeof(buffer), &bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            err = s_deserialize(dopts,
+                                S_GET_STRUCT_TYPE_INFO(sss_generic_value), json,
+                                buffer, bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_EQUAL_STRING(doubles[i].json, json);
+        }
+    }
+
+    { // formatted values read back exactly
+        uint64_t x = 88172645463325252ull;
+
+        for (int i = 0; i < 100000; i++) {
+            x ^= x << 13;
+            x ^= x >> 7;
+            x ^= x << 17;
+
+            double d;
+            float f;
+            uint32_t f_bits = (uint32_t) x;
+            char str[S_NUMBER_MAX_CHARS + 1];
+
+            memcpy(&d, &x, sizeof(d));
+            memcpy(&f, &f_bits, sizeof(f));
+
+            if (d == d && d - d == 0) { // finite
+                str[s_format_double(d, str)] = '\0';
+                double read_d = strtod(str, NULL);
+                TEST_ASSERT_EQUAL_MEMORY(&d, &read_d, sizeof(d));
+            }
+
+            if (f == f && f - f == 0) {
+                str[s_format_float(f, str)] = '\0';
+                float read_f = strtof(str, NULL);
+                TEST_ASSERT_EQUAL_MEMORY(&f, &read_f, sizeof(f));
+            }
+        }
+    }
+}
+
+void test_deserialize_json_string_escaping() {
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    char json[1024];
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(json),
+    };
+
+    { // special and control characters, utf-8 is kept as is
+        simple_struct ss = {
+            .name = "Say \"hi\"\\\n\t\r\b\f\x01\x1F \xC3\xBC/",
+            .passport_number = "",
+        };
+
+        s_serializer_error err =
+            s_serialize(opts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+                        buffer, sizeof(buffer), &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                            buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_NOT_NULL(
+            strstr(json, "\"name\":\"Say \\\"hi\\\"\\\\\\n\\t\\r\\b\\f\\u0001"
+                         "\\u001f \xC3\xBC/\",\"PassportNumber\":\"\""));
+    }
+
+    { // escaped character at every position of long string
+        char name[48];
+        char expected[64];
+
+        for (size_t pos = 0; pos < sizeof(name) - 1; pos++) {
+            memset(name, 'a', sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+            name[pos] = pos % 2 ? '"' : '\n';
+
+            snprintf(expected, sizeof(expected), "\"name\":\"%.*s\\%c%s\",",
+                     (int) pos, name, pos % 2 ? '"' : 'n', name + pos + 1);
+
+            simple_struct ss = {.name = name, .passport_number = ""};
+
+            s_serializer_error err =
+                s_serialize(opts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+                            buffer, sizeof(buffer), &bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                                json, buffer, bytes_written);
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_NOT_NULL(strstr(json, expected));
+        }
+    }
+}
+
+static void assert_to_json_same_as_deserialized(const s_type_info* info,
+                                                 const void* data) {
+    static uint8_t buffer[8192];
+    static char expected_json[8192];
+    static char json[8192];
+    size_t bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(expected_json),
+    };
+
+    s_serializer_error err = s_serialize(opts, info, data, buffer,
+                                         sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    // blobs as number arrays, then as base64
+    for (int i = 0; i < 2; i++) {
+        dopts.json_base64_blobs = i;
+        err = s_deserialize(dopts, info, expected_json, buffer, bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        err = s_to_json(dopts, info, data, json, sizeof(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(expected_json, json);
+    }
+}
+
+void test_to_json() {
+    simple_struct ss = {
+        .id = 42,
+        .value = 3.14f,
+        .active = true,
+        .name = "Hello, \"World\"!",
+        .passport_number = NULL,
+        .blob = {0x01, 0x02, 0x03, 0x04},
+    };
+    assert_to_json_same_as_deserialized(S_GET_STRUCT_TYPE_INFO(simple_struct),
+                                        &ss);
+
+    nested_struct ns = {.id = ENUM_VALUE_3, .sub = ss, .name = "nested"};
+    assert_to_json_same_as_deserialized(S_GET_STRUCT_TYPE_INFO(nested_struct),
+                                        &ns);
+
+    { // unions
+        nested_union_struct nus = {.id = ENUM_VALUE_2, .data.str.str = "str"};
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(nested_union_struct), &nus);
+
+        nus.id = ENUM_VALUE_1;
+        nus.data.sub = ss;
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(nested_union_struct), &nus);
+    }
+
+    { // all array kinds
+        int32_t ints[] = {-1, 0, 1};
+        builtin_arrays_struct bas = {
+            .n_static_ints = 2,
+            .static_ints = {INT32_MIN, INT32_MAX},
+            .n_dynamic_ints = 3,
+            .dynamic_ints = ints,
+        };
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct), &bas);
+
+        simple_struct structs[] = {ss, {.id = 2}};
+        struct_arrays_struct sas = {
+            .n_static_structs = 1,
+            .static_structs = {ss},
+            .n_dynamic_structs = 2,
+            .dynamic_structs = structs,
+        };
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &sas);
+
+        sas.n_dynamic_structs = 0;
+        sas.dynamic_structs = NULL;
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &sas);
+
+        fixed_strings_struct fss = {
+            .name = "fixed",
+            .n_phone_numbers = 2,
+            .phone_numbers = {"123", "45\t6"},
+        };
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(fixed_strings_struct), &fss);
+    }
+
+    { // tagged unions in struct array
+        sss_system_message ssm = {
+            .type_ = SSS_MSG_TYPE_CUSTOM_DICT,
+            .timestamp_usec_ = 1234567890,
+            .seq_no_ = 42,
+            .as_.custom_dict_data_ = {
+                .n_entries_ = 3,
+                .keys_ = {"key1", "key2", "key3"},
+                .values_ = {
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 42},
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_DOUBLE,
+                     .as_.double_ = 0.1},
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_STRING,
+                     .as_.string_ = "Hello"},
+                }}};
+        assert_to_json_same_as_deserialized(
+            S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm);
+    }
+
+    { // output is bounded
+        char json[1024];
+        s_deserialize_options dopts = {0};
+        s_serializer_error err =
+            s_to_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss, json,
+                      sizeof(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        size_t json_size = strlen(json) + 1;
+        err = s_to_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+                        json, json_size - 1);
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+        TEST_ASSERT_EQUAL(json_size - 2, strlen(json));
+    }
+}
+
+static void assert_from_json_round_trip(const s_type_info* info,
+                                        const void* data) {
+    static char json[8192];
+    static char round_trip_json[8192];
+    static tracking_allocator_ctx allocations;
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_tracking_allocator,
+        .user_data = &allocations,
+    };
+    void* parsed = malloc(info->type_size);
+
+    // blobs as number arrays, then as base64
+    for (int i = 0; i < 2; i++) {
+        dopts.json_base64_blobs = i;
+
+        s_serializer_error err = s_to_json(dopts, info, data, json,
+                                           sizeof(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_from_json(dopts, info, parsed, json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_to_json(dopts, info, parsed, round_trip_json,
+                        sizeof(round_trip_json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING(json, round_trip_json);
+
+        // strings and arrays of parsed struct
+        tracking_release_all(&allocations);
+    }
+
+    free(parsed);
+}
+
+void test_from_json() {
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_default_allocator,
+    };
+    simple_struct ss = {
+        .id = -42,
+        .value = 3.14f,
+        .active = true,
+        .name = "Hello, \"World\"!\n",
+        .passport_number = "AB123",
+        .blob = {0x01, 0x02, 0xFF},
+    };
+
+    { // round trips
+        assert_from_json_round_trip(S_GET_STRUCT_TYPE_INFO(simple_struct), &ss);
+
+        nested_struct ns = {.id = ENUM_VALUE_3, .sub = ss, .name = "nested"};
+        assert_from_json_round_trip(S_GET_STRUCT_TYPE_INFO(nested_struct), &ns);
+
+        nested_union_struct nus = {.id = ENUM_VALUE_2, .data.str.str = "str"};
+        assert_from_json_round_trip(S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                                    &nus);
+        nus.id = ENUM_VALUE_1;
+        nus.data.sub = ss;
+        assert_from_json_round_trip(S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                                    &nus);
+
+        int32_t ints[] = {INT32_MIN, 0, INT32_MAX};
+        builtin_arrays_struct bas = {
+            .n_static_ints = 2,
+            .static_ints = {-1, 1},
+            .n_dynamic_ints = 3,
+            .dynamic_ints = ints,
+        };
+        assert_from_json_round_trip(
+            S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct), &bas);
+
+        simple_struct structs[] = {ss, {.id = 2}};
+        struct_arrays_struct sas = {
+            .n_static_structs = 1,
+            .static_structs = {ss},
+            .n_dynamic_structs = 2,
+            .dynamic_structs = structs,
+        };
+        assert_from_json_round_trip(
+            S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &sas);
+
+        fixed_strings_struct fss = {
+            .name = "fixed",
+            .n_phone_numbers = 2,
+            .phone_numbers = {"123", "45\t6"},
+        };
+        assert_from_json_round_trip(
+            S_GET_STRUCT_TYPE_INFO(fixed_strings_struct), &fss);
+
+        counters_struct cs = {
+            .i16 = INT16_MIN,
+            .u16 = UINT16_MAX,
+            .i32 = INT32_MIN,
+            .u32 = UINT32_MAX,
+            .i64 = INT64_MIN,
+            .u64 = UINT64_MAX,
+            .u8 = UINT8_MAX,
+        };
+        assert_from_json_round_trip(S_GET_STRUCT_TYPE_INFO(counters_struct),
+                                    &cs);
+
+        sss_system_message ssm = {
+            .type_ = SSS_MSG_TYPE_CUSTOM_DICT,
+            .timestamp_usec_ = 1234567890.5,
+            .seq_no_ = 42,
+            .as_.custom_dict_data_ = {
+                .n_entries_ = 3,
+                .keys_ = {"key1", "key2", "key3"},
+                .values_ = {
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 42},
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_DOUBLE,
+                     .as_.double_ = 0.1},
+                    {.type_ = SSS_GENERIC_VALUE_TYPE_STRING,
+                     .as_.string_ = "Hello"},
+                }}};
+        assert_from_json_round_trip(
+            S_GET_STRUCT_TYPE_INFO(sss_system_message), &ssm);
+    }
+
+    { // names, labels, whitespace, unknown keys and escapes
+        const char* json =
+            " {\n\t\"Data\" : [ 1 , 2 ] , \"unknown\": {\"a\": [1, {\"b\": "
+            "\"}\"}]},\r\n \"name\": \"\\u00fc\\uD83D\\uDE00\\/\\\"\", "
+            "\"id\": -7, \"value\": 1.5e1, \"active\": false, "
+            "\"passport_number\": null } ";
+        simple_struct parsed;
+
+        s_serializer_error err =
+            s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), &parsed,
+                        json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(-7, parsed.id);
+        TEST_ASSERT_EQUAL_FLOAT(15.0f, parsed.value);
+        TEST_ASSERT_FALSE(parsed.active);
+        TEST_ASSERT_EQUAL_STRING("\xC3\xBC\xF0\x9F\x98\x80/\"", parsed.name);
+        TEST_ASSERT_NULL(parsed.passport_number);
+        TEST_ASSERT_EQUAL(1, parsed.blob[0]);
+        TEST_ASSERT_EQUAL(2, parsed.blob[1]);
+        TEST_ASSERT_EQUAL(0, parsed.blob[2]);
+        free((char*) parsed.name);
+    }
+
+    { // escapes and quotes around 64-byte block boundaries
+        char name[160];
+        char json[512];
+        simple_struct parsed;
+
+        for (size_t pos = 0; pos < sizeof(name) - 1; pos++) {
+            memset(name, 'a', sizeof(name) - 1);
+            name[sizeof(name) - 1] = '\0';
+            name[pos] = pos % 3 == 0 ? '"' : pos % 3 == 1 ? '\\' : '\n';
+
+            simple_struct ss_escaped = {.name = name};
+            s_serializer_error err =
+                s_to_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                          &ss_escaped, json, sizeof(json));
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                              &parsed, json, strlen(json));
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_EQUAL_STRING(name, parsed.name);
+            free((char*) parsed.name);
+            free(parsed.passport_number);
+        }
+    }
+
+    { // invalid json
+        const char* invalid[] = {
+            "",
+            "[]",
+            "{",
+            "{\"id\": 1,}",
+            "{\"id\": 1} x",
+            "{\"id\": 1}{}",
+            "{\"id\" 1}",
+            "{\"name\": \"unterminated}",
+            "{\"name\": \"ctrl\x01\"}",
+            "{\"name\": \"\\x\"}",
+            "{\"name\": \"\\uDE00\"}",
+            "{\"id\": 01}",
+            "{\"id\": 1.}",
+            "{\"id\": 1.5}",
+            "{\"id\": 2147483648}",
+            "{\"id\": -2147483649}",
+            "{\"id\": 1, \"Id\": 2}",
+            "{\"active\": 1}",
+            "{\"active\": truex}",
+            "{\"Data\": [256]}",
+            "{\"name\": \"leaked\", \"Data\": [-1]}",
+        };
+        simple_struct parsed;
+
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            s_serializer_error err =
+                s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                            &parsed, invalid[i], strlen(invalid[i]));
+            TEST_ASSERT_EQUAL_MESSAGE(SERIALIZER_ERROR_INVALID_TYPE, err,
+                                      invalid[i]);
+            TEST_ASSERT_NULL(parsed.name);
+        }
+
+        counters_struct cs;
+        const char* json = "{\"u16\": 65536}";
+        s_serializer_error err =
+            s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct), &cs,
+                        json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+        json = "{\"u64\": -1}";
+        err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(counters_struct), &cs,
+                          json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+
+        fixed_strings_struct fss;
+        json = "{\"name\": \"0123456789012345678901234567890123\"}";
+        err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(fixed_strings_struct),
+                          &fss, json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+
+        // escapes make it fit
+        json = "{\"name\": \"\\u0041123456789012345678901234567890\"}";
+        err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(fixed_strings_struct),
+                          &fss, json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_STRING("A123456789012345678901234567890", fss.name);
+
+        builtin_arrays_struct bas;
+        char large_json[512] = "{\"static_ints\": [0";
+        for (int i = 1; i < 33; i++)
+            strcat(large_json, ",0");
+        strcat(large_json, "]}");
+        err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct),
+                          &bas, large_json, strlen(large_json));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+
+        // union tag after its member
+        nested_union_struct nus;
+        json = "{\"Sub\": {\"Id\": 1}, \"id\": 1}";
+        err = s_from_json(dopts, S_GET_STRUCT_TYPE_INFO(nested_union_struct),
+                          &nus, json, strlen(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+    }
+
+    { // json to tlv is the same as serialized struct
+        uint8_t expected[1024];
+        uint8_t buffer[1024];
+        char json[1024];
+        size_t expected_size = 0;
+        size_t bytes_written = 0;
+        s_serialize_options opts = {0};
+
+        s_serializer_error err =
+            s_serialize(opts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+                        expected, sizeof(expected), &expected_size);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_to_json(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+                        json, sizeof(json));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        err = s_json_to_tlv(opts, dopts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                            json, strlen(json), buffer, sizeof(buffer),
+                            &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(expected_size, bytes_written);
+        TEST_ASSERT_EQUAL_MEMORY(expected, buffer, bytes_written);
+
+        // allocator gets its context with every call
+        counting_allocator_ctx counts = {0};
+        s_deserialize_options copts = {.allocator = &g_counting_allocator,
+                                       .user_data = &counts};
+
+        memset(buffer, 0, sizeof(buffer));
+        err = s_json_to_tlv(opts, copts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                            json, strlen(json), buffer, sizeof(buffer),
+                            &bytes_written);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL_MEMORY(expected, buffer, bytes_written);
+        TEST_ASSERT_TRUE(counts.n_allocated > 1);
+        TEST_ASSERT_EQUAL(counts.n_allocated, counts.n_released);
+    }
+}
+
+void test_json_base64_blobs() {
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    char json[1024];
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(json),
+        .json_base64_blobs = true,
+    };
+    simple_struct ss = {
+        .name = "",
+        .passport_number = "",
+        .blob = {0xFB, 0xFF, 0xBF, 'M', 'a', 'n'},
+    };
+
+    s_serializer_error err =
+        s_serialize(opts, S_GET_STRUCT_TYPE_INFO(simple_struct), &ss, buffer,
+                    sizeof(buffer), &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    err = s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(simple_struct), json,
+                        buffer, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_NOT_NULL(strstr(
+        json, "\"Data\":\"+/+/TWFuAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA=\""));
+
+    { // byte arrays of every length around vector block sizes
+        int8_t bytes[64];
+        byte_arrays_struct bas;
+
+        for (size_t i = 0; i < sizeof(bytes); i++)
+            bytes[i] = (int8_t) (i * 37 + 11);
+
+        for (int32_t n = 0; n <= 64; n++) {
+            memset(&bas, 0, sizeof(bas));
+            bas.n_static_bytes = n;
+            memcpy(bas.static_bytes, bytes, n);
+            bas.n_dynamic_bytes = n;
+            bas.dynamic_bytes = bytes;
+
+            assert_to_json_same_as_deserialized(
+                S_GET_STRUCT_TYPE_INFO(byte_arrays_struct), &bas);
+            assert_from_json_round_trip(
+                S_GET_STRUCT_TYPE_INFO(byte_arrays_struct), &bas);
+        }
+    }
+
+    { // parsing takes both forms, invalid base64 is rejected
+        s_deserialize_options from_opts = {
+            .format = FORMAT_C_STRUCT,
+            .allocator = &g_default_allocator,
+        };
+        const char* valid = "{\"StaticBytes\": \"AQID\", "
+                            "\"DynamicBytes\": [1, 2, 3, 4]}";
+        const char* invalid[] = {
+            "{\"StaticBytes\": \"AQI\"}",
+            "{\"StaticBytes\": \"AQ=D\"}",
+            "{\"StaticBytes\": \"AQ\\u0041D\"}",
+            "{\"StaticBytes\": \"A*ID\"}",
+        };
+        byte_arrays_struct bas;
+
+        err = s_from_json(from_opts, S_GET_STRUCT_TYPE_INFO(byte_arrays_struct),
+                          &bas, valid, strlen(valid));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(3, bas.n_static_bytes);
+        TEST_ASSERT_EQUAL(3, bas.static_bytes[2]);
+        TEST_ASSERT_EQUAL(4, bas.n_dynamic_bytes);
+        TEST_ASSERT_EQUAL(4, bas.dynamic_bytes[3]);
+        free(bas.dynamic_bytes);
+
+        for (size_t i = 0; i < sizeof(invalid) / sizeof(invalid[0]); i++) {
+            err = s_from_json(from_opts,
+                              S_GET_STRUCT_TYPE_INFO(byte_arrays_struct), &bas,
+                              invalid[i], strlen(invalid[i]));
+            TEST_ASSERT_EQUAL_MESSAGE(SERIALIZER_ERROR_INVALID_TYPE, err,
+                                      invalid[i]);
+        }
+
+        // blob longer than field
+        char long_blob[128] = "{\"Data\": \"";
+        for (int i = 0; i < 11; i++)
+            strcat(long_blob, "AAAA");
+        strcat(long_blob, "\"}");
+        simple_struct parsed;
+        err = s_from_json(from_opts, S_GET_STRUCT_TYPE_INFO(simple_struct),
+                          &parsed, long_blob, strlen(long_blob));
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+    }
+}
+
+void setUp() {}
+void tearDown() {}
+
+static void assert_codec_record_equal(const codec_record* expected,
+                                      const codec_record* actual) {
+    TEST_ASSERT_EQUAL_UINT64(expected->id, actual->id);
+    TEST_ASSERT_EQUAL_STRING(expected->name, actual->name);
+    TEST_ASSERT_EQUAL_STRING(expected->kind, actual->kind);
+    TEST_ASSERT_EQUAL_INT32(expected->origin.x, actual->origin.x);
+    TEST_ASSERT_EQUAL_DOUBLE(expected->origin.y, actual->origin.y);
+    TEST_ASSERT_EQUAL(expected->origin.is_set, actual->origin.is_set);
+    TEST_ASSERT_EQUAL_STRING(expected->origin.label, actual->origin.label);
+    TEST_ASSERT_EQUAL_INT32(expected->n_samples, actual->n_samples);
+    TEST_ASSERT_EQUAL_MEMORY(expected->samples, actual->samples,
+                             expected->n_samples * sizeof(float));
+    TEST_ASSERT_EQUAL_UINT16(expected->n_bytes, actual->n_bytes);
+    TEST_ASSERT_EQUAL_MEMORY(expected->bytes, actual->bytes,
+                             expected->n_bytes);
+    TEST_ASSERT_EQUAL_INT8(expected->level, actual->level);
+}
+
+void test_serialize_deserialize_codec() {
+    uint8_t bytes[] = {1, 2, 3, 4, 5};
+    codec_record record = {
+        .id = 0x1122334455667788ull,
+        .name = "record",
+        .kind = "sample",
+        .origin = {.x = -7, .y = 2.5, .is_set = true, .label = "origin"},
+        .n_samples = 3,
+        .samples = {0.5f, 1.5f, -2.0f},
+        .n_bytes = sizeof(bytes),
+        .bytes = bytes,
+        .level = -3,
+    };
+
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(codec_record);
+    TEST_ASSERT_NOT_NULL(info->encode);
+    TEST_ASSERT_NOT_NULL(info->decode);
+    TEST_ASSERT_EQUAL(9, info->field_count);
+    TEST_ASSERT_EQUAL_STRING("Id", info->fields[0].label);
+    TEST_ASSERT_NULL(S_GET_STRUCT_TYPE_INFO(codec_record_generic)->encode);
+
+    // codec writes exactly what generic encoder writes
+    uint8_t buffer[512], generic_buffer[512];
+    size_t bytes_written = 0, generic_bytes_written = 0;
+    s_serialize_options opts = {0};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_encode_codec_record(&record, buffer, sizeof(buffer),
+                                            &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(opts,
+                                  S_GET_STRUCT_TYPE_INFO(codec_record_generic),
+                                  &record, generic_buffer,
+                                  sizeof(generic_buffer),
+                                  &generic_bytes_written));
+    TEST_ASSERT_EQUAL(generic_bytes_written, bytes_written);
+    TEST_ASSERT_EQUAL_MEMORY(generic_buffer, buffer, bytes_written);
+
+    // s_serialize dispatches to codec
+    size_t serialized_bytes = 0;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(opts, info, &record, generic_buffer,
+                                  sizeof(generic_buffer), &serialized_bytes));
+    TEST_ASSERT_EQUAL(bytes_written, serialized_bytes);
+    TEST_ASSERT_EQUAL_MEMORY(buffer, generic_buffer, bytes_written);
+
+    // every short buffer is refused
+    for (size_t size = 0; size < bytes_written; size++) {
+        size_t n = 0;
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL,
+                          s_encode_codec_record(&record, buffer, size, &n));
+    }
+
+    // both decoders read codec output
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_default_allocator,
+    };
+    codec_record decoded;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_decode_codec_record(&decoded, buffer, bytes_written,
+                                            &g_default_allocator, NULL));
+    assert_codec_record_equal(&record, &decoded);
+    s_release_codec_record(&decoded, &g_default_allocator, NULL);
+    TEST_ASSERT_NULL(decoded.name);
+    TEST_ASSERT_NULL(decoded.bytes);
+
+    codec_record_generic generic_decoded = {0};
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_deserialize(dopts,
+                                    S_GET_STRUCT_TYPE_INFO(
+                                        codec_record_generic),
+                                    &generic_decoded, buffer, bytes_written));
+    assert_codec_record_equal(&record, &generic_decoded);
+    s_release_codec_record(&generic_decoded, &g_default_allocator, NULL);
+
+    // truncated or damaged input is refused without leaks
+    for (size_t size = 0; size < bytes_written; size++)
+        TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                          s_decode_codec_record(&decoded, buffer, size,
+                                                &g_default_allocator, NULL));
+    uint8_t damaged[512];
+    memcpy(damaged, buffer, bytes_written);
+    damaged[bytes_written - 6] = 2; // last element is nested now
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_decode_codec_record(&decoded, damaged, bytes_written,
+                                            &g_default_allocator, NULL));
+    TEST_ASSERT_NULL(decoded.name);
+
+    // other formats take generic path both ways
+    s_serialize_options formats[] = {
+        {.use_compact_format = true},
+        {.use_field_ids = true},
+        {.use_varints = true},
+        {.omit_defaults = true},
+    };
+
+    for (size_t i = 0; i < sizeof(formats) / sizeof(formats[0]); i++) {
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_serialize(formats[i], info, &record,
+                                      generic_buffer, sizeof(generic_buffer),
+                                      &generic_bytes_written));
+        TEST_ASSERT_FALSE(generic_bytes_written == bytes_written &&
+                          !memcmp(generic_buffer, buffer, bytes_written));
+
+        codec_record from_generic = {0};
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_deserialize(dopts, info, &from_generic,
+                                        generic_buffer,
+                                        generic_bytes_written));
+        assert_codec_record_equal(&record, &from_generic);
+        s_release_codec_record(&from_generic, &g_default_allocator, NULL);
+    }
+
+    // too many elements for static array
+    record.n_samples = 9;
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_encode_codec_record(&record, buffer, sizeof(buffer),
+                                            &bytes_written));
+}
+
+void test_serialize_deserialize_schema_header() {
+    simple_struct ss = {
+        .id = 42,
+        .value = 3.14f,
+        .active = true,
+        .name = "Hello, World!",
+        .passport_number = "1234567890",
+        .blob = {0x01, 0x02, 0x03, 0x04},
+    };
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(simple_struct);
+
+    // hash covers fields, not type names
+    TEST_ASSERT_TRUE(info->schema_hash != 0);
+    TEST_ASSERT_TRUE(info->schema_hash == s_type_info_hash(info));
+    TEST_ASSERT_TRUE(s_type_info_hash(info) !=
+                     s_type_info_hash(S_GET_STRUCT_TYPE_INFO(nested_struct)));
+    TEST_ASSERT_TRUE(
+        s_type_info_hash(S_GET_STRUCT_TYPE_INFO(codec_record)) ==
+        s_type_info_hash(S_GET_STRUCT_TYPE_INFO(codec_record_generic)));
+    TEST_ASSERT_TRUE(
+        s_type_info_hash(S_GET_STRUCT_TYPE_INFO(builtin_arrays_struct)) !=
+        s_type_info_hash(S_GET_STRUCT_TYPE_INFO(byte_arrays_struct)));
+
+    uint8_t plain[1024], buffer[1024];
+    size_t plain_size = 0, bytes_written = 0;
+    s_serialize_options opts = {0};
+    s_serialize_options header_opts = {.use_schema_header = true};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(opts, info, &ss, plain,
+                                                 sizeof(plain), &plain_size));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(header_opts, info, &ss, buffer,
+                                  sizeof(buffer), &bytes_written));
+    TEST_ASSERT_EQUAL(S_SCHEMA_HEADER_SIZE + plain_size, bytes_written);
+    TEST_ASSERT_EQUAL_MEMORY(plain, buffer + S_SCHEMA_HEADER_SIZE, plain_size);
+
+    s_schema_header header;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_read_schema_header(buffer, bytes_written, &header));
+    TEST_ASSERT_TRUE(header.schema_hash == s_type_info_hash(info));
+    TEST_ASSERT_EQUAL(plain_size, header.length);
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_read_schema_header(plain, plain_size, &header));
+
+    size_t n = 0;
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL,
+                      s_serialize(header_opts, info, &ss, buffer,
+                                  S_SCHEMA_HEADER_SIZE + plain_size - 1, &n));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(header_opts, info, &ss, buffer,
+                                  sizeof(buffer), &bytes_written));
+
+    // matching schema is decoded as usual
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_default_allocator,
+    };
+    simple_struct decoded = {0};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(dopts, info, &decoded,
+                                                   buffer, bytes_written));
+    TEST_ASSERT_EQUAL_INT(42, decoded.id);
+    TEST_ASSERT_EQUAL_STRING("Hello, World!", decoded.name);
+    TEST_ASSERT_EQUAL_STRING("1234567890", decoded.passport_number);
+    free((void*) decoded.name);
+    free(decoded.passport_number);
+
+    char json[1024], plain_json[1024];
+    s_deserialize_options json_opts = {
+        .format = FORMAT_JSON_STRING,
+        .allocator = &g_default_allocator,
+        .data_size = sizeof(json),
+    };
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(json_opts, info, json,
+                                                   buffer, bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(json_opts, info, plain_json,
+                                                   plain, plain_size));
+    TEST_ASSERT_EQUAL_STRING(plain_json, json);
+
+    // other schema is refused up front
+    nested_struct other = {0};
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_SCHEMA_MISMATCH,
+                      s_deserialize(dopts, S_GET_STRUCT_TYPE_INFO(nested_struct),
+                                    &other, buffer, bytes_written));
+    TEST_ASSERT_NULL(other.name);
+
+    // header promising more than there is
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_deserialize(dopts, info, &decoded, buffer,
+                                    bytes_written - 1));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_deserialize(dopts, info, &decoded, buffer,
+                                    S_SCHEMA_HEADER_SIZE - 1));
+}
+
+#if defined(SSS_TESTS_HAVE_THREADS)
+#define N_REGISTRY_THREADS (4)
+
+static s_type_registry g_shared_registry;
+
+// looks up types while they are being added, any entry found is complete
+static void* find_types_concurrently(void* arg) {
+    const s_type_info* info = (const s_type_info*) arg;
+    const s_type_info* found = NULL;
+
+    while (!found) {
+        found = s_type_registry_find(&g_shared_registry, info->schema_hash);
+
+        if (found && found->schema_hash != info->schema_hash)
+            return (void*) 1;
+    }
+
+    return NULL;
+}
+#endif
+
+void test_deserialize_any() {
+    s_type_registry registry = {0};
+    const s_type_info* types[] = {
+        S_GET_STRUCT_TYPE_INFO(simple_struct),
+        S_GET_STRUCT_TYPE_INFO(nested_struct),
+        S_GET_STRUCT_TYPE_INFO(sss_system_message),
+        S_GET_STRUCT_TYPE_INFO(codec_record),
+    };
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, s_type_registry_add(&registry,
+                                                             types[i]));
+
+    // same type again is fine, same schema under another type is not
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_type_registry_add(&registry, types[0]));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_SCHEMA_MISMATCH,
+                      s_type_registry_add(&registry,
+                                          S_GET_STRUCT_TYPE_INFO(
+                                              codec_record_generic)));
+
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+        TEST_ASSERT_EQUAL_PTR(types[i],
+                              s_type_registry_find(&registry,
+                                                   types[i]->schema_hash));
+    TEST_ASSERT_NULL(s_type_registry_find(
+        &registry, S_GET_STRUCT_TYPE_INFO(counters_struct)->schema_hash));
+
+    // messages of different types in one stream
+    simple_struct simple = {.id = 7, .name = "simple", .passport_number = "1"};
+    nested_struct nested = {
+        .id = ENUM_VALUE_3, .sub = {.id = 8, .name = "sub"}, .name = "nested"};
+    uint8_t stream[1024];
+    size_t stream_size = 0, bytes_written = 0;
+    s_serialize_options opts = {.use_schema_header = true};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize_record(opts, types[1], &nested, stream,
+                                         sizeof(stream), &bytes_written));
+    stream_size += bytes_written;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize_record(opts, types[0], &simple,
+                                         stream + stream_size,
+                                         sizeof(stream) - stream_size,
+                                         &bytes_written));
+    stream_size += bytes_written;
+
+    s_deserialize_options dopts = {
+        .format = FORMAT_C_STRUCT,
+        .allocator = &g_default_allocator,
+    };
+    union {
+        simple_struct simple;
+        nested_struct nested;
+    } any;
+    const s_type_info* info = NULL;
+    const uint8_t* it = stream;
+
+    // both records are short enough for 1-byte length prefix
+    TEST_ASSERT_TRUE(it[0] < 0x80 && it[1 + it[0]] < 0x80);
+    memset(&any, 0, sizeof(any));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_deserialize_any(dopts, &registry, &info, &any,
+                                        sizeof(any), it + 1, it[0]));
+    TEST_ASSERT_EQUAL_PTR(types[1], info);
+    TEST_ASSERT_EQUAL(ENUM_VALUE_3, any.nested.id);
+    TEST_ASSERT_EQUAL_INT(8, any.nested.sub.id);
+    TEST_ASSERT_EQUAL_STRING("nested", any.nested.name);
+    free((void*) any.nested.name);
+    free((void*) any.nested.sub.name);
+    it += 1 + it[0];
+
+    memset(&any, 0, sizeof(any));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_deserialize_any(dopts, &registry, &info, &any,
+                                        sizeof(any), it + 1, it[0]));
+    TEST_ASSERT_EQUAL_PTR(types[0], info);
+    TEST_ASSERT_EQUAL_INT(7, any.simple.id);
+    TEST_ASSERT_EQUAL_STRING("simple", any.simple.name);
+    free((void*) any.simple.name);
+    free(any.simple.passport_number);
+
+    // type has to fit into data
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL,
+                      s_deserialize_any(dopts, &registry, &info, &any,
+                                        sizeof(simple_struct) - 1, it + 1,
+                                        it[0]));
+    TEST_ASSERT_NULL(info);
+
+    // unknown types and messages without header
+    counters_struct counters = {.i32 = 1};
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(opts, S_GET_STRUCT_TYPE_INFO(counters_struct),
+                                  &counters, stream, sizeof(stream),
+                                  &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_SCHEMA_MISMATCH,
+                      s_deserialize_any(dopts, &registry, &info, &any,
+                                        sizeof(any), stream, bytes_written));
+
+    opts.use_schema_header = false;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(opts, types[0], &simple, stream,
+                                  sizeof(stream), &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE,
+                      s_deserialize_any(dopts, &registry, &info, &any,
+                                        sizeof(any), stream, bytes_written));
+
+#if defined(SSS_TESTS_HAVE_THREADS)
+    pthread_t threads[N_REGISTRY_THREADS];
+
+    for (int i = 0; i < N_REGISTRY_THREADS; i++)
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL,
+                                            find_types_concurrently,
+                                            (void*) types[i]));
+
+    for (int i = N_REGISTRY_THREADS; i-- > 0;)
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_type_registry_add(&g_shared_registry, types[i]));
+
+    for (int i = 0; i < N_REGISTRY_THREADS; i++) {
+        void* result = NULL;
+
+        pthread_join(threads[i], &result);
+        TEST_ASSERT_NULL(result);
+    }
+#endif
+}
+
+#if defined(SSS_TESTS_HAVE_THREADS)
+#define N_INIT_THREADS (16)
+
+static int g_init_start = 0;
+
+static void* get_type_info_concurrently(void* arg) {
+    while (!__atomic_load_n(&g_init_start, __ATOMIC_ACQUIRE))
+        ;
+
+    *(const s_type_info**) arg = S_GET_STRUCT_TYPE_INFO(concurrent_init_struct);
+
+    return NULL;
+}
+#endif
+
+static void count_top_level_cb(const s_tlv_decoded_element_data* el,
+                               void* user_data) {
+    if (el && el->level == 0)
+        (*(int*) user_data)++;
+}
+
+static int count_top_level(const uint8_t* buffer, size_t size) {
+    int n = 0;
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_tlv_decode(buffer, size, count_top_level_cb, &n));
+    return n;
+}
+
+void test_serialize_deserialize_union_tables() {
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(wide_union_struct);
+    const s_type_info* str_info = S_GET_STRUCT_TYPE_INFO(string_union_struct);
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {.format = FORMAT_C_STRUCT,
+                                   .allocator = &g_default_allocator};
+    uint8_t buffer[256];
+    size_t bytes_written = 0;
+
+    // every alternative points to the table of its union
+    const s_union_table* table = info->fields[1].optional_field_info.table;
+
+    TEST_ASSERT_NOT_NULL(table);
+    TEST_ASSERT_EQUAL(1, table->first_field);
+    TEST_ASSERT_EQUAL(7, table->field_count);
+    for (size_t i = 1; i < info->field_count; i++)
+        TEST_ASSERT_TRUE(info->fields[i].optional_field_info.table == table);
+    TEST_ASSERT_NOT_NULL(str_info->fields[1].optional_field_info.table);
+    TEST_ASSERT_NULL(info->fields[0].optional_field_info.table);
+
+    int32_t kinds[] = {1, 2, 3, 4, 6, 7, 8};
+
+    for (size_t i = 0; i < sizeof(kinds) / sizeof(kinds[0]); i++) {
+        wide_union_struct ws = {.kind = kinds[i]};
+        wide_union_struct decoded = {0};
+        int32_t kind = kinds[i];
+
+        TEST_ASSERT_TRUE(s_union_table_find(table, &kind) ==
+                         &info->fields[1 + i]);
+
+        switch (kinds[i]) {
+        case 1: ws.value.i8 = -8; break;
+        case 2: ws.value.i16 = -1600; break;
+        case 3: ws.value.i32 = 320000; break;
+        case 4: ws.value.i64 = -6400000000LL; break;
+        case 6: ws.value.f32 = 3.25f; break;
+        case 7: ws.value.f64 = 6.125; break;
+        default: strcpy(ws.value.str, "eight"); break;
+        }
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_serialize(opts, info, &ws, buffer, sizeof(buffer),
+                                      &bytes_written));
+        // tag and active alternative only
+        TEST_ASSERT_EQUAL(2, count_top_level(buffer, bytes_written));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_deserialize(dopts, info, &decoded, buffer,
+                                        bytes_written));
+        TEST_ASSERT_EQUAL_MEMORY(&ws, &decoded, sizeof(ws));
+    }
+
+    // tag without alternative -- union is omitted
+    wide_union_struct unknown = {.kind = 5, .value.i64 = 5};
+    wide_union_struct decoded_unknown = {0};
+    int32_t below = -1;
+
+    TEST_ASSERT_NULL(s_union_table_find(table, &unknown.kind));
+    TEST_ASSERT_NULL(s_union_table_find(table, &below));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize(opts, info, &unknown, buffer, sizeof(buffer),
+                                  &bytes_written));
+    TEST_ASSERT_EQUAL(1, count_top_level(buffer, bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_deserialize(dopts, info, &decoded_unknown, buffer,
+                                    bytes_written));
+    TEST_ASSERT_EQUAL(5, decoded_unknown.kind);
+    TEST_ASSERT_EQUAL(0, decoded_unknown.value.i64);
+
+    // string tags
+    string_union_struct ss[] = {
+        {.kind = "count", .value.count = 42},
+        {.kind = "ratio", .value.ratio = 0.5},
+        {.kind = "label", .value.label = "tagged"},
+    };
+
+    for (size_t i = 0; i < sizeof(ss) / sizeof(ss[0]); i++) {
+        string_union_struct decoded = {0};
+
+        TEST_ASSERT_TRUE(
+            s_union_table_find(str_info->fields[1].optional_field_info.table,
+                               ss[i].kind) == &str_info->fields[1 + i]);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_serialize(opts, str_info, &ss[i], buffer,
+                                      sizeof(buffer), &bytes_written));
+        TEST_ASSERT_EQUAL(2, count_top_level(buffer, bytes_written));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_deserialize(dopts, str_info, &decoded, buffer,
+                                        bytes_written));
+        TEST_ASSERT_EQUAL_STRING(ss[i].kind, decoded.kind);
+        TEST_ASSERT_EQUAL_MEMORY(&ss[i].value, &decoded.value,
+                                 sizeof(ss[i].value));
+    }
+
+    string_union_struct other = {.kind = "counts", .value.count = 7};
+    char json[256];
+
+    TEST_ASSERT_NULL(s_union_table_find(
+        str_info->fields[1].optional_field_info.table, other.kind));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_to_json(dopts, str_info, &other, json,
+                                               sizeof(json)));
+    TEST_ASSERT_NULL(strstr(json, "count\""));
+}
+
+void test_find_field() {
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(simple_struct);
+
+    TEST_ASSERT_NOT_NULL(info->field_index);
+    TEST_ASSERT_TRUE(s_find_field(info, "id", 2) == &info->fields[0]);
+    TEST_ASSERT_TRUE(s_find_field(info, "Id", 2) == &info->fields[0]);
+    TEST_ASSERT_TRUE(s_find_field(info, "PassportNumber", 14) ==
+                     &info->fields[4]);
+    // name doesn't have to be terminated
+    TEST_ASSERT_TRUE(s_find_field(info, "blobs", 4) == &info->fields[5]);
+    TEST_ASSERT_NULL(s_find_field(info, "blobs", 5));
+    TEST_ASSERT_NULL(s_find_field(info, "i", 1));
+    TEST_ASSERT_NULL(s_find_field(info, "", 0));
+    TEST_ASSERT_NULL(s_find_next_field(info, &info->fields[0], "id", 2));
+
+    // union members share label
+    const s_type_info* value_info = S_GET_STRUCT_TYPE_INFO(sss_generic_value);
+    const s_field_info* field = s_find_field(value_info, "value", 5);
+
+    TEST_ASSERT_TRUE(field == &value_info->fields[1]);
+    field = s_find_next_field(value_info, field, "value", 5);
+    TEST_ASSERT_TRUE(field == &value_info->fields[2]);
+    field = s_find_next_field(value_info, field, "value", 5);
+    TEST_ASSERT_TRUE(field == &value_info->fields[3]);
+    TEST_ASSERT_NULL(s_find_next_field(value_info, field, "value", 5));
+
+    // every name and label of every type, same as scanning
+    const s_type_info* infos[] = {
+        info,
+        value_info,
+        S_GET_STRUCT_TYPE_INFO(sss_system_message),
+        S_GET_STRUCT_TYPE_INFO(counters_struct),
+        S_GET_STRUCT_TYPE_INFO(wide_union_struct),
+        S_GET_STRUCT_TYPE_INFO(TestStruct3),
+        S_GET_STRUCT_TYPE_INFO(codec_record),
+    };
+
+    for (size_t t = 0; t < sizeof(infos) / sizeof(infos[0]); t++) {
+        s_type_info scanned = *infos[t];
+
+        scanned.field_index = NULL;
+        TEST_ASSERT_NOT_NULL(infos[t]->field_index);
+
+        for (size_t i = 0; i < scanned.field_count; i++) {
+            const char* keys[] = {scanned.fields[i].name,
+                                  scanned.fields[i].label};
+
+            for (int k = 0; k < 2; k++) {
+                if (!keys[k])
+                    continue;
+
+                size_t len = strlen(keys[k]);
+                const s_field_info* found = s_find_field(infos[t], keys[k],
+                                                         len);
+                const s_field_info* expected =
+                    s_find_field(&scanned, keys[k], len);
+
+                TEST_ASSERT_TRUE(found == expected);
+                while (found) {
+                    found = s_find_next_field(infos[t], found, keys[k], len);
+                    expected = s_find_next_field(&scanned, expected, keys[k],
+                                                 len);
+                    TEST_ASSERT_TRUE(found == expected);
+                }
+                TEST_ASSERT_TRUE(s_find_field(infos[t], keys[k], len - 1) ==
+                                 s_find_field(&scanned, keys[k], len - 1));
+            }
+        }
+    }
+}
+
+static void free_map_message(sss_map_message* msg) {
+    sss_name_entry* names = (sss_name_entry*) msg->names_.entries;
+
+    for (uint32_t i = 0; i < msg->names_.count; i++)
+        g_default_allocator.deallocate(names[i].name_, NULL);
+
+    s_map_free(&msg->dict_, &g_default_allocator, NULL);
+    s_map_free(&msg->names_, &g_default_allocator, NULL);
+}
+
+static void check_map_message(const sss_map_message* msg) {
+    const s_type_info* dict_info = S_GET_STRUCT_TYPE_INFO(sss_dict_entry);
+    const s_type_info* name_info = S_GET_STRUCT_TYPE_INFO(sss_name_entry);
+    const sss_dict_entry* dict = (const sss_dict_entry*) msg->dict_.entries;
+
+    // sorted by key, binary searched
+    TEST_ASSERT_EQUAL(3, msg->dict_.count);
+    TEST_ASSERT_EQUAL(0, msg->dict_.n_slots);
+    TEST_ASSERT_NULL(msg->dict_.slots);
+    TEST_ASSERT_EQUAL_STRING("alpha", dict[0].key_);
+    TEST_ASSERT_EQUAL_STRING("beta", dict[1].key_);
+    TEST_ASSERT_EQUAL_STRING("gamma", dict[2].key_);
+
+    const sss_dict_entry* beta = s_map_find(dict_info, &msg->dict_, "beta");
+
+    TEST_ASSERT_TRUE(beta == &dict[1]);
+    TEST_ASSERT_EQUAL(SSS_GENERIC_VALUE_TYPE_DOUBLE, beta->value_.type_);
+    TEST_ASSERT_EQUAL_DOUBLE(2.5, beta->value_.as_.double_);
+    TEST_ASSERT_NULL(s_map_find(dict_info, &msg->dict_, "delta"));
+    TEST_ASSERT_NULL(s_map_find(dict_info, &msg->dict_, ""));
+
+    // hashed, order of entries kept
+    TEST_ASSERT_EQUAL(40, msg->names_.count);
+    TEST_ASSERT_TRUE(msg->names_.n_slots >= 2 * msg->names_.count);
+    TEST_ASSERT_NOT_NULL(msg->names_.slots);
+
+    for (int64_t id = 0; id < 40; id++) {
+        int64_t key = 1000 - 7 * id;
+        const sss_name_entry* entry =
+            s_map_find(name_info, &msg->names_, &key);
+        char name[32];
+
+        snprintf(name, sizeof(name), "name %lld", (long long) key);
+        TEST_ASSERT_NOT_NULL(entry);
+        TEST_ASSERT_TRUE(entry ==
+                         (const sss_name_entry*) msg->names_.entries + id);
+        TEST_ASSERT_EQUAL_STRING(name, entry->name_);
+    }
+
+    int64_t missing = 1001;
+    TEST_ASSERT_NULL(s_map_find(name_info, &msg->names_, &missing));
+}
+
+void test_serialize_deserialize_maps() {
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(sss_map_message);
+    sss_dict_entry dict[3] = {
+        {.key_ = "gamma",
+         .value_ = {.type_ = SSS_GENERIC_VALUE_TYPE_STRING,
+                    .as_.string_ = "third"}},
+        {.key_ = "alpha",
+         .value_ = {.type_ = SSS_GENERIC_VALUE_TYPE_INT32, .as_.int_ = 1}},
+        {.key_ = "beta",
+         .value_ = {.type_ = SSS_GENERIC_VALUE_TYPE_DOUBLE,
+                    .as_.double_ = 2.5}},
+    };
+    sss_name_entry names[40];
+    char name_strs[40][32];
+
+    for (int i = 0; i < 40; i++) {
+        names[i].id_ = 1000 - 7 * i;
+        snprintf(name_strs[i], sizeof(name_strs[i]), "name %lld",
+                 (long long) names[i].id_);
+        names[i].name_ = name_strs[i];
+    }
+
+    sss_map_message msg = {
+        .seq_no_ = 7,
+        .dict_ = {.entries = dict, .count = 3},
+        .names_ = {.entries = names, .count = 40},
+    };
+
+    TEST_ASSERT_EQUAL(FIELD_TYPE_MAP, info->fields[1].type);
+    TEST_ASSERT_TRUE(info->fields[2].opts & S_FIELD_OPT_MAP_HASHED);
+
+    // map layout is not part of the schema
+    s_field_info fields[3];
+    s_type_info other = *info;
+
+    memcpy(fields, info->fields, sizeof(fields));
+    fields[2].opts &= ~S_FIELD_OPT_MAP_HASHED;
+    other.fields = fields;
+    other.schema_hash = 0;
+    TEST_ASSERT_TRUE(s_type_info_hash(&other) == info->schema_hash);
+
+    uint8_t buffer[4096];
+    size_t bytes_written = 0;
+    s_serialize_options variants[] = {
+        {0},
+        {.use_compact_format = true},
+        {.use_field_ids = true, .use_varints = true},
+    };
+    s_deserialize_options dopts = {.format = FORMAT_C_STRUCT,
+                                   .allocator = &g_default_allocator};
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        sss_map_message decoded = {0};
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                          s_serialize(variants[v], info, &msg, buffer,
+                                      sizeof(buffer), &bytes_written));
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(dopts, info, &decoded,
+                                                       buffer, bytes_written));
+        TEST_ASSERT_EQUAL(7, decoded.seq_no_);
+        check_map_message(&decoded);
+        free_map_message(&decoded);
+    }
+
+    // entries come out of json the same way
+    char json[8192];
+    sss_map_message parsed = {0};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_to_json(dopts, info, &msg, json, sizeof(json)));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"dict\":{\"count\":3,"));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_from_json(dopts, info, &parsed, json, strlen(json)));
+    check_map_message(&parsed);
+
+    // delta carries changed map whole, it's sorted again
+    sss_map_message prev = {0}, cur = msg;
+    sss_dict_entry* prev_dict;
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(variants[0], info, &msg,
+                                                 buffer, sizeof(buffer),
+                                                 &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_deserialize(dopts, info, &prev, buffer, bytes_written));
+
+    cur.dict_.count = 2; // without "beta"
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize_delta(variants[0], info, &parsed, &cur,
+                                        buffer, sizeof(buffer),
+                                        &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_apply_delta(dopts, info, &prev, buffer, bytes_written));
+
+    prev_dict = (sss_dict_entry*) prev.dict_.entries;
+    TEST_ASSERT_EQUAL(2, prev.dict_.count);
+    TEST_ASSERT_EQUAL_STRING("alpha", prev_dict[0].key_);
+    TEST_ASSERT_EQUAL_STRING("gamma", prev_dict[1].key_);
+    TEST_ASSERT_NULL(s_map_find(S_GET_STRUCT_TYPE_INFO(sss_dict_entry),
+                                &prev.dict_, "beta"));
+    TEST_ASSERT_EQUAL(40, prev.names_.count);
+
+    free_map_message(&prev);
+    free_map_message(&parsed);
+}
+
+static void check_feature_flags(const feature_flags_struct* expected,
+                                const feature_flags_struct* actual) {
+    TEST_ASSERT_EQUAL(expected->id, actual->id);
+    TEST_ASSERT_EQUAL_MEMORY(&expected->enabled, &actual->enabled, 10);
+    TEST_ASSERT_EQUAL(expected->level, actual->level);
+    TEST_ASSERT_EQUAL(expected->dark_mode, actual->dark_mode);
+    TEST_ASSERT_EQUAL(expected->legacy, actual->legacy);
+    TEST_ASSERT_EQUAL(expected->n_flags, actual->n_flags);
+    TEST_ASSERT_EQUAL_MEMORY(expected->flags, actual->flags,
+                             expected->n_flags);
+    TEST_ASSERT_EQUAL(expected->n_dynamic_flags, actual->n_dynamic_flags);
+
+    if (expected->n_dynamic_flags)
+        TEST_ASSERT_EQUAL_MEMORY(expected->dynamic_flags,
+                                 actual->dynamic_flags,
+                                 expected->n_dynamic_flags);
+    else
+        TEST_ASSERT_NULL(actual->dynamic_flags);
+}
+
+void test_serialize_deserialize_packed_bools() {
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(feature_flags_struct);
+    bool dynamic_flags[19];
+    feature_flags_struct msg = {.id = 42,
+                                .enabled = true,
+                                .archived = true,
+                                .muted = true,
+                                .trusted = true,
+                                .level = 3,
+                                .dark_mode = true,
+                                .n_flags = 37,
+                                .n_dynamic_flags = 19,
+                                .dynamic_flags = dynamic_flags};
+
+    for (int i = 0; i < msg.n_flags; i++)
+        msg.flags[i] = i % 3 == 0;
+
+    for (int i = 0; i < 19; i++)
+        dynamic_flags[i] = i % 2;
+
+    // bitmaps of any length match bool by bool, whatever the byte of true is
+    uint8_t values[70];
+    uint8_t bits[S_BITS_SIZE(70)];
+    bool unpacked[70];
+
+    for (size_t n = 0; n <= sizeof(values); n++) {
+        for (size_t i = 0; i < n; i++)
+            values[i] = (i * 7) % 5 ? (uint8_t) (i % 4) : 0;
+
+        s_bits_pack((const bool*) values, n, bits);
+        s_bits_unpack(bits, n, unpacked);
+
+        for (size_t i = 0; i < n; i++)
+            TEST_ASSERT_EQUAL(values[i] != 0, unpacked[i]);
+
+        if (n % 8)
+            TEST_ASSERT_EQUAL(0, bits[n / 8] >> (n % 8));
+    }
+
+    // runs are made of packed bools next to each other
+    TEST_ASSERT_TRUE(info->fields[1].opts & S_FIELD_OPT_BOOL_PACKED);
+    TEST_ASSERT_EQUAL(0, info->fields[1].packed_field_info.bit);
+    TEST_ASSERT_EQUAL(9, info->fields[10].packed_field_info.bit);
+    TEST_ASSERT_EQUAL(10, info->fields[10].packed_field_info.count);
+    TEST_ASSERT_EQUAL(1, info->fields[12].packed_field_info.count);
+    TEST_ASSERT_FALSE(info->fields[13].opts & S_FIELD_OPT_BOOL_PACKED);
+
+    uint8_t buffer[512];
+    size_t bytes_written = 0;
+    s_serialize_options variants[] = {
+        {0},
+        {.use_compact_format = true},
+        {.use_field_ids = true, .use_varints = true},
+        {.omit_defaults = true},
+    };
+    s_deserialize_options dopts = {.format = FORMAT_C_STRUCT,
+                                   .allocator = &g_default_allocator};
+
+    // one element per run and per bool array: 2 + 5 and 3 + 1 bytes of value
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(variants[0], info, &msg,
+                                                 buffer, sizeof(buffer),
+                                                 &bytes_written));
+    TEST_ASSERT_EQUAL(9, count_top_level(buffer, bytes_written));
+    TEST_ASSERT_EQUAL(9 * 6 + 4 + 2 + 4 + 1 + 1 + 4 + 6 + 4 + 4,
+                      bytes_written);
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        feature_flags_struct empty = {.id = 1};
+
+        for (int pass = 0; pass < 2; pass++) {
+            feature_flags_struct* expected = pass ? &empty : &msg;
+            feature_flags_struct decoded;
+
+            memset(&decoded, 0xFF, sizeof(decoded));
+            decoded.dynamic_flags = NULL;
+
+            TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                              s_serialize(variants[v], info, expected, buffer,
+                                          sizeof(buffer), &bytes_written));
+            TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                              s_deserialize(dopts, info, &decoded, buffer,
+                                            bytes_written));
+            check_feature_flags(expected, &decoded);
+            free(decoded.dynamic_flags);
+        }
+    }
+
+    // json lists bools one by one, from the wire and from memory alike
+    char json[2048], wire_json[2048];
+    s_deserialize_options jopts = {.format = FORMAT_JSON_STRING,
+                                   .allocator = &g_default_allocator,
+                                   .data_size = sizeof(wire_json)};
+    feature_flags_struct parsed = {0};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(variants[0], info, &msg,
+                                                 buffer, sizeof(buffer),
+                                                 &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(jopts, info, wire_json,
+                                                   buffer, bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_to_json(dopts, info, &msg, json, sizeof(json)));
+    TEST_ASSERT_EQUAL_STRING(json, wire_json);
+    TEST_ASSERT_NOT_NULL(
+        strstr(json, "\"enabled\":true,\"visible\":false,\"locked\":false,"
+                     "\"archived\":true,\"shared\":false,\"pinned\":false,"
+                     "\"Muted\":true,"));
+    TEST_ASSERT_NOT_NULL(
+        strstr(json, "\"Flags\":[true,false,false,true,false,false,true,"));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_from_json(dopts, info, &parsed, json, strlen(json)));
+    check_feature_flags(&msg, &parsed);
+
+    // delta sends changed bitmaps and bool arrays whole
+    feature_flags_struct cur = msg;
+
+    cur.pinned = true;
+    cur.flags[35] = true;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize_delta(variants[0], info, &msg, &cur, buffer,
+                                        sizeof(buffer), &bytes_written));
+    TEST_ASSERT_EQUAL(2, count_top_level(buffer, bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_apply_delta(dopts, info, &parsed, buffer,
+                                    bytes_written));
+    check_feature_flags(&cur, &parsed);
+    free(parsed.dynamic_flags);
+}
+
+static double abs_diff(double a, double b) { return a > b ? a - b : b - a; }
+
+// value through fixed point of scale, saturating at max
+static double fixed_point(double value, double scale, double max) {
+    double scaled = value * scale;
+
+    if (scaled >= max)
+        scaled = max;
+    else if (scaled <= -max - 1)
+        scaled = -max - 1;
+    else
+        scaled = (double) (int64_t) (scaled < 0 ? scaled - 0.5 : scaled + 0.5);
+
+    return scaled / scale;
+}
+
+static void check_telemetry(const telemetry_struct* expected,
+                            const telemetry_struct* actual) {
+    TEST_ASSERT_EQUAL(expected->id, actual->id);
+    TEST_ASSERT_EQUAL_FLOAT(
+        s_half_to_float(s_float_to_half(expected->temperature)),
+        actual->temperature);
+    TEST_ASSERT_EQUAL_DOUBLE(
+        s_half_to_float(s_float_to_half((float) expected->altitude)),
+        actual->altitude);
+    TEST_ASSERT_EQUAL_FLOAT((float) fixed_point(expected->pressure, 10,
+                                                INT16_MAX),
+                            actual->pressure);
+    TEST_ASSERT_EQUAL_DOUBLE(fixed_point(expected->latitude, 1e6, INT32_MAX),
+                             actual->latitude);
+    TEST_ASSERT_EQUAL_MEMORY(&expected->raw, &actual->raw, sizeof(float));
+    TEST_ASSERT_EQUAL(expected->n_samples, actual->n_samples);
+
+    for (int i = 0; i < expected->n_samples; i++)
+        TEST_ASSERT_EQUAL_FLOAT(
+            s_half_to_float(s_float_to_half(expected->samples[i])),
+            actual->samples[i]);
+
+    TEST_ASSERT_EQUAL(expected->n_levels, actual->n_levels);
+
+    for (uint32_t i = 0; i < expected->n_levels; i++)
+        TEST_ASSERT_EQUAL_DOUBLE(
+            fixed_point(expected->levels[i], 100, INT16_MAX),
+            actual->levels[i]);
+
+    if (!expected->n_levels)
+        TEST_ASSERT_NULL(actual->levels);
+}
+
+void test_serialize_deserialize_quantized_floats() {
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(telemetry_struct);
+    double levels[6] = {0.5, -12.344, 101.01, 0, 327.67, 1000};
+    telemetry_struct msg = {.id = 7,
+                            .temperature = 21.37f,
+                            .altitude = 1843.25,
+                            .pressure = 1013.27f,
+                            .latitude = 52.5200066,
+                            .raw = 0.1f,
+                            .n_samples = 37,
+                            .n_levels = 6,
+                            .levels = levels};
+
+    for (int i = 0; i < msg.n_samples; i++)
+        msg.samples[i] = (i - 18) * 0.731f;
+
+    // half precision rounds to nearest even, saturates to infinity and
+    // flushes to zero at its limits
+    TEST_ASSERT_EQUAL_HEX16(0x3C00, s_float_to_half(1.0f));
+    TEST_ASSERT_EQUAL_HEX16(0xC000, s_float_to_half(-2.0f));
+    TEST_ASSERT_EQUAL_HEX16(0x3555, s_float_to_half(1.0f / 3));
+    TEST_ASSERT_EQUAL_HEX16(0x3C00, s_float_to_half(1.00048828125f));
+    TEST_ASSERT_EQUAL_HEX16(0x3C02, s_float_to_half(1.00146484375f));
+    TEST_ASSERT_EQUAL_HEX16(0x7BFF, s_float_to_half(65504.0f));
+    TEST_ASSERT_EQUAL_HEX16(0x7C00, s_float_to_half(65520.0f));
+    TEST_ASSERT_EQUAL_HEX16(0x0400, s_float_to_half(6.103515625e-5f));
+    TEST_ASSERT_EQUAL_HEX16(0x0001, s_float_to_half(5.9604645e-8f));
+    TEST_ASSERT_EQUAL_HEX16(0x8000, s_float_to_half(-2.9802322e-8f));
+    TEST_ASSERT_EQUAL_HEX16(0xFC00, s_float_to_half(s_half_to_float(0xFC00)));
+    TEST_ASSERT_EQUAL_HEX16(0x7E00, s_float_to_half(s_half_to_float(0x7E00)));
+
+    // every half survives conversion to float and back, vector conversion
+    // matches scalar one
+    static uint16_t halves[65536];
+    static float floats[65536];
+
+    for (uint32_t h = 0; h < 65536; h++)
+        halves[h] = (uint16_t) h;
+
+    s_halves_to_floats(halves, 65536, floats);
+
+    for (uint32_t h = 0; h < 65536; h++) {
+        float value = s_half_to_float((uint16_t) h);
+
+        TEST_ASSERT_EQUAL_MEMORY(&value, &floats[h], sizeof(value));
+
+        if ((h & 0x7FFF) <= 0x7C00)
+            TEST_ASSERT_EQUAL_HEX16(h, s_float_to_half(value));
+        else
+            TEST_ASSERT_TRUE(value != value);
+    }
+
+    uint32_t seed = 12345;
+
+    for (uint32_t i = 0; i < 65536; i++) {
+        uint32_t bits;
+
+        seed = seed * 1664525 + 1013904223;
+        // mostly around the range of half, some anywhere
+        bits = i % 4 ? (seed & 0x807FFFFF) | ((100 + (seed >> 8) % 46) << 23)
+                     : seed;
+        memcpy(&floats[i], &bits, sizeof(bits));
+    }
+
+    s_floats_to_halves(floats, 65536, halves);
+
+    for (uint32_t i = 0; i < 65536; i++)
+        TEST_ASSERT_EQUAL_HEX16(s_float_to_half(floats[i]), halves[i]);
+
+    // 2 bytes per half, 2 and 4 per fixed point value
+    uint8_t buffer[512];
+    size_t bytes_written = 0;
+    s_serialize_options variants[] = {
+        {0},
+        {.use_compact_format = true},
+        {.use_field_ids = true, .use_varints = true},
+        {.omit_defaults = true},
+    };
+    s_deserialize_options dopts = {.format = FORMAT_C_STRUCT,
+                                   .allocator = &g_default_allocator};
+
+    TEST_ASSERT_TRUE(info->fields[3].opts & S_FIELD_OPT_FIXED);
+    TEST_ASSERT_EQUAL(2, s_quantized_size(&info->fields[3]));
+    TEST_ASSERT_EQUAL(4, s_quantized_size(&info->fields[4]));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(variants[0], info, &msg,
+                                                 buffer, sizeof(buffer),
+                                                 &bytes_written));
+    TEST_ASSERT_EQUAL(10 * 6 + 4 + 2 + 2 + 2 + 4 + 4 + 4 + 37 * 2 + 4 + 6 * 2,
+                      bytes_written);
+
+    for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+        telemetry_struct empty = {.id = 1};
+
+        for (int pass = 0; pass < 2; pass++) {
+            telemetry_struct* expected = pass ? &empty : &msg;
+            telemetry_struct decoded;
+
+            memset(&decoded, 0xFF, sizeof(decoded));
+            decoded.levels = NULL;
+
+            TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                              s_serialize(variants[v], info, expected, buffer,
+                                          sizeof(buffer), &bytes_written));
+            TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                              s_deserialize(dopts, info, &decoded, buffer,
+                                            bytes_written));
+            check_telemetry(expected, &decoded);
+
+            // error is bounded by precision of half and by scale
+            if (!pass) {
+                TEST_ASSERT_TRUE(abs_diff(msg.temperature,
+                                          decoded.temperature) <=
+                                 msg.temperature / 2048);
+                TEST_ASSERT_TRUE(abs_diff(msg.altitude, decoded.altitude) <=
+                                 msg.altitude / 2048);
+                TEST_ASSERT_TRUE(abs_diff(msg.pressure, decoded.pressure) <=
+                                 0.05 + 1e-4);
+                TEST_ASSERT_TRUE(abs_diff(msg.latitude, decoded.latitude) <=
+                                 0.5e-6 + 1e-12);
+
+                for (int i = 0; i < msg.n_samples; i++)
+                    TEST_ASSERT_TRUE(abs_diff(msg.samples[i],
+                                              decoded.samples[i]) <=
+                                     abs_diff(msg.samples[i], 0) / 2048);
+
+                for (int i = 0; i < 5; i++)
+                    TEST_ASSERT_TRUE(abs_diff(levels[i], decoded.levels[i]) <=
+                                     0.005 + 1e-12);
+
+                TEST_ASSERT_EQUAL_DOUBLE(327.67, decoded.levels[5]);
+            }
+
+            free(decoded.levels);
+        }
+    }
+
+    // json shows values as they come out of the wire, from memory too
+    char json[2048], wire_json[2048];
+    s_deserialize_options jopts = {.format = FORMAT_JSON_STRING,
+                                   .allocator = &g_default_allocator,
+                                   .data_size = sizeof(wire_json)};
+    telemetry_struct parsed = {0};
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_serialize(variants[0], info, &msg,
+                                                 buffer, sizeof(buffer),
+                                                 &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, s_deserialize(jopts, info, wire_json,
+                                                   buffer, bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_to_json(dopts, info, &msg, json, sizeof(json)));
+    TEST_ASSERT_EQUAL_STRING(json, wire_json);
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"pressure\":1013.3,"));
+    TEST_ASSERT_NOT_NULL(strstr(json, "\"lat\":52.520007,"));
+    TEST_ASSERT_NOT_NULL(
+        strstr(json, "\"levels\":[0.5,-12.34,101.01,0.0,327.67,327.67]"));
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_from_json(dopts, info, &parsed, json, strlen(json)));
+    check_telemetry(&msg, &parsed);
+
+    // delta sends changed quantized arrays whole
+    telemetry_struct cur = msg;
+
+    cur.pressure = 990.5f;
+    cur.samples[3] = 100.0f;
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_serialize_delta(variants[0], info, &msg, &cur, buffer,
+                                        sizeof(buffer), &bytes_written));
+    TEST_ASSERT_EQUAL(2, count_top_level(buffer, bytes_written));
+    TEST_ASSERT_EQUAL(2 * 6 + 2 + 37 * 2, bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK,
+                      s_apply_delta(dopts, info, &parsed, buffer,
+                                    bytes_written));
+    check_telemetry(&cur, &parsed);
+    free(parsed.levels);
+}
+
+void test_type_info_concurrent_init() {
+#if defined(SSS_TESTS_HAVE_THREADS)
+    pthread_t threads[N_INIT_THREADS];
+    const s_type_info* infos[N_INIT_THREADS] = {0};
+
+    for (int i = 0; i < N_INIT_THREADS; i++)
+        TEST_ASSERT_EQUAL(0, pthread_create(&threads[i], NULL,
+                                            get_type_info_concurrently,
+                                            &infos[i]));
+
+    __atomic_store_n(&g_init_start, 1, __ATOMIC_RELEASE);
+
+    for (int i = 0; i < N_INIT_THREADS; i++)
+        pthread_join(threads[i], NULL);
+
+    // every thread sees the same, fully built type info
+    for (int i = 0; i < N_INIT_THREADS; i++) {
+        TEST_ASSERT_EQUAL_PTR(infos[0], infos[i]);
+        TEST_ASSERT_EQUAL(4, infos[i]->field_count);
+        TEST_ASSERT_EQUAL_STRING("values", infos[i]->fields[3].name);
+        TEST_ASSERT_EQUAL_PTR(S_GET_STRUCT_TYPE_INFO(nested_struct),
+                              infos[i]->fields[1].struct_type_info);
+    }
+#else
+    TEST_IGNORE_MESSAGE("no threads support");
+#endif
+}
+
+void test_type_info_failed() {
+    // type info whose fields couldn't be allocated is refused, not taken for
+    // an empty struct, also when nested
+    s_type_info failed = {.type_name = "failed",
+                          .type_size = sizeof(simple_struct)};
+    s_field_info sub = {.type = FIELD_TYPE_STRUCT,
+                        .size = sizeof(simple_struct),
+                        .struct_type_info = &failed,
+                        .name = "sub"};
+    s_type_info outer = {.type_name = "outer",
+                         .fields = &sub,
+                         .field_count = 1,
+                         .type_size = sizeof(simple_struct)};
+    simple_struct ss = {0};
+    uint8_t buffer[64] = {0};
+    size_t bytes_written = 0;
+    char json[64];
+    s_serialize_options opts = {0};
+    s_deserialize_options dopts = {.format = FORMAT_C_STRUCT,
+                                   .allocator = &g_default_allocator};
+
+    TEST_ASSERT_TRUE(s_type_info_is_failed(&failed));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_ALLOCATOR_FAILED,
+                      s_serialize(opts, &failed, &ss, buffer, sizeof(buffer),
+                                  &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_ALLOCATOR_FAILED,
+                      s_serialize(opts, &outer, &ss, buffer, sizeof(buffer),
+                                  &bytes_written));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_ALLOCATOR_FAILED,
+                      s_deserialize(dopts, &failed, &ss, buffer, 0));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_ALLOCATOR_FAILED,
+                      s_to_json(dopts, &outer, &ss, json, sizeof(json)));
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_ALLOCATOR_FAILED,
+                      s_from_json(dopts, &failed, &ss, "{}", 2));
+}
+
+int main() {
+#if defined(SSS_TESTS_GENERATED)
+    // same tests, s_serialize and s_deserialize go through generated codecs
+    test_schemas_register();
+#endif
 
-int main() {
     UNITY_BEGIN();
 
+    RUN_TEST(test_type_info_concurrent_init);
+    RUN_TEST(test_type_info_failed);
     RUN_TEST(test_serialize_deserialize_simple_struct);
     RUN_TEST(test_serialize_deserialize_with_empty_and_null_string);
     RUN_TEST(test_serialize_deserialize_nested_struct);
     RUN_TEST(test_serialize_deserialize_super_nested_struct);
     RUN_TEST(test_serialize_deserialize_union_structs);
+    RUN_TEST(test_serialize_deserialize_union_tables);
     RUN_TEST(test_serialize_deserialize_into_json_string);
+    RUN_TEST(test_deserialize_json_string_buffer_size);
+    RUN_TEST(test_deserialize_json_string_sink);
+    RUN_TEST(test_deserialize_ndjson);
+    RUN_TEST(test_deserialize_json_string_numbers);
+    RUN_TEST(test_deserialize_json_string_escaping);
+    RUN_TEST(test_to_json);
+    RUN_TEST(test_from_json);
+    RUN_TEST(test_json_base64_blobs);
     RUN_TEST(test_serialize_deserialize_struct_with_arrays);
     RUN_TEST(test_serialize_deserialize_arrays_into_json_string);
     RUN_TEST(tests_seialize_deserialize_struct_with_fixed_strings);
@@ -1113,6 +4122,18 @@ int main() {
     // RUN_TEST(test_serialize_deserialize_test_structs);
 
     RUN_TEST(test_serialize_deserialize_sample_system_message);
+    RUN_TEST(test_serialize_deserialize_varints);
+    RUN_TEST(test_serialize_deserialize_compact_format);
+    RUN_TEST(test_serialize_deserialize_omit_defaults);
+    RUN_TEST(test_serialize_deserialize_field_ids);
+    RUN_TEST(test_serialize_deserialize_delta);
+    RUN_TEST(test_serialize_deserialize_codec);
+    RUN_TEST(test_serialize_deserialize_schema_header);
+    RUN_TEST(test_deserialize_any);
+    RUN_TEST(test_find_field);
+    RUN_TEST(test_serialize_deserialize_maps);
+    RUN_TEST(test_serialize_deserialize_packed_bools);
+    RUN_TEST(test_serialize_deserialize_quantized_floats);
 
     UNITY_END();
     return 0;
@@ -766,6 +766,273 @@ void test_tlv_encode_decode_super_nested_struct() {
     print_decode_data_debug(&data);
 }
 
+void test_tlv_encode_decode_varints() {
+    counters_struct cs = {
+        .i16 = -1,
+        .u16 = 300,
+        .i32 = 0,
+        .u32 = 1,
+        .i64 = -64,
+        .u64 = UINT64_MAX,
+        .u8 = 200,
+    };
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(counters_struct);
+    s_serializer_error err =
+        s_tlv_encode(info, &cs, buffer, sizeof(buffer), &bytes_written);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(7 * 6 + 2 + 2 + 4 + 4 + 8 + 8 + 1, bytes_written);
+
+    err = s_tlv_encode_ex(info, &cs, TLV_ENCODE_FLAG_VARINT, buffer,
+                          sizeof(buffer), &bytes_written);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(7 * 6 + 1 + 2 + 1 + 1 + 1 + 10 + 1, bytes_written);
+
+    struct decode_data data = {0};
+
+    err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+    print_decode_data_debug(&data);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(7, data.tlv_el_num);
+
+    { // check each decoded element
+        for (int i = 0; i < 6; i++) {
+            TEST_ASSERT_EQUAL_INT(TLV_TAG_VARINT, data.tlv_els[i].type);
+        }
+        // uint8 is not varint encoded unless requested per field
+        TEST_ASSERT_EQUAL_INT(TLV_TAG_FIELD, data.tlv_els[6].type);
+
+        uint64_t value = 0;
+        TEST_ASSERT_EQUAL(1, s_tlv_varint_decode(data.tlv_els[0].value,
+                                                 data.tlv_els[0].length,
+                                                 &value));
+        TEST_ASSERT_EQUAL(-1, S_ZIGZAG_DECODE(value));
+        TEST_ASSERT_EQUAL(2, s_tlv_varint_decode(data.tlv_els[1].value,
+                                                 data.tlv_els[1].length,
+                                                 &value));
+        TEST_ASSERT_EQUAL(300, value);
+        TEST_ASSERT_EQUAL(10, s_tlv_varint_decode(data.tlv_els[5].value,
+                                                  data.tlv_els[5].length,
+                                                  &value));
+        TEST_ASSERT_TRUE(value == UINT64_MAX);
+
+        // 10th byte holds only the 64th bit
+        uint8_t overlong[TLV_VARINT_MAX_SIZE] = {0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+                                                 0xFF, 0xFF, 0xFF, 0xFF, 0x02};
+        TEST_ASSERT_EQUAL(0, s_tlv_varint_decode(overlong, sizeof(overlong),
+                                                 &value));
+    }
+}
+
+void test_tlv_encode_decode_compact_format() {
+    struct_arrays_struct sas = {
+        .n_static_structs = 2,
+        .static_structs =
+            {
+                {.id = 1, .name = "12345"},
+                {.id = 2, .name = "1234567890"},
+            },
+    };
+
+    uint8_t buffer[1024];
+    size_t bytes_written = 0;
+    struct decode_data data = {0};
+    struct decode_data compact_data = {0};
+
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(struct_arrays_struct);
+    s_serializer_error err =
+        s_tlv_encode(info, &sas, buffer, sizeof(buffer), &bytes_written);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(0, buffer[0]);
+
+    err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+    size_t v1_bytes_written = bytes_written;
+    uint8_t compact_buffer[1024];
+
+    err = s_tlv_encode_ex(info, &sas, TLV_ENCODE_FLAG_COMPACT, compact_buffer,
+                          sizeof(compact_buffer), &bytes_written);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(TLV_COMPACT_MAGIC, compact_buffer[0]);
+    TEST_ASSERT_EQUAL(TLV_COMPACT_VERSION, compact_buffer[1]);
+    // 16 elements, each header shrinks from 6 to 2 bytes
+    TEST_ASSERT_EQUAL(v1_bytes_written - 16 * 4 + TLV_COMPACT_PREFIX_SIZE,
+                      bytes_written);
+
+    err = s_tlv_decode(compact_buffer, bytes_written, on_tlv_decode_element,
+                       &compact_data);
+    print_decode_data_debug(&compact_data);
+
+    TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+    TEST_ASSERT_EQUAL(data.tlv_el_num, compact_data.tlv_el_num);
+
+    for (int i = 0; i < data.tlv_el_num; i++) {
+        TEST_ASSERT_EQUAL_INT(data.tlv_els[i].idx, compact_data.tlv_els[i].idx);
+        TEST_ASSERT_EQUAL_INT(data.tlv_els[i].level,
+                              compact_data.tlv_els[i].level);
+        TEST_ASSERT_EQUAL_INT(data.tlv_els[i].type,
+                              compact_data.tlv_els[i].type);
+
+        // nested elements hold headers, so only compare leaf values
+        if (data.tlv_els[i].type != TLV_TAG_NESTED_LIST) {
+            TEST_ASSERT_EQUAL_INT(data.tlv_els[i].length,
+                                  compact_data.tlv_els[i].length);
+            TEST_ASSERT_EQUAL_MEMORY(data.tlv_els[i].value,
+                                     compact_data.tlv_els[i].value,
+                                     data.tlv_els[i].length);
+        }
+    }
+
+    // buffer too small for header is reported
+    err = s_tlv_encode_ex(info, &sas, TLV_ENCODE_FLAG_COMPACT, compact_buffer,
+                          1, &bytes_written);
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_BUFFER_TOO_SMALL, err);
+
+    // unknown version is rejected
+    compact_buffer[1] = TLV_COMPACT_VERSION + 1;
+    err = s_tlv_decode(compact_buffer, sizeof(compact_buffer),
+                       on_tlv_decode_element, &compact_data);
+    TEST_ASSERT_EQUAL(SERIALIZER_ERROR_INVALID_TYPE, err);
+}
+
+void test_tlv_encode_decode_omit_defaults() {
+    nested_struct ns = {
+        .id = ENUM_VALUE_1,
+        .sub = {.id = 42},
+        .name = NULL,
+    };
+
+    uint32_t formats[] = {TLV_ENCODE_FLAG_NONE, TLV_ENCODE_FLAG_COMPACT};
+    const s_type_info* info = S_GET_STRUCT_TYPE_INFO(nested_struct);
+
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+        uint8_t buffer[1024];
+        size_t bytes_written = 0;
+        struct decode_data data = {0};
+        s_serializer_error err = s_tlv_encode_ex(
+            info, &ns, formats[f] | TLV_ENCODE_FLAG_OMIT_DEFAULTS, buffer,
+            sizeof(buffer), &bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+        print_decode_data_debug(&data);
+
+        // only sub struct and its id are left, both carry field ids
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(2, data.tlv_el_num);
+        TEST_ASSERT_EQUAL(TLV_TAG_NESTED, data.tlv_els[0].type);
+        TEST_ASSERT_EQUAL(1, data.tlv_els[0].field_id);
+        TEST_ASSERT_EQUAL(TLV_TAG_FIELD, data.tlv_els[1].type);
+        TEST_ASSERT_EQUAL(1, data.tlv_els[1].level);
+        TEST_ASSERT_EQUAL(0, data.tlv_els[1].field_id);
+        TEST_ASSERT_EQUAL(42, *(int32_t*) data.tlv_els[1].value);
+    }
+
+    { // struct with all fields omitted keeps its first field
+        simple_struct ss = {0};
+        uint8_t buffer[1024];
+        size_t bytes_written = 0;
+        struct decode_data data = {0};
+        s_serializer_error err = s_tlv_encode_ex(
+            S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+            TLV_ENCODE_FLAG_OMIT_DEFAULTS, buffer, sizeof(buffer),
+            &bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(1, data.tlv_el_num);
+        TEST_ASSERT_EQUAL(0, data.tlv_els[0].field_id);
+        TEST_ASSERT_EQUAL(sizeof(int32_t), data.tlv_els[0].length);
+    }
+
+    { // empty string is kept, only NULL is omitted
+        simple_struct ss = {.name = ""};
+        uint8_t buffer[1024];
+        size_t bytes_written = 0;
+        struct decode_data data = {0};
+        s_serializer_error err = s_tlv_encode_ex(
+            S_GET_STRUCT_TYPE_INFO(simple_struct), &ss,
+            TLV_ENCODE_FLAG_OMIT_DEFAULTS, buffer, sizeof(buffer),
+            &bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+        TEST_ASSERT_EQUAL(1, data.tlv_el_num);
+        TEST_ASSERT_EQUAL(3, data.tlv_els[0].field_id);
+        TEST_ASSERT_EQUAL(1, data.tlv_els[0].length);
+    }
+
+    { // each struct of struct array starts with an element of its own
+        struct_arrays_struct sas = {
+            .n_static_structs = 2,
+            .static_structs = {{.id = 1}, {.value = 2.5f}},
+        };
+
+        for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++) {
+            uint8_t buffer[1024];
+            size_t bytes_written = 0;
+            struct decode_data data = {0};
+            s_serializer_error err = s_tlv_encode_ex(
+                S_GET_STRUCT_TYPE_INFO(struct_arrays_struct), &sas,
+                formats[f] | TLV_ENCODE_FLAG_OMIT_DEFAULTS, buffer,
+                sizeof(buffer), &bytes_written);
+
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+            err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element,
+                               &data);
+            print_decode_data_debug(&data);
+
+            // size, array, then start and the only field of each struct
+            TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+            TEST_ASSERT_EQUAL(6, data.tlv_el_num);
+            TEST_ASSERT_EQUAL(TLV_TAG_NESTED_LIST, data.tlv_els[1].type);
+
+            for (int i = 2; i < 6; i += 2) {
+                TEST_ASSERT_EQUAL(TLV_TAG_NESTED_LIST_EL, data.tlv_els[i].type);
+                TEST_ASSERT_EQUAL(1, data.tlv_els[i].level);
+                TEST_ASSERT_EQUAL(0, data.tlv_els[i].length);
+                TEST_ASSERT_EQUAL(TLV_NO_FIELD_ID, data.tlv_els[i].field_id);
+            }
+
+            TEST_ASSERT_EQUAL(0, data.tlv_els[3].field_id);
+            TEST_ASSERT_EQUAL(1, *(int32_t*) data.tlv_els[3].value);
+            TEST_ASSERT_EQUAL(1, data.tlv_els[5].field_id);
+            TEST_ASSERT_EQUAL_FLOAT(2.5f, *(float*) data.tlv_els[5].value);
+        }
+    }
+
+    { // elements of regular encoding have no field ids
+        uint8_t buffer[1024];
+        size_t bytes_written = 0;
+        struct decode_data data = {0};
+        s_serializer_error err =
+            s_tlv_encode(info, &ns, buffer, sizeof(buffer), &bytes_written);
+
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        err = s_tlv_decode(buffer, bytes_written, on_tlv_decode_element, &data);
+        TEST_ASSERT_EQUAL(SERIALIZER_OK, err);
+
+        for (int i = 0; i < data.tlv_el_num; i++)
+            TEST_ASSERT_EQUAL(TLV_NO_FIELD_ID, data.tlv_els[i].field_id);
+    }
+}
+
 void setUp() {}
 void tearDown() {}
 
@@ -783,6 +1050,9 @@ int main() {
 
     RUN_TEST(test_tlv_encode_decode_test_structs);
     RUN_TEST(test_tlv_encode_decode_super_nested_struct);
+    RUN_TEST(test_tlv_encode_decode_varints);
+    RUN_TEST(test_tlv_encode_decode_compact_format);
+    RUN_TEST(test_tlv_encode_decode_omit_defaults);
 
     UNITY_END();
     return 0;
@@ -0,0 +1,1712 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#include "sss_gen.h"
+
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define S_GEN_MAX_TYPES (256)
+#define S_GEN_MAX_LITERAL (1024)
+#define S_GEN_MAX_PATH (4096)
+#define S_GEN_HEADER_SIZE (6) // 2-byte tag and 4-byte length of wire format v1
+
+typedef struct {
+    FILE* out;
+    const char* unit;
+    const s_type_info* types[S_GEN_MAX_TYPES];
+    size_t n_types;
+    int err;
+} s_gen;
+
+typedef enum {
+    S_GEN_FIELD_SCALAR,
+    S_GEN_FIELD_VARINT,
+    S_GEN_FIELD_STRING,
+    S_GEN_FIELD_STRING_FIXED,
+    S_GEN_FIELD_STRUCT,
+    S_GEN_FIELD_ARRAY,
+    S_GEN_FIELD_STRING_ARRAY,
+    S_GEN_FIELD_STRUCT_ARRAY,
+    S_GEN_FIELD_UNSUPPORTED
+} s_gen_field_kind;
+
+// helpers of generated code, same wire format as tlv.c
+static const char k_prelude[] =
+    "#define S_GEN_HEADER_SIZE (6)\n"
+    "#define S_GEN_TAG_FIELD (0x01)\n"
+    "#define S_GEN_TAG_NESTED (0x02)\n"
+    "#define S_GEN_TAG_LIST (0x03)\n"
+    "#define S_GEN_TAG_NESTED_LIST (0x04)\n"
+    "#define S_GEN_TAG_VARINT (0x09)\n"
+    "#define S_GEN_VARINT_MAX_SIZE (10)\n"
+    "\n"
+    "static inline void s_gen_header(uint8_t* p, uint16_t tag, uint32_t "
+    "length) {\n"
+    "    p[0] = (uint8_t) (tag >> 8);\n"
+    "    p[1] = (uint8_t) tag;\n"
+    "    p[2] = (uint8_t) (length >> 24);\n"
+    "    p[3] = (uint8_t) (length >> 16);\n"
+    "    p[4] = (uint8_t) (length >> 8);\n"
+    "    p[5] = (uint8_t) length;\n"
+    "}\n"
+    "\n"
+    "// moves p past header of element with the tag, false if there is none\n"
+    "static inline bool s_gen_element(const uint8_t** p, const uint8_t* end,\n"
+    "                                 uint16_t tag, uint32_t* length) {\n"
+    "    const uint8_t* q = *p;\n"
+    "\n"
+    "    if ((size_t) (end - q) < S_GEN_HEADER_SIZE || q[0] != (tag >> 8) ||\n"
+    "        q[1] != (uint8_t) tag)\n"
+    "        return false;\n"
+    "\n"
+    "    *length = ((uint32_t) q[2] << 24) | ((uint32_t) q[3] << 16) |\n"
+    "              ((uint32_t) q[4] << 8) | (uint32_t) q[5];\n"
+    "    *p = q + S_GEN_HEADER_SIZE;\n"
+    "\n"
+    "    return *length <= (size_t) (end - *p);\n"
+    "}\n"
+    "\n"
+    "// array size field, as s_tlv_array_size\n"
+    "static inline uint32_t s_gen_count(const void* data, size_t offset,\n"
+    "                                   size_t size) {\n"
+    "    const uint8_t* p = (const uint8_t*) data + offset;\n"
+    "\n"
+    "    switch (size) {\n"
+    "    case 1:\n"
+    "        return *p;\n"
+    "    case 2: {\n"
+    "        uint16_t count;\n"
+    "        memcpy(&count, p, sizeof(count));\n"
+    "        return count;\n"
+    "    }\n"
+    "    default: {\n"
+    "        uint32_t count;\n"
+    "        memcpy(&count, p, sizeof(count));\n"
+    "        return count;\n"
+    "    }\n"
+    "    }\n"
+    "}\n"
+    "\n"
+    "static inline int32_t s_gen_tag_int(const void* data, size_t offset) {\n"
+    "    int32_t tag;\n"
+    "\n"
+    "    memcpy(&tag, (const uint8_t*) data + offset, sizeof(tag));\n"
+    "\n"
+    "    return tag;\n"
+    "}\n"
+    "\n"
+    "static inline uint64_t s_gen_zigzag(int64_t value) {\n"
+    "    return ((uint64_t) value << 1) ^ (uint64_t) (value >> 63);\n"
+    "}\n"
+    "\n"
+    "static inline int64_t s_gen_unzigzag(uint64_t value) {\n"
+    "    return (int64_t) (value >> 1) ^ -(int64_t) (value & 1);\n"
+    "}\n"
+    "\n"
+    "static inline size_t s_gen_varint_size(uint64_t value) {\n"
+    "    size_t n = 1;\n"
+    "\n"
+    "    while (value >= 0x80) {\n"
+    "        value >>= 7;\n"
+    "        n++;\n"
+    "    }\n"
+    "\n"
+    "    return n;\n"
+    "}\n"
+    "\n"
+    "static inline size_t s_gen_varint_write(uint64_t value, uint8_t* out) "
+    "{\n"
+    "    size_t n = 0;\n"
+    "\n"
+    "    while (value >= 0x80) {\n"
+    "        out[n++] = (uint8_t) (value | 0x80);\n"
+    "        value >>= 7;\n"
+    "    }\n"
+    "    out[n++] = (uint8_t) value;\n"
+    "\n"
+    "    return n;\n"
+    "}\n"
+    "\n"
+    "// false unless varint takes exactly length bytes\n"
+    "static inline bool s_gen_varint_read(const uint8_t* p, uint32_t length,\n"
+    "                                     uint64_t* value) {\n"
+    "    uint64_t result = 0;\n"
+    "\n"
+    "    for (uint32_t i = 0; i < length && i < S_GEN_VARINT_MAX_SIZE; i++) "
+    "{\n"
+    "        result |= (uint64_t) (p[i] & 0x7F) << (7 * i);\n"
+    "\n"
+    "        if (!(p[i] & 0x80)) {\n"
+    "            *value = result;\n"
+    "            return i + 1 == length;\n"
+    "        }\n"
+    "    }\n"
+    "\n"
+    "    return false;\n"
+    "}\n"
+    "\n"
+    "static inline void s_gen_json_bytes(s_json_writer* w, const uint8_t* "
+    "data,\n"
+    "                                    size_t size) {\n"
+    "    if (w->base64_blobs) {\n"
+    "        s_json_append_base64(w, data, size);\n"
+    "        return;\n"
+    "    }\n"
+    "\n"
+    "    s_json_append_char(w, '[');\n"
+    "\n"
+    "    for (size_t i = 0; i < size; i++) {\n"
+    "        if (i != 0)\n"
+    "            s_json_append_char(w, ',');\n"
+    "\n"
+    "        s_json_append_uint(w, data[i]);\n"
+    "    }\n"
+    "\n"
+    "    s_json_append_char(w, ']');\n"
+    "}\n"
+    "\n"
+    "// NULL strings are written as empty\n"
+    "static inline void s_gen_json_string(s_json_writer* w, const char* str) "
+    "{\n"
+    "    s_json_append_string(w, str ? str : \"\", str ? strlen(str) : 0);\n"
+    "}\n"
+    "\n"
+    "static inline void s_gen_json_fail(s_json_writer* w) {\n"
+    "    if (w->err == SERIALIZER_OK)\n"
+    "        w->err = SERIALIZER_ERROR_INVALID_TYPE;\n"
+    "}\n";
+
+static void s_gen_fail(s_gen* g, const char* fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    fprintf(stderr, "sss-gen: ");
+    vfprintf(stderr, fmt, args);
+    fprintf(stderr, "\n");
+    va_end(args);
+
+    g->err = 1;
+}
+
+// line of generated code, indented by 4 spaces per level
+static void s_gen_line(s_gen* g, int indent, const char* fmt, ...) {
+    va_list args;
+
+    for (int i = 0; i < indent; i++)
+        fputs("    ", g->out);
+
+    va_start(args, fmt);
+    vfprintf(g->out, fmt, args);
+    va_end(args);
+
+    fputc('\n', g->out);
+}
+
+// C string literal of str
+static void s_gen_literal(const char* str, char* out, size_t out_size) {
+    size_t n = 0;
+
+    out[n++] = '"';
+
+    for (; *str && n + 6 < out_size; str++) {
+        unsigned char c = (unsigned char) *str;
+
+        if (c == '"' || c == '\\' || c == '?') {
+            out[n++] = '\\';
+            out[n++] = (char) c;
+        } else if (c < 0x20 || c >= 0x7F)
+            n += (size_t) snprintf(out + n, out_size - n, "\\%03o", c);
+        else
+            out[n++] = (char) c;
+    }
+
+    out[n++] = '"';
+    out[n] = '\0';
+}
+
+// json key as written by s_json_append_string, followed by ':'
+static void s_gen_json_key(const char* label, char* out, size_t out_size) {
+    static const char k_hex_digits[] = "0123456789abcdef";
+    char key[S_GEN_MAX_LITERAL];
+    size_t n = 0;
+
+    key[n++] = '"';
+
+    for (; *label && n + 8 < sizeof(key); label++) {
+        unsigned char c = (unsigned char) *label;
+
+        switch (c) {
+        case '"':
+        case '\\':
+            key[n++] = '\\';
+            key[n++] = (char) c;
+            break;
+        case '\b':
+            key[n++] = '\\';
+            key[n++] = 'b';
+            break;
+        case '\f':
+            key[n++] = '\\';
+            key[n++] = 'f';
+            break;
+        case '\n':
+            key[n++] = '\\';
+            key[n++] = 'n';
+            break;
+        case '\r':
+            key[n++] = '\\';
+            key[n++] = 'r';
+            break;
+        case '\t':
+            key[n++] = '\\';
+            key[n++] = 't';
+            break;
+        default:
+            if (c < 0x20) {
+                key[n++] = '\\';
+                key[n++] = 'u';
+                key[n++] = '0';
+                key[n++] = '0';
+                key[n++] = k_hex_digits[c >> 4];
+                key[n++] = k_hex_digits[c & 0xF];
+            } else
+                key[n++] = (char) c;
+            break;
+        }
+    }
+
+    key[n++] = '"';
+    key[n++] = ':';
+    key[n] = '\0';
+
+    s_gen_literal(key, out, out_size);
+}
+
+static bool s_gen_is_optional(const s_field_info* field) {
+    return field->opts & S_FIELD_OPT_OPTIONAL;
+}
+
+static bool s_gen_is_dynamic(const s_field_info* field) {
+    return field->opts & S_FIELD_OPT_ARRAY_DYNAMIC;
+}
+
+static bool s_gen_is_signed(const s_field_info* field) {
+    return field->type == FIELD_TYPE_INT8 || field->type == FIELD_TYPE_INT16 ||
+           field->type == FIELD_TYPE_INT32 || field->type == FIELD_TYPE_INT64;
+}
+
+static const char* s_gen_int_type(const s_field_info* field) {
+    switch (field->type) {
+    case FIELD_TYPE_INT8:
+        return "int8_t";
+    case FIELD_TYPE_UINT8:
+        return "uint8_t";
+    case FIELD_TYPE_INT16:
+        return "int16_t";
+    case FIELD_TYPE_UINT16:
+        return "uint16_t";
+    case FIELD_TYPE_INT32:
+        return "int32_t";
+    case FIELD_TYPE_UINT32:
+        return "uint32_t";
+    case FIELD_TYPE_INT64:
+        return "int64_t";
+    case FIELD_TYPE_UINT64:
+        return "uint64_t";
+    default:
+        return NULL;
+    }
+}
+
+// integer of element size, as arrays are written by json.c
+static const char* s_gen_sized_int_type(size_t size, bool is_signed) {
+    switch (size) {
+    case 1:
+        return is_signed ? "int8_t" : "uint8_t";
+    case 2:
+        return is_signed ? "int16_t" : "uint16_t";
+    case 4:
+        return is_signed ? "int32_t" : "uint32_t";
+    case 8:
+        return is_signed ? "int64_t" : "uint64_t";
+    default:
+        return NULL;
+    }
+}
+
+static s_gen_field_kind s_gen_kind(const s_field_info* field) {
+    switch (field->type) {
+    case FIELD_TYPE_INT8:
+    case FIELD_TYPE_UINT8:
+    case FIELD_TYPE_INT16:
+    case FIELD_TYPE_UINT16:
+    case FIELD_TYPE_INT32:
+    case FIELD_TYPE_UINT32:
+    case FIELD_TYPE_INT64:
+    case FIELD_TYPE_UINT64:
+        if (!(field->opts & S_FIELD_OPT_VARINT))
+            return S_GEN_FIELD_SCALAR;
+
+        return s_gen_sized_int_type(field->size, false)
+                   ? S_GEN_FIELD_VARINT
+                   : S_GEN_FIELD_UNSUPPORTED;
+    case FIELD_TYPE_BOOL:
+        return (field->opts & S_FIELD_OPT_BOOL_PACKED)
+                   ? S_GEN_FIELD_UNSUPPORTED
+                   : S_GEN_FIELD_SCALAR;
+    case FIELD_TYPE_FLOAT:
+    case FIELD_TYPE_DOUBLE:
+        return (field->opts & (S_FIELD_OPT_HALF | S_FIELD_OPT_FIXED))
+                   ? S_GEN_FIELD_UNSUPPORTED
+                   : S_GEN_FIELD_SCALAR;
+    case FIELD_TYPE_BLOB:
+        return S_GEN_FIELD_SCALAR;
+    case FIELD_TYPE_STRING:
+        return (field->opts & S_FIELD_OPT_STRING_FIXED)
+                   ? S_GEN_FIELD_STRING_FIXED
+                   : S_GEN_FIELD_STRING;
+    case FIELD_TYPE_STRUCT:
+        return field->struct_type_info ? S_GEN_FIELD_STRUCT
+                                       : S_GEN_FIELD_UNSUPPORTED;
+    case FIELD_TYPE_ARRAY: {
+        size_t count_size = field->array_field_info.size_field_size;
+
+        if (count_size != 1 && count_size != 2 && count_size != 4 &&
+            count_size != 8)
+            return S_GEN_FIELD_UNSUPPORTED;
+
+        if (field->struct_type_info)
+            return S_GEN_FIELD_STRUCT_ARRAY;
+
+        switch (field->array_field_info.builtin_type) {
+        case S_ARRAY_BUILTIN_TYPE_STRING:
+            return s_gen_is_dynamic(field) ? S_GEN_FIELD_UNSUPPORTED
+                                           : S_GEN_FIELD_STRING_ARRAY;
+        case S_ARRAY_BUILTIN_TYPE_FLOAT:
+            return (field->size == 4 || field->size == 8) &&
+                           !(field->opts &
+                             (S_FIELD_OPT_HALF | S_FIELD_OPT_FIXED))
+                       ? S_GEN_FIELD_ARRAY
+                       : S_GEN_FIELD_UNSUPPORTED;
+        case S_ARRAY_BUILTIN_TYPE_BITS:
+            return S_GEN_FIELD_UNSUPPORTED;
+        default:
+            return s_gen_sized_int_type(field->size, true)
+                       ? S_GEN_FIELD_ARRAY
+                       : S_GEN_FIELD_UNSUPPORTED;
+        }
+    }
+    default:
+        return S_GEN_FIELD_UNSUPPORTED;
+    }
+}
+
+// type has anything for free function to do
+static bool s_gen_needs_free(const s_type_info* info) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+
+        switch (s_gen_kind(field)) {
+        case S_GEN_FIELD_STRING:
+            return true;
+        case S_GEN_FIELD_ARRAY:
+            if (s_gen_is_dynamic(field))
+                return true;
+            break;
+        case S_GEN_FIELD_STRUCT:
+            if (s_gen_needs_free(field->struct_type_info))
+                return true;
+            break;
+        case S_GEN_FIELD_STRUCT_ARRAY:
+            if (s_gen_is_dynamic(field) ||
+                s_gen_needs_free(field->struct_type_info))
+                return true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+// field allocates when decoded and has to be undone on later errors
+static bool s_gen_needs_undo(const s_field_info* field) {
+    switch (s_gen_kind(field)) {
+    case S_GEN_FIELD_STRING:
+        return true;
+    case S_GEN_FIELD_ARRAY:
+        return s_gen_is_dynamic(field);
+    case S_GEN_FIELD_STRUCT:
+        return s_gen_needs_free(field->struct_type_info);
+    case S_GEN_FIELD_STRUCT_ARRAY:
+        return s_gen_is_dynamic(field) ||
+               s_gen_needs_free(field->struct_type_info);
+    default:
+        return false;
+    }
+}
+
+static bool s_gen_uses_allocator(const s_type_info* info) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        switch (s_gen_kind(&info->fields[i])) {
+        case S_GEN_FIELD_STRING:
+        case S_GEN_FIELD_STRUCT:
+        case S_GEN_FIELD_STRUCT_ARRAY:
+            return true;
+        case S_GEN_FIELD_ARRAY:
+            if (s_gen_is_dynamic(&info->fields[i]))
+                return true;
+            break;
+        default:
+            break;
+        }
+    }
+
+    return false;
+}
+
+static bool s_gen_has_optional(const s_type_info* info) {
+    for (size_t i = 0; i < info->field_count; i++) {
+        if (s_gen_is_optional(&info->fields[i]))
+            return true;
+    }
+
+    return false;
+}
+
+// condition of union member being encoded, as is_field_present
+static void s_gen_condition(const s_field_info* field, char* out,
+                            size_t out_size) {
+    if (field->optional_field_info.tag_type == FIELD_TYPE_INT32) {
+        snprintf(out, out_size, "s_gen_tag_int(data, %zu) == %d",
+                 field->optional_field_info.tag_offset,
+                 field->optional_field_info.tag_value_int);
+    } else {
+        char literal[S_GEN_MAX_LITERAL];
+
+        s_gen_literal(field->optional_field_info.tag_value_string, literal,
+                      sizeof(literal));
+        snprintf(out, out_size, "strcmp((const char*) data + %zu, %s) == 0",
+                 field->optional_field_info.tag_offset, literal);
+    }
+}
+
+// decoder only sees union members whose tag was decoded before them, in
+// which case the tag is already in data
+static bool s_gen_is_decodable(const s_type_info* info, size_t field_idx) {
+    const s_field_info* field = &info->fields[field_idx];
+
+    if (!s_gen_is_optional(field))
+        return true;
+
+    for (size_t i = 0; i < field_idx; i++) {
+        if (info->fields[i].offset == field->optional_field_info.tag_offset)
+            return true;
+    }
+
+    return false;
+}
+
+// opens block of union member, returns indent of its body
+static int s_gen_begin_field(s_gen* g, const s_field_info* field,
+                             int indent) {
+    char condition[S_GEN_MAX_LITERAL];
+
+    if (!s_gen_is_optional(field))
+        return indent;
+
+    s_gen_condition(field, condition, sizeof(condition));
+    s_gen_line(g, indent, "if (%s) {", condition);
+
+    return indent + 1;
+}
+
+static void s_gen_end_field(s_gen* g, const s_field_info* field,
+                            int indent) {
+    if (s_gen_is_optional(field))
+        s_gen_line(g, indent, "}");
+}
+
+static void s_gen_count(s_gen* g, const s_field_info* field, int indent) {
+    s_gen_line(g, indent, "uint32_t count = s_gen_count(data, %zu, %zu);",
+               field->array_field_info.size_field_offset,
+               field->array_field_info.size_field_size);
+}
+
+static void s_gen_add_type(s_gen* g, const s_type_info* info) {
+    for (size_t i = 0; i < g->n_types; i++) {
+        if (g->types[i] == info)
+            return;
+    }
+
+    if (g->n_types == S_GEN_MAX_TYPES) {
+        s_gen_fail(g, "too many types");
+        return;
+    }
+
+    // placeholder against self-referencing dynamic arrays
+    size_t idx = g->n_types++;
+    g->types[idx] = info;
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+
+        if (s_gen_kind(field) == S_GEN_FIELD_UNSUPPORTED) {
+            s_gen_fail(g, "%s::%s: unsupported field", info->type_name,
+                       field->name);
+            continue;
+        }
+
+        if (field->struct_type_info)
+            s_gen_add_type(g, field->struct_type_info);
+    }
+}
+
+static void s_gen_prototypes(s_gen* g, const s_type_info* info,
+                             bool is_static) {
+    const char* unit = g->unit;
+    const char* type = info->type_name;
+
+    if (is_static) {
+        s_gen_line(g, 0, "static bool %s_measure_%s(const %s* data, "
+                         "size_t* size);", unit, type, type);
+        s_gen_line(g, 0, "static uint8_t* %s_write_%s(const %s* data, "
+                         "uint8_t* p);", unit, type, type);
+        s_gen_line(g, 0, "static const uint8_t* %s_read_%s(%s* data, "
+                         "const uint8_t* p,", unit, type, type);
+        s_gen_line(g, 1, "const uint8_t* end, bool exact, s_allocator* "
+                         "allocator, void* user_data);");
+        s_gen_line(g, 0, "static void %s_json_%s(s_json_writer* w, "
+                         "const %s* data);", unit, type, type);
+        return;
+    }
+
+    s_gen_line(g, 0, "// %s", type);
+    s_gen_line(g, 0, "s_serializer_error %s_size_%s(const %s* data, "
+                     "size_t* size);", unit, type, type);
+    s_gen_line(g, 0, "s_serializer_error %s_encode_%s(const %s* data, "
+                     "uint8_t* buffer,", unit, type, type);
+    s_gen_line(g, 1, "size_t buffer_size, size_t* bytes_written);");
+    s_gen_line(g, 0, "s_serializer_error %s_decode_%s(%s* data, "
+                     "const uint8_t* buffer,", unit, type, type);
+    s_gen_line(g, 1, "size_t buffer_size, s_allocator* allocator, "
+                     "void* user_data);");
+    s_gen_line(g, 0, "s_serializer_error %s_to_json_%s("
+                     "s_deserialize_options opts,", unit, type);
+    s_gen_line(g, 1, "const %s* data, char* out, size_t out_size);", type);
+    s_gen_line(g, 0, "void %s_free_%s(%s* data, s_allocator* allocator, "
+                     "void* user_data);", unit, type, type);
+}
+
+static void s_gen_measure(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    size_t fixed_size = 0;
+    bool is_fixed = true;
+
+    // headers and values of fixed-size fields are added up here
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+
+        if (s_gen_is_optional(field)) {
+            is_fixed = false;
+            continue;
+        }
+
+        fixed_size += S_GEN_HEADER_SIZE;
+
+        if (s_gen_kind(field) == S_GEN_FIELD_SCALAR)
+            fixed_size += field->size;
+        else
+            is_fixed = false;
+    }
+
+    s_gen_line(g, 0, "static bool %s_measure_%s(const %s* data, "
+                     "size_t* size) {", unit, info->type_name,
+               info->type_name);
+    s_gen_line(g, 1, "size_t n = %zu;", fixed_size);
+    s_gen_line(g, 0, "");
+
+    if (is_fixed)
+        s_gen_line(g, 1, "(void) data;");
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* name = field->name;
+        const char* header =
+            s_gen_is_optional(field) ? "S_GEN_HEADER_SIZE + " : "";
+        const char* sub_type =
+            field->struct_type_info ? field->struct_type_info->type_name : "";
+        s_gen_field_kind kind = s_gen_kind(field);
+
+        if (kind == S_GEN_FIELD_SCALAR && !s_gen_is_optional(field))
+            continue;
+
+        int indent = s_gen_begin_field(g, field, 1);
+
+        switch (kind) {
+        case S_GEN_FIELD_SCALAR: {
+            s_gen_line(g, indent, "n += S_GEN_HEADER_SIZE + %zu;",
+                       field->size);
+        } break;
+        case S_GEN_FIELD_VARINT: {
+            if (s_gen_is_signed(field))
+                s_gen_line(g, indent, "n += %ss_gen_varint_size(s_gen_zigzag("
+                                      "(%s) data->%s));", header,
+                           s_gen_int_type(field), name);
+            else
+                s_gen_line(g, indent, "n += %ss_gen_varint_size((%s) "
+                                      "data->%s);", header,
+                           s_gen_int_type(field), name);
+        } break;
+        case S_GEN_FIELD_STRING: {
+            s_gen_line(g, indent, "n += %s(data->%s ? strlen(data->%s) + 1 "
+                                  ": 0);", header, name, name);
+        } break;
+        case S_GEN_FIELD_STRING_FIXED: {
+            s_gen_line(g, indent, "n += %sstrlen(data->%s) + 1;", header,
+                       name);
+        } break;
+        case S_GEN_FIELD_STRUCT: {
+            s_gen_line(g, indent, "size_t sub_size = 0;");
+            s_gen_line(g, indent, "if (!%s_measure_%s(&data->%s, "
+                                  "&sub_size))", unit, sub_type, name);
+            s_gen_line(g, indent + 1, "return false;");
+            s_gen_line(g, indent, "n += %ssub_size;", header);
+        } break;
+        case S_GEN_FIELD_ARRAY:
+        case S_GEN_FIELD_STRING_ARRAY:
+        case S_GEN_FIELD_STRUCT_ARRAY: {
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+
+            if (s_gen_is_dynamic(field))
+                s_gen_line(g, indent + 1, "if (count && !data->%s)", name);
+            else
+                s_gen_line(g, indent + 1, "if (count > %zu)",
+                           field->array_field_info.capacity);
+
+            s_gen_line(g, indent + 2, "return false;");
+
+            if (kind == S_GEN_FIELD_ARRAY) {
+                s_gen_line(g, indent + 1, "n += %s(size_t) count * %zu;",
+                           header, field->size);
+            } else {
+                if (*header)
+                    s_gen_line(g, indent + 1, "n += S_GEN_HEADER_SIZE;");
+
+                s_gen_line(g, indent + 1, "for (uint32_t i = 0; i < count; "
+                                          "i++) {");
+
+                if (kind == S_GEN_FIELD_STRING_ARRAY) {
+                    s_gen_line(g, indent + 2, "n += strlen(data->%s[i]) + 1;",
+                               name);
+                } else {
+                    s_gen_line(g, indent + 2, "size_t sub_size = 0;");
+                    s_gen_line(g, indent + 2, "if (!%s_measure_%s(&data->%s[i],"
+                                              " &sub_size))", unit, sub_type,
+                               name);
+                    s_gen_line(g, indent + 3, "return false;");
+                    s_gen_line(g, indent + 2, "n += sub_size;");
+                }
+
+                s_gen_line(g, indent + 1, "}");
+            }
+
+            s_gen_line(g, indent, "}");
+        } break;
+        default:
+            break;
+        }
+
+        s_gen_end_field(g, field, 1);
+    }
+
+    s_gen_line(g, 1, "*size = n;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return true;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+static void s_gen_write(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+
+    s_gen_line(g, 0, "static uint8_t* %s_write_%s(const %s* data, "
+                     "uint8_t* p) {", unit, info->type_name,
+               info->type_name);
+
+    if (!info->field_count)
+        s_gen_line(g, 1, "(void) data;");
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* name = field->name;
+        const char* sub_type =
+            field->struct_type_info ? field->struct_type_info->type_name : "";
+        s_gen_field_kind kind = s_gen_kind(field);
+
+        s_gen_line(g, 1, "// %s", name);
+        int indent = s_gen_begin_field(g, field, 1);
+
+        switch (kind) {
+        case S_GEN_FIELD_SCALAR: {
+            s_gen_line(g, indent, "s_gen_header(p, S_GEN_TAG_FIELD, %zu);",
+                       field->size);
+            s_gen_line(g, indent, "memcpy(p + S_GEN_HEADER_SIZE, &data->%s, "
+                                  "%zu);", name, field->size);
+            s_gen_line(g, indent, "p += S_GEN_HEADER_SIZE + %zu;",
+                       field->size);
+        } break;
+        case S_GEN_FIELD_VARINT: {
+            s_gen_line(g, indent, "{");
+
+            if (s_gen_is_signed(field))
+                s_gen_line(g, indent + 1, "size_t length = s_gen_varint_write("
+                                          "s_gen_zigzag((%s) data->%s),",
+                           s_gen_int_type(field), name);
+            else
+                s_gen_line(g, indent + 1, "size_t length = s_gen_varint_write("
+                                          "(%s) data->%s,",
+                           s_gen_int_type(field), name);
+
+            s_gen_line(g, indent + 3, "p + S_GEN_HEADER_SIZE);");
+            s_gen_line(g, indent + 1, "s_gen_header(p, S_GEN_TAG_VARINT, "
+                                      "(uint32_t) length);");
+            s_gen_line(g, indent + 1, "p += S_GEN_HEADER_SIZE + length;");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRING:
+        case S_GEN_FIELD_STRING_FIXED: {
+            s_gen_line(g, indent, "{");
+
+            if (kind == S_GEN_FIELD_STRING)
+                s_gen_line(g, indent + 1, "size_t length = data->%s ? "
+                                          "strlen(data->%s) + 1 : 0;", name,
+                           name);
+            else
+                s_gen_line(g, indent + 1, "size_t length = strlen(data->%s) "
+                                          "+ 1;", name);
+
+            s_gen_line(g, indent + 1, "s_gen_header(p, S_GEN_TAG_FIELD, "
+                                      "(uint32_t) length);");
+
+            if (kind == S_GEN_FIELD_STRING) {
+                s_gen_line(g, indent + 1, "if (length)");
+                s_gen_line(g, indent + 2, "memcpy(p + S_GEN_HEADER_SIZE, "
+                                          "data->%s, length);", name);
+            } else
+                s_gen_line(g, indent + 1, "memcpy(p + S_GEN_HEADER_SIZE, "
+                                          "data->%s, length);", name);
+
+            s_gen_line(g, indent + 1, "p += S_GEN_HEADER_SIZE + length;");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRUCT: {
+            s_gen_line(g, indent, "{");
+            s_gen_line(g, indent + 1, "uint8_t* start = p + "
+                                      "S_GEN_HEADER_SIZE;");
+            s_gen_line(g, indent + 1, "p = %s_write_%s(&data->%s, start);",
+                       unit, sub_type, name);
+            s_gen_line(g, indent + 1, "s_gen_header(start - "
+                                      "S_GEN_HEADER_SIZE, S_GEN_TAG_NESTED,");
+            s_gen_line(g, indent + 3, "(uint32_t) (p - start));");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_ARRAY: {
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+            s_gen_line(g, indent + 1, "size_t length = (size_t) count * "
+                                      "%zu;", field->size);
+            s_gen_line(g, indent + 1, "s_gen_header(p, S_GEN_TAG_LIST, "
+                                      "(uint32_t) length);");
+            s_gen_line(g, indent + 1, "if (length)");
+            s_gen_line(g, indent + 2, "memcpy(p + S_GEN_HEADER_SIZE, "
+                                      "&data->%s[0], length);", name);
+            s_gen_line(g, indent + 1, "p += S_GEN_HEADER_SIZE + length;");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRING_ARRAY:
+        case S_GEN_FIELD_STRUCT_ARRAY: {
+            bool is_string = kind == S_GEN_FIELD_STRING_ARRAY;
+
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+            s_gen_line(g, indent + 1, "uint8_t* start = p + "
+                                      "S_GEN_HEADER_SIZE;");
+            s_gen_line(g, indent + 1, "p = start;");
+            s_gen_line(g, indent + 1, "for (uint32_t i = 0; i < count; i++) "
+                                      "{");
+
+            if (is_string) {
+                s_gen_line(g, indent + 2, "size_t length = "
+                                          "strlen(data->%s[i]) + 1;", name);
+                s_gen_line(g, indent + 2, "memcpy(p, data->%s[i], length);",
+                           name);
+                s_gen_line(g, indent + 2, "p += length;");
+            } else
+                s_gen_line(g, indent + 2, "p = %s_write_%s(&data->%s[i], p);",
+                           unit, sub_type, name);
+
+            s_gen_line(g, indent + 1, "}");
+            s_gen_line(g, indent + 1, "s_gen_header(start - "
+                                      "S_GEN_HEADER_SIZE, %s,",
+                       is_string ? "S_GEN_TAG_LIST" : "S_GEN_TAG_NESTED_LIST");
+            s_gen_line(g, indent + 3, "(uint32_t) (p - start));");
+            s_gen_line(g, indent, "}");
+        } break;
+        default:
+            break;
+        }
+
+        s_gen_end_field(g, field, 1);
+    }
+
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return p;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+// releases what decoder allocated for field
+static void s_gen_undo(s_gen* g, const s_field_info* field, size_t field_idx,
+                       int indent) {
+    const char* unit = g->unit;
+    const char* name = field->name;
+    int outer = indent;
+
+    indent = s_gen_begin_field(g, field, indent);
+
+    switch (s_gen_kind(field)) {
+    case S_GEN_FIELD_STRING:
+    case S_GEN_FIELD_ARRAY: {
+        s_gen_line(g, indent, "if (data->%s) {", name);
+        s_gen_line(g, indent + 1, "allocator->deallocate((void*) data->%s, "
+                                  "user_data);", name);
+        s_gen_line(g, indent + 1, "data->%s = NULL;", name);
+        s_gen_line(g, indent, "}");
+    } break;
+    case S_GEN_FIELD_STRUCT: {
+        s_gen_line(g, indent, "%s_free_%s(&data->%s, allocator, user_data);",
+                   unit, field->struct_type_info->type_name, name);
+    } break;
+    case S_GEN_FIELD_STRUCT_ARRAY: {
+        if (s_gen_needs_free(field->struct_type_info)) {
+            s_gen_line(g, indent, "for (uint32_t i = 0; i < n_decoded_%zu; "
+                                  "i++)", field_idx);
+            s_gen_line(g, indent + 1, "%s_free_%s(&data->%s[i], allocator, "
+                                      "user_data);", unit,
+                       field->struct_type_info->type_name, name);
+        }
+
+        if (s_gen_is_dynamic(field)) {
+            s_gen_line(g, indent, "if (is_allocated_%zu) {", field_idx);
+            s_gen_line(g, indent + 1, "allocator->deallocate(data->%s, "
+                                      "user_data);", name);
+            s_gen_line(g, indent + 1, "data->%s = NULL;", name);
+            s_gen_line(g, indent, "}");
+        }
+    } break;
+    default:
+        break;
+    }
+
+    s_gen_end_field(g, field, outer);
+}
+
+static void s_gen_read(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    // fail_<n> labels undo n allocating fields decoded so far
+    bool labels[S_MAX_FIELDS + 1] = {false};
+    size_t undo_fields[S_MAX_FIELDS];
+    size_t n_undo = 0;
+
+    s_gen_line(g, 0, "static const uint8_t* %s_read_%s(%s* data, "
+                     "const uint8_t* p,", unit, info->type_name,
+               info->type_name);
+    s_gen_line(g, 1, "const uint8_t* end, bool exact, s_allocator* "
+                     "allocator, void* user_data) {");
+
+    if (info->field_count)
+        s_gen_line(g, 1, "uint32_t length = 0;");
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+
+        if (s_gen_kind(field) != S_GEN_FIELD_STRUCT_ARRAY ||
+            !s_gen_is_decodable(info, i))
+            continue;
+
+        s_gen_line(g, 1, "uint32_t n_decoded_%zu = 0;", i);
+
+        if (s_gen_is_dynamic(field))
+            s_gen_line(g, 1, "bool is_allocated_%zu = false;", i);
+    }
+
+    if (!s_gen_uses_allocator(info)) {
+        s_gen_line(g, 1, "(void) allocator;");
+        s_gen_line(g, 1, "(void) user_data;");
+    }
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* name = field->name;
+        const char* sub_type =
+            field->struct_type_info ? field->struct_type_info->type_name : "";
+        s_gen_field_kind kind = s_gen_kind(field);
+        size_t fail = n_undo;
+
+        if (!s_gen_is_decodable(info, i))
+            continue;
+
+        labels[fail] = true;
+        s_gen_line(g, 0, "");
+        s_gen_line(g, 1, "// %s", name);
+        int indent = s_gen_begin_field(g, field, 1);
+
+        switch (kind) {
+        case S_GEN_FIELD_SCALAR: {
+            s_gen_line(g, indent, "if (!s_gen_element(&p, end, "
+                                  "S_GEN_TAG_FIELD, &length) ||");
+            s_gen_line(g, indent + 1, "length != %zu)", field->size);
+            s_gen_line(g, indent + 1, "goto fail_%zu;", fail);
+            s_gen_line(g, indent, "memcpy(&data->%s, p, %zu);", name,
+                       field->size);
+            s_gen_line(g, indent, "p += length;");
+        } break;
+        case S_GEN_FIELD_VARINT: {
+            const char* type = s_gen_sized_int_type(field->size, false);
+
+            s_gen_line(g, indent, "{");
+            s_gen_line(g, indent + 1, "uint64_t value = 0;");
+            s_gen_line(g, indent + 1, "%s scalar;", type);
+            s_gen_line(g, indent + 1, "if (!s_gen_element(&p, end, "
+                                      "S_GEN_TAG_VARINT, &length) ||");
+            s_gen_line(g, indent + 2, "!s_gen_varint_read(p, length, "
+                                      "&value))");
+            s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+
+            if (s_gen_is_signed(field))
+                s_gen_line(g, indent + 1, "scalar = (%s) s_gen_unzigzag("
+                                          "value);", type);
+            else
+                s_gen_line(g, indent + 1, "scalar = (%s) value;", type);
+
+            s_gen_line(g, indent + 1, "memcpy(&data->%s, &scalar, "
+                                      "sizeof(scalar));", name);
+            s_gen_line(g, indent + 1, "p += length;");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRING: {
+            s_gen_line(g, indent, "if (!s_gen_element(&p, end, "
+                                  "S_GEN_TAG_FIELD, &length))");
+            s_gen_line(g, indent + 1, "goto fail_%zu;", fail);
+            s_gen_line(g, indent, "data->%s = NULL;", name);
+            s_gen_line(g, indent, "if (length) {");
+            s_gen_line(g, indent + 1, "char* str = (char*) "
+                                      "allocator->allocate(length, "
+                                      "user_data);");
+            s_gen_line(g, indent + 1, "if (!str)");
+            s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+            s_gen_line(g, indent + 1, "memcpy(str, p, length);");
+            s_gen_line(g, indent + 1, "data->%s = str;", name);
+            s_gen_line(g, indent, "}");
+            s_gen_line(g, indent, "p += length;");
+        } break;
+        case S_GEN_FIELD_STRING_FIXED: {
+            s_gen_line(g, indent, "if (!s_gen_element(&p, end, "
+                                  "S_GEN_TAG_FIELD, &length) ||");
+            s_gen_line(g, indent + 1, "length > %zu)", field->size);
+            s_gen_line(g, indent + 1, "goto fail_%zu;", fail);
+            s_gen_line(g, indent, "memcpy(data->%s, p, length);", name);
+            s_gen_line(g, indent, "p += length;");
+        } break;
+        case S_GEN_FIELD_STRUCT: {
+            s_gen_line(g, indent, "if (!s_gen_element(&p, end, "
+                                  "S_GEN_TAG_NESTED, &length) ||");
+            s_gen_line(g, indent + 1, "!%s_read_%s(&data->%s, p, p + length, "
+                                      "true, allocator,", unit, sub_type,
+                       name);
+            s_gen_line(g, indent + 3, "user_data))");
+            s_gen_line(g, indent + 1, "goto fail_%zu;", fail);
+            s_gen_line(g, indent, "p += length;");
+        } break;
+        case S_GEN_FIELD_ARRAY: {
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+            s_gen_line(g, indent + 1, "if (!s_gen_element(&p, end, "
+                                      "S_GEN_TAG_LIST, &length) ||");
+
+            if (s_gen_is_dynamic(field)) {
+                s_gen_line(g, indent + 2, "length != (size_t) count * %zu)",
+                           field->size);
+                s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+                s_gen_line(g, indent + 1, "data->%s = NULL;", name);
+                s_gen_line(g, indent + 1, "if (length) {");
+                s_gen_line(g, indent + 2, "void* array = "
+                                          "allocator->allocate(length, "
+                                          "user_data);");
+                s_gen_line(g, indent + 2, "if (!array)");
+                s_gen_line(g, indent + 3, "goto fail_%zu;", fail);
+                s_gen_line(g, indent + 2, "memcpy(array, p, length);");
+                s_gen_line(g, indent + 2, "data->%s = array;", name);
+                s_gen_line(g, indent + 1, "}");
+            } else {
+                s_gen_line(g, indent + 2, "count > %zu || length != "
+                                          "(size_t) count * %zu)",
+                           field->array_field_info.capacity, field->size);
+                s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+                s_gen_line(g, indent + 1, "memcpy(data->%s, p, length);",
+                           name);
+            }
+
+            s_gen_line(g, indent + 1, "p += length;");
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRING_ARRAY: {
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+            s_gen_line(g, indent + 1, "const uint8_t* list_end;");
+            s_gen_line(g, indent + 1, "if (!s_gen_element(&p, end, "
+                                      "S_GEN_TAG_LIST, &length) ||");
+            s_gen_line(g, indent + 2, "count > %zu)",
+                       field->array_field_info.capacity);
+            s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+            s_gen_line(g, indent + 1, "list_end = p + length;");
+            s_gen_line(g, indent + 1, "for (uint32_t i = 0; i < count; i++) "
+                                      "{");
+            s_gen_line(g, indent + 2, "const uint8_t* str_end = "
+                                      "memchr(p, '\\0', (size_t) (list_end "
+                                      "- p));");
+            s_gen_line(g, indent + 2, "if (!str_end || (size_t) (str_end - p)"
+                                      " >= %zu)", field->size);
+            s_gen_line(g, indent + 3, "goto fail_%zu;", fail);
+            s_gen_line(g, indent + 2, "memcpy(data->%s[i], p, (size_t) "
+                                      "(str_end - p) + 1);", name);
+            s_gen_line(g, indent + 2, "p = str_end + 1;");
+            s_gen_line(g, indent + 1, "}");
+            s_gen_line(g, indent + 1, "if (p != list_end)");
+            s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+            s_gen_line(g, indent, "}");
+        } break;
+        case S_GEN_FIELD_STRUCT_ARRAY: {
+            // partially decoded array is undone with the field itself
+            size_t own_fail = s_gen_needs_undo(field) ? fail + 1 : fail;
+
+            labels[own_fail] = true;
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+            s_gen_line(g, indent + 1, "const uint8_t* list_end;");
+            s_gen_line(g, indent + 1, "if (!s_gen_element(&p, end, "
+                                      "S_GEN_TAG_NESTED_LIST, &length))");
+            s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+
+            if (s_gen_is_dynamic(field)) {
+                s_gen_line(g, indent + 1, "if (!count) {");
+                s_gen_line(g, indent + 2, "data->%s = NULL;", name);
+                s_gen_line(g, indent + 1, "} else if (!data->%s) {", name);
+                s_gen_line(g, indent + 2, "size_t size = (size_t) count * "
+                                          "sizeof(data->%s[0]);", name);
+                s_gen_line(g, indent + 2, "data->%s = allocator->allocate("
+                                          "size, user_data);", name);
+                s_gen_line(g, indent + 2, "if (!data->%s)", name);
+                s_gen_line(g, indent + 3, "goto fail_%zu;", fail);
+                s_gen_line(g, indent + 2, "memset(data->%s, 0, size);", name);
+                s_gen_line(g, indent + 2, "is_allocated_%zu = true;", i);
+                s_gen_line(g, indent + 1, "}");
+            } else {
+                s_gen_line(g, indent + 1, "if (count > %zu)",
+                           field->array_field_info.capacity);
+                s_gen_line(g, indent + 2, "goto fail_%zu;", fail);
+            }
+
+            s_gen_line(g, indent + 1, "list_end = p + length;");
+            s_gen_line(g, indent + 1, "for (; n_decoded_%zu < count; "
+                                      "n_decoded_%zu++) {", i, i);
+            s_gen_line(g, indent + 2, "p = %s_read_%s(&data->%s[n_decoded_%zu]"
+                                      ", p, list_end, false,", unit,
+                       sub_type, name, i);
+            s_gen_line(g, indent + 4, "allocator, user_data);");
+            s_gen_line(g, indent + 2, "if (!p)");
+            s_gen_line(g, indent + 3, "goto fail_%zu;", own_fail);
+            s_gen_line(g, indent + 1, "}");
+            s_gen_line(g, indent + 1, "if (p != list_end)");
+            s_gen_line(g, indent + 2, "goto fail_%zu;", own_fail);
+            s_gen_line(g, indent, "}");
+        } break;
+        default:
+            break;
+        }
+
+        s_gen_end_field(g, field, 1);
+
+        if (s_gen_needs_undo(field))
+            undo_fields[n_undo++] = i;
+    }
+
+    labels[n_undo] = true;
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "if (exact && p != end)");
+    s_gen_line(g, 2, "goto fail_%zu;", n_undo);
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return p;");
+    s_gen_line(g, 0, "");
+
+    for (size_t n = n_undo + 1; n-- > 0;) {
+        if (labels[n])
+            s_gen_line(g, 0, "fail_%zu:", n);
+
+        if (n)
+            s_gen_undo(g, &info->fields[undo_fields[n - 1]],
+                       undo_fields[n - 1], 1);
+    }
+
+    s_gen_line(g, 1, "return NULL;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+static void s_gen_json(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    bool has_optional = s_gen_has_optional(info);
+
+    s_gen_line(g, 0, "static void %s_json_%s(s_json_writer* w, const %s* "
+                     "data) {", unit, info->type_name, info->type_name);
+
+    if (has_optional)
+        s_gen_line(g, 1, "bool is_first = true;");
+
+    if (!info->field_count)
+        s_gen_line(g, 1, "(void) data;");
+
+    s_gen_line(g, 1, "s_json_append_char(w, '{');");
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* name = field->name;
+        const char* sub_type =
+            field->struct_type_info ? field->struct_type_info->type_name : "";
+        char key[S_GEN_MAX_LITERAL];
+        s_gen_field_kind kind = s_gen_kind(field);
+
+        s_gen_json_key(field->label ? field->label : field->name, key,
+                       sizeof(key));
+        s_gen_line(g, 0, "");
+        s_gen_line(g, 1, "// %s", name);
+        int indent = s_gen_begin_field(g, field, 1);
+
+        if (has_optional) {
+            s_gen_line(g, indent, "if (!is_first)");
+            s_gen_line(g, indent + 1, "s_json_append_char(w, ',');");
+            s_gen_line(g, indent, "is_first = false;");
+        } else if (i != 0)
+            s_gen_line(g, indent, "s_json_append_char(w, ',');");
+
+        s_gen_line(g, indent, "JSON_APPEND(w, %s);", key);
+
+        switch (field->type) {
+        case FIELD_TYPE_INT8:
+        case FIELD_TYPE_INT16:
+        case FIELD_TYPE_INT32:
+        case FIELD_TYPE_INT64: {
+            s_gen_line(g, indent, "s_json_append_int(w, (%s) data->%s);",
+                       s_gen_int_type(field), name);
+        } break;
+        case FIELD_TYPE_UINT8:
+        case FIELD_TYPE_UINT16:
+        case FIELD_TYPE_UINT32:
+        case FIELD_TYPE_UINT64: {
+            s_gen_line(g, indent, "s_json_append_uint(w, (%s) data->%s);",
+                       s_gen_int_type(field), name);
+        } break;
+        case FIELD_TYPE_FLOAT: {
+            s_gen_line(g, indent, "s_json_append_float(w, data->%s);", name);
+        } break;
+        case FIELD_TYPE_DOUBLE: {
+            s_gen_line(g, indent, "s_json_append_double(w, data->%s);",
+                       name);
+        } break;
+        case FIELD_TYPE_BOOL: {
+            s_gen_line(g, indent, "if (data->%s)", name);
+            s_gen_line(g, indent + 1, "JSON_APPEND(w, \"true\");");
+            s_gen_line(g, indent, "else");
+            s_gen_line(g, indent + 1, "JSON_APPEND(w, \"false\");");
+        } break;
+        case FIELD_TYPE_BLOB: {
+            s_gen_line(g, indent, "s_gen_json_bytes(w, (const uint8_t*) "
+                                  "&data->%s, %zu);", name, field->size);
+        } break;
+        case FIELD_TYPE_STRING: {
+            s_gen_line(g, indent, "s_gen_json_string(w, data->%s);", name);
+        } break;
+        case FIELD_TYPE_STRUCT: {
+            s_gen_line(g, indent, "%s_json_%s(w, &data->%s);", unit,
+                       sub_type, name);
+        } break;
+        case FIELD_TYPE_ARRAY: {
+            bool is_bytes =
+                kind == S_GEN_FIELD_ARRAY && field->size == 1 &&
+                field->array_field_info.builtin_type ==
+                    S_ARRAY_BUILTIN_TYPE_BLOB;
+
+            s_gen_line(g, indent, "{");
+            s_gen_count(g, field, indent + 1);
+
+            if (s_gen_is_dynamic(field))
+                s_gen_line(g, indent + 1, "if (count && !data->%s) {", name);
+            else
+                s_gen_line(g, indent + 1, "if (count > %zu) {",
+                           field->array_field_info.capacity);
+
+            s_gen_line(g, indent + 2, "s_gen_json_fail(w);");
+            s_gen_line(g, indent + 2, "return;");
+            s_gen_line(g, indent + 1, "}");
+
+            int loop_indent = indent + 1;
+
+            if (is_bytes) {
+                s_gen_line(g, indent + 1, "if (w->base64_blobs) {");
+                s_gen_line(g, indent + 2, "s_json_append_base64(w, "
+                                          "(const uint8_t*) data->%s, "
+                                          "count);", name);
+                s_gen_line(g, indent + 1, "} else {");
+                loop_indent++;
+            }
+
+            s_gen_line(g, loop_indent, "s_json_append_char(w, '[');");
+            s_gen_line(g, loop_indent, "for (uint32_t i = 0; i < count; i++) "
+                                       "{");
+            s_gen_line(g, loop_indent + 1, "if (i != 0)");
+            s_gen_line(g, loop_indent + 2, "s_json_append_char(w, ',');");
+
+            if (kind == S_GEN_FIELD_STRUCT_ARRAY)
+                s_gen_line(g, loop_indent + 1, "%s_json_%s(w, "
+                                               "&data->%s[i]);", unit,
+                           sub_type, name);
+            else if (kind == S_GEN_FIELD_STRING_ARRAY)
+                s_gen_line(g, loop_indent + 1, "s_json_append_string(w, "
+                                               "data->%s[i], "
+                                               "strlen(data->%s[i]));", name,
+                           name);
+            else if (field->array_field_info.builtin_type ==
+                     S_ARRAY_BUILTIN_TYPE_FLOAT)
+                s_gen_line(g, loop_indent + 1, "s_json_append_%s(w, "
+                                               "((const %s*) data->%s)[i]);",
+                           field->size == 4 ? "float" : "double",
+                           field->size == 4 ? "float" : "double", name);
+            else
+                s_gen_line(g, loop_indent + 1, "s_json_append_int(w, "
+                                               "((const %s*) data->%s)[i]);",
+                           s_gen_sized_int_type(field->size, true), name);
+
+            s_gen_line(g, loop_indent, "}");
+            s_gen_line(g, loop_indent, "s_json_append_char(w, ']');");
+
+            if (is_bytes)
+                s_gen_line(g, indent + 1, "}");
+
+            s_gen_line(g, indent, "}");
+        } break;
+        default:
+            break;
+        }
+
+        s_gen_end_field(g, field, 1);
+    }
+
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "s_json_append_char(w, '}');");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+static void s_gen_free(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    const char* type = info->type_name;
+
+    s_gen_line(g, 0, "void %s_free_%s(%s* data, s_allocator* allocator, "
+                     "void* user_data) {", unit, type, type);
+
+    if (!s_gen_needs_free(info)) {
+        s_gen_line(g, 1, "(void) data;");
+        s_gen_line(g, 1, "(void) allocator;");
+        s_gen_line(g, 1, "(void) user_data;");
+        s_gen_line(g, 0, "}");
+        s_gen_line(g, 0, "");
+        return;
+    }
+
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        const char* name = field->name;
+        s_gen_field_kind kind = s_gen_kind(field);
+        bool is_dynamic = s_gen_is_dynamic(field);
+        bool sub_needs_free = field->struct_type_info &&
+                              s_gen_needs_free(field->struct_type_info);
+
+        if (kind == S_GEN_FIELD_STRUCT && !sub_needs_free)
+            continue;
+
+        if ((kind == S_GEN_FIELD_ARRAY && !is_dynamic) ||
+            (kind == S_GEN_FIELD_STRUCT_ARRAY && !is_dynamic &&
+             !sub_needs_free))
+            continue;
+
+        if (kind != S_GEN_FIELD_STRING && kind != S_GEN_FIELD_STRUCT &&
+            kind != S_GEN_FIELD_ARRAY && kind != S_GEN_FIELD_STRUCT_ARRAY)
+            continue;
+
+        int indent = s_gen_begin_field(g, field, 1);
+
+        switch (kind) {
+        case S_GEN_FIELD_STRING:
+        case S_GEN_FIELD_ARRAY: {
+            s_gen_line(g, indent, "if (data->%s)", name);
+            s_gen_line(g, indent + 1, "allocator->deallocate((void*) "
+                                      "data->%s, user_data);", name);
+            s_gen_line(g, indent, "data->%s = NULL;", name);
+        } break;
+        case S_GEN_FIELD_STRUCT: {
+            s_gen_line(g, indent, "%s_free_%s(&data->%s, allocator, "
+                                  "user_data);", unit,
+                       field->struct_type_info->type_name, name);
+        } break;
+        case S_GEN_FIELD_STRUCT_ARRAY: {
+            s_gen_line(g, indent, "{");
+
+            if (sub_needs_free) {
+                s_gen_count(g, field, indent + 1);
+
+                // dynamic arrays may be NULL
+                if (is_dynamic)
+                    s_gen_line(g, indent + 1, "for (uint32_t i = 0; data->%s "
+                                              "&& i < count; i++)", name);
+                else
+                    s_gen_line(g, indent + 1, "for (uint32_t i = 0; i < count;"
+                                              " i++)");
+
+                s_gen_line(g, indent + 2, "%s_free_%s(&data->%s[i], "
+                                          "allocator, user_data);", unit,
+                           field->struct_type_info->type_name, name);
+            }
+
+            if (is_dynamic) {
+                s_gen_line(g, indent + 1, "if (data->%s)", name);
+                s_gen_line(g, indent + 2, "allocator->deallocate(data->%s, "
+                                          "user_data);", name);
+                s_gen_line(g, indent + 1, "data->%s = NULL;", name);
+            }
+
+            s_gen_line(g, indent, "}");
+        } break;
+        default:
+            break;
+        }
+
+        s_gen_end_field(g, field, 1);
+    }
+
+    // sizes of released arrays are zeroed last, they may be shared
+    for (size_t i = 0; i < info->field_count; i++) {
+        const s_field_info* field = &info->fields[i];
+        bool is_duplicate = false;
+
+        if (field->type != FIELD_TYPE_ARRAY || !s_gen_is_dynamic(field))
+            continue;
+
+        for (size_t j = 0; j < i; j++) {
+            is_duplicate |=
+                info->fields[j].type == FIELD_TYPE_ARRAY &&
+                s_gen_is_dynamic(&info->fields[j]) &&
+                info->fields[j].array_field_info.size_field_offset ==
+                    field->array_field_info.size_field_offset;
+        }
+
+        if (is_duplicate)
+            continue;
+
+        int indent = s_gen_begin_field(g, field, 1);
+        s_gen_line(g, indent, "memset((uint8_t*) data + %zu, 0, %zu);",
+                   field->array_field_info.size_field_offset,
+                   field->array_field_info.size_field_size);
+        s_gen_end_field(g, field, 1);
+    }
+
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+static void s_gen_public(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    const char* type = info->type_name;
+
+    s_gen_line(g, 0, "s_serializer_error %s_size_%s(const %s* data, "
+                     "size_t* size) {", unit, type, type);
+    s_gen_line(g, 1, "if (!data || !size)");
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return %s_measure_%s(data, size) ? SERIALIZER_OK",
+               unit, type);
+    s_gen_line(g, 1, "                                 : "
+                     "SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+
+    s_gen_line(g, 0, "s_serializer_error %s_encode_%s(const %s* data, "
+                     "uint8_t* buffer,", unit, type, type);
+    s_gen_line(g, 1, "size_t buffer_size, size_t* bytes_written) {");
+    s_gen_line(g, 1, "size_t size = 0;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "if (!data || !buffer || !bytes_written ||");
+    s_gen_line(g, 2, "!%s_measure_%s(data, &size))", unit, type);
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "// single bounds check, writes below are unchecked");
+    s_gen_line(g, 1, "if (buffer_size < size)");
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_BUFFER_TOO_SMALL;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "*bytes_written = (size_t) (%s_write_%s(data, buffer) - "
+                     "buffer);", unit, type);
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return SERIALIZER_OK;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+
+    s_gen_line(g, 0, "s_serializer_error %s_decode_%s(%s* data, "
+                     "const uint8_t* buffer,", unit, type, type);
+    s_gen_line(g, 1, "size_t buffer_size, s_allocator* allocator, "
+                     "void* user_data) {");
+    s_gen_line(g, 1, "if (!data || !buffer || !allocator)");
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return %s_read_%s(data, buffer, buffer + buffer_size, "
+                     "true, allocator,", unit, type);
+    s_gen_line(g, 1, "       user_data)");
+    s_gen_line(g, 2, "? SERIALIZER_OK");
+    s_gen_line(g, 2, ": SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+
+    s_gen_line(g, 0, "s_serializer_error %s_to_json_%s("
+                     "s_deserialize_options opts,", unit, type);
+    s_gen_line(g, 1, "const %s* data, char* out, size_t out_size) {", type);
+    s_gen_line(g, 1, "char chunk[S_JSON_CHUNK_SIZE];");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "if (!data || (!out && !opts.json_sink))");
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_INVALID_TYPE;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "if (!opts.json_sink && !out_size)");
+    s_gen_line(g, 2, "return SERIALIZER_ERROR_BUFFER_TOO_SMALL;");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "s_json_writer w = {");
+    s_gen_line(g, 2, ".data = opts.json_sink ? chunk : out,");
+    s_gen_line(g, 2, ".length = 0,");
+    s_gen_line(g, 2, ".capacity = opts.json_sink ? sizeof(chunk) : "
+                     "out_size,");
+    s_gen_line(g, 2, ".base64_blobs = opts.json_base64_blobs,");
+    s_gen_line(g, 2, ".sink = opts.json_sink,");
+    s_gen_line(g, 2, ".sink_data = opts.json_sink_data,");
+    s_gen_line(g, 2, ".err = SERIALIZER_OK,");
+    s_gen_line(g, 1, "};");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "w.data[0] = '\\0';");
+    s_gen_line(g, 1, "%s_json_%s(&w, data);", unit, type);
+    s_gen_line(g, 1, "s_json_flush(&w);");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 1, "return w.err;");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+static void s_gen_hooks(s_gen* g, const s_type_info* info) {
+    const char* unit = g->unit;
+    const char* type = info->type_name;
+
+    s_gen_line(g, 0, "static s_serializer_error %s_encode_any_%s(const void* "
+                     "data, uint8_t* buffer,", unit, type);
+    s_gen_line(g, 1, "size_t buffer_size, size_t* bytes_written) {");
+    s_gen_line(g, 1, "return %s_encode_%s((const %s*) data, buffer, "
+                     "buffer_size,", unit, type, type);
+    s_gen_line(g, 1, "       bytes_written);");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+    s_gen_line(g, 0, "static s_serializer_error %s_decode_any_%s(void* data, "
+                     "const uint8_t* buffer,", unit, type);
+    s_gen_line(g, 1, "size_t buffer_size, s_allocator* allocator, "
+                     "void* user_data) {");
+    s_gen_line(g, 1, "return %s_decode_%s((%s*) data, buffer, buffer_size, "
+                     "allocator,", unit, type, type);
+    s_gen_line(g, 1, "       user_data);");
+    s_gen_line(g, 0, "}");
+    s_gen_line(g, 0, "");
+}
+
+int sss_gen_write(FILE* source, FILE* header, const char* unit,
+                  const char* include, const s_type_info* const* types,
+                  size_t n_types) {
+    s_gen g = {.out = header, .unit = unit};
+
+    for (size_t i = 0; i < n_types; i++) {
+        if (!types[i]) {
+            s_gen_fail(&g, "type %zu has no type info", i);
+            continue;
+        }
+
+        s_gen_add_type(&g, types[i]);
+    }
+
+    if (g.err)
+        return g.err;
+
+    // header
+    s_gen_line(&g, 0, "/* Generated by sss-gen, do not edit. */");
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#ifndef __SSS_GEN_%s_H__", unit);
+    s_gen_line(&g, 0, "#define __SSS_GEN_%s_H__", unit);
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#include \"%s\"", include);
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#include <sss/sss.h>");
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "// makes s_serialize and s_deserialize use generated "
+                      "code of");
+    s_gen_line(&g, 0, "// %s", types[0]->type_name);
+
+    for (size_t i = 1; i < n_types; i++)
+        s_gen_line(&g, 0, "// %s", types[i]->type_name);
+
+    s_gen_line(&g, 0, "void %s_register(void);", unit);
+    s_gen_line(&g, 0, "");
+
+    for (size_t i = 0; i < g.n_types; i++) {
+        s_gen_prototypes(&g, g.types[i], false);
+        s_gen_line(&g, 0, "");
+    }
+
+    s_gen_line(&g, 0, "#endif");
+
+    // source
+    g.out = source;
+    s_gen_line(&g, 0, "/* Generated by sss-gen, do not edit. */");
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#include \"%s.h\"", unit);
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#include <sss/json.h>");
+    s_gen_line(&g, 0, "");
+    s_gen_line(&g, 0, "#include <stddef.h>");
+    s_gen_line(&g, 0, "#include <string.h>");
+    s_gen_line(&g, 0, "");
+    fputs(k_prelude, source);
+    s_gen_line(&g, 0, "");
+
+    // layout the code was generated for
+    for (size_t i = 0; i < g.n_types; i++) {
+        const s_type_info* info = g.types[i];
+
+        s_gen_line(&g, 0, "_Static_assert(sizeof(%s) == %zu, \"%s changed, "
+                          "regenerate\");", info->type_name, info->type_size,
+                   info->type_name);
+
+        for (size_t j = 0; j < info->field_count; j++)
+            s_gen_line(&g, 0, "_Static_assert(offsetof(%s, %s) == %zu, "
+                              "\"%s changed, regenerate\");", info->type_name,
+                       info->fields[j].name, info->fields[j].offset,
+                       info->type_name);
+    }
+
+    s_gen_line(&g, 0, "");
+
+    for (size_t i = 0; i < g.n_types; i++)
+        s_gen_prototypes(&g, g.types[i], true);
+
+    s_gen_line(&g, 0, "");
+
+    for (size_t i = 0; i < g.n_types; i++) {
+        s_gen_measure(&g, g.types[i]);
+        s_gen_write(&g, g.types[i]);
+        s_gen_read(&g, g.types[i]);
+        s_gen_json(&g, g.types[i]);
+        s_gen_free(&g, g.types[i]);
+        s_gen_public(&g, g.types[i]);
+    }
+
+    for (size_t i = 0; i < n_types; i++)
+        s_gen_hooks(&g, types[i]);
+
+    s_gen_line(&g, 0, "void %s_register(void) {", unit);
+
+    for (size_t i = 0; i < n_types; i++) {
+        const char* type = types[i]->type_name;
+
+        s_gen_line(&g, 1, "S_GET_STRUCT_TYPE_INFO(%s)->encode = "
+                          "%s_encode_any_%s;", type, unit, type);
+        s_gen_line(&g, 1, "S_GET_STRUCT_TYPE_INFO(%s)->decode = "
+                          "%s_decode_any_%s;", type, unit, type);
+    }
+
+    s_gen_line(&g, 0, "}");
+
+    if (ferror(source) || ferror(header)) {
+        s_gen_fail(&g, "failed to write output");
+        return g.err;
+    }
+
+    return g.err;
+}
+
+int sss_gen_main(int argc, char** argv, const s_type_info* const* types,
+                 size_t n_types) {
+    const char* output = NULL;
+    const char* unit = NULL;
+    const char* include = NULL;
+
+    for (int i = 1; i + 1 < argc; i += 2) {
+        if (!strcmp(argv[i], "--output"))
+            output = argv[i + 1];
+        else if (!strcmp(argv[i], "--name"))
+            unit = argv[i + 1];
+        else if (!strcmp(argv[i], "--include"))
+            include = argv[i + 1];
+    }
+
+    if (!output || !unit || !include || !n_types) {
+        fprintf(stderr, "usage: %s --output <dir> --name <unit> "
+                        "--include <header>\n",
+                argv[0]);
+        return 1;
+    }
+
+    char source_path[S_GEN_MAX_PATH], header_path[S_GEN_MAX_PATH];
+
+    snprintf(source_path, sizeof(source_path), "%s/%s.c", output, unit);
+    snprintf(header_path, sizeof(header_path), "%s/%s.h", output, unit);
+
+    FILE* source = fopen(source_path, "w");
+    FILE* header = fopen(header_path, "w");
+    int err = 1;
+
+    if (source && header)
+        err = sss_gen_write(source, header, unit, include, types, n_types);
+    else
+        fprintf(stderr, "sss-gen: can't open output in %s\n", output);
+
+    if (source)
+        fclose(source);
+    if (header)
+        fclose(header);
+
+    if (err) {
+        remove(source_path);
+        remove(header_path);
+    }
+
+    return err;
+}
@@ -0,0 +1,41 @@
+/*
+ * Created on Mon Oct 19 2026
+ *
+ * Author: Peter Gusev
+ * Copyright (c) 2025 Peter Gusev. All rights reserved.
+ */
+
+#ifndef __SSS_GEN_H__
+#define __SSS_GEN_H__
+
+#include <sss/sss.h>
+
+#include <stdio.h>
+
+// Offline code generator: writes C sources with unrolled codecs of structs
+// described by type info. For every struct type reachable from types, named
+// <unit>_<op>_<type>:
+//
+//   size     -- encoded size, wire format v1 without field ids
+//   encode   -- same output as s_serialize with default options
+//   decode   -- reads that output, anything else is refused so that
+//               s_deserialize can fall back to generic decoding
+//   to_json  -- same output as s_to_json
+//   free     -- releases strings and dynamic arrays of decoded struct
+//
+// and <unit>_register(), which sets encode/decode hooks of types so that
+// s_serialize and s_deserialize use generated code. Output includes header,
+// which has to declare the types and their type info.
+//
+// Returns 0 on success, error is printed to stderr.
+int sss_gen_write(FILE* source, FILE* header, const char* unit,
+                  const char* include, const s_type_info* const* types,
+                  size_t n_types);
+
+// Command line front end: sss_gen_main(argc, argv, types, n_types) writes
+// <dir>/<unit>.c and <dir>/<unit>.h for
+//   --output <dir> --name <unit> --include <header>
+int sss_gen_main(int argc, char** argv, const s_type_info* const* types,
+                 size_t n_types);
+
+#endif